@@ -5,6 +5,7 @@
 #include "etharden.h"
 #include "pass/chunkpass.h"
 #include "pass/stackxor.h"
+#include "pass/devirtualize.h"
 #include "pass/endbradd.h"
 #include "pass/endbrenforce.h"
 #include "pass/shadowstack.h"
@@ -13,6 +14,10 @@
 #include "pass/profilesave.h"
 #include "pass/condwatchpoint.h"
 #include "pass/retpoline.h"
+#include "pass/inlinecalls.h"
+#include "pass/peephole.h"
+#include "pass/schedule.h"
+#include "analysis/manager.h"
 #include "log/registry.h"
 #include "log/temp.h"
 
@@ -45,11 +50,9 @@ void HardenApp::generate(const std::string &output, bool oneToOne) {
 void HardenApp::doCFI() {
     auto program = getProgram();
     std::cout << "Adding endbr CFI...\n";
-    EndbrAddPass endbradd;
-    program->accept(&endbradd);
-
-    EndbrEnforcePass endbrEnforce;
-    program->accept(&endbrEnforce);
+    RUN_PASS(DevirtualizePass(), program);
+    RUN_PASS(EndbrAddPass(), program);
+    RUN_PASS(EndbrEnforcePass(), program);
 }
 
 void HardenApp::doShadowStack(bool gsMode) {
@@ -58,9 +61,9 @@ void HardenApp::doShadowStack(bool gsMode) {
     auto program = getProgram();
 
     std::cout << "Adding shadow stack...\n";
-    ShadowStackPass shadowStack(gsMode
-        ? ShadowStackPass::MODE_GS : ShadowStackPass::MODE_CONST);
-    program->accept(&shadowStack);
+    RUN_PASS(ShadowStackPass(gsMode
+        ? ShadowStackPass::MODE_GS : ShadowStackPass::MODE_CONST,
+        elideChecks), program);
 }
 
 void HardenApp::doPermuteData() {
@@ -69,10 +72,12 @@ void HardenApp::doPermuteData() {
     RUN_PASS(PermuteDataPass(), program);
 }
 
-void HardenApp::doProfiling() {
-    std::cout << "Adding function profiling...\n";
+void HardenApp::doProfiling(bool edges) {
+    std::cout << "Adding " << (edges ? "edge" : "function") << " profiling...\n";
     auto program = getProgram();
-    RUN_PASS(ProfileInstrumentPass(), program);
+    RUN_PASS(ProfileInstrumentPass(edges
+        ? ProfileInstrumentPass::MODE_EDGE : ProfileInstrumentPass::MODE_FUNCTION),
+        program);
     RUN_PASS(ProfileSavePass(), program);
 }
 
@@ -91,6 +96,51 @@ void HardenApp::doRetpolines() {
     }
 }
 
+void HardenApp::doInlining(bool oneToOne) {
+    if(oneToOne) {
+        std::cout << "Not inlining calls: this needs union output (-u)\n";
+        return;
+    }
+    std::cout << "Inlining small library functions...\n";
+    auto program = getProgram();
+    RUN_PASS(InlineCallsPass(), program);
+}
+
+void HardenApp::doPeephole() {
+    std::cout << "Removing redundant instructions...\n";
+    auto program = getProgram();
+    PeepholePass peephole;
+    program->accept(&peephole);
+    AnalysisManager::getInstance()->passFinished(&peephole);
+    peephole.printReport(std::cout);
+}
+
+static std::set<Instruction *> getAllInstructions(Program *program) {
+    std::set<Instruction *> instrList;
+    for(auto module : CIter::children(program)) {
+        for(auto function : CIter::functions(module)) {
+            for(auto block : CIter::children(function)) {
+                for(auto instr : CIter::children(block)) {
+                    instrList.insert(instr);
+                }
+            }
+        }
+    }
+    return instrList;
+}
+
+void HardenApp::doSchedule(const std::set<Instruction *> &originalList) {
+    std::cout << "Scheduling instrumentation into idle cycles...\n";
+    auto program = getProgram();
+
+    // everything the techniques added gets the lowest priority
+    std::set<Instruction *> deferList;
+    for(auto instr : getAllInstructions(program)) {
+        if(!originalList.count(instr)) deferList.insert(instr);
+    }
+    RUN_PASS(InstructionSchedulePass(deferList), program);
+}
+
 static void printUsage(const char *program) {
     std::cout << "Usage: " << program << " [options] [mode] input-file output-file\n"
         "    Transforms an executable by adding CFI and a shadow stack.\n"
@@ -100,6 +150,8 @@ static void printUsage(const char *program) {
         "    -q     Quiet mode (default), suppress logging messages\n"
         "    -m     Perform mirror elf generation (1-1 output)\n"
         "    -u     Perform union elf generation (merged output)\n"
+        "    -e     Elide redundant shadow stack checks: skip leaf functions\n"
+        "           that cannot overwrite their return address\n"
         "\n"
         "Modes:\n"
         "    --nop          No transformation (default)\n"
@@ -114,12 +166,22 @@ static void printUsage(const char *program) {
         "        --cet-const     Constant offset shadow stack implementation\n"
         "    --permute-data Randomize order of global variables in .data\n"
         "    --profile      Add profiling counters to each function\n"
+        "        --profile-edges Count control-flow edges within functions\n"
         "    --cond-watchpoint   Add conditional watchpoints for GDB\n"
+        "    --inline       Inline tiny leaf functions called across modules\n"
+        "                   (union output only)\n"
+        "    --peephole     Remove redundant moves, push/pop pairs and jumps\n"
+        "                   after all other modes\n"
+        "    --schedule     Reorder instructions within blocks so that added\n"
+        "                   instrumentation fills idle cycles, after all\n"
+        "                   other modes\n"
         "Note: the EGALITO_DEBUG variable is also honoured.\n";
 }
 
 void HardenApp::run(int argc, char **argv) {
     bool oneToOne = true;
+    bool peephole = false;
+    bool schedule = false;
     std::vector<std::string> ops;
 
     const struct {
@@ -134,6 +196,8 @@ void HardenApp::run(int argc, char **argv) {
         {"-m", [&oneToOne] () { oneToOne = true; }},
         {"-u", [&oneToOne] () { oneToOne = false; }},
 
+        {"-e", [this] () { elideChecks = true; }},
+
         {"--nop",           [&ops] () { }},
         {"--retpolines",    [&ops] () { ops.push_back("retpolines"); }},
         {"--cfi",           [&ops] () { ops.push_back("cfi"); }},
@@ -146,7 +210,13 @@ void HardenApp::run(int argc, char **argv) {
         {"--cet-const",     [&ops] () { ops.push_back("cet-const"); }},
         {"--permute-data",  [&ops] () { ops.push_back("permute-data"); }},
         {"--profile",       [&ops] () { ops.push_back("profile"); }},
+        {"--profile-edges", [&ops] () { ops.push_back("profile-edges"); }},
         {"--cond-watchpoint", [&ops] () { ops.push_back("cond-watchpoint"); }},
+        // before any other technique, so that they see the inlined code
+        {"--inline",        [&ops] () { ops.insert(ops.begin(), "inline"); }},
+        // after every other technique, so that it sees what they added
+        {"--peephole",      [&peephole] () { peephole = true; }},
+        {"--schedule",      [&schedule] () { schedule = true; }},
     };
 
     std::map<std::string, std::function<void ()>> techniques = {
@@ -157,9 +227,11 @@ void HardenApp::run(int argc, char **argv) {
         {"cet-gs",          [this] () { doShadowStack(true); doCFI(); }},
         {"cet-const",       [this] () { doShadowStack(false); doCFI(); }},
         {"permute-data",    [this] () { doPermuteData(); }},
-        {"profile",         [this] () { doProfiling(); }},
+        {"profile",         [this] () { doProfiling(false); }},
+        {"profile-edges",   [this] () { doProfiling(true); }},
         {"cond-watchpoint", [this] () { doWatching(); }},
         {"retpolines",      [this] () { doRetpolines(); }},
+        {"inline",          [this, &oneToOne] () { doInlining(oneToOne); }},
     };
 
     for(int a = 1; a < argc; a ++) {
@@ -179,9 +251,23 @@ void HardenApp::run(int argc, char **argv) {
         }
         else if(argv[a] && argv[a + 1]) {
             parse(argv[a], oneToOne);
+            std::set<Instruction *> originalList;
+            bool haveOriginal = false;
             for(auto op : ops) {
+                // inlined code is not instrumentation
+                if(schedule && !haveOriginal && op != "inline") {
+                    originalList = getAllInstructions(getProgram());
+                    haveOriginal = true;
+                }
                 techniques[op]();
             }
+            if(peephole) doPeephole();
+            if(schedule) {
+                if(!haveOriginal) originalList = getAllInstructions(getProgram());
+                doSchedule(originalList);
+            }
+            // all techniques share cached analyses through AnalysisManager
+            if(!quiet) AnalysisManager::getInstance()->dumpStatistics();
             generate(argv[a + 1], oneToOne);
             break;
         }
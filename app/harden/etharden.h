@@ -1,14 +1,16 @@
 #ifndef EGALITO_APP_HARDEN_H
 #define EGALITO_APP_HARDEN_H
 
+#include <set>
 #include "conductor/interface.h"
 
 class HardenApp {
 private:
     bool quiet;
+    bool elideChecks;
     EgalitoInterface *egalito;
 public:
-    HardenApp() : quiet(true) {}
+    HardenApp() : quiet(true), elideChecks(false) {}
     void run(int argc, char **argv);
     void parse(const std::string &filename, bool oneToOne);
     void generate(const std::string &filename, bool oneToOne);
@@ -17,9 +19,12 @@ private:
     void doCFI();
     void doShadowStack(bool gsMode);
     void doPermuteData();
-    void doProfiling();
+    void doProfiling(bool edges);
     void doWatching();
     void doRetpolines();
+    void doInlining(bool oneToOne);
+    void doPeephole();
+    void doSchedule(const std::set<Instruction *> &originalList);
 };
 
 #endif
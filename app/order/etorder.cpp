@@ -10,8 +10,15 @@
 #include <cstring>  // for std::strcmp
 #include "etorder.h"
 #include "conductor/interface.h"
-#include "chunk/function.h"
+#include "analysis/calllayout.h"
+#include "analysis/manager.h"
+#include "chunk/concrete.h"
+#include "instr/concrete.h"
 #include "operation/find2.h"
+#include "pass/blockreorder.h"
+#include "pass/jumpthread.h"
+#include "pass/permutedata.h"
+#include "transform/alignment.h"
 
 #undef DEBUG_GROUP
 #define DEBUG_GROUP load
@@ -24,28 +31,68 @@ static unsigned long getBucket(unsigned long count) {
     return value <= 3 ? 0 : value;
 }
 
-static std::vector<Function *> parseOrder(Conductor *conductor, Module *module,
+struct ProfileData {
+    std::map<Function *, unsigned long> functionCount;
+    // keyed by block offsets, only for functions with edge profiles
+    std::map<Function *, BlockReorderPass::BlockCountMap> blockCount;
+    std::map<Function *, BlockReorderPass::EdgeCountMap> edgeCount;
+};
+
+static ProfileData readProfile(Conductor *conductor, Module *module,
     const std::string &orderFile) {
 
     std::ifstream file(orderFile.c_str());
     std::string line;
-    std::map<Function *, unsigned long> data;
+    ProfileData data;
+    Function *current = nullptr;
+    std::vector<address_t> blockOffset;  // of current, by block index
     while(std::getline(file, line)) {
         std::istringstream stream(line);
 
         unsigned long count = 0;
         std::string nameToken;
-        if(stream >> count >> nameToken
-            && nameToken[0] == '[' && nameToken[nameToken.length() - 1] == ']') {
-            
+        if(!(stream >> count >> nameToken)) continue;
+
+        if(nameToken[0] == '[' && nameToken[nameToken.length() - 1] == ']') {
             nameToken = nameToken.substr(1, nameToken.length() - 2);
-            auto f = ChunkFind2(conductor).findFunctionInModule(nameToken.c_str(), module);
-            if(f) {
-                data.insert(std::make_pair(f, getBucket(count)));
-                LOG(0, "count " << f->getName() << " = " << getBucket(count));
+            current = ChunkFind2(conductor).findFunctionInModule(
+                nameToken.c_str(), module);
+            blockOffset.clear();
+            if(current) {
+                data.functionCount[current] = count;
+                LOG(0, "count " << current->getName() << " = " << count);
+            }
+        }
+        else if(nameToken == "block" && current) {
+            // etprofile's edge summary: "count block index at +0xoffset"
+            std::string index, at, offset;
+            if(stream >> index >> at >> offset && offset.size() > 1) {
+                blockOffset.push_back(std::stoul(offset.substr(1), 0, 16));
+                data.blockCount[current][blockOffset.back()] = count;
+            }
+        }
+        else if(nameToken == "edge" && current) {
+            // "count edge from -> to", where to may be "exit"
+            size_t from, to;
+            std::string arrow;
+            if(stream >> from >> arrow >> to
+                && from < blockOffset.size() && to < blockOffset.size()) {
+
+                data.edgeCount[current][std::make_pair(
+                    blockOffset[from], blockOffset[to])] = count;
             }
         }
     }
+    return data;
+}
+
+static std::vector<Function *> orderByCount(Module *module,
+    const ProfileData &profile) {
+
+    std::map<Function *, unsigned long> data;
+    for(auto &entry : profile.functionCount) {
+        data.insert(std::make_pair(entry.first, getBucket(entry.second)));
+    }
 
     std::map<Function *, unsigned long> input;
     unsigned long index = 0;
@@ -81,8 +128,152 @@ static std::vector<Function *> parseOrder(Conductor *conductor, Module *module,
     return order;
 }
 
+static Function *getCallTarget(Instruction *instr) {
+    auto semantic = instr->getSemantic();
+    if(!dynamic_cast<ControlFlowInstruction *>(semantic)) return nullptr;
+    auto link = semantic->getLink();
+    if(!link) return nullptr;
+
+    if(auto target = dynamic_cast<Function *>(&*link->getTarget())) {
+        return target;
+    }
+    if(auto pltLink = dynamic_cast<PLTLink *>(link)) {
+        return dynamic_cast<Function *>(
+            pltLink->getPLTTrampoline()->getTarget());
+    }
+    return nullptr;
+}
+
+// Call edge weights come from block counts where there is an edge profile;
+// otherwise a call is assumed to run as often as the colder of its ends.
+static std::vector<Function *> orderByCallChains(Module *module,
+    const ProfileData &profile) {
+
+    CallChainLayout layout;
+    std::vector<Function *> functionList;
+    std::map<Function *, int> idMap;
+    for(auto func : CIter::functions(module)) {
+        auto it = profile.functionCount.find(func);
+        auto count = (it != profile.functionCount.end()) ? it->second : 0;
+        idMap[func] = layout.addFunction(func->getSize(), count);
+        functionList.push_back(func);
+    }
+
+    for(auto caller : functionList) {
+        auto blocks = profile.blockCount.find(caller);
+        bool haveBlocks = (blocks != profile.blockCount.end());
+        for(auto block : CIter::children(caller)) {
+            unsigned long blockCount = 0;
+            if(haveBlocks) {
+                auto it = blocks->second.find(
+                    block->getAddress() - caller->getAddress());
+                if(it != blocks->second.end()) blockCount = it->second;
+            }
+
+            for(auto instr : CIter::children(block)) {
+                auto callee = getCallTarget(instr);
+                if(!callee || !idMap.count(callee)) continue;
+
+                int from = idMap[caller], to = idMap[callee];
+                layout.addCall(from, to, haveBlocks ? blockCount
+                    : std::min(layout.getCount(from), layout.getCount(to)));
+            }
+        }
+    }
+
+    std::vector<Function *> order;
+    for(auto id : layout.getOrder()) {
+        order.push_back(functionList[id]);
+        LOG(1, "    [" << functionList[id]->getName() << "] count "
+            << std::dec << layout.getCount(id));
+    }
+    return order;
+}
+
+static void reorderBlocks(Module *module, const ProfileData &profile,
+    std::vector<Function *> &order) {
+
+    BlockReorderPass reorder;
+    for(auto &entry : profile.blockCount) {
+        auto edges = profile.edgeCount.find(entry.first);
+        reorder.setProfile(entry.first, entry.second,
+            edges != profile.edgeCount.end()
+                ? edges->second : BlockReorderPass::EdgeCountMap());
+    }
+    module->accept(&reorder);
+    AnalysisManager::getInstance()->passFinished(&reorder);
+
+    // the cold parts never ran, so they go last
+    for(auto cold : reorder.getColdList()) order.push_back(cold);
+}
+
+// Layout and splitting leave jumps to blocks that only jump elsewhere, and
+// jumps to small blocks that could just as well be copied in their place.
+static void threadJumps(Module *module) {
+    JumpThreadPass jumpThread;
+    module->accept(&jumpThread);
+    AnalysisManager::getInstance()->passFinished(&jumpThread);
+
+    std::cout << "threaded " << jumpThread.getThreadedCount()
+        << " jumps, duplicated " << jumpThread.getDuplicatedCount()
+        << " tail blocks (+" << jumpThread.getAddedBytes() << " bytes)\n";
+}
+
+// Whether the instruction stores to its memory operand; in AT&T order the
+// destination is the last operand.
+static bool writesMemory(Assembly *assembly) {
+    auto asmOps = assembly->getAsmOperands();
+    size_t count = asmOps->getOpCount();
+    if(count == 0) return false;
+
+    switch(assembly->getId()) {
+    case X86_INS_CMP:
+    case X86_INS_TEST:
+    case X86_INS_BT:
+    case X86_INS_PUSH:
+        return false;
+    default:
+        return asmOps->getOperands()[count - 1].type == X86_OP_MEM;
+    }
+}
+
+// Each static access to a global runs as often as its block, so the edge
+// profile's block counts give exact counts for direct accesses.
+static PermuteDataPass::AccessMap countDataAccesses(const ProfileData &profile) {
+    PermuteDataPass::AccessMap accesses;
+    for(auto &entry : profile.blockCount) {
+        auto function = entry.first;
+        for(auto block : CIter::children(function)) {
+            auto it = entry.second.find(
+                block->getAddress() - function->getAddress());
+            if(it == entry.second.end() || it->second == 0) continue;
+
+            for(auto instr : CIter::children(block)) {
+                auto linked = dynamic_cast<LinkedInstruction *>(
+                    instr->getSemantic());
+                if(!linked || !linked->getAssembly()) continue;
+                if(!dynamic_cast<DataOffsetLink *>(linked->getLink())) continue;
+                auto assembly = linked->getAssembly();
+                if(assembly->getId() == X86_INS_LEA) continue;
+
+                auto &count = accesses[linked->getLink()->getTargetAddress()];
+                if(writesMemory(&*assembly)) count.writes += it->second;
+                else count.reads += it->second;
+            }
+        }
+    }
+    return accesses;
+}
+
+static void layoutData(Module *module, const ProfileData &profile) {
+    PermuteDataPass permuteData;
+    permuteData.setAccessProfile(countDataAccesses(profile));
+    module->accept(&permuteData);
+}
+
 static void parse(const std::string &filename, const std::string &orderFile,
-    const std::string &output, bool oneToOne, bool quiet) {
+    const std::string &output, bool oneToOne, bool byCount, bool blocks,
+    bool data, bool threading, bool align, bool hugeText, bool quiet) {
 
     std::cout << "Transforming file [" << filename << "]\n";
 
@@ -110,10 +301,35 @@ static void parse(const std::string &filename, const std::string &orderFile,
         std::cout << "Performing code generation into [" << output << "]...\n";
         assert(oneToOne);
 
-        auto order = parseOrder(egalito.getConductor(), module, orderFile);
+        auto profile = readProfile(egalito.getConductor(), module, orderFile);
+        auto order = byCount ? orderByCount(module, profile)
+            : orderByCallChains(module, profile);
+        // before blocks move, since block counts are keyed by offset
+        if(data) layoutData(module, profile);
+        if(blocks) reorderBlocks(module, profile, order);
+        if(threading) threadJumps(module);
+
+        AlignmentPolicy alignment;
+        if(align) {
+            for(auto &entry : profile.functionCount) {
+                if(entry.second > 0) alignment.setHot(entry.first);
+            }
+            alignment.setHugePageText(hugeText);
+            egalito.getSetup()->setAlignmentPolicy(&alignment);
+        }
 
         egalito.generate(output, order);
 
+        if(align) {
+            egalito.getSetup()->setAlignmentPolicy(nullptr);
+            alignment.printReport(std::cout);
+            if(alignment.getHotTextEnd()) {
+                std::cout << "hot text ends at 0x" << std::hex
+                    << alignment.getHotTextEnd() << std::dec
+                    << ", preload libhugetext.so to map it on huge pages\n";
+            }
+        }
+
     }
     catch(const char *message) {
         std::cout << "Exception: " << message << std::endl;
@@ -122,13 +338,25 @@ static void parse(const std::string &filename, const std::string &orderFile,
 
 static void printUsage(const char *program) {
     std::cout << "Usage: " << program << " [options] input-file function-ordering output-file\n"
-        "    Transforms an executable to a new ELF file.\n"
+        "    Transforms an executable to a new ELF file, laying out functions\n"
+        "    according to function-ordering, the output of etprofile. Hot call\n"
+        "    chains are packed together (C3); functions that never ran go last.\n"
         "\n"
         "Options:\n"
         "    -m     Perform mirror elf generation (1-1 output)\n"
         "    -u     Perform union elf generation (merged output)\n"
         "    -v     Verbose mode, print logging messages\n"
         "    -q     Quiet mode (default), suppress logging messages\n"
+        "    -c     Order by call count only, without call-chain clustering\n"
+        "    -b     Also reorder blocks within functions and move blocks that\n"
+        "           never ran to the end (needs an edge profile)\n"
+        "    -d     Also lay out .data by access counts, frequently written\n"
+        "           variables apart from read-mostly ones (needs an edge profile)\n"
+        "    -j     Thread jumps and duplicate small tail blocks after layout\n"
+        "    -a     Align functions that ran and their inner loops, pack the\n"
+        "           others tightly, and print the padding used\n"
+        "    -H     Like -a, and also put the functions that ran in their own\n"
+        "           2MB-aligned segment, to be remapped by libhugetext.so\n"
         "Note: the EGALITO_DEBUG variable is also honoured.\n";
 }
 
@@ -139,6 +367,12 @@ int main(int argc, char *argv[]) {
     }
 
     bool oneToOne = true;
+    bool byCount = false;
+    bool blocks = false;
+    bool data = false;
+    bool threading = false;
+    bool align = false;
+    bool hugeText = false;
     bool quiet = true;
 
     struct {
@@ -152,6 +386,20 @@ int main(int argc, char *argv[]) {
         // should we show debugging log messages?
         {"-v", [&quiet] () { quiet = false; }},
         {"-q", [&quiet] () { quiet = true; }},
+
+        // how should functions be ordered?
+        {"-c", [&byCount] () { byCount = true; }},
+        {"-b", [&blocks] () { blocks = true; }},
+
+        // should data be laid out too?
+        {"-d", [&data] () { data = true; }},
+
+        // should jumps left by layout be removed?
+        {"-j", [&threading] () { threading = true; }},
+
+        // should hot code be aligned?
+        {"-a", [&align] () { align = true; }},
+        {"-H", [&align, &hugeText] () { align = true; hugeText = true; }},
     };
 
     for(int a = 1; a < argc; a ++) {
@@ -171,7 +419,8 @@ int main(int argc, char *argv[]) {
             }
         }
         else if(argv[a] && argv[a + 1] && argv[a + 2]) {
-            parse(argv[a], argv[a + 1], argv[a + 2], oneToOne, quiet);
+            parse(argv[a], argv[a + 1], argv[a + 2], oneToOne, byCount, blocks,
+                data, threading, align, hugeText, quiet);
             break;
         }
         else {
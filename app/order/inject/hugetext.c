@@ -0,0 +1,74 @@
+/* Remaps the hot text of a program laid out by etorder -H onto transparent
+ * huge pages. Preload it to enable:
+ *
+ *     LD_PRELOAD=./libhugetext.so ./program
+ *
+ * The hot text is the executable PT_LOAD segment of the main program with
+ * 2MB alignment. Its code is copied aside, the range is replaced with
+ * anonymous memory advised with MADV_HUGEPAGE, and the code is copied back
+ * before the range is made executable again. perf record then sees the range
+ * as anonymous memory, but perf stat counts are unaffected. Set
+ * EGALITO_HUGETEXT=0 to leave the text alone.
+ */
+#define _GNU_SOURCE
+#include <link.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define HUGE_PAGE_SIZE 0x200000UL
+
+static int remap(unsigned long start, unsigned long end) {
+    size_t size = end - start;
+    void *copy = mmap(NULL, size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(copy == MAP_FAILED) return -1;
+    memcpy(copy, (void *)start, size);
+
+    /* nothing in this library or in libc runs from the range meanwhile */
+    void *text = mmap((void *)start, size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+    if(text == MAP_FAILED) {
+        /* the old mapping may be gone; nothing sensible is left to run */
+        abort();
+    }
+    madvise(text, size, MADV_HUGEPAGE);
+    memcpy(text, copy, size);
+    mprotect(text, size, PROT_READ | PROT_EXEC);
+
+    munmap(copy, size);
+    return 0;
+}
+
+static int find_hot_text(struct dl_phdr_info *info, size_t size, void *data) {
+    (void)size, (void)data;
+
+    /* the main program comes first */
+    for(int i = 0; i < info->dlpi_phnum; i ++) {
+        const ElfW(Phdr) *phdr = &info->dlpi_phdr[i];
+        if(phdr->p_type != PT_LOAD || !(phdr->p_flags & PF_X)) continue;
+        if(phdr->p_align != HUGE_PAGE_SIZE) continue;
+
+        /* only whole huge pages can be backed by them */
+        unsigned long start = info->dlpi_addr + phdr->p_vaddr;
+        unsigned long end = start + phdr->p_memsz;
+        start = (start + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+        end &= ~(HUGE_PAGE_SIZE - 1);
+        if(start >= end) continue;
+
+        if(remap(start, end) < 0) {
+            fprintf(stderr, "hugetext: cannot remap 0x%lx-0x%lx\n",
+                start, end);
+        }
+    }
+    return 1;
+}
+
+__attribute__((constructor))
+static void egalito_hugetext_init(void) {
+    const char *env = getenv("EGALITO_HUGETEXT");
+    if(env && !strcmp(env, "0")) return;
+
+    dl_iterate_phdr(find_hot_text, NULL);
+}
@@ -4,14 +4,54 @@
 #include <cstring>  // for std::strlen
 #include <cstdio>
 #include "elf/elfmap.h"
+#include "analysis/edgeprofile.h"
 
 static void printUsage(const char *program) {
     std::cout << "Usage: " << program << " [options] executable\n"
         "    Summarizes profiling information from profile.data, like gprof.\n"
+        "    Edge counts are reconstructed for functions instrumented with\n"
+        "    edge profiling; edges marked * were counted directly.\n"
         "\n"
         "Note: the EGALITO_DEBUG variable is also honoured.\n";
 }
 
+static void printEdgeProfiles(ElfSection *edgeSection,
+    const std::vector<unsigned long> &count) {
+
+    char *p = reinterpret_cast<char *>(edgeSection->getReadAddress());
+    char *end = p + edgeSection->getSize();
+    for(; p < end; p += std::strlen(p) + 1) {
+        EdgeProfile profile;
+        if(!profile.decode(p)) {
+            std::printf("malformed edge profile [%s]\n", p);
+            continue;
+        }
+
+        std::vector<unsigned long> edgeCount;
+        bool complete = profile.reconstruct(count, edgeCount);
+        auto blockCount = profile.getBlockCounts(edgeCount);
+
+        std::printf("%5ld [%s]%s\n", blockCount.empty() ? 0 : blockCount[0],
+            profile.getName().c_str(), complete ? "" : " (incomplete)");
+        for(size_t i = 0; i < blockCount.size(); i ++) {
+            std::printf("%5ld     block %zu at +0x%lx\n", blockCount[i], i,
+                profile.getBlockOffset(i));
+        }
+        auto &edgeList = profile.getEdgeList();
+        for(size_t i = 0; i < edgeList.size(); i ++) {
+            if(edgeList[i].to == profile.getExitID()) {
+                std::printf("%5ld     edge %d -> exit%s\n", edgeCount[i],
+                    edgeList[i].from, edgeList[i].counter >= 0 ? " *" : "");
+            }
+            else {
+                std::printf("%5ld     edge %d -> %d%s\n", edgeCount[i],
+                    edgeList[i].from, edgeList[i].to,
+                    edgeList[i].counter >= 0 ? " *" : "");
+            }
+        }
+    }
+}
+
 int main(int argc, char *argv[]) {
     if(argc < 2) {
         printUsage(argv[0] ? argv[0] : "etprofile");
@@ -33,11 +73,16 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    // edge counters are summarized per function below
     char *p = reinterpret_cast<char *>(nameSection->getReadAddress());
     for(size_t i = 0; i < count.size(); i ++) {
-        std::printf("%5ld [%s]\n", count[i], p);
+        if(!std::strchr(p, '#')) std::printf("%5ld [%s]\n", count[i], p);
         p += std::strlen(p) + 1;
     }
 
+    if(auto edgeSection = elf->findSection(".profiling.edges")) {
+        printEdgeProfiles(edgeSection, count);
+    }
+
     return 0;
 }
@@ -6,10 +6,50 @@
 #include "chunk/chunkfwd.h"
 #include "chunk/dump.h"
 #include "chunk/visitor.h"
+#include "chunk/concrete.h"
+#include "analysis/loops.h"
+#include "analysis/manager.h"
 #include "types.h"
 
 using namespace boost::python;
 
+template <typename Type>
+static list makeList(const std::vector<Type *> &vector) {
+    list result;
+    for(auto element : vector) result.append(ptr(element));
+    return result;
+}
+
+static list getLoops(Function *function) {
+    auto forest = AnalysisManager::getInstance()->getLoopForest(function);
+    return makeList(forest->getLoopList());
+}
+
+static Loop *getInnermostLoop(Function *function, Block *block) {
+    auto forest = AnalysisManager::getInstance()->getLoopForest(function);
+    return forest->getLoopFor(block);
+}
+
+static int getLoopDepth(Function *function, Block *block) {
+    auto forest = AnalysisManager::getInstance()->getLoopForest(function);
+    return forest->getDepth(block);
+}
+
+static address_t getBlockAddress(Block *block) { return block->getAddress(); }
+
+static list getLoopHeaders(Loop *loop) { return makeList(loop->getHeaderList()); }
+static list getLoopLatches(Loop *loop) { return makeList(loop->getLatchList()); }
+static list getLoopBlocks(Loop *loop) { return makeList(loop->getBlockList()); }
+static list getLoopChildren(Loop *loop) { return makeList(loop->getChildList()); }
+
+static list getLoopExits(Loop *loop) {
+    list result;
+    for(auto edge : loop->getExitList()) {
+        result.append(make_tuple(ptr(edge.first), ptr(edge.second)));
+    }
+    return result;
+}
+
 BOOST_PYTHON_MODULE(python_egalito) {
     register_exception_translator<const char *>([] (const char *s) {
         PyErr_SetString(PyExc_RuntimeError, s);
@@ -41,6 +81,30 @@ BOOST_PYTHON_MODULE(python_egalito) {
 		.def("get_name", &Function::getName)
 		.def("accept",  &Function::accept);
 
+	class_<Block, boost::noncopyable>("Block", no_init)
+		.def("get_name",    &Block::getName)
+		.def("get_address", &getBlockAddress);
+
+	class_<Loop, boost::noncopyable>("Loop", no_init)
+		.def("get_header",     &Loop::getHeader,
+            return_value_policy<reference_existing_object>())
+		.def("get_headers",    &getLoopHeaders)
+		.def("get_latches",    &getLoopLatches)
+		.def("get_blocks",     &getLoopBlocks)
+		.def("get_exits",      &getLoopExits)
+		.def("get_children",   &getLoopChildren)
+		.def("get_parent",     &Loop::getParent,
+            return_value_policy<reference_existing_object>())
+		.def("get_depth",      &Loop::getDepth)
+		.def("is_irreducible", &Loop::isIrreducible);
+
+	// results are owned by the AnalysisManager; don't keep them across
+	// transformations of the function
+	def("get_loops",          &getLoops);
+	def("get_innermost_loop", &getInnermostLoop,
+        return_value_policy<reference_existing_object>());
+	def("get_loop_depth",     &getLoopDepth);
+
 	class_<Conductor>("Conductor");
 
 	class_<ConductorSetup>("ConductorSetup")
@@ -14,6 +14,7 @@
 #include "generate/bingen.h"
 #include "operation/find.h"
 #include "operation/find2.h"
+#include "operation/findbytes.h"
 #include "pass/logcalls.h"
 #include "pass/dumptlsinstr.h"
 #include "pass/stackxor.h"
@@ -701,6 +702,41 @@ void DisassCommands::registerCommands(CompositeCommand *topLevel) {
         }
     }, "finds all endbr instruction and prints statistics");
 
+    topLevel->add("findbytes", [&] (Arguments args) {
+        args.shouldHaveAtLeast(1);
+        auto pattern = ByteScanner::parseHex(args.front());
+        if(pattern.empty()) {
+            std::cout << "expected hex bytes, e.g. f30f1efa\n";
+            return;
+        }
+
+        std::vector<Module *> moduleList;
+        if(args.size() == 1) {
+            for(auto module : CIter::modules(
+                setup->getConductor()->getProgram())) {
+
+                moduleList.push_back(module);
+            }
+        }
+        else {
+            auto module = CIter::findChild(setup->getConductor()->getProgram(),
+                args.get(1).c_str());
+            if(!module) {
+                std::cout << "No such module.\n";
+                return;
+            }
+            moduleList.push_back(module);
+        }
+
+        for(auto module : moduleList) {
+            for(auto instr : ChunkFindBytes(pattern).find(module)) {
+                std::cout << "0x" << std::hex << instr->getAddress()
+                    << " in [" << instr->getParent()->getParent()->getName()
+                    << "] of [" << module->getName() << "]\n";
+            }
+        }
+    }, "finds instructions that start with the given hex bytes");
+
     topLevel->add("endbradd", [&] (Arguments args) {
         EndbrAddPass endbradd;
         if (args.size() == 0) {
@@ -808,7 +844,12 @@ void DisassCommands::registerCommands(CompositeCommand *topLevel) {
     }, "permute data sections");
 
     topLevel->add("profileinstrument", [&] (Arguments args) {
-        ProfileInstrumentPass pass;
+        auto mode = ProfileInstrumentPass::MODE_FUNCTION;
+        if(args.size() > 0 && args.front() == "-e") {
+            mode = ProfileInstrumentPass::MODE_EDGE;
+            args = args.popFront();
+        }
+        ProfileInstrumentPass pass(mode);
         if (args.size() == 0) {
             setup->getConductor()->getProgram()->accept(&pass);
         }
@@ -821,7 +862,7 @@ void DisassCommands::registerCommands(CompositeCommand *topLevel) {
             }
             module->accept(&pass);
         }
-    }, "add profiling instrumentation");
+    }, "add profiling instrumentation, per edge with -e");
     
     topLevel->add("profilesave", [&] (Arguments args) {
         ProfileSavePass pass;
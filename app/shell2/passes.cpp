@@ -19,6 +19,7 @@
 #include "pass/collectglobals.h"
 #include "pass/debloat.h"
 #include "pass/detectnullptr.h"
+#include "pass/devirtualize.h"
 #include "pass/dumplink.h"
 #include "pass/dumptlsinstr.h"
 #include "pass/encodingcheckpass.h"
@@ -112,6 +113,8 @@ void PassCommands::makePassMap(EgalitoInterface *egalito) {
     passMap["collapseplt"] = PassContext(true, {},
         [egalito] (Chunk *chunk)
             { return new CollapsePLTPass(egalito->getConductor()); });
+    passMap["devirtualize"] = PassContext({TYPE_Program},
+        [] (Chunk *chunk) { return new DevirtualizePass(); });
     passMap["endbradd"] = PassContext(true, {},
         [] (Chunk *chunk) { return new EndbrAddPass(); });
     passMap["endbrenforce"] = PassContext(true, {},
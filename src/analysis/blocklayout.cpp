@@ -0,0 +1,82 @@
+#include <algorithm>
+#include "blocklayout.h"
+
+void BlockChainLayout::addEdge(int from, int to, unsigned long weight,
+    bool fallThrough) {
+
+    if(weight == 0 || from == to) return;
+    edgeList.push_back(Edge{from, to, weight, fallThrough});
+}
+
+std::vector<int> BlockChainLayout::getOrder(size_t *coldStart) const {
+    const int n = static_cast<int>(countList.size());
+
+    // each block starts as a chain of its own
+    std::vector<std::vector<int>> chainList(n);
+    std::vector<int> chainOf(n);
+    for(int i = 0; i < n; i ++) {
+        chainList[i].push_back(i);
+        chainOf[i] = i;
+    }
+
+    std::vector<Edge> sorted = edgeList;
+    std::stable_sort(sorted.begin(), sorted.end(),
+        [] (const Edge &a, const Edge &b) {
+            if(a.weight != b.weight) return a.weight > b.weight;
+            return a.fallThrough && !b.fallThrough;
+        });
+
+    for(const auto &edge : sorted) {
+        if(edge.to == 0) continue;  // the entry block must stay first
+
+        int a = chainOf[edge.from], b = chainOf[edge.to];
+        if(a == b) continue;
+        if(chainList[a].back() != edge.from) continue;
+        if(chainList[b].front() != edge.to) continue;
+
+        for(auto block : chainList[b]) {
+            chainList[a].push_back(block);
+            chainOf[block] = a;
+        }
+        chainList[b].clear();
+    }
+
+    auto getHottest = [this] (const std::vector<int> &chain) {
+        unsigned long hottest = 0;
+        for(auto block : chain) hottest = std::max(hottest, countList[block]);
+        return hottest;
+    };
+
+    std::vector<int> hotChains;
+    for(int i = 0; i < n; i ++) {
+        if(i == chainOf[0]) continue;
+        if(!chainList[i].empty() && getHottest(chainList[i]) > 0) {
+            hotChains.push_back(i);
+        }
+    }
+    std::stable_sort(hotChains.begin(), hotChains.end(),
+        [&] (int a, int b) {
+            return getHottest(chainList[a]) > getHottest(chainList[b]);
+        });
+
+    std::vector<int> order;
+    if(n > 0) order = chainList[chainOf[0]];
+    for(auto chain : hotChains) {
+        order.insert(order.end(), chainList[chain].begin(),
+            chainList[chain].end());
+    }
+
+    std::vector<bool> placed(n, false);
+    for(auto block : order) placed[block] = true;
+    for(int i = 0; i < n; i ++) {
+        if(!placed[i] && pinnedList[i]) {
+            order.push_back(i);
+            placed[i] = true;
+        }
+    }
+    *coldStart = order.size();
+    for(int i = 0; i < n; i ++) {
+        if(!placed[i]) order.push_back(i);
+    }
+    return order;
+}
@@ -0,0 +1,46 @@
+#ifndef EGALITO_ANALYSIS_BLOCK_LAYOUT_H
+#define EGALITO_ANALYSIS_BLOCK_LAYOUT_H
+
+#include <vector>
+
+/** Profile-guided order of the blocks of one function (bottom-up chain
+    merging, as in Pettis and Hansen).
+
+    Edges are visited from heaviest to lightest, and an edge joins two
+    chains whenever its source ends one chain and its target starts the
+    other, so that the hottest edges become fall-throughs. The chain with
+    the entry block comes first, then the other chains that ran, hottest
+    first. Blocks that never ran come last, in their original order; those
+    that are pinned (e.g. possible landing pads, which the CFG cannot see
+    entering) stay in front of the others.
+
+    Blocks are identified by their index in the original order.
+*/
+class BlockChainLayout {
+private:
+    struct Edge {
+        int from;
+        int to;
+        unsigned long weight;
+        bool fallThrough;
+    };
+private:
+    std::vector<unsigned long> countList;
+    std::vector<bool> pinnedList;
+    std::vector<Edge> edgeList;
+public:
+    BlockChainLayout(size_t blockCount)
+        : countList(blockCount, 0), pinnedList(blockCount, false) {}
+
+    void setCount(int block, unsigned long count) { countList[block] = count; }
+    void setPinned(int block) { pinnedList[block] = true; }
+    /** Ties between equal weights go to original fall-throughs. */
+    void addEdge(int from, int to, unsigned long weight, bool fallThrough);
+
+    /** Returns the new order. Blocks from index coldStart on never ran and
+        may be moved away from the rest of the function.
+    */
+    std::vector<int> getOrder(size_t *coldStart) const;
+};
+
+#endif
@@ -0,0 +1,103 @@
+#include <algorithm>
+#include "calllayout.h"
+
+#include "log/log.h"
+
+// merging must not make the caller's cluster this many times less dense
+#define MAX_DENSITY_DEGRADATION 8
+
+int CallChainLayout::addFunction(unsigned long size, unsigned long count) {
+    nodeList.push_back(Node{std::max(size, 1ul), count});
+    return static_cast<int>(nodeList.size() - 1);
+}
+
+void CallChainLayout::addCall(int caller, int callee, unsigned long weight) {
+    if(caller == callee || weight == 0) return;
+    callMap[std::make_pair(caller, callee)] += weight;
+}
+
+static double getDensity(unsigned long count, unsigned long size) {
+    return static_cast<double>(count) / size;
+}
+
+std::vector<int> CallChainLayout::getOrder() const {
+    const size_t n = nodeList.size();
+
+    // a function is at least as hot as the calls into it
+    std::vector<unsigned long> count(n);
+    std::vector<int> bestCaller(n, -1);
+    std::vector<unsigned long> bestWeight(n, 0);
+    std::vector<unsigned long> incoming(n, 0);
+    for(const auto &call : callMap) {
+        int caller = call.first.first, callee = call.first.second;
+        if(call.second > bestWeight[callee]) {
+            bestWeight[callee] = call.second;
+            bestCaller[callee] = caller;
+        }
+        incoming[callee] += call.second;
+    }
+    for(size_t i = 0; i < n; i ++) {
+        count[i] = std::max(nodeList[i].count, incoming[i]);
+    }
+
+    std::vector<Cluster> clusterList(n);
+    std::vector<int> clusterOf(n);
+    for(size_t i = 0; i < n; i ++) {
+        clusterList[i] = Cluster{{static_cast<int>(i)}, nodeList[i].size,
+            count[i]};
+        clusterOf[i] = i;
+    }
+
+    std::vector<int> hot;
+    for(size_t i = 0; i < n; i ++) {
+        if(count[i] > 0) hot.push_back(i);
+    }
+    std::stable_sort(hot.begin(), hot.end(),
+        [&count] (int a, int b) { return count[a] > count[b]; });
+
+    for(auto f : hot) {
+        int caller = bestCaller[f];
+        if(caller < 0 || count[caller] == 0) continue;
+
+        auto &into = clusterList[clusterOf[caller]];
+        auto &from = clusterList[clusterOf[f]];
+        if(&into == &from) continue;
+        if(into.size + from.size > clusterLimit) continue;
+
+        double merged = getDensity(into.count + from.count,
+            into.size + from.size);
+        if(getDensity(into.count, into.size)
+            > merged * MAX_DENSITY_DEGRADATION) continue;
+
+        LOG(10, "C3: appending cluster of " << f << " after caller " << caller);
+        for(auto member : from.members) {
+            into.members.push_back(member);
+            clusterOf[member] = clusterOf[caller];
+        }
+        into.size += from.size;
+        into.count += from.count;
+        from.members.clear();
+    }
+
+    std::vector<const Cluster *> sorted;
+    for(const auto &cluster : clusterList) {
+        if(!cluster.members.empty() && cluster.count > 0) {
+            sorted.push_back(&cluster);
+        }
+    }
+    std::stable_sort(sorted.begin(), sorted.end(),
+        [] (const Cluster *a, const Cluster *b) {
+            return getDensity(a->count, a->size)
+                > getDensity(b->count, b->size);
+        });
+
+    std::vector<int> order;
+    for(auto cluster : sorted) {
+        order.insert(order.end(), cluster->members.begin(),
+            cluster->members.end());
+    }
+    for(size_t i = 0; i < n; i ++) {
+        if(count[i] == 0) order.push_back(i);
+    }
+    return order;
+}
@@ -0,0 +1,48 @@
+#ifndef EGALITO_ANALYSIS_CALL_LAYOUT_H
+#define EGALITO_ANALYSIS_CALL_LAYOUT_H
+
+#include <vector>
+#include <map>
+#include <utility>
+
+/** Profile-guided function ordering with the C3 heuristic (call-chain
+    clustering; Ottoni and Maher, CGO 2017).
+
+    Functions are visited from hottest to coldest, and each one's cluster
+    is appended to the cluster of its most frequent caller, as long as the
+    result stays within clusterLimit bytes and does not dilute the caller's
+    cluster too much. Clusters are then laid out by decreasing density
+    (count per byte), followed by every function that never ran, in the
+    order they were added.
+
+    Functions are identified by the index returned from addFunction().
+*/
+class CallChainLayout {
+private:
+    struct Node {
+        unsigned long size;
+        unsigned long count;
+    };
+    struct Cluster {
+        std::vector<int> members;
+        unsigned long size;
+        unsigned long count;
+    };
+private:
+    size_t clusterLimit;
+    std::vector<Node> nodeList;
+    std::map<std::pair<int, int>, unsigned long> callMap;
+public:
+    CallChainLayout(size_t clusterLimit = 0x1000)
+        : clusterLimit(clusterLimit) {}
+
+    int addFunction(unsigned long size, unsigned long count);
+    /** Repeated calls between the same pair accumulate. */
+    void addCall(int caller, int callee, unsigned long weight);
+
+    unsigned long getCount(int id) const { return nodeList[id].count; }
+
+    std::vector<int> getOrder() const;
+};
+
+#endif
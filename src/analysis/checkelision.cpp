@@ -0,0 +1,139 @@
+#include <set>
+#include "checkelision.h"
+#include "analysis/framesummary.h"
+#include "analysis/liveness.h"
+#include "analysis/manager.h"
+#include "chunk/concrete.h"
+#include "instr/concrete.h"
+#include "instr/register.h"
+
+#include "log/log.h"
+
+#ifdef ARCH_X86_64
+// in AT&T order the destination is the last operand
+static const cs_x86_op *getStoreOperand(Assembly *assembly) {
+    auto asmOps = assembly->getAsmOperands();
+    size_t count = asmOps->getOpCount();
+    if(count == 0) return nullptr;
+
+    switch(assembly->getId()) {
+    case X86_INS_CMP:
+    case X86_INS_TEST:
+    case X86_INS_BT:
+    case X86_INS_PUSH:
+    case X86_INS_NOP:
+    case X86_INS_LEA:
+        return nullptr;
+    default:
+        break;
+    }
+    auto &op = asmOps->getOperands()[count - 1];
+    return (op.type == X86_OP_MEM) ? &op : nullptr;
+}
+
+// only for instructions that do not transfer control
+static bool definesRegister(Instruction *instr, int reg) {
+    auto semantic = instr->getSemantic();
+    if(!dynamic_cast<IsolatedInstruction *>(semantic)
+        && !dynamic_cast<LinkedInstruction *>(semantic)) return false;
+    return RegisterAccess(instr).getDef().get(RegisterBitVector::getIndex(reg));
+}
+
+static bool movesStackPointer(Instruction *instr) {
+    auto id = instr->getSemantic()->getAssembly()->getId();
+    return id != X86_INS_PUSH && id != X86_INS_POP
+        && definesRegister(instr, X86_REG_RSP);
+}
+#endif
+
+bool CheckElision::isSafeLeaf(Function *function) {
+#ifdef ARCH_X86_64
+    auto summary = AnalysisManager::getInstance()->getFrameSummary(function);
+    if(!summary->isLeaf()) return false;
+
+    auto instrList = FrameSummary::getInstructionList(function);
+    // blocks that end in a return, so changes there go nowhere else
+    std::set<Block *> epilogueBlocks;
+    for(auto instr : FrameSummary::getInstructions(instrList,
+        summary->getExitList())) {
+
+        if(dynamic_cast<ReturnInstruction *>(instr->getSemantic())) {
+            epilogueBlocks.insert(static_cast<Block *>(instr->getParent()));
+        }
+    }
+
+    // the frame is only a fixed distance from the return address if
+    // nothing but the prologue, epilogue, pushes and pops move the SP, and
+    // the frame pointer only if nothing but the epilogue changes it
+    bool frameKnown = (summary->getSetSP() != FrameSummary::NONE);
+    bool framePointerKnown = (summary->getSetBP() != FrameSummary::NONE);
+    for(uint32_t i = 0; i < instrList.size(); i ++) {
+        auto instr = instrList[i];
+        auto assembly = instr->getSemantic()->getAssembly();
+        if(!assembly) continue;
+
+        if(epilogueBlocks.count(static_cast<Block *>(instr->getParent()))) {
+            continue;
+        }
+        if(i != summary->getSetSP() && movesStackPointer(instr)) {
+            frameKnown = false;
+        }
+        if(i != summary->getSetBP() && definesRegister(instr, X86_REG_RBP)) {
+            framePointerKnown = false;
+        }
+    }
+
+    uint32_t i = 0;
+    for(auto block : CIter::children(function)) {
+        bool movedSP = false;
+        bool movedBP = false;
+        for(auto instr : CIter::children(block)) {
+            uint32_t index = i ++;
+            auto assembly = instr->getSemantic()->getAssembly();
+            if(!assembly) continue;
+
+            // the prologue is in the first block, and dominates the rest
+            bool frameValid = frameKnown && !movedSP
+                && index > summary->getSetSP();
+            bool framePointerValid = framePointerKnown && !movedBP
+                && index > summary->getSetBP();
+            auto op = getStoreOperand(&*assembly);
+            if(op) {
+                auto &mem = op->mem;
+                int64_t end = mem.disp + op->size;
+                bool safe = false;
+                if(mem.index != X86_REG_INVALID
+                    || mem.segment != X86_REG_INVALID) {
+
+                    safe = false;
+                }
+                else if(mem.base == X86_REG_RIP) {
+                    safe = true;
+                }
+                else if(mem.base == X86_REG_RSP) {
+                    safe = (end <= 0) || (frameValid && mem.disp >= 0
+                        && end <= static_cast<int64_t>(
+                            summary->getFrameSize()));
+                }
+                else if(mem.base == X86_REG_RBP) {
+                    safe = framePointerValid && end <= 0;
+                }
+                if(!safe) return false;
+            }
+
+            // e.g. leave, or pop %rbp in the epilogue
+            if(index != summary->getSetSP() && movesStackPointer(instr)) {
+                movedSP = true;
+            }
+            if(index != summary->getSetBP()
+                && definesRegister(instr, X86_REG_RBP)) {
+
+                movedBP = true;
+            }
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,24 @@
+#ifndef EGALITO_ANALYSIS_CHECK_ELISION_H
+#define EGALITO_ANALYSIS_CHECK_ELISION_H
+
+class Function;
+
+/** Finds hardening checks that can be left out without weakening what
+    the hardening passes enforce (x86_64 only).
+
+    isSafeLeaf() picks functions that make no calls and whose stores
+    cannot reach their own return address: only pushes, RIP-relative
+    stores, stores below the stack or frame pointer, and stores into the
+    frame allocated by the prologue. ShadowStackPass may skip these.
+
+    Indirect branch checks are never elided: a callee may spill even a
+    callee-saved register to memory, where it can be overwritten before
+    being restored, so an earlier check of the same register proves
+    nothing once a call intervenes.
+*/
+class CheckElision {
+public:
+    static bool isSafeLeaf(Function *function);
+};
+
+#endif
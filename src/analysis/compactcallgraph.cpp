@@ -0,0 +1,213 @@
+#include <algorithm>
+#include "compactcallgraph.h"
+#include "chunk/concrete.h"
+#include "chunk/link.h"
+#include "chunk/plt.h"
+#include "instr/concrete.h"
+#include "util/parallel.h"
+
+#include "log/log.h"
+
+CompactCallGraph::CompactCallGraph(Program *program, unsigned threads) {
+    std::vector<Module *> moduleList;
+    for(auto module : CIter::children(program)) {
+        moduleList.push_back(module);
+    }
+    build(moduleList, threads);
+}
+
+CompactCallGraph::CompactCallGraph(Module *module) {
+    build(std::vector<Module *>{module}, 1);
+}
+
+void CompactCallGraph::build(const std::vector<Module *> &moduleList,
+    unsigned threads) {
+
+    // ids are handed out serially so that they follow program order
+    std::vector<IDType> firstID;
+    size_t total = 0;
+    for(auto module : moduleList) {
+        total += module->getFunctionList()->getChildren()
+            ->getIterable()->getCount();
+    }
+    functionList.reserve(total);
+    idMap.reserve(total);
+    for(auto module : moduleList) {
+        firstID.push_back(functionList.size());
+        for(auto function : CIter::functions(module)) {
+            idMap[function] = functionList.size();
+            functionList.push_back(function);
+        }
+    }
+
+    size_t moduleCount = moduleList.size();
+    std::vector<std::vector<IDType>> counts(moduleCount);
+    std::vector<std::vector<IDType>> targets(moduleCount);
+
+    parallelFor(moduleCount, threads, [&] (size_t i) {
+        collectEdges(moduleList[i], firstID[i], counts[i], targets[i]);
+    });
+
+    // each module's functions have consecutive ids, so its rows can be
+    // appended as they are
+    calleeOffset.resize(functionList.size() + 1);
+    calleeOffset[0] = 0;
+    size_t edges = 0;
+    for(auto &list : targets) edges += list.size();
+    calleeList.reserve(edges);
+    IDType id = 0;
+    for(size_t i = 0; i < moduleCount; i ++) {
+        for(auto count : counts[i]) {
+            calleeOffset[id + 1] = calleeOffset[id] + count;
+            id ++;
+        }
+        calleeList.insert(calleeList.end(),
+            targets[i].begin(), targets[i].end());
+    }
+
+    buildReverseEdges();
+    buildSccs();
+    LOG(1, "call graph: " << std::dec << getCount() << " functions, "
+        << getEdgeCount() << " edges, " << getSccCount() << " SCCs");
+}
+
+auto CompactCallGraph::getID(Function *function) const -> IDType {
+    auto it = idMap.find(function);
+    return (it != idMap.end()) ? it->second : INVALID_ID;
+}
+
+bool CompactCallGraph::isRecursive(IDType scc) const {
+    auto members = getSccMembers(scc);
+    if(members.size() > 1) return true;
+
+    auto id = *members.begin();
+    auto callees = getCallees(id);
+    return std::binary_search(callees.begin(), callees.end(), id);
+}
+
+void CompactCallGraph::collectEdges(Module *module, IDType firstID,
+    std::vector<IDType> &counts, std::vector<IDType> &targets) const {
+
+    // runs concurrently with other modules: only reads the Chunk tree and
+    // idMap, and must not log
+    std::vector<IDType> row;
+    for(auto function : CIter::functions(module)) {
+        row.clear();
+        for(auto block : CIter::children(function)) {
+            for(auto instr : CIter::children(block)) {
+                auto semantic = instr->getSemantic();
+                if(!dynamic_cast<ControlFlowInstruction *>(semantic)) continue;
+                auto link = semantic->getLink();
+                if(!link) continue;
+
+                Function *target = dynamic_cast<Function *>(
+                    &*link->getTarget());
+                if(!target) {
+                    if(auto pltLink = dynamic_cast<PLTLink *>(link)) {
+                        target = dynamic_cast<Function *>(
+                            pltLink->getPLTTrampoline()->getTarget());
+                    }
+                }
+                if(!target) continue;
+
+                auto id = getID(target);
+                if(id != INVALID_ID) row.push_back(id);
+            }
+        }
+        std::sort(row.begin(), row.end());
+        row.erase(std::unique(row.begin(), row.end()), row.end());
+        counts.push_back(row.size());
+        targets.insert(targets.end(), row.begin(), row.end());
+    }
+}
+
+void CompactCallGraph::buildReverseEdges() {
+    size_t count = getCount();
+    callerOffset.assign(count + 1, 0);
+    for(auto target : calleeList) callerOffset[target + 1] ++;
+    for(size_t i = 0; i < count; i ++) {
+        callerOffset[i + 1] += callerOffset[i];
+    }
+
+    // callers are visited in increasing order, so every row comes out sorted
+    callerList.resize(calleeList.size());
+    std::vector<IDType> cursor(callerOffset.begin(), callerOffset.end() - 1);
+    for(IDType caller = 0; caller < count; caller ++) {
+        for(auto callee : getCallees(caller)) {
+            callerList[cursor[callee] ++] = caller;
+        }
+    }
+}
+
+void CompactCallGraph::buildSccs() {
+    // iterative Tarjan; an SCC is only completed after every SCC it can
+    // reach, which gives the bottom-up numbering for free
+    const IDType UNVISITED = INVALID_ID;
+    size_t count = getCount();
+    std::vector<IDType> index(count, UNVISITED);
+    std::vector<IDType> low(count);
+    std::vector<bool> onStack(count, false);
+    std::vector<IDType> stack;
+    std::vector<std::pair<IDType, IDType>> frames;  // node, next edge
+
+    sccIndex.assign(count, INVALID_ID);
+    sccOffset.assign(1, 0);
+    sccMemberList.clear();
+    sccMemberList.reserve(count);
+
+    IDType counter = 0;
+    auto visit = [&] (IDType v) {
+        index[v] = low[v] = counter ++;
+        stack.push_back(v);
+        onStack[v] = true;
+        frames.emplace_back(v, calleeOffset[v]);
+    };
+
+    for(IDType root = 0; root < count; root ++) {
+        if(index[root] != UNVISITED) continue;
+        visit(root);
+
+        while(!frames.empty()) {
+            auto v = frames.back().first;
+            auto &edge = frames.back().second;
+            if(edge < calleeOffset[v + 1]) {
+                auto w = calleeList[edge ++];
+                if(index[w] == UNVISITED) {
+                    visit(w);  // invalidates edge
+                }
+                else if(onStack[w]) {
+                    low[v] = std::min(low[v], index[w]);
+                }
+                continue;
+            }
+
+            if(low[v] == index[v]) {
+                IDType scc = sccOffset.size() - 1;
+                IDType w;
+                do {
+                    w = stack.back();
+                    stack.pop_back();
+                    onStack[w] = false;
+                    sccIndex[w] = scc;
+                    sccMemberList.push_back(w);
+                } while(w != v);
+                sccOffset.push_back(sccMemberList.size());
+            }
+            frames.pop_back();
+            if(!frames.empty()) {
+                auto u = frames.back().first;
+                low[u] = std::min(low[u], low[v]);
+            }
+        }
+    }
+}
+
+void CompactCallGraph::dump() const {
+    for(IDType id = 0; id < getCount(); id ++) {
+        LOG(1, std::dec << id << " " << getFunction(id)->getName()
+            << " (SCC " << getScc(id) << ")");
+        for(auto callee : getCallees(id)) {
+            LOG(1, "    -> " << getFunction(callee)->getName());
+        }
+    }
+}
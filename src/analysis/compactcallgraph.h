@@ -0,0 +1,105 @@
+#ifndef EGALITO_ANALYSIS_COMPACT_CALL_GRAPH_H
+#define EGALITO_ANALYSIS_COMPACT_CALL_GRAPH_H
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+class Program;
+class Module;
+class Function;
+
+/** A whole-program call graph of direct calls (including calls through
+    the PLT), stored in compressed sparse row form.
+
+    Every Function gets a dense id in program order, so per-function
+    results can be kept in plain vectors indexed by id. Callees and callers
+    of id are contiguous, sorted, duplicate-free slices of one array each.
+    Edges are collected for each Module in parallel.
+
+    Strongly connected components are computed once. They are numbered
+    bottom-up: every SCC has a higher index than the SCCs it calls, so
+    visiting SCCs in index order sees callees before callers.
+*/
+class CompactCallGraph {
+public:
+    typedef uint32_t IDType;
+    enum : IDType {
+        INVALID_ID = ~0u
+    };
+
+    /** A read-only slice of one of the edge arrays. */
+    class IDRange {
+    private:
+        const IDType *first;
+        const IDType *last;
+    public:
+        IDRange(const IDType *first, const IDType *last)
+            : first(first), last(last) {}
+        const IDType *begin() const { return first; }
+        const IDType *end() const { return last; }
+        size_t size() const { return last - first; }
+        bool empty() const { return first == last; }
+    };
+private:
+    std::vector<Function *> functionList;
+    std::unordered_map<Function *, IDType> idMap;
+
+    std::vector<IDType> calleeOffset;   // getCount() + 1 entries
+    std::vector<IDType> calleeList;
+    std::vector<IDType> callerOffset;
+    std::vector<IDType> callerList;
+
+    std::vector<IDType> sccIndex;       // function id -> SCC
+    std::vector<IDType> sccOffset;      // getSccCount() + 1 entries
+    std::vector<IDType> sccMemberList;  // function ids grouped by SCC
+public:
+    /** Uses up to threads workers; 0 means one per hardware thread. */
+    CompactCallGraph(Program *program, unsigned threads = 0);
+    /** Only the functions of module, e.g. while it is still being parsed.
+        Calls through the PLT are left out unless already resolved.
+    */
+    CompactCallGraph(Module *module);
+
+    size_t getCount() const { return functionList.size(); }
+    size_t getEdgeCount() const { return calleeList.size(); }
+    Function *getFunction(IDType id) const { return functionList[id]; }
+    /** Returns INVALID_ID if function is not part of the program. */
+    IDType getID(Function *function) const;
+
+    IDRange getCallees(IDType id) const
+        { return slice(calleeList, calleeOffset, id); }
+    IDRange getCallers(IDType id) const
+        { return slice(callerList, callerOffset, id); }
+
+    size_t getSccCount() const { return sccOffset.size() - 1; }
+    IDType getScc(IDType id) const { return sccIndex[id]; }
+    IDRange getSccMembers(IDType scc) const
+        { return slice(sccMemberList, sccOffset, scc); }
+    /** True if the SCC has a cycle: several members, or a self call. */
+    bool isRecursive(IDType scc) const;
+
+    /** Every function id, callees before callers; SCCs are contiguous. */
+    const std::vector<IDType> &getBottomUpOrder() const
+        { return sccMemberList; }
+    /** Every function id, callers before callees. */
+    std::vector<IDType> getTopDownOrder() const
+        { return std::vector<IDType>(sccMemberList.rbegin(),
+            sccMemberList.rend()); }
+
+    void dump() const;
+private:
+    static IDRange slice(const std::vector<IDType> &list,
+        const std::vector<IDType> &offset, IDType index)
+        { return IDRange(list.data() + offset[index],
+            list.data() + offset[index + 1]); }
+
+    void build(const std::vector<Module *> &moduleList, unsigned threads);
+    void collectEdges(Module *module, IDType firstID,
+        std::vector<IDType> &counts, std::vector<IDType> &targets) const;
+    void buildReverseEdges();
+    void buildSccs();
+};
+
+#endif
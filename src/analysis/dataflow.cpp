@@ -7,31 +7,58 @@
 #include "instr/semantic.h"
 #include "instr/linked-aarch64.h"
 #include "operation/find2.h"
+#include "util/parallel.h"
 
 #include "log/log.h"
 
 void DataFlow::addUseDefFor(Function *function) {
-    auto graph = new ControlFlowGraph(function);
-    auto config = new UDConfiguration(graph);
-    auto working = new UDRegMemWorkingSet(function, graph);
-    auto usedef = new UseDef(config, working);
-
-    SccOrder order(graph);
-    order.genFull(0);
-    usedef->analyze(order.get());
-
-    flowList[function] = usedef;
-    workingList.push_back(working);
-    configList.push_back(config);
-    graphList.push_back(graph);
+    addUseDefFor(std::vector<Function *>{function}, 1);
+}
+
+void DataFlow::addUseDefFor(const std::vector<Function *> &functionList,
+    unsigned threads) {
+
+    size_t count = functionList.size();
+    std::vector<ControlFlowGraph *> graphs(count);
+    std::vector<UDConfiguration *> configs(count);
+    std::vector<UDRegMemWorkingSet *> workings(count);
+    std::vector<UseDef *> usedefs(count);
+
+    // each function only reads its own code, so this can run in parallel
+    parallelFor(count, threads, [&] (size_t i) {
+        auto function = functionList[i];
+        auto graph = new ControlFlowGraph(function);
+        auto config = new UDConfiguration(graph);
+        auto working = new UDRegMemWorkingSet(function, graph);
+        auto usedef = new UseDef(config, working);
+
+        SccOrder order(graph);
+        order.genFull(0);
+        usedef->analyze(order.get());
+
+        graphs[i] = graph;
+        configs[i] = config;
+        workings[i] = working;
+        usedefs[i] = usedef;
+    });
+
+    for(size_t i = 0; i < count; i ++) {
+        flowList[functionList[i]] = usedefs[i];
+        workingList.push_back(workings[i]);
+        configList.push_back(configs[i]);
+        graphList.push_back(graphs[i]);
+    }
 }
 
 UDRegMemWorkingSet *DataFlow::getWorkingSet(Function *function) {
+    // no insertion once every function has been added, so callers may
+    // run concurrently
     auto it = flowList.find(function);
     if(it == flowList.end()) {
         addUseDefFor(function);
+        it = flowList.find(function);
     }
-    return flowList[function]->getWorkingSet<UDRegMemWorkingSet>();
+    return it->second->getWorkingSet<UDRegMemWorkingSet>();
 }
 
 void DataFlow::adjustCallUse(
@@ -64,7 +91,7 @@ void DataFlow::adjustCallUse(
                 auto working = getWorkingSet(function);
                 auto state = working->getState(instr);
                 if(isTLSdescResolveCall(state, module)) {
-                    auto ud = flowList[function];
+                    auto ud = flowList.at(function);
                     // reg0 holds the TLS offset after return
                     for(int i = 1; i < 19; i++) {
                         LOG(10, "canceling use of " << std::dec << i);
@@ -151,7 +178,7 @@ void DataFlow::adjustUse(LiveRegister *live, Instruction *instruction,
     LOG(10, "adjusting use at " << std::hex << instruction->getAddress());
 
     auto info = live->getInfo(target);
-    auto ud = flowList[source];
+    auto ud = flowList.at(source);
     for(int i = 0; i < 19; i++) {
         if(viaTrampoline && (i == 16 || i == 17)) continue;
         if(info.get(i)) {
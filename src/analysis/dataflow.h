@@ -17,6 +17,11 @@ private:
 public:
     ~DataFlow();
     void addUseDefFor(Function *function);
+    /** Computes use-def for every function in parallel, with up to threads
+        workers (0 means one per hardware thread).
+    */
+    void addUseDefFor(const std::vector<Function *> &functionList,
+        unsigned threads = 0);
     void adjustCallUse(LiveRegister *live, Function *function, Module *module);
     void adjustPLTCallUse(LiveRegister *live, Function *function,
         Program *program);
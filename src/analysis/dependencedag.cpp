@@ -0,0 +1,670 @@
+#include <algorithm>
+#include <cstring>
+#include "dependencedag.h"
+#include "analysis/controlflow.h"
+#include "analysis/liveness.h"
+#include "chunk/concrete.h"
+#include "chunk/dump.h"
+#include "instr/concrete.h"
+#include "instr/register.h"
+
+#include "log/log.h"
+
+/** How one instruction touches memory. */
+struct MemoryAccess {
+    enum {
+        BASE_NONE = -1,
+        BASE_ABSOLUTE = -2
+    };
+    bool read;
+    bool write;
+    bool barrier;       // orders every memory access and side effect
+    bool mayFault;
+    bool known;         // base, disp and size describe the address
+    int base;
+    int64_t disp;
+    uint32_t size;
+
+    MemoryAccess() : read(false), write(false), barrier(false),
+        mayFault(false), known(false), base(BASE_NONE), disp(0), size(0) {}
+};
+
+static bool startsWith(const std::string &s, const char *prefix) {
+    return s.compare(0, std::strlen(prefix), prefix) == 0;
+}
+
+#ifdef ARCH_X86_64
+// the last (AT&T destination) operand is only read
+static bool isReadOnlyDestX86(unsigned int id) {
+    switch(id) {
+    case X86_INS_CMP:
+    case X86_INS_TEST:
+    case X86_INS_BT:
+    case X86_INS_PUSH:
+    case X86_INS_UCOMISS:
+    case X86_INS_UCOMISD:
+    case X86_INS_COMISS:
+    case X86_INS_COMISD:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool isBarrierX86(unsigned int id, const std::string &mnemonic) {
+    if(startsWith(mnemonic, "lock") || startsWith(mnemonic, "rep")) {
+        return true;
+    }
+    switch(id) {
+    case X86_INS_MFENCE:
+    case X86_INS_LFENCE:
+    case X86_INS_SFENCE:
+    case X86_INS_CPUID:
+    case X86_INS_RDTSC:
+    case X86_INS_RDTSCP:
+    case X86_INS_SYSCALL:
+    case X86_INS_INT:
+    case X86_INS_INT3:
+    case X86_INS_HLT:
+    case X86_INS_UD2:
+    case X86_INS_XCHG:
+    case X86_INS_CMPXCHG:
+    case X86_INS_XADD:
+    case X86_INS_PUSHFQ:
+    case X86_INS_POPFQ:
+    case X86_INS_STOSB:
+    case X86_INS_STOSW:
+    case X86_INS_STOSD:
+    case X86_INS_STOSQ:
+    case X86_INS_MOVSB:
+    case X86_INS_MOVSW:
+    case X86_INS_MOVSQ:
+    case X86_INS_LODSB:
+    case X86_INS_LODSW:
+    case X86_INS_LODSD:
+    case X86_INS_LODSQ:
+    case X86_INS_SCASB:
+    case X86_INS_SCASW:
+    case X86_INS_SCASD:
+    case X86_INS_SCASQ:
+    case X86_INS_CMPSB:
+    case X86_INS_CMPSW:
+    case X86_INS_CMPSQ:
+    case X86_INS_ENDBR64:   // an indirect branch target must stay first
+        return true;
+    default:
+        return false;
+    }
+}
+#endif
+
+static MemoryAccess getMemoryAccess(Instruction *instr) {
+    MemoryAccess access;
+    auto semantic = instr->getSemantic();
+
+    if(dynamic_cast<ReturnInstruction *>(semantic)) {
+        access.read = true;
+        return access;
+    }
+    if(dynamic_cast<BreakInstruction *>(semantic)
+        || dynamic_cast<IndirectCallInstruction *>(semantic)) {
+
+        access.barrier = true;
+        return access;
+    }
+#ifdef ARCH_X86_64
+    if(dynamic_cast<DataLinkedControlFlowInstruction *>(semantic)) {
+        access.barrier = true;
+        return access;
+    }
+    if(auto cfi = dynamic_cast<ControlFlowInstruction *>(semantic)) {
+        if(cfi->getMnemonic() == "callq") access.barrier = true;
+        return access;
+    }
+#elif defined(ARCH_AARCH64)
+    if(auto cfi = dynamic_cast<ControlFlowInstruction *>(semantic)) {
+        if(cfi->getAssembly()->getMnemonic() == "bl") access.barrier = true;
+        return access;
+    }
+#endif
+    if(auto ij = dynamic_cast<IndirectJumpInstruction *>(semantic)) {
+        if(ij->hasMemoryOperand()) {
+            access.read = true;
+            access.mayFault = true;
+        }
+#ifdef ARCH_X86_64
+        if(ij->getMnemonic() == "callq") access.barrier = true;
+#elif defined(ARCH_AARCH64)
+        if(ij->getMnemonic() == "blr") access.barrier = true;
+#endif
+        return access;
+    }
+
+    auto assembly = semantic->getAssembly();
+    if(!assembly) {
+        access.barrier = true;
+        return access;
+    }
+    auto asmOps = assembly->getAsmOperands();
+    size_t count = asmOps->getOpCount();
+    unsigned int id = assembly->getId();
+    const std::string &mnemonic = assembly->getMnemonic();
+
+#ifdef ARCH_X86_64
+    if(isBarrierX86(id, mnemonic)) {
+        access.barrier = true;
+        return access;
+    }
+    if(id == X86_INS_DIV || id == X86_INS_IDIV) access.mayFault = true;
+    if(id == X86_INS_LEA || id == X86_INS_NOP
+        || startsWith(mnemonic, "prefetch")) {
+
+        return access;
+    }
+
+    if(id == X86_INS_PUSH) {
+        access.write = true;
+    }
+    if(id == X86_INS_POP || id == X86_INS_LEAVE) {
+        access.read = true;
+    }
+
+    int dest = (isReadOnlyDestX86(id) || count == 0)
+        ? -1 : static_cast<int>(count) - 1;
+    int memoryOperands = 0;
+    for(size_t i = 0; i < count; i ++) {
+        auto &op = asmOps->getOperands()[i];
+        if(op.type != X86_OP_MEM) continue;
+        memoryOperands ++;
+
+        access.mayFault = true;
+        if(static_cast<int>(i) == dest) {
+            access.write = true;
+            if(id != X86_INS_MOV && id != X86_INS_MOVAPS
+                && id != X86_INS_MOVUPS && id != X86_INS_MOVDQA
+                && id != X86_INS_MOVDQU && id != X86_INS_MOVQ
+                && id != X86_INS_MOVD && id != X86_INS_MOVSS
+                && id != X86_INS_MOVSD) {
+
+                access.read = true;
+            }
+        }
+        else {
+            access.read = true;
+        }
+
+        access.size = op.size;
+        access.disp = op.mem.disp;
+        if(op.mem.index != X86_REG_INVALID || op.mem.segment != X86_REG_INVALID) {
+            access.known = false;
+        }
+        else if(op.mem.base == X86_REG_RIP) {
+            // pc-relative: the operand itself holds the final address
+            access.known = true;
+            access.base = MemoryAccess::BASE_ABSOLUTE;
+            access.disp = instr->getAddress() + instr->getSize() + op.mem.disp;
+        }
+        else {
+            access.base = RegisterBitVector::getIndex(op.mem.base);
+            access.known = (access.base >= 0);
+        }
+    }
+    if(memoryOperands > 1 || access.size == 0) access.known = false;
+    if(id == X86_INS_PUSH || id == X86_INS_POP || id == X86_INS_LEAVE) {
+        access.known = false;
+    }
+#elif defined(ARCH_AARCH64)
+    if(mnemonic == "dmb" || mnemonic == "dsb" || mnemonic == "isb"
+        || mnemonic == "svc" || mnemonic == "hvc" || mnemonic == "brk"
+        || mnemonic == "hlt" || mnemonic == "mrs" || mnemonic == "msr"
+        || mnemonic == "sys" || mnemonic == "sysl"
+        || startsWith(mnemonic, "cas") || startsWith(mnemonic, "swp")
+        || startsWith(mnemonic, "ldx") || startsWith(mnemonic, "ldax")
+        || startsWith(mnemonic, "ldar") || startsWith(mnemonic, "ldapr")
+        || startsWith(mnemonic, "stx") || startsWith(mnemonic, "stlx")
+        || startsWith(mnemonic, "stlr")) {
+
+        access.barrier = true;
+        return access;
+    }
+    static const char *atomics[] = {
+        "add", "clr", "eor", "set", "smax", "smin", "umax", "umin"
+    };
+    for(auto op : atomics) {
+        if((startsWith(mnemonic, "ld") || startsWith(mnemonic, "st"))
+            && mnemonic.compare(2, std::strlen(op), op) == 0) {
+
+            access.barrier = true;
+            return access;
+        }
+    }
+    if(startsWith(mnemonic, "prfm") || startsWith(mnemonic, "prfum")) {
+        return access;
+    }
+
+    if(startsWith(mnemonic, "ld")) access.read = true;
+    else if(startsWith(mnemonic, "st")) access.write = true;
+    else return access;
+
+    access.mayFault = true;
+    for(size_t i = 0; i < count; i ++) {
+        auto &op = asmOps->getOperands()[i];
+        if(op.type != ARM64_OP_MEM) continue;
+
+        access.base = RegisterBitVector::getIndex(op.mem.base);
+        access.disp = op.mem.disp;
+        // large enough for a pair of q registers
+        access.size = 32;
+        access.known = (access.base >= 0 && op.mem.index == ARM64_REG_INVALID
+            && !asmOps->getWriteback());
+    }
+#endif
+
+    return access;
+}
+
+static bool mayAlias(const MemoryAccess &a, uint32_t aVersion,
+    const MemoryAccess &b, uint32_t bVersion) {
+
+    if(!a.known || !b.known) return true;
+
+    bool aAbsolute = (a.base == MemoryAccess::BASE_ABSOLUTE);
+    bool bAbsolute = (b.base == MemoryAccess::BASE_ABSOLUTE);
+    if(aAbsolute != bAbsolute) {
+        // globals never overlap the stack frame
+        int base = aAbsolute ? b.base : a.base;
+        return !RegisterBitVector::stackPointer().get(base);
+    }
+    if(!aAbsolute && (a.base != b.base || aVersion != bVersion)) return true;
+
+    return a.disp < b.disp + static_cast<int64_t>(b.size)
+        && b.disp < a.disp + static_cast<int64_t>(a.size);
+}
+
+static bool isControl(Instruction *instr) {
+    auto semantic = instr->getSemantic();
+    return dynamic_cast<ControlFlowInstruction *>(semantic)
+        || dynamic_cast<IndirectControlFlowInstructionBase *>(semantic)
+        || dynamic_cast<ReturnInstruction *>(semantic)
+#ifdef ARCH_X86_64
+        || dynamic_cast<DataLinkedControlFlowInstruction *>(semantic)
+#endif
+        ;
+}
+
+DependenceDAG::DependenceDAG(Block *block,
+    InterproceduralLiveness *summaries) {
+
+    std::vector<Instruction *> instrList;
+    for(auto instr : CIter::children(block)) {
+        instrList.push_back(instr);
+    }
+    build(instrList, std::vector<bool>(instrList.size(), false),
+        nullptr, summaries);
+}
+
+DependenceDAG::DependenceDAG(const std::vector<Block *> &superblock,
+    LivenessAnalysis *liveness, InterproceduralLiveness *summaries) {
+
+    std::vector<Instruction *> instrList;
+    std::vector<bool> sideExit;
+    for(size_t b = 0; b < superblock.size(); b ++) {
+        for(auto instr : CIter::children(superblock[b])) {
+            instrList.push_back(instr);
+            sideExit.push_back(false);
+        }
+        if(b + 1 < superblock.size() && !sideExit.empty()) {
+            sideExit.back() = isControl(instrList.back());
+        }
+    }
+    build(instrList, sideExit, liveness, summaries);
+}
+
+std::vector<Block *> DependenceDAG::formSuperblock(Block *head,
+    ControlFlowGraph *cfg, size_t maxBlocks) {
+
+    std::vector<Block *> superblock{head};
+    auto id = cfg->getIDFor(head);
+    while(superblock.size() < maxBlocks && id + 1 < cfg->getCount()) {
+        bool fallsThrough = false;
+        for(auto link : cfg->get(id)->forwardLinks()) {
+            if(link->getTargetID() == id + 1) fallsThrough = true;
+        }
+        if(!fallsThrough) break;
+
+        auto next = cfg->get(id + 1);
+        size_t predecessors = 0;
+        for(auto link : next->backwardLinks()) {
+            (void)link;
+            predecessors ++;
+        }
+        if(predecessors != 1) break;
+
+        superblock.push_back(next->getBlock());
+        id ++;
+    }
+    return superblock;
+}
+
+void DependenceDAG::build(const std::vector<Instruction *> &instrList,
+    const std::vector<bool> &sideExit, LivenessAnalysis *liveness,
+    InterproceduralLiveness *summaries) {
+
+    const uint32_t NONE = ~0u;
+    size_t count = instrList.size();
+    nodeList = instrList;
+    latencyList.resize(count);
+
+    struct RawEdge {
+        uint32_t from, to;
+        uint16_t kind, latency;
+    };
+    std::vector<RawEdge> edges;
+    auto addEdge = [&] (uint32_t from, uint32_t to, uint16_t kind,
+        uint16_t latency) {
+
+        if(from != NONE && from != to) {
+            edges.push_back(RawEdge{from, to, kind, latency});
+        }
+    };
+
+    std::vector<uint32_t> lastDef(RegisterBitVector::BITS, NONE);
+    std::vector<std::vector<uint32_t>> readers(RegisterBitVector::BITS);
+
+    // memory accesses since the last barrier, with their base versions
+    std::vector<std::pair<uint32_t, MemoryAccess>> memoryList;
+    std::vector<uint32_t> memoryVersion(count, NONE);
+
+    uint32_t lastBarrier = NONE;   // orders everything after it
+    std::vector<uint32_t> exitList;     // side exits since lastBarrier
+    std::vector<uint32_t> sinceBarrier;
+
+    for(uint32_t i = 0; i < count; i ++) {
+        auto instr = instrList[i];
+        RegisterAccess regs(instr, summaries);
+        auto memory = getMemoryAccess(instr);
+        latencyList[i] = estimateLatency(instr);
+        bool control = isControl(instr);
+
+        if(memory.base >= 0) memoryVersion[i] = lastDef[memory.base];
+
+        // registers: reads first, so that read-modify-write is one node
+        regs.getUse().forEach([&] (int r) {
+            uint16_t kind = DEP_REGISTER;
+            if(r == RegisterBitVector::FLAGS) kind |= DEP_FLAGS;
+            if(lastDef[r] != NONE) {
+                addEdge(lastDef[r], i, kind, latencyList[lastDef[r]]);
+            }
+            readers[r].push_back(i);
+        });
+        regs.getDef().forEach([&] (int r) {
+            uint16_t flags = (r == RegisterBitVector::FLAGS) ? DEP_FLAGS : 0;
+            addEdge(lastDef[r], i, DEP_OUTPUT | flags, 1);
+            for(auto reader : readers[r]) {
+                addEdge(reader, i, DEP_ANTI | flags, 0);
+            }
+            lastDef[r] = i;
+            readers[r].clear();
+        });
+
+        // memory
+        if(memory.read || memory.write) {
+            for(const auto &prior : memoryList) {
+                if(!memory.write && !prior.second.write) continue;
+                if(mayAlias(memory, memoryVersion[i],
+                    prior.second, memoryVersion[prior.first])) {
+
+                    addEdge(prior.first, i, DEP_MEMORY,
+                        prior.second.write && memory.read ? 1 : 0);
+                }
+            }
+            memoryList.emplace_back(i, memory);
+        }
+
+        // may this be hoisted above a side exit?
+        bool speculable = !control && !memory.barrier && !memory.read
+            && !memory.write && !memory.mayFault;
+
+        addEdge(lastBarrier, i, DEP_CONTROL, 0);
+        if(!speculable) {
+            // exits are ordered among themselves, so the last one suffices
+            if(!exitList.empty()) addEdge(exitList.back(), i, DEP_CONTROL, 0);
+        }
+        else {
+            // only if no exit's target sees what we write
+            for(auto exit : exitList) {
+                auto exitInstr = instrList[exit];
+                auto link = exitInstr->getSemantic()->getLink();
+                auto target = link ? dynamic_cast<Instruction *>(
+                    &*link->getTarget()) : nullptr;
+                bool dead = false;
+                if(liveness && target && target->getParent()->getParent()
+                    == exitInstr->getParent()->getParent()) {
+
+                    auto live = liveness->getLiveBefore(target);
+                    live &= regs.getDef();
+                    dead = live.empty();
+                }
+                if(!dead) addEdge(exit, i, DEP_CONTROL, 0);
+            }
+        }
+
+        if(memory.barrier || control) {
+            // nothing moves below a barrier or branch
+            for(auto prior : sinceBarrier) {
+                addEdge(prior, i, DEP_CONTROL, 0);
+            }
+            if(memory.barrier || !sideExit[i]) {
+                lastBarrier = i;
+                exitList.clear();
+                sinceBarrier.clear();
+                memoryList.clear();
+            }
+            else {
+                exitList.push_back(i);
+            }
+        }
+        sinceBarrier.push_back(i);
+    }
+
+    // merge parallel edges, then lay out both directions
+    std::sort(edges.begin(), edges.end(),
+        [] (const RawEdge &a, const RawEdge &b) {
+            return a.from < b.from || (a.from == b.from && a.to < b.to);
+        });
+    std::vector<RawEdge> merged;
+    for(const auto &e : edges) {
+        if(!merged.empty() && merged.back().from == e.from
+            && merged.back().to == e.to) {
+
+            merged.back().kind |= e.kind;
+            merged.back().latency = std::max(merged.back().latency,
+                e.latency);
+        }
+        else merged.push_back(e);
+    }
+
+    succOffset.assign(count + 1, 0);
+    predOffset.assign(count + 1, 0);
+    for(const auto &e : merged) {
+        succOffset[e.from + 1] ++;
+        predOffset[e.to + 1] ++;
+    }
+    for(size_t i = 0; i < count; i ++) {
+        succOffset[i + 1] += succOffset[i];
+        predOffset[i + 1] += predOffset[i];
+    }
+    succList.resize(merged.size());
+    predList.resize(merged.size());
+    std::vector<uint32_t> succCursor(succOffset.begin(), succOffset.end() - 1);
+    std::vector<uint32_t> predCursor(predOffset.begin(), predOffset.end() - 1);
+    for(const auto &e : merged) {
+        succList[succCursor[e.from] ++] = Edge{e.to, e.kind, e.latency};
+        predList[predCursor[e.to] ++] = Edge{e.from, e.kind, e.latency};
+    }
+
+    // edges point forward, so a reverse scan sees successors first
+    heightList.assign(count, 0);
+    for(size_t i = count; i-- > 0; ) {
+        uint32_t height = latencyList[i];
+        for(const auto &e : getSuccessors(i)) {
+            height = std::max(height, e.latency + heightList[e.node]);
+        }
+        heightList[i] = height;
+    }
+}
+
+uint32_t DependenceDAG::getCriticalPath() const {
+    uint32_t path = 0;
+    for(auto height : heightList) path = std::max(path, height);
+    return path;
+}
+
+uint16_t DependenceDAG::estimateLatency(Instruction *instr) {
+    auto assembly = instr->getSemantic()->getAssembly();
+    if(!assembly) return 1;
+    const std::string &mnemonic = assembly->getMnemonic();
+
+#ifdef ARCH_X86_64
+    unsigned int id = assembly->getId();
+    if(id == X86_INS_DIV || id == X86_INS_IDIV) return 25;
+    if(startsWith(mnemonic, "sqrt") || startsWith(mnemonic, "div")) return 15;
+    uint16_t latency = 1;
+    if(id == X86_INS_IMUL || id == X86_INS_MUL
+        || startsWith(mnemonic, "mul")) {
+
+        latency = 3;
+    }
+    if(id != X86_INS_LEA) {
+        auto asmOps = assembly->getAsmOperands();
+        for(size_t i = 0; i < asmOps->getOpCount(); i ++) {
+            if(asmOps->getOperands()[i].type == X86_OP_MEM) latency += 4;
+        }
+    }
+    if(id == X86_INS_POP) latency += 4;
+    return latency;
+#elif defined(ARCH_AARCH64)
+    if(mnemonic == "sdiv" || mnemonic == "udiv" || mnemonic == "fdiv"
+        || mnemonic == "fsqrt") {
+
+        return 12;
+    }
+    if(startsWith(mnemonic, "ld")) return 4;
+    if(mnemonic == "mul" || mnemonic == "madd" || mnemonic == "msub"
+        || mnemonic == "smull" || mnemonic == "umull" || mnemonic == "smulh"
+        || mnemonic == "umulh" || startsWith(mnemonic, "fmul")
+        || startsWith(mnemonic, "fmadd")) {
+
+        return 3;
+    }
+    return 1;
+#else
+    return 1;
+#endif
+}
+
+void DependenceDAG::dump() const {
+    for(uint32_t i = 0; i < getCount(); i ++) {
+        LOG0(1, std::dec << i << " [h=" << heightList[i] << "] ");
+        ChunkDumper dumper;
+        nodeList[i]->accept(&dumper);
+        for(const auto &e : getSuccessors(i)) {
+            LOG(1, "    -> " << std::dec << e.node << " kind 0x"
+                << std::hex << e.kind << " latency " << std::dec
+                << e.latency);
+        }
+    }
+}
+
+ListScheduler::ListScheduler(const DependenceDAG *dag, unsigned issueWidth)
+    : dag(dag), issueWidth(issueWidth ? issueWidth : 1), length(0) {
+
+    priority = [dag] (uint32_t id) {
+        return static_cast<int>(dag->getHeight(id));
+    };
+}
+
+const std::vector<uint32_t> &ListScheduler::schedule() {
+    size_t count = dag->getCount();
+    order.clear();
+    order.reserve(count);
+    cycleList.assign(count, 0);
+    length = 0;
+
+    std::vector<uint32_t> waiting(count);     // unscheduled predecessors
+    std::vector<uint32_t> earliest(count, 0); // first cycle operands are ready
+    std::vector<uint32_t> ready;
+    for(uint32_t i = 0; i < count; i ++) {
+        waiting[i] = dag->getPredecessors(i).size();
+        if(waiting[i] == 0) ready.push_back(i);
+    }
+
+    uint32_t cycle = 0;
+    unsigned issued = 0;
+    while(order.size() < count) {
+        // best ready instruction whose operands are available now; ties go
+        // to the original order so that nothing moves without a reason
+        size_t best = ready.size();
+        int bestPriority = 0;
+        for(size_t r = 0; r < ready.size(); r ++) {
+            auto id = ready[r];
+            if(earliest[id] > cycle) continue;
+            int p = priority(id);
+            if(best == ready.size() || p > bestPriority
+                || (p == bestPriority && id < ready[best])) {
+
+                best = r;
+                bestPriority = p;
+            }
+        }
+
+        if(best == ready.size() || issued == issueWidth) {
+            cycle ++;
+            issued = 0;
+            continue;
+        }
+
+        auto id = ready[best];
+        ready.erase(ready.begin() + best);
+        order.push_back(id);
+        cycleList[id] = cycle;
+        issued ++;
+        length = std::max(length, cycle + dag->getLatency(id));
+
+        for(const auto &e : dag->getSuccessors(id)) {
+            earliest[e.node] = std::max(earliest[e.node], cycle + e.latency);
+            if(--waiting[e.node] == 0) ready.push_back(e.node);
+        }
+    }
+
+    return order;
+}
+
+uint32_t ListScheduler::simulate(const DependenceDAG *dag,
+    const std::vector<uint32_t> &order, unsigned issueWidth) {
+
+    if(issueWidth == 0) issueWidth = 1;
+    std::vector<uint32_t> cycleOf(dag->getCount(), 0);
+    uint32_t cycle = 0;
+    uint32_t length = 0;
+    unsigned issued = 0;
+    for(auto id : order) {
+        uint32_t start = cycle;
+        for(const auto &e : dag->getPredecessors(id)) {
+            start = std::max(start, cycleOf[e.node] + e.latency);
+        }
+        // in-order issue: nothing may start before its predecessor in order
+        if(start > cycle) {
+            cycle = start;
+            issued = 0;
+        }
+        if(issued == issueWidth) {
+            cycle ++;
+            issued = 0;
+        }
+        cycleOf[id] = cycle;
+        issued ++;
+        length = std::max(length, cycle + dag->getLatency(id));
+    }
+    return length;
+}
@@ -0,0 +1,141 @@
+#ifndef EGALITO_ANALYSIS_DEPENDENCE_DAG_H
+#define EGALITO_ANALYSIS_DEPENDENCE_DAG_H
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+class Block;
+class Instruction;
+class ControlFlowGraph;
+class LivenessAnalysis;
+class InterproceduralLiveness;
+
+/** Ordering constraints between the instructions of a basic block or a
+    superblock, for moving code around without changing what it computes.
+
+    Nodes are numbered in program order and every edge goes from a lower
+    to a higher id, so id order is always a valid schedule. Edges are kept
+    in flat (CSR) successor and predecessor arrays; parallel edges between
+    the same pair of nodes are merged and carry every kind that applies.
+
+    Register dependences come from RegisterAccess, so this works for both
+    x86_64 and aarch64. Memory accesses are disambiguated only when they
+    share a base register that is not written in between, or are both at
+    absolute (pc-relative) addresses. Calls, fences, atomics and anything
+    not understood order everything.
+
+    A superblock is a chain of blocks where each one falls through to the
+    next and has no other predecessor. Given a LivenessAnalysis, an
+    instruction that cannot fault may be hoisted above a side exit when
+    nothing it writes is live at the exit's target.
+*/
+class DependenceDAG {
+public:
+    enum DependenceKind {
+        DEP_REGISTER    = 1 << 0,   // read after write
+        DEP_ANTI        = 1 << 1,   // write after read
+        DEP_OUTPUT      = 1 << 2,   // write after write
+        DEP_FLAGS       = 1 << 3,   // one of the above, on the flags
+        DEP_MEMORY      = 1 << 4,
+        DEP_CONTROL     = 1 << 5    // branches, calls, barriers
+    };
+    struct Edge {
+        uint32_t node;
+        uint16_t kind;
+        uint16_t latency;
+    };
+    class EdgeRange {
+    private:
+        const Edge *first;
+        const Edge *last;
+    public:
+        EdgeRange(const Edge *first, const Edge *last)
+            : first(first), last(last) {}
+        const Edge *begin() const { return first; }
+        const Edge *end() const { return last; }
+        size_t size() const { return last - first; }
+        bool empty() const { return first == last; }
+    };
+private:
+    std::vector<Instruction *> nodeList;
+    std::vector<uint16_t> latencyList;
+    std::vector<uint32_t> heightList;
+    std::vector<uint32_t> succOffset;
+    std::vector<Edge> succList;
+    std::vector<uint32_t> predOffset;
+    std::vector<Edge> predList;
+public:
+    DependenceDAG(Block *block, InterproceduralLiveness *summaries = nullptr);
+    DependenceDAG(const std::vector<Block *> &superblock,
+        LivenessAnalysis *liveness = nullptr,
+        InterproceduralLiveness *summaries = nullptr);
+
+    /** Extends head along fallthrough edges while the next block has no
+        other predecessor.
+    */
+    static std::vector<Block *> formSuperblock(Block *head,
+        ControlFlowGraph *cfg, size_t maxBlocks = 8);
+
+    size_t getCount() const { return nodeList.size(); }
+    size_t getEdgeCount() const { return succList.size(); }
+    Instruction *getInstruction(uint32_t id) const { return nodeList[id]; }
+    /** Cycles before a dependent instruction can use the result. */
+    uint32_t getLatency(uint32_t id) const { return latencyList[id]; }
+    /** Length of the longest dependence path starting at id. */
+    uint32_t getHeight(uint32_t id) const { return heightList[id]; }
+    uint32_t getCriticalPath() const;
+
+    EdgeRange getSuccessors(uint32_t id) const
+        { return EdgeRange(succList.data() + succOffset[id],
+            succList.data() + succOffset[id + 1]); }
+    EdgeRange getPredecessors(uint32_t id) const
+        { return EdgeRange(predList.data() + predOffset[id],
+            predList.data() + predOffset[id + 1]); }
+
+    static uint16_t estimateLatency(Instruction *instr);
+
+    void dump() const;
+private:
+    void build(const std::vector<Instruction *> &instrList,
+        const std::vector<bool> &sideExit, LivenessAnalysis *liveness,
+        InterproceduralLiveness *summaries);
+};
+
+/** Cycle-by-cycle list scheduling over a DependenceDAG for a machine that
+    issues up to issueWidth instructions per cycle.
+
+    Among the instructions whose operands are ready, the one with the
+    highest priority goes first; by default that is the DAG height, which
+    keeps the critical path moving. Giving instrumentation a low priority
+    makes it fill cycles that would otherwise be idle.
+*/
+class ListScheduler {
+public:
+    typedef std::function<int (uint32_t id)> PriorityFunction;
+private:
+    const DependenceDAG *dag;
+    unsigned issueWidth;
+    PriorityFunction priority;
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> cycleList;
+    uint32_t length;
+public:
+    ListScheduler(const DependenceDAG *dag, unsigned issueWidth = 4);
+
+    void setPriority(PriorityFunction priority)
+        { this->priority = priority; }
+
+    /** Returns node ids in their new order. */
+    const std::vector<uint32_t> &schedule();
+    uint32_t getCycle(uint32_t id) const { return cycleList[id]; }
+    /** Cycles taken by the last schedule(). */
+    uint32_t getLength() const { return length; }
+
+    /** Cycles taken when the DAG is issued in order, without reordering. */
+    static uint32_t simulate(const DependenceDAG *dag,
+        const std::vector<uint32_t> &order, unsigned issueWidth = 4);
+};
+
+#endif
@@ -99,6 +99,16 @@ std::vector<ControlFlow::id_t> Dominance::getDominators(ControlFlow::id_t id) {
     return doms;
 }
 
+bool Dominance::dominates(ControlFlow::id_t a, ControlFlow::id_t b) const {
+    if(idoms[b] == -1) return false;
+
+    for(;;) {
+        if(b == a) return true;
+        if(b == 0) return false;
+        b = idoms[b];
+    }
+}
+
 std::vector<ControlFlow::id_t> Dominance::getPostDominators(
     ControlFlow::id_t id) {
 
@@ -18,6 +18,10 @@ public:
     Dominance(ControlFlowGraph *cfg);
     std::vector<id_t> getDominators(id_t id);
     std::vector<id_t> getPostDominators(id_t id);
+    /** Returns -1 for nodes unreachable from the entry. */
+    id_t getImmediateDominator(id_t id) const { return idoms[id]; }
+    /** Returns true if every path from the entry to b passes through a. */
+    bool dominates(id_t a, id_t b) const;
 
 private:
     id_t intersect(id_t i1, id_t i2);
@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <sstream>
+#include "edgeprofile.h"
+
+static int findRoot(std::vector<int> &parent, int node) {
+    while(parent[node] != node) {
+        parent[node] = parent[parent[node]];
+        node = parent[node];
+    }
+    return node;
+}
+
+// returns false if a and b were already connected
+static bool unite(std::vector<int> &parent, int a, int b) {
+    a = findRoot(parent, a);
+    b = findRoot(parent, b);
+    if(a == b) return false;
+    parent[a] = b;
+    return true;
+}
+
+bool EdgeProfile::placeCounters(const std::vector<unsigned long> &weight,
+    const std::vector<bool> &fixed, int firstCounter) {
+
+    std::vector<int> parent(getBlockCount() + 1);
+    for(size_t i = 0; i < parent.size(); i ++) parent[i] = i;
+
+    // the implicit exit->entry edge is never counted
+    unite(parent, getExitID(), 0);
+
+    std::vector<bool> inTree(edgeList.size(), false);
+    for(size_t i = 0; i < edgeList.size(); i ++) {
+        if(!fixed[i]) continue;
+        if(!unite(parent, edgeList[i].from, edgeList[i].to)) return false;
+        inTree[i] = true;
+    }
+
+    std::vector<size_t> order;
+    for(size_t i = 0; i < edgeList.size(); i ++) {
+        if(!fixed[i]) order.push_back(i);
+    }
+    std::stable_sort(order.begin(), order.end(),
+        [&weight] (size_t a, size_t b) { return weight[a] > weight[b]; });
+    for(auto i : order) {
+        inTree[i] = unite(parent, edgeList[i].from, edgeList[i].to);
+    }
+
+    int counter = firstCounter;
+    for(size_t i = 0; i < edgeList.size(); i ++) {
+        edgeList[i].counter = inTree[i] ? -1 : counter ++;
+    }
+    return true;
+}
+
+size_t EdgeProfile::getCounterCount() const {
+    size_t count = 0;
+    for(const auto &edge : edgeList) {
+        if(edge.counter >= 0) count ++;
+    }
+    return count;
+}
+
+bool EdgeProfile::reconstruct(const std::vector<unsigned long> &counters,
+    std::vector<unsigned long> &edgeCounts) const {
+
+    // the last entry stands for the exit->entry edge
+    const size_t virtualEdge = edgeList.size();
+    const size_t nodeCount = getBlockCount() + 1;
+    std::vector<std::vector<size_t>> inEdges(nodeCount), outEdges(nodeCount);
+    for(size_t i = 0; i < edgeList.size(); i ++) {
+        outEdges[edgeList[i].from].push_back(i);
+        inEdges[edgeList[i].to].push_back(i);
+    }
+    outEdges[getExitID()].push_back(virtualEdge);
+    inEdges[0].push_back(virtualEdge);
+
+    std::vector<unsigned long> count(edgeList.size() + 1, 0);
+    std::vector<bool> known(edgeList.size() + 1, false);
+    size_t unknownCount = 1;
+    for(size_t i = 0; i < edgeList.size(); i ++) {
+        int counter = edgeList[i].counter;
+        if(counter >= 0 && static_cast<size_t>(counter) < counters.size()) {
+            count[i] = counters[counter];
+            known[i] = true;
+        }
+        else unknownCount ++;
+    }
+
+    // Each pass solves every node with exactly one unknown incident edge.
+    // A tree has a leaf, so this terminates after at most one pass per edge.
+    bool progress = true;
+    while(unknownCount > 0 && progress) {
+        progress = false;
+        for(size_t node = 0; node < nodeCount; node ++) {
+            size_t unknown = virtualEdge + 1;
+            bool unknownIsIn = false;
+            int unknowns = 0;
+            long in = 0, out = 0;
+            for(auto e : inEdges[node]) {
+                if(known[e]) in += count[e];
+                else { unknown = e; unknownIsIn = true; unknowns ++; }
+            }
+            for(auto e : outEdges[node]) {
+                if(known[e]) out += count[e];
+                else { unknown = e; unknownIsIn = false; unknowns ++; }
+            }
+            if(unknowns != 1) continue;
+
+            // Counts may be inconsistent if the program left through
+            // exit() or a signal in the middle of a function.
+            long value = unknownIsIn ? out - in : in - out;
+            count[unknown] = (value > 0) ? value : 0;
+            known[unknown] = true;
+            unknownCount --;
+            progress = true;
+        }
+    }
+
+    edgeCounts.assign(count.begin(), count.end() - 1);
+    return unknownCount == 0;
+}
+
+std::vector<unsigned long> EdgeProfile::getBlockCounts(
+    const std::vector<unsigned long> &edgeCounts) const {
+
+    std::vector<unsigned long> blockCount(getBlockCount(), 0);
+    unsigned long entries = 0;
+    for(size_t i = 0; i < edgeList.size(); i ++) {
+        if(edgeList[i].to == getExitID()) entries += edgeCounts[i];
+        else blockCount[edgeList[i].to] += edgeCounts[i];
+    }
+    if(!blockCount.empty()) blockCount[0] += entries;
+    return blockCount;
+}
+
+std::string EdgeProfile::encode() const {
+    std::ostringstream stream;
+    stream << name << " " << getBlockCount();
+    for(auto offset : blockOffsetList) stream << " " << offset;
+    stream << " " << edgeList.size();
+    for(const auto &edge : edgeList) {
+        stream << " " << edge.from << " " << edge.to << " " << edge.counter;
+    }
+    return stream.str();
+}
+
+bool EdgeProfile::decode(const std::string &text) {
+    std::istringstream stream(text);
+    size_t blocks = 0, edges = 0;
+
+    name.clear();
+    blockOffsetList.clear();
+    edgeList.clear();
+
+    if(!(stream >> name >> blocks)) return false;
+    for(size_t i = 0; i < blocks; i ++) {
+        unsigned long offset;
+        if(!(stream >> offset)) return false;
+        blockOffsetList.push_back(offset);
+    }
+    if(!(stream >> edges)) return false;
+    for(size_t i = 0; i < edges; i ++) {
+        Edge edge;
+        if(!(stream >> edge.from >> edge.to >> edge.counter)) return false;
+        if(edge.from < 0 || edge.from > getExitID()
+            || edge.to < 0 || edge.to > getExitID()) {
+
+            return false;
+        }
+        edgeList.push_back(edge);
+    }
+    return true;
+}
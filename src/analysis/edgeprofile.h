@@ -0,0 +1,69 @@
+#ifndef EGALITO_ANALYSIS_EDGE_PROFILE_H
+#define EGALITO_ANALYSIS_EDGE_PROFILE_H
+
+#include <string>
+#include <vector>
+
+/** Spanning-tree edge profiling (Knuth; Ball and Larus) for one function.
+
+    The graph has one node per block plus a virtual exit node, an edge to
+    the exit from every block that leaves the function, and an implicit
+    edge from the exit back to the entry (node 0). Only the edges that are
+    not in a spanning tree of this graph need counters: once those counts
+    are known, every other edge count follows from flow conservation, one
+    leaf of the tree at a time.
+
+    The instrumentation pass builds one of these per function and stores
+    its encode()d form next to the counters; etprofile decode()s it and
+    calls reconstruct() on the saved counter values.
+*/
+class EdgeProfile {
+public:
+    struct Edge {
+        int from;
+        int to;         // getExitID() for edges that leave the function
+        int counter;    // index of its counter, or -1 if it is in the tree
+    };
+private:
+    std::string name;
+    std::vector<unsigned long> blockOffsetList;
+    std::vector<Edge> edgeList;
+public:
+    EdgeProfile(const std::string &name = "") : name(name) {}
+
+    const std::string &getName() const { return name; }
+    /** Block offsets are only used to describe blocks in reports. */
+    void addBlock(unsigned long offset) { blockOffsetList.push_back(offset); }
+    void addEdge(int from, int to) { edgeList.push_back(Edge{from, to, -1}); }
+
+    size_t getBlockCount() const { return blockOffsetList.size(); }
+    unsigned long getBlockOffset(int block) const
+        { return blockOffsetList[block]; }
+    int getExitID() const { return static_cast<int>(getBlockCount()); }
+    const std::vector<Edge> &getEdgeList() const { return edgeList; }
+
+    /** Chooses a maximum-weight spanning tree; weight[i] is the expected
+        frequency of edge i. Edges with fixed[i] set cannot be instrumented
+        and are put in the tree first. Every other edge outside the tree
+        gets a counter, numbered from firstCounter. Returns false if the
+        fixed edges alone form a cycle, in which case nothing is assigned.
+    */
+    bool placeCounters(const std::vector<unsigned long> &weight,
+        const std::vector<bool> &fixed, int firstCounter = 0);
+    size_t getCounterCount() const;
+
+    /** Computes the count of every edge from the counter values. Returns
+        false if some count could not be determined.
+    */
+    bool reconstruct(const std::vector<unsigned long> &counters,
+        std::vector<unsigned long> &edgeCounts) const;
+    /** The number of times each block ran, from reconstructed edge counts. */
+    std::vector<unsigned long> getBlockCounts(
+        const std::vector<unsigned long> &edgeCounts) const;
+
+    /** A single line of text: name, blocks, edges and counter indices. */
+    std::string encode() const;
+    bool decode(const std::string &text);
+};
+
+#endif
@@ -0,0 +1,348 @@
+#include <set>
+#include <capstone/capstone.h>
+#include "framesummary.h"
+#include "archive/stream.h"
+#include "chunk/concrete.h"
+#include "instr/concrete.h"
+#include "instr/semantic.h"
+#ifdef ARCH_X86_64
+#include "instr/linked-x86_64.h"
+#endif
+#ifdef ARCH_AARCH64
+#include "instr/linked-aarch64.h"
+#endif
+#include "log/log.h"
+
+FrameSummary::FrameSummary() : flags(0), frameSize(0), instructionCount(0),
+    setBP(NONE), setSP(NONE) {
+
+}
+
+FrameSummary::FrameSummary(Function *function) : flags(0), frameSize(0),
+    instructionCount(0), setBP(NONE), setSP(NONE) {
+
+    auto instrList = getInstructionList(function);
+    instructionCount = instrList.size();
+
+    findFrame(instrList);
+    findExits(instrList);
+    findResetSP(instrList);
+
+    if(callList.empty()) flags |= FLAG_LEAF;
+}
+
+std::vector<Instruction *> FrameSummary::getInstructionList(
+    Function *function) {
+
+    std::vector<Instruction *> instrList;
+    for(auto block : CIter::children(function)) {
+        for(auto instr : CIter::children(block)) {
+            instrList.push_back(instr);
+        }
+    }
+    return instrList;
+}
+
+std::vector<Instruction *> FrameSummary::getInstructions(
+    const std::vector<Instruction *> &instrList,
+    const std::vector<uint32_t> &indexList) {
+
+    std::vector<Instruction *> result;
+    result.reserve(indexList.size());
+    for(auto index : indexList) {
+        result.push_back(instrList[index]);
+    }
+    return result;
+}
+
+bool FrameSummary::matches(Function *function) const {
+    size_t count = 0;
+    for(auto block : CIter::children(function)) {
+        count += block->getChildren()->getIterable()->getCount();
+    }
+    return count == instructionCount;
+}
+
+void FrameSummary::findFrame(const std::vector<Instruction *> &instrList) {
+
+    if(instrList.empty()) return;
+
+    size_t firstCount = 0;
+    auto firstBlock = instrList[0]->getParent();
+    while(firstCount < instrList.size()
+        && instrList[firstCount]->getParent() == firstBlock) {
+
+        firstCount ++;
+    }
+
+#ifdef ARCH_X86_64
+    bool belowSP = false;
+    for(size_t i = 0; i < instrList.size(); i ++) {
+        auto assembly = instrList[i]->getSemantic()->getAssembly();
+        if(!assembly) continue;
+
+        auto asmOps = assembly->getAsmOperands();
+        auto operands = asmOps->getOperands();
+        if(assembly->getId() == X86_INS_PUSH) {
+            flags |= FLAG_FRAME;
+        }
+        else if(assembly->getId() == X86_INS_SUB
+            && asmOps->getOpCount() == 2
+            && operands[0].type == X86_OP_IMM
+            && operands[1].type == X86_OP_REG
+            && operands[1].reg == X86_REG_RSP) {
+
+            flags |= FLAG_FRAME;
+            if(i < firstCount && setSP == NONE) {
+                setSP = i;
+                frameSize = operands[0].imm;
+            }
+        }
+        else if(i < firstCount && setBP == NONE
+            && assembly->getId() == X86_INS_MOV
+            && asmOps->getOpCount() == 2
+            && operands[0].type == X86_OP_REG
+            && operands[0].reg == X86_REG_RSP
+            && operands[1].type == X86_OP_REG
+            && operands[1].reg == X86_REG_RBP) {
+
+            setBP = i;
+        }
+
+        for(size_t op = 0; op < asmOps->getOpCount(); op ++) {
+            if(operands[op].type == X86_OP_MEM
+                && operands[op].mem.base == X86_REG_RSP
+                && operands[op].mem.disp < 0) {
+
+                belowSP = true;
+            }
+        }
+    }
+
+    // only meaningful for code that never moves the stack pointer itself
+    if(!hasFrame()) setBP = NONE;
+    if(!hasFrame() && belowSP) flags |= FLAG_RED_ZONE;
+#elif defined(ARCH_AARCH64)
+    for(size_t i = 0; i < firstCount; i ++) {
+        auto assembly = instrList[i]->getSemantic()->getAssembly();
+        if(!assembly) continue;
+
+        auto operands = assembly->getAsmOperands()->getOperands();
+        auto writeback = assembly->getAsmOperands()->getWriteback();
+        if(assembly->getId() == ARM64_INS_SUB
+            && operands[0].reg == ARM64_REG_SP) {
+
+            flags |= FLAG_FRAME;
+            if(!frameSize && assembly->getAsmOperands()->getOpCount() >= 3
+                && operands[2].type == ARM64_OP_IMM) {
+
+                frameSize = operands[2].imm;
+            }
+        }
+        else if(assembly->getId() == ARM64_INS_STP
+            && operands[2].type == ARM64_OP_MEM
+            && writeback) {
+
+            flags |= FLAG_FRAME;
+            if(!frameSize && operands[2].mem.disp < 0) {
+                frameSize = -operands[2].mem.disp;
+            }
+        }
+    }
+
+    if(hasFrame()) {
+        for(size_t i = 0; i < firstCount; i ++) {
+            auto assembly = instrList[i]->getSemantic()->getAssembly();
+            if(!assembly) continue;
+
+            auto asmOps = assembly->getAsmOperands();
+            if(asmOps->getOpCount() >= 2
+                && asmOps->getOperands()[0].type == ARM64_OP_REG
+                && asmOps->getOperands()[0].reg == ARM64_REG_X29
+                && asmOps->getOperands()[1].type == ARM64_OP_REG
+                && asmOps->getOperands()[1].reg == ARM64_REG_SP) {
+
+                if(assembly->getId() == ARM64_INS_MOV
+                    || assembly->getId() == ARM64_INS_ADD) {
+
+                    setBP = i;
+                }
+                break;
+            }
+        }
+    }
+#endif
+}
+
+void FrameSummary::findExits(const std::vector<Instruction *> &instrList) {
+
+    std::set<Instruction *> exitSet;
+    for(size_t i = 0; i < instrList.size(); i ++) {
+        auto semantic = instrList[i]->getSemantic();
+        if(dynamic_cast<ReturnInstruction *>(semantic)) {
+            exitList.push_back(i);
+        }
+        else if(auto cfi = dynamic_cast<ControlFlowInstruction *>(semantic)) {
+#ifdef ARCH_X86_64
+            bool isCall = (cfi->getMnemonic() == "callq");
+#elif defined(ARCH_AARCH64)
+            bool isCall = (cfi->getAssembly()->getId() == ARM64_INS_BL);
+#else
+            bool isCall = false;
+#endif
+            if(isCall) {
+                callList.push_back(i);
+                continue;
+            }
+
+            auto link = cfi->getLink();
+            if(auto normal = dynamic_cast<NormalLink *>(link)) {
+                if(dynamic_cast<Function *>(&*normal->getTarget())) {
+                    exitList.push_back(i);
+                    continue;
+                }
+            }
+            if(dynamic_cast<PLTLink *>(link)
+                || (link && link->isExternalJump())) {
+
+                exitList.push_back(i);
+            }
+        }
+        else if(auto ij = dynamic_cast<IndirectJumpInstruction *>(semantic)) {
+#ifdef ARCH_X86_64
+            bool isCall = (ij->getMnemonic() == "callq");
+#elif defined(ARCH_AARCH64)
+            bool isCall = (ij->getMnemonic() == "blr");
+#else
+            bool isCall = false;
+#endif
+            if(isCall) callList.push_back(i);
+            else if(!ij->isForJumpTable()) exitList.push_back(i);
+        }
+        else if(dynamic_cast<IndirectCallInstruction *>(semantic)) {
+            callList.push_back(i);
+        }
+#ifdef ARCH_X86_64
+        else if(auto v = dynamic_cast<DataLinkedControlFlowInstruction *>(
+            semantic)) {
+
+            if(v->isCall()) callList.push_back(i);
+            else exitList.push_back(i);
+        }
+#endif
+    }
+
+    for(auto index : exitList) exitSet.insert(instrList[index]);
+
+    for(size_t i = 0; i < instrList.size(); i ++) {
+        auto cfi = dynamic_cast<ControlFlowInstruction *>(
+            instrList[i]->getSemantic());
+        if(!cfi || !cfi->getLink()) continue;
+
+        auto target = dynamic_cast<Instruction *>(cfi->getLink()->getTarget());
+        if(target && exitSet.count(target)) {
+            jumpToExitList.push_back(i);
+        }
+    }
+}
+
+void FrameSummary::findResetSP(const std::vector<Instruction *> &instrList) {
+    for(auto index : exitList) {
+        // the exit ends its block, so walk back to the start of the block
+        auto block = instrList[index]->getParent();
+        size_t begin = index;
+        while(begin > 0 && instrList[begin - 1]->getParent() == block) {
+            begin --;
+        }
+
+        for(size_t i = begin; i <= index; i ++) {
+            auto assembly = instrList[i]->getSemantic()->getAssembly();
+            if(!assembly) continue;
+
+            auto operands = assembly->getAsmOperands()->getOperands();
+#ifdef ARCH_X86_64
+            if(assembly->getId() == X86_INS_ADD
+                && assembly->getAsmOperands()->getOpCount() == 2
+                && operands[0].type == X86_OP_IMM
+                && operands[1].type == X86_OP_REG
+                && operands[1].reg == X86_REG_RSP) {
+
+                resetSPList.push_back(i);
+            }
+#elif defined(ARCH_AARCH64)
+            if((assembly->getId() == ARM64_INS_MOV
+                    || assembly->getId() == ARM64_INS_SUB)
+                && operands[0].reg == ARM64_REG_SP
+                && operands[1].type == ARM64_OP_REG
+                && operands[1].reg == ARM64_REG_X29) {
+
+                resetSPList.push_back(i);
+            }
+#endif
+        }
+    }
+}
+
+static void writeIndexList(ArchiveStreamWriter &writer,
+    const std::vector<uint32_t> &list) {
+
+    writer.write<uint32_t>(list.size());
+    for(auto index : list) writer.write<uint32_t>(index);
+}
+
+static void readIndexList(ArchiveStreamReader &reader,
+    std::vector<uint32_t> &list) {
+
+    uint32_t count = reader.read<uint32_t>();
+    list.clear();
+    for(uint32_t i = 0; i < count && reader.stillGood(); i ++) {
+        list.push_back(reader.read<uint32_t>());
+    }
+}
+
+void FrameSummary::serialize(ArchiveStreamWriter &writer) const {
+    writer.write<uint32_t>(flags);
+    writer.write<uint32_t>(frameSize);
+    writer.write<uint32_t>(instructionCount);
+    writer.write<uint32_t>(setBP);
+    writer.write<uint32_t>(setSP);
+    writeIndexList(writer, resetSPList);
+    writeIndexList(writer, exitList);
+    writeIndexList(writer, jumpToExitList);
+    writeIndexList(writer, callList);
+}
+
+bool FrameSummary::deserialize(ArchiveStreamReader &reader) {
+    flags = reader.read<uint32_t>();
+    frameSize = reader.read<uint32_t>();
+    instructionCount = reader.read<uint32_t>();
+    setBP = reader.read<uint32_t>();
+    setSP = reader.read<uint32_t>();
+    readIndexList(reader, resetSPList);
+    readIndexList(reader, exitList);
+    readIndexList(reader, jumpToExitList);
+    readIndexList(reader, callList);
+    if(!reader.stillGood()) return false;
+
+    // reject anything that points outside the function
+    auto inRange = [this] (uint32_t index) {
+        return index < instructionCount;
+    };
+    if(setBP != NONE && !inRange(setBP)) return false;
+    if(setSP != NONE && !inRange(setSP)) return false;
+    for(auto list : {&resetSPList, &exitList, &jumpToExitList, &callList}) {
+        for(auto index : *list) {
+            if(!inRange(index)) return false;
+        }
+    }
+    return true;
+}
+
+void FrameSummary::dump() const {
+    LOG(1, "frame " << (hasFrame() ? "yes" : "no")
+        << " size 0x" << std::hex << frameSize
+        << (isLeaf() ? " leaf" : "")
+        << (usesRedZone() ? " red-zone" : "")
+        << std::dec << " exits " << exitList.size()
+        << " calls " << callList.size());
+}
@@ -0,0 +1,86 @@
+#ifndef EGALITO_ANALYSIS_FRAME_SUMMARY_H
+#define EGALITO_ANALYSIS_FRAME_SUMMARY_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+class Function;
+class Instruction;
+class ArchiveStreamReader;
+class ArchiveStreamWriter;
+
+/** What the stack-manipulating passes need to know about a function's
+    frame, found in one walk over its instructions.
+
+    Instructions are recorded by their index in layout order rather than
+    by pointer, so a summary can be written into an archive together with
+    the Function and read back without re-running the analysis. Use
+    getInstructionList() to turn indices back into Instructions.
+
+    Exits are the instructions that leave the function: returns, tail
+    jumps (including jumps back to the function's own entry), and indirect
+    jumps that are not for a jump table. Calls are kept separately.
+*/
+class FrameSummary {
+public:
+    static const uint32_t NONE = ~0u;
+private:
+    enum {
+        FLAG_FRAME      = 1 << 0,   // pushes or subtracts from the SP
+        FLAG_LEAF       = 1 << 1,   // makes no calls
+        FLAG_RED_ZONE   = 1 << 2    // no frame, but accesses below the SP
+    };
+
+    uint32_t flags;
+    uint32_t frameSize;
+    uint32_t instructionCount;
+    uint32_t setBP;
+    uint32_t setSP;
+    std::vector<uint32_t> resetSPList;
+    std::vector<uint32_t> exitList;
+    std::vector<uint32_t> jumpToExitList;
+    std::vector<uint32_t> callList;
+public:
+    FrameSummary();
+    FrameSummary(Function *function);
+
+    bool hasFrame() const { return (flags & FLAG_FRAME) != 0; }
+    bool isLeaf() const { return (flags & FLAG_LEAF) != 0; }
+    bool usesRedZone() const { return (flags & FLAG_RED_ZONE) != 0; }
+    /** Bytes allocated by the prologue's SP adjustment, if any. */
+    size_t getFrameSize() const { return frameSize; }
+    size_t getInstructionCount() const { return instructionCount; }
+
+    uint32_t getSetBP() const { return setBP; }
+    uint32_t getSetSP() const { return setSP; }
+    const std::vector<uint32_t> &getResetSPList() const
+        { return resetSPList; }
+    const std::vector<uint32_t> &getExitList() const { return exitList; }
+    /** Control flow within the function that targets an exit. */
+    const std::vector<uint32_t> &getJumpToExitList() const
+        { return jumpToExitList; }
+    const std::vector<uint32_t> &getCallList() const { return callList; }
+
+    /** Returns false if function has a different number of instructions
+        than when this summary was made (i.e. it is certainly stale).
+    */
+    bool matches(Function *function) const;
+
+    static std::vector<Instruction *> getInstructionList(Function *function);
+    /** Looks up a list of indices in getInstructionList(function). */
+    static std::vector<Instruction *> getInstructions(
+        const std::vector<Instruction *> &instrList,
+        const std::vector<uint32_t> &indexList);
+
+    void serialize(ArchiveStreamWriter &writer) const;
+    bool deserialize(ArchiveStreamReader &reader);
+
+    void dump() const;
+private:
+    void findFrame(const std::vector<Instruction *> &instrList);
+    void findExits(const std::vector<Instruction *> &instrList);
+    void findResetSP(const std::vector<Instruction *> &instrList);
+};
+
+#endif
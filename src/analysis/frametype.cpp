@@ -1,6 +1,7 @@
+#include <algorithm>
 #include <capstone/capstone.h>
 #include "frametype.h"
-#include "analysis/jumptable.h"
+#include "framesummary.h"
 #include "chunk/chunk.h"
 #include "chunk/concrete.h"
 #include "instr/instr.h"
@@ -16,174 +17,45 @@
 #include "log/temp.h"
 
 FrameType::FrameType(Function *function)
-    : setBPInstr(nullptr), setSPInstr(nullptr) {
+    : FrameType(function, FrameSummary(function)) {
 
-    this->hasFrame = hasStackFrame(function);
-
-    // first find setBPInstr
-    if(hasFrame) {
-        auto firstB = function->getChildren()->getIterable()->get(0);
-        for(auto ins : firstB->getChildren()->getIterable()->iterable()) {
-            if(auto assembly = ins->getSemantic()->getAssembly()) {
-                auto asmOps = assembly->getAsmOperands();
-#ifdef ARCH_X86_64
-                if(assembly->getId() == X86_INS_MOV
-                    && assembly->getAsmOperands()->getOpCount() == 2
-                    && asmOps->getOperands()[0].type == X86_OP_REG
-                    && asmOps->getOperands()[0].reg == X86_REG_RSP
-                    && asmOps->getOperands()[1].type == X86_OP_REG
-                    && asmOps->getOperands()[1].reg == X86_REG_RBP) {
+}
 
-                    setBPInstr = ins;
-                    break;
-                }
-#elif defined(ARCH_AARCH64)
-                if(asmOps->getOpCount() >= 2
-                    && asmOps->getOperands()[0].type == ARM64_OP_REG
-                    && asmOps->getOperands()[0].reg == ARM64_REG_X29
-                    && asmOps->getOperands()[1].type == ARM64_OP_REG
-                    && asmOps->getOperands()[1].reg == ARM64_REG_SP) {
+FrameType::FrameType(Function *function, const FrameSummary &summary)
+    : hasFrame(summary.hasFrame()), setBPInstr(nullptr), setSPInstr(nullptr) {
 
-                    if(assembly->getId() == ARM64_INS_MOV) {
-                        setBPInstr = ins;
-                    }
-                    else if(assembly->getId() == ARM64_INS_ADD) {
-                        setBPInstr = ins;
-                    }
-                    break;
-                }
-#endif
-            }
-        }
+    auto instrList = FrameSummary::getInstructionList(function);
+    if(summary.getSetBP() != FrameSummary::NONE) {
+        setBPInstr = instrList[summary.getSetBP()];
     }
-
-    // now find setSPInstr
-#ifdef ARCH_X86_64
-    // enabling this for AARCH64 will confuse dataflow analysis for pointer
-    // detection (i.e. loader hello would fail). This is probably due to
-    // assembly data structure not being cleared after it has becom stale.
-    // clearAssembly() below will make loader to successfully load hello,
-    // but the proper fix should be done somewhere else.
-    auto firstB = function->getChildren()->getIterable()->get(0);
-    for(auto ins : firstB->getChildren()->getIterable()->iterable()) {
-        if(auto assembly = ins->getSemantic()->getAssembly()) {
-            auto operands = assembly->getAsmOperands()->getOperands();
-#ifdef ARCH_X86_64
-            if(assembly->getId() == X86_INS_SUB
-                && assembly->getAsmOperands()->getOpCount() == 2
-                && operands[0].type == X86_OP_IMM
-                && operands[1].type == X86_OP_REG
-                && operands[1].reg == X86_REG_RSP) {
-
-                setSPInstr = ins;
-                break;
-            }
-#elif defined(ARCH_AARCH64)
-            if(assembly->getId() == ARM64_INS_MOV
-                && operands[0].reg == ARM64_REG_SP
-                && operands[1].type == ARM64_OP_REG
-                && operands[1].reg == ARM64_REG_X29) {
-
-                setSPInstr = ins;
-                break;
-            }
-#endif
-        }
-#ifdef ARCH_AARCH64
-        static_cast<SemanticImpl *>(ins->getSemantic())->clearAssembly();
-#endif
+    if(summary.getSetSP() != FrameSummary::NONE) {
+        setSPInstr = instrList[summary.getSetSP()];
     }
-#endif
+    resetSPInstrs = FrameSummary::getInstructions(instrList,
+        summary.getResetSPList());
 
-    // find epilogueInstrs, instructions that leave this function
-    auto module = dynamic_cast<Module *>(function->getParent()->getParent());
-    for(auto b : function->getChildren()->getIterable()->iterable()) {
-        for(auto ins : b->getChildren()->getIterable()->iterable()) {
-            if(dynamic_cast<ReturnInstruction *>(ins->getSemantic())) {
-                epilogueInstrs.push_back(ins);
-            }
-            else if(auto cfi = dynamic_cast<ControlFlowInstruction *>(
-                ins->getSemantic())) {
+    // a jump back to our own entry stays within this frame
+    for(auto ins : FrameSummary::getInstructions(instrList,
+        summary.getExitList())) {
 
-#ifdef ARCH_X86_64
-                if(cfi->getMnemonic() == "callq") continue;
-#elif defined(ARCH_AARCH64)
-                if(cfi->getAssembly()->getId() == ARM64_INS_BL) continue;
-#endif
-                if(auto link = dynamic_cast<NormalLink *>(cfi->getLink())) {
-                    if(auto f = dynamic_cast<Function *>(&*link->getTarget())) {
-                        if(f != function) epilogueInstrs.push_back(ins);
-                    }
-                    continue;
-                }
-                if(dynamic_cast<PLTLink *>(cfi->getLink())) {
-                    epilogueInstrs.push_back(ins);
-                    continue;
-                }
-            }
-            else if(dynamic_cast<IndirectJumpInstruction *>(
-                ins->getSemantic())) {
+        if(auto cfi = dynamic_cast<ControlFlowInstruction *>(
+            ins->getSemantic())) {
 
-                bool tablejump = false;
-                for(auto jt : CIter::children(module->getJumpTableList())) {
-                    if(ins == jt->getDescriptor()->getInstruction()) {
-                        tablejump = true;
-                        break;
-                    }
-                }
-                if(!tablejump) epilogueInstrs.push_back(ins);
-            }
+            auto link = dynamic_cast<NormalLink *>(cfi->getLink());
+            if(link && &*link->getTarget() == function) continue;
         }
+        epilogueInstrs.push_back(ins);
     }
 
-    // find resetSPInstrs, instructions that begin a function epilogue
-    for(auto const &retInstr : epilogueInstrs) {
-        auto parent = dynamic_cast<Block *>(retInstr->getParent());
-        for(auto ins : parent->getChildren()->getIterable()->iterable()) {
-            if(auto assembly = ins->getSemantic()->getAssembly()) {
-                auto operands = assembly->getAsmOperands()->getOperands();
-#ifdef ARCH_X86_64
-                if(assembly->getId() == X86_INS_ADD
-                    && assembly->getAsmOperands()->getOpCount() == 2
-                    && operands[0].type == X86_OP_IMM
-                    && operands[1].type == X86_OP_REG
-                    && operands[1].reg == X86_REG_RSP) {
-
-                    resetSPInstrs.push_back(ins);
-                }
-#elif defined(ARCH_AARCH64)
-                if(assembly->getId() == ARM64_INS_MOV
-                    && operands[0].reg == ARM64_REG_SP
-                    && operands[1].type == ARM64_OP_REG
-                    && operands[1].reg == ARM64_REG_X29) {
-
-                    resetSPInstrs.push_back(ins);
-                }
-                else if(assembly->getId() == ARM64_INS_SUB
-                    && operands[0].reg == ARM64_REG_SP
-                    && operands[1].type == ARM64_OP_REG
-                    && operands[1].reg == ARM64_REG_X29) {
-
-                    resetSPInstrs.push_back(ins);
-                }
-#endif
-            }
-        }
-    }
+    for(auto ins : FrameSummary::getInstructions(instrList,
+        summary.getJumpToExitList())) {
 
-    // fill out jumpToEpilogueInstrs
-    for(auto block : function->getChildren()->getIterable()->iterable()) {
-        for(auto ins : block->getChildren()->getIterable()->iterable()) {
-            if(auto cfi = dynamic_cast<ControlFlowInstruction *>(
-                ins->getSemantic())) {
+        auto cfi = static_cast<ControlFlowInstruction *>(ins->getSemantic());
+        auto target = cfi->getLink()->getTarget();
+        if(std::find(epilogueInstrs.begin(), epilogueInstrs.end(), target)
+            != epilogueInstrs.end()) {
 
-                for(auto ins : epilogueInstrs) {
-                    if(cfi->getLink()->getTarget() == ins) {
-                        jumpToEpilogueInstrs.push_back(cfi);
-                        break;
-                    }
-                }
-            }
+            jumpToEpilogueInstrs.push_back(cfi);
         }
     }
 }
@@ -6,6 +6,7 @@
 class Function;
 class Instruction;
 class ControlFlowInstruction;
+class FrameSummary;
 
 class FrameType {
 private:
@@ -18,6 +19,10 @@ private:
 
 public:
     FrameType(Function *function);
+    /** Resolves summary's instruction indices in function, which must not
+        have changed since the summary was made.
+    */
+    FrameType(Function *function, const FrameSummary &summary);
     bool createsFrame() { return hasFrame; }
     Instruction *getSetBPInstr() const { return setBPInstr; }
     Instruction *getSetSPInstr() const { return setSPInstr; }
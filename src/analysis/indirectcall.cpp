@@ -0,0 +1,562 @@
+#include <algorithm>
+#include "indirectcall.h"
+#include "analysis/call.h"
+#include "analysis/compactcallgraph.h"
+#include "analysis/controlflow.h"
+#include "analysis/liveness.h"
+#include "analysis/manager.h"
+#include "chunk/concrete.h"
+#include "chunk/link.h"
+#include "chunk/plt.h"
+#include "chunk/vtable.h"
+#include "elf/symbol.h"
+#include "instr/concrete.h"
+
+#include "log/log.h"
+
+// bounds the backward walk for a single call site
+#define MAX_BLOCKS_PER_SITE     64
+#define MAX_CALL_DEPTH          1
+#define MAX_LOAD_DEPTH          3
+
+/** What a register may hold at one point: a few known values, or unknown.
+    An empty set that is not unknown means no definition has been reached
+    yet (e.g. only around a loop).
+*/
+class IndirectCallTargets::ValueSet {
+public:
+    enum Kind {
+        FUNCTION,   // the address of a Function
+        ADDRESS,    // some other constant address within module
+        VPTR        // loaded from offset 0 of an unknown object
+    };
+    struct Value {
+        Kind kind;
+        Function *function;
+        Module *module;
+        address_t address;
+
+        bool operator == (const Value &other) const
+            { return kind == other.kind && function == other.function
+                && module == other.module && address == other.address; }
+    };
+private:
+    size_t limit;
+    std::vector<Value> valueList;
+    bool unknown;
+    bool hierarchy;
+public:
+    ValueSet(size_t limit) : limit(limit), unknown(false), hierarchy(false) {}
+
+    const std::vector<Value> &getValues() const { return valueList; }
+    bool isUnknown() const { return unknown; }
+    bool isEmpty() const { return !unknown && valueList.empty(); }
+    bool usesHierarchy() const { return hierarchy; }
+
+    void setUnknown() { unknown = true; valueList.clear(); }
+    void setHierarchy() { hierarchy = true; }
+    void add(Kind kind, Function *function, Module *module,
+        address_t address);
+};
+
+void IndirectCallTargets::ValueSet::add(Kind kind, Function *function,
+    Module *module, address_t address) {
+
+    if(unknown) return;
+    Value value = {kind, function, module, address};
+    if(std::find(valueList.begin(), valueList.end(), value)
+        != valueList.end()) {
+
+        return;
+    }
+    valueList.push_back(value);
+    if(valueList.size() > limit) setUnknown();
+}
+
+static Module *getModule(Function *function) {
+    return static_cast<Module *>(function->getParent()->getParent());
+}
+
+IndirectCallTargets::IndirectCallTargets(Program *program,
+    CompactCallGraph *graph, size_t maxTargets)
+    : graph(graph), maxTargets(maxTargets), loadDepth(0) {
+
+    for(size_t i = 0; i < PRECISION_COUNT; i ++) count[i] = 0;
+
+    findAddressTaken(program);
+    buildSlotMap(program);
+
+    for(auto module : CIter::children(program)) {
+        for(auto function : CIter::functions(module)) {
+            for(auto block : CIter::children(function)) {
+                for(auto instr : CIter::children(block)) {
+                    auto semantic = instr->getSemantic();
+                    IndirectControlFlowInstructionBase *indirect = nullptr;
+                    if(auto v = dynamic_cast<IndirectCallInstruction *>(
+                        semantic)) {
+
+                        indirect = v;
+                    }
+                    else if(auto v = dynamic_cast<IndirectJumpInstruction *>(
+                        semantic)) {
+
+                        if(!v->isForJumpTable()) indirect = v;
+                    }
+                    if(!indirect) continue;
+
+                    auto set = resolveSite(instr, indirect);
+                    count[set.getPrecision()] ++;
+                    siteMap[instr] = set;
+                }
+            }
+        }
+    }
+    this->graph = nullptr;
+
+    LOG(1, "indirect call targets: " << std::dec << siteMap.size()
+        << " sites, " << count[EXACT] << " exact, "
+        << count[CLASS_HIERARCHY] << " via vtables, "
+        << count[UNRESOLVED] << " unresolved");
+}
+
+auto IndirectCallTargets::getTargets(Instruction *instr) const
+    -> const TargetSet * {
+
+    auto it = siteMap.find(instr);
+    return (it != siteMap.end()) ? &it->second : nullptr;
+}
+
+Function *IndirectCallTargets::getSingleTarget(Instruction *instr,
+    bool allowClassHierarchy) const {
+
+    auto set = getTargets(instr);
+    if(!set || set->getTargets().size() != 1) return nullptr;
+    if(set->getPrecision() == EXACT
+        || (allowClassHierarchy
+            && set->getPrecision() == CLASS_HIERARCHY)) {
+
+        return set->getTargets()[0];
+    }
+    return nullptr;
+}
+
+void IndirectCallTargets::findAddressTaken(Program *program) {
+    // functions referenced from data, including vtables
+    addressTaken = AnalysisManager::getInstance()
+        ->getIndirectCalleeList(program)->getList();
+
+    // ... and from code, other than by calls and jumps
+    for(auto module : CIter::children(program)) {
+        for(auto function : CIter::functions(module)) {
+            for(auto block : CIter::children(function)) {
+                for(auto instr : CIter::children(block)) {
+                    auto semantic = instr->getSemantic();
+                    if(dynamic_cast<ControlFlowInstruction *>(semantic)) {
+                        continue;
+                    }
+                    auto link = semantic->getLink();
+                    if(!link) continue;
+                    if(auto target = dynamic_cast<Function *>(
+                        &*link->getTarget())) {
+
+                        addressTaken.insert(target);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void IndirectCallTargets::buildSlotMap(Program *program) {
+    for(auto module : CIter::children(program)) {
+        auto vtableList = module->getVTableList();
+        if(!vtableList) continue;
+
+        for(auto vtable : CIter::children(vtableList)) {
+            auto addressPoint = vtable->getAddressPoint();
+            if(!addressPoint) continue;
+
+            for(auto entry : CIter::children(vtable)) {
+                auto link = entry->getLink();
+                if(!link || entry->getAddress() < addressPoint) continue;
+                auto target = dynamic_cast<Function *>(&*link->getTarget());
+                if(!target) continue;
+
+                size_t slot = (entry->getAddress() - addressPoint) / 8;
+                slotMap[slot].push_back(target);
+            }
+        }
+    }
+    for(auto &kv : slotMap) {
+        auto &list = kv.second;
+        std::sort(list.begin(), list.end());
+        list.erase(std::unique(list.begin(), list.end()), list.end());
+    }
+}
+
+auto IndirectCallTargets::resolveSite(Instruction *instr,
+    IndirectControlFlowInstructionBase *semantic) -> TargetSet {
+
+#if defined(ARCH_X86_64) || defined(ARCH_AARCH64)
+    int reg = RegisterBitVector::getIndex(semantic->getRegister());
+    if(reg < 0) return TargetSet();  // e.g. call *sym(%rip)
+
+    auto block = static_cast<Block *>(instr->getParent());
+    size_t index = block->getChildren()->getIterable()->indexOf(instr);
+    VisitedSet visited;
+    ValueSet values(maxTargets);
+    if(semantic->hasMemoryOperand()) {
+        if(semantic->getIndexRegister() != INVALID_REGISTER) {
+            return TargetSet();
+        }
+        ValueSet base(maxTargets);
+        resolveBase(block, index, reg, MAX_CALL_DEPTH, base);
+        resolveLoad(base, semantic->getDisplacement(), values);
+    }
+    else {
+        resolveBefore(block, index, reg, MAX_CALL_DEPTH, visited, values);
+    }
+    if(values.isUnknown() || values.isEmpty()) return TargetSet();
+
+    std::vector<Function *> targets;
+    for(auto &value : values.getValues()) {
+        if(value.kind != ValueSet::FUNCTION) return TargetSet();
+        targets.push_back(value.function);
+    }
+    std::sort(targets.begin(), targets.end());
+    targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+    return TargetSet(values.usesHierarchy() ? CLASS_HIERARCHY : EXACT,
+        targets);
+#else
+    return TargetSet();
+#endif
+}
+
+void IndirectCallTargets::resolveBefore(Block *block, size_t end, int reg,
+    int depth, VisitedSet &visited, ValueSet &out) {
+
+    if(out.isUnknown()) return;
+
+    auto list = block->getChildren()->getIterable();
+    for(size_t i = end; i -- > 0; ) {
+        RegisterAccess access(list->get(i));
+        if(access.getDef().get(reg)) {
+            resolveDef(block, i, reg, depth, visited, out);
+            return;
+        }
+    }
+
+    // a block already on the path adds nothing that other paths don't
+    if(!visited.insert(std::make_pair(block, reg)).second) return;
+    if(visited.size() > MAX_BLOCKS_PER_SITE) {
+        out.setUnknown();
+        return;
+    }
+
+    auto function = static_cast<Function *>(block->getParent());
+    auto cfg = AnalysisManager::getInstance()->getControlFlowGraph(function);
+    auto node = cfg->get(cfg->getIDFor(block));
+    bool reached = false;
+    if(block == function->getChildren()->getIterable()->get(0)) {
+        resolveArgument(function, reg, depth, visited, out);
+        reached = true;
+    }
+    for(auto link : node->backwardLinks()) {
+        auto pred = cfg->get(link->getTargetID())->getBlock();
+        resolveBefore(pred, pred->getChildren()->getIterable()->getCount(),
+            reg, depth, visited, out);
+        reached = true;
+        if(out.isUnknown()) return;
+    }
+    if(!reached) out.setUnknown();  // e.g. an exception landing pad
+}
+
+void IndirectCallTargets::resolveBase(Block *block, size_t end, int reg,
+    int depth, ValueSet &out) {
+
+    // a separate walk, since its values go to a different set; bounded
+    // because pointer chasing in a loop would lead back here
+    if(loadDepth >= MAX_LOAD_DEPTH) {
+        out.setUnknown();
+        return;
+    }
+    loadDepth ++;
+    VisitedSet visited;
+    resolveBefore(block, end, reg, depth, visited, out);
+    loadDepth --;
+}
+
+void IndirectCallTargets::resolveDef(Block *block, size_t index, int reg,
+    int depth, VisitedSet &visited, ValueSet &out) {
+
+    auto instr = block->getChildren()->getIterable()->get(index);
+    auto semantic = instr->getSemantic();
+    auto assembly = semantic->getAssembly();
+    if(dynamic_cast<ControlFlowInstruction *>(semantic) || !assembly) {
+        out.setUnknown();
+        return;
+    }
+    if(auto link = semantic->getLink()) {
+        resolveLinked(instr, link, reg, out);
+        return;
+    }
+
+    auto asmOps = assembly->getAsmOperands();
+    auto ops = asmOps->getOperands();
+#ifdef ARCH_X86_64
+    // AT&T order: the destination comes last
+    if(assembly->getId() == X86_INS_MOV && asmOps->getOpCount() == 2
+        && ops[1].type == X86_OP_REG && ops[1].size == 8
+        && RegisterBitVector::getIndex(ops[1].reg) == reg) {
+
+        if(ops[0].type == X86_OP_REG) {
+            int source = RegisterBitVector::getIndex(ops[0].reg);
+            if(source >= 0) {
+                resolveBefore(block, index, source, depth, visited, out);
+                return;
+            }
+        }
+        else if(ops[0].type == X86_OP_MEM
+            && ops[0].mem.segment == X86_REG_INVALID
+            && ops[0].mem.index == X86_REG_INVALID) {
+
+            int base = RegisterBitVector::getIndex(ops[0].mem.base);
+            if(base >= 0) {
+                ValueSet baseValues(maxTargets);
+                resolveBase(block, index, base, depth, baseValues);
+                resolveLoad(baseValues, ops[0].mem.disp, out);
+                return;
+            }
+        }
+    }
+#elif defined(ARCH_AARCH64)
+    if(asmOps->getOpCount() == 2 && ops[0].type == ARM64_OP_REG
+        && ops[0].reg >= ARM64_REG_X0 && ops[0].reg <= ARM64_REG_X28
+        && RegisterBitVector::getIndex(ops[0].reg) == reg) {
+
+        if(assembly->getId() == ARM64_INS_MOV && ops[1].type == ARM64_OP_REG) {
+            int source = RegisterBitVector::getIndex(ops[1].reg);
+            if(source >= 0) {
+                resolveBefore(block, index, source, depth, visited, out);
+                return;
+            }
+        }
+        else if(assembly->getId() == ARM64_INS_LDR
+            && ops[1].type == ARM64_OP_MEM && !asmOps->getWriteback()
+            && ops[1].mem.index == ARM64_REG_INVALID) {
+
+            int base = RegisterBitVector::getIndex(ops[1].mem.base);
+            if(base >= 0) {
+                ValueSet baseValues(maxTargets);
+                resolveBase(block, index, base, depth, baseValues);
+                resolveLoad(baseValues, ops[1].mem.disp, out);
+                return;
+            }
+        }
+    }
+#endif
+    out.setUnknown();
+}
+
+void IndirectCallTargets::resolveLinked(Instruction *instr, Link *link,
+    int reg, ValueSet &out) {
+
+    auto assembly = instr->getSemantic()->getAssembly();
+    auto asmOps = assembly->getAsmOperands();
+    auto ops = asmOps->getOperands();
+    auto module = getModule(static_cast<Function *>(
+        instr->getParent()->getParent()));
+
+    bool isAddress = false;
+    bool isLoad = false;
+#ifdef ARCH_X86_64
+    if(asmOps->getOpCount() == 2 && ops[1].type == X86_OP_REG
+        && ops[1].size == 8
+        && RegisterBitVector::getIndex(ops[1].reg) == reg) {
+
+        switch(assembly->getId()) {
+        case X86_INS_LEA:
+            isAddress = true;
+            break;
+        case X86_INS_MOV:
+        case X86_INS_MOVABS:
+            isAddress = (ops[0].type == X86_OP_IMM);
+            isLoad = (ops[0].type == X86_OP_MEM);
+            break;
+        default:
+            break;
+        }
+    }
+#elif defined(ARCH_AARCH64)
+    if(asmOps->getOpCount() >= 2 && ops[0].type == ARM64_OP_REG
+        && ops[0].reg >= ARM64_REG_X0 && ops[0].reg <= ARM64_REG_X28
+        && RegisterBitVector::getIndex(ops[0].reg) == reg) {
+
+        // the link of an adrp/add or adrp/ldr pair carries the full target
+        switch(assembly->getId()) {
+        case ARM64_INS_ADRP:
+        case ARM64_INS_ADR:
+        case ARM64_INS_ADD:
+            isAddress = true;
+            break;
+        case ARM64_INS_LDR:
+            isLoad = true;
+            break;
+        default:
+            break;
+        }
+    }
+#endif
+
+    if(isAddress) {
+        addLinkTarget(link, module, out);
+    }
+    else if(isLoad) {
+        ValueSet base(maxTargets);
+        base.add(ValueSet::ADDRESS, nullptr, module, link->getTargetAddress());
+        resolveLoad(base, 0, out);
+    }
+    else {
+        out.setUnknown();
+    }
+}
+
+void IndirectCallTargets::resolveArgument(Function *function, int reg,
+    int depth, VisitedSet &visited, ValueSet &out) {
+
+    if(depth <= 0 || !graph || out.isUnknown()
+        || !RegisterBitVector::argumentRegisters().get(reg)
+        || addressTaken.count(function) || isExported(function)) {
+
+        out.setUnknown();
+        return;
+    }
+    auto id = graph->getID(function);
+    if(id == CompactCallGraph::INVALID_ID || graph->getCallers(id).empty()) {
+        out.setUnknown();
+        return;
+    }
+
+    for(auto callerID : graph->getCallers(id)) {
+        auto caller = graph->getFunction(callerID);
+        for(auto block : CIter::children(caller)) {
+            size_t index = 0;
+            for(auto instr : CIter::children(block)) {
+                auto cfi = dynamic_cast<ControlFlowInstruction *>(
+                    instr->getSemantic());
+                auto link = cfi ? cfi->getLink() : nullptr;
+                Chunk *target = link ? &*link->getTarget() : nullptr;
+                if(auto pltLink = dynamic_cast<PLTLink *>(link)) {
+                    target = pltLink->getPLTTrampoline()->getTarget();
+                }
+                if(target == function) {
+                    resolveBefore(block, index, reg, depth - 1, visited, out);
+                    if(out.isUnknown()) return;
+                }
+                index ++;
+            }
+        }
+    }
+}
+
+// .got and .data.rel.ro are only protected by RELRO, which the generated
+// binaries do not have, so they stay writable at run time
+static bool isReadOnly(DataRegion *region) {
+    return !region->writable();
+}
+
+void IndirectCallTargets::resolveLoad(const ValueSet &base,
+    int64_t displacement, ValueSet &out) {
+
+    if(out.isUnknown()) return;
+    if(base.isUnknown() || base.isEmpty()) {
+        // the first word of an object we know nothing about
+        if(displacement == 0 && !slotMap.empty()) {
+            out.add(ValueSet::VPTR, nullptr, nullptr, 0);
+        }
+        else {
+            out.setUnknown();
+        }
+        return;
+    }
+    if(base.usesHierarchy()) out.setHierarchy();
+
+    for(auto &value : base.getValues()) {
+        if(value.kind == ValueSet::ADDRESS) {
+            address_t address = value.address + displacement;
+            auto regionList = value.module->getDataRegionList();
+            auto region = regionList->findNonTLSRegionContaining(address);
+            auto section = region
+                ? region->findDataSectionContaining(address) : nullptr;
+            auto var = section ? section->findVariable(address) : nullptr;
+            if(!var || !var->getDest() || !isReadOnly(region)) {
+                out.setUnknown();
+                return;
+            }
+            addLinkTarget(var->getDest(), value.module, out);
+        }
+        else if(value.kind == ValueSet::VPTR) {
+            auto it = (displacement >= 0 && displacement % 8 == 0)
+                ? slotMap.find(displacement / 8) : slotMap.end();
+            if(it == slotMap.end()) {
+                out.setUnknown();
+                return;
+            }
+            out.setHierarchy();
+            for(auto target : it->second) {
+                out.add(ValueSet::FUNCTION, target, nullptr, 0);
+            }
+        }
+        else {
+            out.setUnknown();  // loading from code
+        }
+        if(out.isUnknown()) return;
+    }
+}
+
+void IndirectCallTargets::addLinkTarget(Link *link, Module *module,
+    ValueSet &out) {
+
+    Chunk *target = &*link->getTarget();
+    if(auto pltLink = dynamic_cast<PLTLink *>(link)) {
+        target = pltLink->getPLTTrampoline()->getTarget();
+        if(!target) {
+            out.setUnknown();
+            return;
+        }
+    }
+
+    if(auto function = dynamic_cast<Function *>(target)) {
+        out.add(ValueSet::FUNCTION, function, nullptr, 0);
+    }
+    else if(dynamic_cast<Block *>(target)
+        || dynamic_cast<Instruction *>(target)) {
+
+        out.setUnknown();  // code, but not the start of a function
+    }
+    else {
+        out.add(ValueSet::ADDRESS, nullptr, module, link->getTargetAddress());
+    }
+}
+
+bool IndirectCallTargets::isExported(Function *function) const {
+    if(function->getDynamicSymbol()) return true;
+    auto symbol = function->getSymbol();
+    return symbol && symbol->getBind() != Symbol::BIND_LOCAL;
+}
+
+void IndirectCallTargets::dump() const {
+    static const char *precisionName[] = {
+        "unresolved", "exact", "vtable"
+    };
+    for(auto &kv : siteMap) {
+        auto instr = kv.first;
+        auto &set = kv.second;
+        LOG(1, "0x" << std::hex << instr->getAddress() << " in "
+            << instr->getParent()->getParent()->getName() << ": "
+            << precisionName[set.getPrecision()]);
+        for(auto target : set.getTargets()) {
+            LOG(1, "    -> " << target->getName());
+        }
+    }
+}
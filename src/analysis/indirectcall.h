@@ -0,0 +1,106 @@
+#ifndef EGALITO_ANALYSIS_INDIRECT_CALL_H
+#define EGALITO_ANALYSIS_INDIRECT_CALL_H
+
+#include <vector>
+#include <set>
+#include <map>
+#include <utility>
+#include "types.h"
+
+class Program;
+class Module;
+class Function;
+class Block;
+class Instruction;
+class Link;
+class CompactCallGraph;
+class IndirectControlFlowInstructionBase;
+
+/** Resolves indirect calls and indirect tail jumps to small sets of
+    possible target functions.
+
+    Each register is traced backwards from the call site through unique
+    definitions: register copies, code and data addresses from links
+    (lea, mov $sym, adrp/add), and loads from read-only segments. Loads
+    from .got or .data.rel.ro are not trusted: only RELRO protects them,
+    and the generated output has none, so they stay writable. At the
+    function entry, an argument register takes the union of the values
+    passed at every direct call site, provided the function is neither
+    address-taken nor visible outside its module.
+
+    A call through a slot of an object's vtable pointer (a load from offset
+    0 of an unknown pointer) resolves to every vtable entry in that slot,
+    using the vtables found by DisassembleVTables. That assumes the whole
+    class hierarchy is known, so such sites are kept apart from EXACT ones.
+*/
+class IndirectCallTargets {
+public:
+    enum Precision {
+        UNRESOLVED,
+        EXACT,              // only constants and read-only data involved
+        CLASS_HIERARCHY,    // dispatch through a vtable slot
+        PRECISION_COUNT
+    };
+    class TargetSet {
+    private:
+        Precision precision;
+        std::vector<Function *> targets;
+    public:
+        TargetSet(Precision precision = UNRESOLVED,
+            const std::vector<Function *> &targets = {})
+            : precision(precision), targets(targets) {}
+        Precision getPrecision() const { return precision; }
+        bool isResolved() const { return precision != UNRESOLVED; }
+        /** Sorted and free of duplicates; empty if unresolved. */
+        const std::vector<Function *> &getTargets() const { return targets; }
+    };
+private:
+    class ValueSet;
+    typedef std::set<std::pair<Block *, int>> VisitedSet;
+
+    CompactCallGraph *graph;    // only used while resolving
+    size_t maxTargets;
+    int loadDepth;
+    std::set<Function *> addressTaken;
+    std::map<size_t, std::vector<Function *>> slotMap;
+    std::map<Instruction *, TargetSet> siteMap;
+    size_t count[PRECISION_COUNT];
+public:
+    /** Sets with more than maxTargets functions are left unresolved. */
+    IndirectCallTargets(Program *program, CompactCallGraph *graph,
+        size_t maxTargets = 8);
+
+    /** Returns nullptr if instr is not an indirect call or tail jump. */
+    const TargetSet *getTargets(Instruction *instr) const;
+    /** Returns the only possible target, or nullptr. */
+    Function *getSingleTarget(Instruction *instr,
+        bool allowClassHierarchy = false) const;
+
+    const std::map<Instruction *, TargetSet> &getSites() const
+        { return siteMap; }
+    size_t getCount(Precision precision) const { return count[precision]; }
+
+    void dump() const;
+private:
+    void findAddressTaken(Program *program);
+    void buildSlotMap(Program *program);
+    TargetSet resolveSite(Instruction *instr,
+        IndirectControlFlowInstructionBase *semantic);
+
+    void resolveBefore(Block *block, size_t end, int reg, int depth,
+        VisitedSet &visited, ValueSet &out);
+    void resolveBase(Block *block, size_t end, int reg, int depth,
+        ValueSet &out);
+    void resolveDef(Block *block, size_t index, int reg, int depth,
+        VisitedSet &visited, ValueSet &out);
+    void resolveLinked(Instruction *instr, Link *link, int reg,
+        ValueSet &out);
+    void resolveArgument(Function *function, int reg, int depth,
+        VisitedSet &visited, ValueSet &out);
+    void resolveLoad(const ValueSet &base, int64_t displacement,
+        ValueSet &out);
+    void addLinkTarget(Link *link, Module *module, ValueSet &out);
+    bool isExported(Function *function) const;
+};
+
+#endif
@@ -1,8 +1,12 @@
 #include <cassert>
+#include <chrono>
+#include <algorithm>
 #include "jumptabledetection.h"
 #include "analysis/walker.h"
 #include "analysis/usedef.h"
 #include "analysis/usedefutil.h"
+#include "analysis/liveness.h"
+#include "analysis/manager.h"
 #include "chunk/concrete.h"
 #include "elf/elfspace.h"
 #include "instr/concrete.h"
@@ -22,19 +26,35 @@ void JumptableDetection::detect(Module *module) {
 
 void JumptableDetection::detect(Function *function) {
     if(containsIndirectJump(function)) {
-        ControlFlowGraph cfg(function);
-        UDConfiguration config(&cfg);
-        UDRegMemWorkingSet working(function, &cfg);
-        UseDef usedef(&config, &working);
+        typedef std::chrono::high_resolution_clock Clock;
+        auto elapsed = [] (Clock::time_point since) {
+            return static_cast<unsigned long>(
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    Clock::now() - since).count());
+        };
+
+        auto manager = AnalysisManager::getInstance();
 
-        IF_LOG(10) cfg.dump();
-        IF_LOG(10) cfg.dumpDot();
+        auto startTime = Clock::now();
+        auto cfg = manager->getControlFlowGraph(function);
 
-        SccOrder order(&cfg);
-        order.genFull(0);
-        usedef.analyze(order.get());
+        IF_LOG(10) cfg->dump();
+        IF_LOG(10) cfg->dumpDot();
+
+        bool fast = detectFast(function, cfg);
+        statistics.fastMicroseconds += elapsed(startTime);
+        if(fast) {
+            statistics.fastFunctions ++;
+            return;
+        }
 
-        detect(&working);
+        startTime = Clock::now();
+        auto working = manager->getUseDef(function);
+        AnalysisManager::Pin pin(ANALYSIS_USE_DEF, function);
+
+        detect(working);
+        statistics.fullMicroseconds += elapsed(startTime);
+        statistics.fullFunctions ++;
     }
 }
 
@@ -226,6 +246,378 @@ bool JumptableDetection::containsIndirectJump(Function *function) const {
     return false;
 }
 
+/* Returns the index of the closest instruction before index in block that
+   may write any part of reg, or -1 if there is none.
+*/
+static long findPreviousWriter(Block *block, long index, int reg) {
+    auto list = block->getChildren()->getIterable();
+    for(long i = index - 1; i >= 0; i --) {
+        if(RegisterAccess(list->get(i)).getDef().get(reg)) return i;
+    }
+    return -1;
+}
+
+bool JumptableDetection::detectFast(Function *function,
+    ControlFlowGraph *cfg) {
+
+    std::vector<std::pair<Instruction *, JumptableInfo>> found;
+    size_t jumps = 0;
+    bool matched = true;
+    for(auto block : CIter::children(function)) {
+        auto instr = block->getChildren()->getIterable()->getLast();
+        auto ij = dynamic_cast<IndirectJumpInstruction *>(
+            instr->getSemantic());
+        if(!ij) continue;
+#ifdef ARCH_X86_64
+        // the full analysis ignores these as well
+        auto mode = ij->getAssembly()->getAsmOperands()->getMode();
+        if(mode != AssemblyOperands::MODE_REG) continue;
+#endif
+        jumps ++;
+        // keep counting, since all of them go to the full analysis
+        if(!matched) continue;
+
+        JumptableInfo info(cfg, nullptr, nullptr);
+        if(!matchFast(block, cfg, &info)) {
+            LOG(10, "fast path does not match jump at 0x"
+                << std::hex << instr->getAddress());
+            matched = false;
+            continue;
+        }
+        found.emplace_back(instr, info);
+    }
+    if(!matched) {
+        statistics.fullJumps += jumps;
+        return false;
+    }
+
+    // only commit once every jump is understood, so that a function is
+    // never described partly by each tier
+    for(auto &pair : found) {
+        makeDescriptor(pair.first, &pair.second);
+    }
+    statistics.fastJumps += jumps;
+    return true;
+}
+
+#ifdef ARCH_X86_64
+bool JumptableDetection::matchFast(Block *block, ControlFlowGraph *cfg,
+    JumptableInfo *info) {
+
+    // lea table(%rip),%rB ; movslq (%rB,%rI,4),%rL ; add %rB,%rL ; jmp *%rL
+    // (or add %rL,%rB ; jmp *%rB), optionally with mov %eS,%eI in between
+    auto list = block->getChildren()->getIterable();
+    long count = list->getCount();
+    if(count < 4) return false;
+
+    auto ij = dynamic_cast<IndirectJumpInstruction *>(
+        list->get(count - 1)->getSemantic());
+    int target = X86Register::convertToPhysical(ij->getRegister());
+
+    long addIndex = count - 2;
+    auto add = list->get(addIndex)->getSemantic()->getAssembly();
+    if(!add || add->getId() != X86_INS_ADD) return false;
+    if(add->getAsmOperands()->getMode() != AssemblyOperands::MODE_REG_REG) {
+        return false;
+    }
+    auto addOps = add->getAsmOperands()->getOperands();
+    if(addOps[1].size != 8) return false;
+    if(X86Register::convertToPhysical(addOps[1].reg) != target) return false;
+    int other = X86Register::convertToPhysical(addOps[0].reg);
+    if(other < 0 || other == target) return false;
+
+    long loadIndex = std::max(findPreviousWriter(block, addIndex, target),
+        findPreviousWriter(block, addIndex, other));
+    if(loadIndex < 0) return false;
+    auto load = list->get(loadIndex)->getSemantic()->getAssembly();
+    if(!load || load->getId() != X86_INS_MOVSXD) return false;
+    if(load->getAsmOperands()->getMode() != AssemblyOperands::MODE_MEM_REG) {
+        return false;
+    }
+    auto loadOps = load->getAsmOperands()->getOperands();
+    int loaded = X86Register::convertToPhysical(loadOps[1].reg);
+    int base = (loaded == target) ? other : target;
+    if(loaded != target && loaded != other) return false;
+    if(loadOps[0].mem.segment != X86_REG_INVALID
+        || loadOps[0].mem.disp != 0
+        || loadOps[0].mem.scale != 4
+        || X86Register::convertToPhysical(loadOps[0].mem.base) != base) {
+
+        return false;
+    }
+    int index = X86Register::convertToPhysical(loadOps[0].mem.index);
+    if(index < 0 || index == base) return false;
+
+    long leaIndex = findPreviousWriter(block, loadIndex, base);
+    if(leaIndex < 0) return false;
+    auto leaInstr = list->get(leaIndex);
+    auto lea = leaInstr->getSemantic()->getAssembly();
+    if(!lea || lea->getId() != X86_INS_LEA) return false;
+    auto leaOps = lea->getAsmOperands()->getOperands();
+    if(leaOps[0].type != X86_OP_MEM
+        || leaOps[0].mem.base != X86_REG_RIP
+        || leaOps[0].mem.index != X86_REG_INVALID) {
+
+        return false;
+    }
+    address_t tableBase = leaInstr->getAddress() + leaInstr->getSize()
+        + leaOps[0].mem.disp;
+
+    // the index may be zero-extended by a 32-bit move after the check
+    int compared = index;
+    long moveIndex = findPreviousWriter(block, loadIndex, index);
+    if(moveIndex >= 0) {
+        auto move = list->get(moveIndex)->getSemantic()->getAssembly();
+        if(!move || move->getId() != X86_INS_MOV) return false;
+        if(move->getAsmOperands()->getMode()
+            != AssemblyOperands::MODE_REG_REG) {
+
+            return false;
+        }
+        auto moveOps = move->getAsmOperands()->getOperands();
+        if(moveOps[1].size != 4) return false;
+        compared = X86Register::convertToPhysical(moveOps[0].reg);
+        if(compared < 0) return false;
+        if(findPreviousWriter(block, moveIndex, compared) >= 0) return false;
+    }
+
+    info->tableBase = tableBase;
+    info->targetBase = tableBase;
+    info->scale = 4;
+    if(!matchFastBound(block, cfg, compared, info)) return false;
+
+    // makeDescriptor() requires the table to be in a known data section
+    if(!module->getDataRegionList()->findDataSectionContaining(tableBase)) {
+        return false;
+    }
+    info->valid = true;
+    return true;
+}
+
+bool JumptableDetection::matchFastBound(Block *block, ControlFlowGraph *cfg,
+    int reg, JumptableInfo *info) {
+
+    // the bounds check must be the only way into the jump block
+    auto node = cfg->get(cfg->getIDFor(block));
+    int predID = -1;
+    for(auto link : node->backwardLinks()) {
+        if(predID >= 0) return false;
+        predID = link->getTargetID();
+    }
+    if(predID < 0) return false;
+
+    auto pred = cfg->get(predID)->getBlock();
+    auto list = pred->getChildren()->getIterable();
+    long count = list->getCount();
+    auto branch = list->getLast();
+    auto cfi = dynamic_cast<ControlFlowInstruction *>(branch->getSemantic());
+    if(!cfi || !cfi->getLink()) return false;
+
+    bool fallthrough = (predID + 1 == node->getID());
+    bool taken = (cfi->getLink()->getTargetAddress() == block->getAddress());
+    if(fallthrough == taken) return false;
+
+    auto mnemonic = cfi->getMnemonic();
+    long inclusive;
+    if(mnemonic == "ja" && fallthrough) inclusive = 1;
+    else if(mnemonic == "jae" && fallthrough) inclusive = 0;
+    else if(mnemonic == "jbe" && taken) inclusive = 1;
+    else if(mnemonic == "jb" && taken) inclusive = 0;
+    else return false;
+
+    long compareIndex = findPreviousWriter(pred, count - 1,
+        RegisterBitVector::FLAGS);
+    if(compareIndex < 0) return false;
+    auto compare = list->get(compareIndex)->getSemantic()->getAssembly();
+    if(!compare || compare->getId() != X86_INS_CMP) return false;
+    if(compare->getAsmOperands()->getMode()
+        != AssemblyOperands::MODE_IMM_REG) {
+
+        return false;
+    }
+    auto compareOps = compare->getAsmOperands()->getOperands();
+    if(X86Register::convertToPhysical(compareOps[1].reg) != reg) return false;
+    if(compareOps[0].imm < 0) return false;
+    if(findPreviousWriter(pred, count - 1, reg) > compareIndex) return false;
+
+    info->entries = compareOps[0].imm + inclusive;
+    LOG(10, "fast path: jump table at 0x" << std::hex << info->tableBase
+        << " with " << std::dec << info->entries << " entries");
+    return true;
+}
+#elif defined(ARCH_AARCH64)
+bool JumptableDetection::matchFast(Block *block, ControlFlowGraph *cfg,
+    JumptableInfo *info) {
+
+    // adrp xP, page ; add xB, xP, #lo12 ; ldrb wL, [xB, wI, uxtw] ;
+    // adr xA, target ; add xT, xA, wL, sxtb #2 ; br xT
+    auto list = block->getChildren()->getIterable();
+    long count = list->getCount();
+    if(count < 6) return false;
+
+    auto jump = list->get(count - 1)->getSemantic()->getAssembly();
+    int target = AARCH64GPRegister::convertToPhysical(
+        jump->getAsmOperands()->getOperands()[0].reg);
+
+    long addIndex = findPreviousWriter(block, count - 1, target);
+    if(addIndex < 0) return false;
+    auto add = list->get(addIndex)->getSemantic()->getAssembly();
+    if(!add || add->getId() != ARM64_INS_ADD) return false;
+    auto addOps = add->getAsmOperands()->getOperands();
+    if(add->getAsmOperands()->getOpCount() != 3
+        || addOps[1].type != ARM64_OP_REG
+        || addOps[2].type != ARM64_OP_REG
+        || addOps[2].shift.value != 2) {
+
+        return false;
+    }
+    int targetBaseReg = AARCH64GPRegister::convertToPhysical(addOps[1].reg);
+    int loaded = AARCH64GPRegister::convertToPhysical(addOps[2].reg);
+
+    long adrIndex = findPreviousWriter(block, addIndex, targetBaseReg);
+    if(adrIndex < 0) return false;
+    auto adr = list->get(adrIndex)->getSemantic()->getAssembly();
+    if(!adr || adr->getId() != ARM64_INS_ADR) return false;
+    address_t targetBase = adr->getAsmOperands()->getOperands()[1].imm;
+
+    long loadIndex = findPreviousWriter(block, addIndex, loaded);
+    if(loadIndex < 0) return false;
+    auto load = list->get(loadIndex)->getSemantic()->getAssembly();
+    if(!load) return false;
+    size_t scale;
+    switch(load->getId()) {
+    case ARM64_INS_LDRB:
+    case ARM64_INS_LDRSB:
+        scale = 1;
+        break;
+    case ARM64_INS_LDRH:
+    case ARM64_INS_LDRSH:
+        scale = 2;
+        break;
+    case ARM64_INS_LDRSW:
+        scale = 4;
+        break;
+    default:
+        return false;
+    }
+    auto loadOps = load->getAsmOperands()->getOperands();
+    if(load->getAsmOperands()->getWriteback()
+        || loadOps[1].type != ARM64_OP_MEM
+        || loadOps[1].mem.disp != 0
+        || loadOps[1].mem.index == ARM64_REG_INVALID) {
+
+        return false;
+    }
+    int base = AARCH64GPRegister::convertToPhysical(loadOps[1].mem.base);
+    int index = AARCH64GPRegister::convertToPhysical(loadOps[1].mem.index);
+    if(findPreviousWriter(block, loadIndex, index) >= 0) return false;
+
+    long addImmIndex = findPreviousWriter(block, loadIndex, base);
+    if(addImmIndex < 0) return false;
+    auto addImm = list->get(addImmIndex)->getSemantic()->getAssembly();
+    if(!addImm || addImm->getId() != ARM64_INS_ADD) return false;
+    auto addImmOps = addImm->getAsmOperands()->getOperands();
+    if(addImm->getAsmOperands()->getOpCount() != 3
+        || addImmOps[1].type != ARM64_OP_REG
+        || addImmOps[2].type != ARM64_OP_IMM
+        || addImmOps[2].shift.value != 0) {
+
+        return false;
+    }
+    int page = AARCH64GPRegister::convertToPhysical(addImmOps[1].reg);
+
+    long adrpIndex = findPreviousWriter(block, addImmIndex, page);
+    if(adrpIndex < 0) return false;
+    auto adrp = list->get(adrpIndex)->getSemantic()->getAssembly();
+    if(!adrp || adrp->getId() != ARM64_INS_ADRP) return false;
+    address_t tableBase = adrp->getAsmOperands()->getOperands()[1].imm
+        + addImmOps[2].imm;
+
+    info->tableBase = tableBase;
+    info->targetBase = targetBase;
+    info->scale = scale;
+    if(!matchFastBound(block, cfg, index, info)) return false;
+
+    // makeDescriptor() requires the table to be in a known data section
+    if(!module->getDataRegionList()->findDataSectionContaining(tableBase)) {
+        return false;
+    }
+    info->valid = true;
+    return true;
+}
+
+bool JumptableDetection::matchFastBound(Block *block, ControlFlowGraph *cfg,
+    int reg, JumptableInfo *info) {
+
+    // the bounds check must be the only way into the jump block
+    auto node = cfg->get(cfg->getIDFor(block));
+    int predID = -1;
+    for(auto link : node->backwardLinks()) {
+        if(predID >= 0) return false;
+        predID = link->getTargetID();
+    }
+    if(predID < 0) return false;
+
+    auto pred = cfg->get(predID)->getBlock();
+    auto list = pred->getChildren()->getIterable();
+    long count = list->getCount();
+    auto branch = list->getLast();
+    auto cfi = dynamic_cast<ControlFlowInstruction *>(branch->getSemantic());
+    if(!cfi || !cfi->getLink()) return false;
+
+    bool fallthrough = (predID + 1 == node->getID());
+    bool taken = (cfi->getLink()->getTargetAddress() == block->getAddress());
+    if(fallthrough == taken) return false;
+
+    auto mnemonic = cfi->getAssembly()->getMnemonic();
+    long inclusive;
+    if(mnemonic == "b.hi" && fallthrough) inclusive = 1;
+    else if((mnemonic == "b.hs" || mnemonic == "b.cs") && fallthrough) {
+        inclusive = 0;
+    }
+    else if(mnemonic == "b.ls" && taken) inclusive = 1;
+    else if((mnemonic == "b.lo" || mnemonic == "b.cc") && taken) {
+        inclusive = 0;
+    }
+    else return false;
+
+    long compareIndex = findPreviousWriter(pred, count - 1,
+        RegisterBitVector::FLAGS);
+    if(compareIndex < 0) return false;
+    auto compare = list->get(compareIndex)->getSemantic()->getAssembly();
+    if(!compare || compare->getId() != ARM64_INS_CMP) return false;
+    auto compareOps = compare->getAsmOperands()->getOperands();
+    if(compare->getAsmOperands()->getOpCount() != 2
+        || compareOps[1].type != ARM64_OP_IMM
+        || compareOps[1].shift.value != 0) {
+
+        return false;
+    }
+    if(AARCH64GPRegister::convertToPhysical(compareOps[0].reg) != reg) {
+        return false;
+    }
+    if(compareOps[1].imm < 0) return false;
+    if(findPreviousWriter(pred, count - 1, reg) > compareIndex) return false;
+
+    info->entries = compareOps[1].imm + inclusive;
+    LOG(10, "fast path: jump table at 0x" << std::hex << info->tableBase
+        << " with " << std::dec << info->entries << " entries");
+    return true;
+}
+#else
+bool JumptableDetection::matchFast(Block *block, ControlFlowGraph *cfg,
+    JumptableInfo *info) {
+
+    return false;
+}
+
+bool JumptableDetection::matchFastBound(Block *block, ControlFlowGraph *cfg,
+    int reg, JumptableInfo *info) {
+
+    return false;
+}
+#endif
+
 bool JumptableDetection::parseJumptable(UDState *state, TreeCapture& cap,
     JumptableInfo *info) {
 
@@ -395,7 +787,6 @@ bool JumptableDetection::parseJumptableWithIndexTable(UDState *state,
 void JumptableDetection::makeDescriptor(Instruction *instruction,
     const JumptableInfo *info) {
 
-    auto working = info->working;
     auto it = tableMap.find(instruction);
     if(it != tableMap.end()) {
         bool exists = false;
@@ -414,7 +805,10 @@ void JumptableDetection::makeDescriptor(Instruction *instruction,
         if(exists) return;
     }
 
-    auto jtd = new JumpTableDescriptor(working->getFunction(), instruction);
+    // the fast path has no working set, so find the function directly
+    auto function
+        = dynamic_cast<Function *>(instruction->getParent()->getParent());
+    auto jtd = new JumpTableDescriptor(function, instruction);
     jtd->setAddress(info->tableBase);
     Link *link = nullptr;
     if(info->tableBase == info->targetBase) {
@@ -423,8 +817,6 @@ void JumptableDetection::makeDescriptor(Instruction *instruction,
     else {
         // even for X86_64, jump table base != target base for hand-written
         // jump tables
-        auto function
-            = dynamic_cast<Function *>(instruction->getParent()->getParent());
         auto target = ChunkFind().findInnermostAt(function, info->targetBase);
         if(target) {
             link = LinkFactory::makeNormalLink(target, true, false);
@@ -446,7 +838,7 @@ void JumptableDetection::makeDescriptor(Instruction *instruction,
     tableList.push_back(jtd);
 
     LOG(10, "jump table jump at "
-        << std::hex << info->jumpState->getInstruction()->getAddress());
+        << std::hex << instruction->getAddress());
     LOG(10, "descriptor:" << jtd);
     LOG(10, "baseAddress = " << std::hex << info->tableBase);
     LOG(10, "targetBaseAddress = " << std::hex << info->targetBase);
@@ -10,10 +10,26 @@
 
 class Module;
 class Function;
+class Block;
 class Instruction;
 class UDRegMemWorkingSet;
 
 class JumptableDetection {
+public:
+    /** Counters for the two detection tiers, accumulated over every
+        detect() call made on this object.
+    */
+    struct Statistics {
+        unsigned long fastJumps;        // resolved by the pattern scan
+        unsigned long fullJumps;        // left to the use-def analysis
+        unsigned long fastFunctions;
+        unsigned long fullFunctions;
+        unsigned long fastMicroseconds; // includes unsuccessful scans
+        unsigned long fullMicroseconds;
+
+        Statistics() : fastJumps(0), fullJumps(0), fastFunctions(0),
+            fullFunctions(0), fastMicroseconds(0), fullMicroseconds(0) {}
+    };
 private:
     struct JumptableInfo {
         ControlFlowGraph *cfg;
@@ -49,6 +65,7 @@ private:
     // because the non-first use of index table requires complex analysis
     std::map<address_t /* index table base */, IndextableInfo> indexTables;
 
+    Statistics statistics;
 public:
     JumptableDetection(Module *module) : module(module) {}
     void detect(Module *module);
@@ -56,9 +73,18 @@ public:
     void detect(UDRegMemWorkingSet *working);
     const std::vector<JumpTableDescriptor *> &getTableList() const
         { return tableList; }
+    const Statistics &getStatistics() const { return statistics; }
 
 private:
     bool containsIndirectJump(Function *function) const;
+
+    // fast path: recognizes the compiler's canonical switch sequence with
+    // a linear scan of the jump block and the block holding its bounds check
+    bool detectFast(Function *function, ControlFlowGraph *cfg);
+    bool matchFast(Block *block, ControlFlowGraph *cfg, JumptableInfo *info);
+    bool matchFastBound(Block *block, ControlFlowGraph *cfg, int reg,
+        JumptableInfo *info);
+
     bool parseJumptable(UDState *state, TreeCapture& cap, JumptableInfo *info);
     void parseOldCJumptable(UDState *state, int reg, JumptableInfo *info);
     bool parseJumptableWithIndexTable(UDState *state, int reg,
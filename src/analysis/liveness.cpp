@@ -0,0 +1,957 @@
+#include <deque>
+#include <set>
+#include <algorithm>
+#include <cctype>
+#include "liveness.h"
+#include "analysis/controlflow.h"
+#include "analysis/compactcallgraph.h"
+#include "analysis/walker.h"
+#include "chunk/concrete.h"
+#include "chunk/link.h"
+#include "chunk/plt.h"
+#include "instr/concrete.h"
+#include "instr/register.h"
+#include "instr/semantic.h"
+
+#include "log/log.h"
+
+bool RegisterBitVector::empty() const {
+    for(size_t i = 0; i < WORDS; i ++) {
+        if(word[i]) return false;
+    }
+    return true;
+}
+
+size_t RegisterBitVector::count() const {
+    size_t total = 0;
+    for(size_t i = 0; i < WORDS; i ++) {
+        total += __builtin_popcountll(word[i]);
+    }
+    return total;
+}
+
+RegisterBitVector &RegisterBitVector::operator |= (
+    const RegisterBitVector &other) {
+
+    for(size_t i = 0; i < WORDS; i ++) word[i] |= other.word[i];
+    return *this;
+}
+
+RegisterBitVector &RegisterBitVector::operator &= (
+    const RegisterBitVector &other) {
+
+    for(size_t i = 0; i < WORDS; i ++) word[i] &= other.word[i];
+    return *this;
+}
+
+RegisterBitVector &RegisterBitVector::subtract(const RegisterBitVector &other) {
+    for(size_t i = 0; i < WORDS; i ++) word[i] &= ~other.word[i];
+    return *this;
+}
+
+bool RegisterBitVector::operator == (const RegisterBitVector &other) const {
+    for(size_t i = 0; i < WORDS; i ++) {
+        if(word[i] != other.word[i]) return false;
+    }
+    return true;
+}
+
+bool RegisterBitVector::assignTransfer(const RegisterBitVector &use,
+    const RegisterBitVector &live, const RegisterBitVector &kill) {
+
+    uint64_t changed = 0;
+    for(size_t i = 0; i < WORDS; i ++) {
+        uint64_t value = use.word[i] | (live.word[i] & ~kill.word[i]);
+        changed |= value ^ word[i];
+        word[i] = value;
+    }
+    return changed != 0;
+}
+
+void RegisterBitVector::dump() const {
+    LOG0(1, "{");
+    forEach([] (int reg) {
+#ifdef ARCH_X86_64
+        if(reg < FLAGS) {
+            LOG0(1, " " << X86Register::getRepresentativeName(reg));
+        }
+        else if(reg == FLAGS) LOG0(1, " flags");
+        else if(reg < MASK_BEGIN) LOG0(1, " v" << (reg - VECTOR_BEGIN));
+        else LOG0(1, " k" << (reg - MASK_BEGIN));
+#elif defined(ARCH_AARCH64)
+        if(reg < VECTOR_BEGIN) LOG0(1, " x" << reg);
+        else if(reg < FLAGS) LOG0(1, " v" << (reg - VECTOR_BEGIN));
+        else LOG0(1, " nzcv");
+#else
+        LOG0(1, " " << reg);
+#endif
+    });
+    LOG(1, " }");
+}
+
+int RegisterBitVector::getIndex(int reg) {
+#ifdef ARCH_X86_64
+    if(reg == X86_REG_EFLAGS) return FLAGS;
+    if(X86_REG_XMM0 <= reg && reg <= X86_REG_XMM31) {
+        return VECTOR_BEGIN + (reg - X86_REG_XMM0);
+    }
+    if(X86_REG_YMM0 <= reg && reg <= X86_REG_YMM31) {
+        return VECTOR_BEGIN + (reg - X86_REG_YMM0);
+    }
+    if(X86_REG_ZMM0 <= reg && reg <= X86_REG_ZMM31) {
+        return VECTOR_BEGIN + (reg - X86_REG_ZMM0);
+    }
+    if(X86_REG_K0 <= reg && reg <= X86_REG_K7) {
+        return MASK_BEGIN + (reg - X86_REG_K0);
+    }
+    return X86Register::convertToPhysical(reg);
+#elif defined(ARCH_AARCH64)
+    // XZR shares R31 with SP in AARCH64GPRegister, but is not a register
+    if(reg == ARM64_REG_XZR || reg == ARM64_REG_WZR) return -1;
+    if(reg == ARM64_REG_NZCV) return FLAGS;
+    return AARCH64GPRegister::convertToPhysical(reg);
+#else
+    return -1;
+#endif
+}
+
+static RegisterBitVector makeRange(int begin, int end) {
+    RegisterBitVector regs;
+    for(int r = begin; r <= end; r ++) regs.set(r);
+    return regs;
+}
+
+RegisterBitVector RegisterBitVector::everything() {
+#ifdef ARCH_X86_64
+    auto regs = makeRange(X86Register::R0, FLAGS);
+    regs |= makeRange(VECTOR_BEGIN, MASK_BEGIN + 7);
+#elif defined(ARCH_AARCH64)
+    auto regs = makeRange(AARCH64GPRegister::R0, FLAGS);
+#else
+    auto regs = makeRange(0, BITS - 1);
+#endif
+    return regs;
+}
+
+RegisterBitVector RegisterBitVector::callerSaved() {
+#ifdef ARCH_X86_64
+    RegisterBitVector regs;
+    for(int r : {X86Register::R0, X86Register::R1, X86Register::R2,
+        X86Register::R6, X86Register::R7}) {
+
+        regs.set(r);
+    }
+    regs |= makeRange(X86Register::R8, X86Register::R11);
+    regs.set(FLAGS);
+    regs |= makeRange(VECTOR_BEGIN, MASK_BEGIN + 7);
+    return regs;
+#elif defined(ARCH_AARCH64)
+    auto regs = makeRange(AARCH64GPRegister::R0, AARCH64GPRegister::R18);
+    regs.set(AARCH64GPRegister::LR);
+    // only the low 64 bits of V8-V15 are preserved; we treat them as saved
+    regs |= makeRange(AARCH64GPRegister::V0, AARCH64GPRegister::V7);
+    regs |= makeRange(AARCH64GPRegister::V16, AARCH64GPRegister::V31);
+    regs.set(FLAGS);
+    return regs;
+#else
+    return everything();
+#endif
+}
+
+RegisterBitVector RegisterBitVector::calleeSaved() {
+#ifdef ARCH_X86_64
+    RegisterBitVector regs;
+    regs.set(X86Register::R3);
+    regs.set(X86Register::BP);
+    regs |= makeRange(X86Register::R12, X86Register::R15);
+    return regs;
+#elif defined(ARCH_AARCH64)
+    auto regs = makeRange(AARCH64GPRegister::R19, AARCH64GPRegister::FP);
+    regs |= makeRange(AARCH64GPRegister::V8, AARCH64GPRegister::V15);
+    return regs;
+#else
+    return RegisterBitVector();
+#endif
+}
+
+RegisterBitVector RegisterBitVector::argumentRegisters() {
+#ifdef ARCH_X86_64
+    RegisterBitVector regs;
+    // %al carries the number of vector arguments for varargs calls
+    for(int r : {X86Register::R7, X86Register::R6, X86Register::R2,
+        X86Register::R1, X86Register::R8, X86Register::R9, X86Register::R0}) {
+
+        regs.set(r);
+    }
+    regs |= makeRange(VECTOR_BEGIN, VECTOR_BEGIN + 7);
+    return regs;
+#elif defined(ARCH_AARCH64)
+    // X8 is the indirect result location register
+    auto regs = makeRange(AARCH64GPRegister::R0, AARCH64GPRegister::R8);
+    regs |= makeRange(AARCH64GPRegister::V0, AARCH64GPRegister::V7);
+    return regs;
+#else
+    return everything();
+#endif
+}
+
+RegisterBitVector RegisterBitVector::returnRegisters() {
+#ifdef ARCH_X86_64
+    RegisterBitVector regs;
+    regs.set(X86Register::R0);
+    regs.set(X86Register::R2);
+    regs.set(VECTOR_BEGIN + 0);
+    regs.set(VECTOR_BEGIN + 1);
+    return regs;
+#elif defined(ARCH_AARCH64)
+    auto regs = makeRange(AARCH64GPRegister::R0, AARCH64GPRegister::R1);
+    regs |= makeRange(AARCH64GPRegister::V0, AARCH64GPRegister::V3);
+    return regs;
+#else
+    return everything();
+#endif
+}
+
+RegisterBitVector RegisterBitVector::stackPointer() {
+    RegisterBitVector regs;
+#ifdef ARCH_X86_64
+    regs.set(X86Register::SP);
+#elif defined(ARCH_AARCH64)
+    regs.set(AARCH64GPRegister::SP);
+#endif
+    return regs;
+}
+
+static Function *getFunctionTarget(Link *link) {
+    if(!link) return nullptr;
+    if(auto pltLink = dynamic_cast<PLTLink *>(link)) {
+        return dynamic_cast<Function *>(
+            pltLink->getPLTTrampoline()->getTarget());
+    }
+    return dynamic_cast<Function *>(&*link->getTarget());
+}
+
+static bool isTargetOutside(Link *link, Function *function) {
+    if(!link) return true;
+    if(dynamic_cast<PLTLink *>(link)) return true;
+    auto target = &*link->getTarget();
+    if(!target) return true;
+    if(dynamic_cast<Function *>(target)) return true;
+    for(Chunk *c = target; c; c = c->getParent()) {
+        if(c == function) return false;
+    }
+    return true;
+}
+
+RegisterAccess::RegisterAccess(Instruction *instr,
+    InterproceduralLiveness *summaries) {
+
+    auto semantic = instr->getSemantic();
+    auto function = dynamic_cast<Function *>(instr->getParent()->getParent());
+
+    if(dynamic_cast<ReturnInstruction *>(semantic)) {
+        handleReturn();
+        return;
+    }
+    if(dynamic_cast<BreakInstruction *>(semantic)
+        || dynamic_cast<LiteralInstruction *>(semantic)) {
+
+        return;
+    }
+#ifdef ARCH_AARCH64
+    if(dynamic_cast<LinkedLiteralInstruction *>(semantic)) return;
+#endif
+
+#if defined(ARCH_X86_64) || defined(ARCH_AARCH64)
+    if(auto cfi = dynamic_cast<ControlFlowInstruction *>(semantic)) {
+        auto link = cfi->getLink();
+#ifdef ARCH_X86_64
+        std::string mnemonic = cfi->getMnemonic();
+        bool isCall = (mnemonic == "callq");
+        if(mnemonic != "jmp" && !isCall) {
+            use.set(RegisterBitVector::FLAGS);
+        }
+        if(mnemonic == "jrcxz" || mnemonic == "jecxz"
+            || mnemonic.compare(0, 4, "loop") == 0) {
+
+            use.set(X86Register::R1);
+            def.set(X86Register::R1);
+        }
+#else
+        std::string mnemonic = cfi->getAssembly()->getMnemonic();
+        bool isCall = (mnemonic == "bl");
+        if(mnemonic.compare(0, 2, "b.") == 0) {
+            use.set(RegisterBitVector::FLAGS);
+        }
+        // cbz/cbnz/tbz/tbnz test a register
+        auto asmOps = cfi->getAssembly()->getAsmOperands();
+        for(size_t i = 0; i < asmOps->getOpCount(); i ++) {
+            auto &op = asmOps->getOperands()[i];
+            if(op.type == ARM64_OP_REG) addUse(op.reg);
+        }
+#endif
+        if(isCall) {
+            handleCall(getFunctionTarget(link), summaries);
+        }
+        else if(isTargetOutside(link, function)) {
+            handleTailCall(getFunctionTarget(link), summaries);
+        }
+        return;
+    }
+#endif
+
+    if(auto icf = dynamic_cast<IndirectControlFlowInstructionBase *>(
+        semantic)) {
+
+        addUse(icf->getRegister());
+        if(icf->hasMemoryOperand()) addUse(icf->getIndexRegister());
+
+        if(dynamic_cast<IndirectCallInstruction *>(semantic)) {
+            handleCall(nullptr, summaries);
+        }
+        else if(auto ij = dynamic_cast<IndirectJumpInstruction *>(semantic)) {
+#ifdef ARCH_X86_64
+            if(ij->getMnemonic() == "callq") handleCall(nullptr, summaries);
+#elif defined(ARCH_AARCH64)
+            if(ij->getMnemonic() == "blr") handleCall(nullptr, summaries);
+#else
+            if(0) {}
+#endif
+            else if(!ij->isForJumpTable()) {
+                // we cannot tell where this goes, so everything may be live
+                use |= RegisterBitVector::everything();
+                def |= RegisterBitVector::everything();
+            }
+        }
+        return;
+    }
+
+#ifdef ARCH_X86_64
+    if(auto dlcfi = dynamic_cast<DataLinkedControlFlowInstruction *>(
+        semantic)) {
+
+        handleAssembly(instr);
+        if(dlcfi->isCall()) handleCall(nullptr, summaries);
+        else handleTailCall(nullptr, summaries);
+        return;
+    }
+#endif
+
+    if(!semantic->getAssembly()) {
+        handleUnknown();
+        return;
+    }
+    handleAssembly(instr);
+}
+
+void RegisterAccess::addUse(int reg) {
+    int index = RegisterBitVector::getIndex(reg);
+    if(index >= 0) use.set(index);
+}
+
+void RegisterAccess::addDef(int reg, bool full) {
+    int index = RegisterBitVector::getIndex(reg);
+    if(index < 0) return;
+    def.set(index);
+    if(full && !RegisterBitVector::stackPointer().get(index)) {
+        kill.set(index);
+    }
+}
+
+void RegisterAccess::handleCall(Function *target,
+    InterproceduralLiveness *summaries) {
+
+    auto callerSaved = RegisterBitVector::callerSaved();
+    const RegisterSummary *summary = nullptr;
+    if(target && summaries) summary = summaries->lookup(target);
+
+    // callee-saved registers are read by any landing pad of this call, and
+    // are restored by the unwinder before control gets there
+    use |= RegisterBitVector::calleeSaved();
+    use |= RegisterBitVector::stackPointer();
+    if(summary) {
+        use |= summary->getLiveIn();
+        def |= summary->getClobbered();
+
+        // registers the callee leaves alone may be kept live across the
+        // call (e.g. gcc -fipa-ra), so only kill what it may overwrite
+        auto clobbered = summary->getClobbered();
+        clobbered &= callerSaved;
+        kill |= clobbered;
+    }
+    else {
+        use |= RegisterBitVector::argumentRegisters();
+        def |= callerSaved;
+        kill |= callerSaved;
+    }
+#ifdef ARCH_AARCH64
+    def.set(AARCH64GPRegister::LR);
+    kill.set(AARCH64GPRegister::LR);
+#endif
+}
+
+void RegisterAccess::handleTailCall(Function *target,
+    InterproceduralLiveness *summaries) {
+
+    const RegisterSummary *summary = nullptr;
+    if(target && summaries) summary = summaries->lookup(target);
+
+    use |= RegisterBitVector::calleeSaved();
+    use |= RegisterBitVector::stackPointer();
+    if(summary) {
+        use |= summary->getLiveIn();
+        def |= summary->getClobbered();
+    }
+    else {
+        use |= RegisterBitVector::argumentRegisters();
+        use |= RegisterBitVector::returnRegisters();
+        def |= RegisterBitVector::callerSaved();
+    }
+}
+
+void RegisterAccess::handleReturn() {
+    use |= RegisterBitVector::returnRegisters();
+    use |= RegisterBitVector::calleeSaved();
+    use |= RegisterBitVector::stackPointer();
+#ifdef ARCH_AARCH64
+    use.set(AARCH64GPRegister::LR);
+#endif
+}
+
+void RegisterAccess::handleUnknown() {
+    use |= RegisterBitVector::everything();
+    def |= RegisterBitVector::everything();
+}
+
+#ifdef ARCH_X86_64
+// the last (AT&T destination) operand is only read
+static bool isReadOnlyX86(unsigned int id) {
+    switch(id) {
+    case X86_INS_CMP:
+    case X86_INS_TEST:
+    case X86_INS_BT:
+    case X86_INS_PUSH:
+    case X86_INS_NOP:
+    case X86_INS_UCOMISS:
+    case X86_INS_UCOMISD:
+    case X86_INS_COMISS:
+    case X86_INS_COMISD:
+    case X86_INS_VUCOMISS:
+    case X86_INS_VUCOMISD:
+    case X86_INS_VCOMISS:
+    case X86_INS_VCOMISD:
+    case X86_INS_PTEST:
+    case X86_INS_VPTEST:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// the destination operand is written without being read
+static bool isWriteOnlyX86(unsigned int id) {
+    switch(id) {
+    case X86_INS_MOV:
+    case X86_INS_MOVABS:
+    case X86_INS_MOVZX:
+    case X86_INS_MOVSX:
+    case X86_INS_MOVSXD:
+    case X86_INS_LEA:
+    case X86_INS_POP:
+    case X86_INS_MOVD:
+    case X86_INS_MOVQ:
+    case X86_INS_VMOVD:
+    case X86_INS_VMOVQ:
+    case X86_INS_VMOVAPS:
+    case X86_INS_VMOVAPD:
+    case X86_INS_VMOVUPS:
+    case X86_INS_VMOVUPD:
+    case X86_INS_VMOVDQA:
+    case X86_INS_VMOVDQU:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// xor %eax,%eax and friends do not depend on the old value
+static bool isZeroIdiomX86(unsigned int id) {
+    switch(id) {
+    case X86_INS_XOR:
+    case X86_INS_SUB:
+    case X86_INS_VPXOR:
+    case X86_INS_VXORPS:
+    case X86_INS_VXORPD:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// instructions which overwrite every status flag
+static bool writesAllFlagsX86(unsigned int id) {
+    switch(id) {
+    case X86_INS_ADD:
+    case X86_INS_ADC:
+    case X86_INS_SUB:
+    case X86_INS_SBB:
+    case X86_INS_AND:
+    case X86_INS_OR:
+    case X86_INS_XOR:
+    case X86_INS_CMP:
+    case X86_INS_TEST:
+    case X86_INS_NEG:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool isFullWriteX86(int reg, unsigned int id) {
+    int index = RegisterBitVector::getIndex(reg);
+    if(index < 0) return false;
+    if(index < X86Register::REGISTER_NUMBER) {
+        // 32-bit writes zero-extend; 8- and 16-bit writes merge
+        return X86Register::getWidth(index, reg) >= 4;
+    }
+    if(index < RegisterBitVector::MASK_BEGIN) {
+        // only VEX/EVEX encodings clear the upper part of the register
+        switch(id) {
+        case X86_INS_VMOVD:
+        case X86_INS_VMOVQ:
+        case X86_INS_VMOVAPS:
+        case X86_INS_VMOVAPD:
+        case X86_INS_VMOVUPS:
+        case X86_INS_VMOVUPD:
+        case X86_INS_VMOVDQA:
+        case X86_INS_VMOVDQU:
+        case X86_INS_VPXOR:
+        case X86_INS_VXORPS:
+        case X86_INS_VXORPD:
+            return true;
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+#endif
+
+void RegisterAccess::handleAssembly(Instruction *instr) {
+    auto assembly = instr->getSemantic()->getAssembly();
+    if(!assembly) {
+        handleUnknown();
+        return;
+    }
+    auto asmOps = assembly->getAsmOperands();
+    size_t count = asmOps->getOpCount();
+    unsigned int id = assembly->getId();
+    const std::string &mnemonic = assembly->getMnemonic();
+
+    for(size_t i = 0; i < assembly->getImplicitRegsReadCount(); i ++) {
+        addUse(assembly->getImplicitRegsRead()[i]);
+    }
+
+#ifdef ARCH_X86_64
+    for(size_t i = 0; i < assembly->getImplicitRegsWriteCount(); i ++) {
+        int reg = assembly->getImplicitRegsWrite()[i];
+        if(reg == X86_REG_EFLAGS) addDef(reg, writesAllFlagsX86(id));
+        else addDef(reg, isFullWriteX86(reg, id));
+    }
+    if(mnemonic.compare(0, 4, "cmov") == 0
+        || mnemonic.compare(0, 3, "set") == 0) {
+
+        use.set(RegisterBitVector::FLAGS);
+    }
+
+    if(id == X86_INS_SYSCALL) {
+        for(auto r : {X86_REG_RAX, X86_REG_RDI, X86_REG_RSI, X86_REG_RDX,
+            X86_REG_R10, X86_REG_R8, X86_REG_R9}) {
+
+            addUse(r);
+        }
+        for(auto r : {X86_REG_RAX, X86_REG_RCX, X86_REG_R11}) {
+            addDef(r, true);
+        }
+        return;
+    }
+
+    bool readOnly = isReadOnlyX86(id);
+    bool writeOnly = isWriteOnlyX86(id);
+    bool bothWritten = (id == X86_INS_XCHG || id == X86_INS_XADD);
+
+    bool zeroIdiom = false;
+    if(isZeroIdiomX86(id) && count >= 2) {
+        zeroIdiom = true;
+        for(size_t i = 0; i < count; i ++) {
+            auto &op = asmOps->getOperands()[i];
+            if(op.type != X86_OP_REG
+                || op.reg != asmOps->getOperands()[0].reg) {
+
+                zeroIdiom = false;
+            }
+        }
+    }
+
+    int dest = (readOnly || count == 0) ? -1 : static_cast<int>(count) - 1;
+    for(size_t i = 0; i < count; i ++) {
+        auto &op = asmOps->getOperands()[i];
+        if(op.type == X86_OP_REG) {
+            if(static_cast<int>(i) == dest) {
+                if(!writeOnly && !zeroIdiom) addUse(op.reg);
+                addDef(op.reg, (writeOnly || zeroIdiom)
+                    && isFullWriteX86(op.reg, id));
+            }
+            else {
+                if(!zeroIdiom) addUse(op.reg);
+                if(bothWritten) addDef(op.reg, false);
+            }
+        }
+        else if(op.type == X86_OP_MEM) {
+            addUse(op.mem.base);
+            addUse(op.mem.index);
+        }
+    }
+#elif defined(ARCH_AARCH64)
+    for(size_t i = 0; i < assembly->getImplicitRegsWriteCount(); i ++) {
+        int reg = assembly->getImplicitRegsWrite()[i];
+        // flag-setting instructions always write all of NZCV
+        addDef(reg, reg == ARM64_REG_NZCV);
+    }
+
+    static const char *flagReaders[] = {
+        "csel", "csinc", "csinv", "csneg", "cset", "csetm", "cinc", "cinv",
+        "cneg", "ccmp", "ccmn", "fcsel", "fccmp", "fccmpe", "adc", "adcs",
+        "sbc", "sbcs", "ngc", "ngcs"
+    };
+    for(auto name : flagReaders) {
+        if(mnemonic == name) use.set(RegisterBitVector::FLAGS);
+    }
+
+    if(id == ARM64_INS_SVC) {
+        for(int r = AARCH64GPRegister::R0; r <= AARCH64GPRegister::R5; r ++) {
+            use.set(r);
+        }
+        use.set(AARCH64GPRegister::R8);
+        def.set(AARCH64GPRegister::R0);
+        kill.set(AARCH64GPRegister::R0);
+        return;
+    }
+
+    // registers which are written: -1 none, 1 first operand, 2 first two
+    int written = 1;
+    bool fullWrite = true;
+    if(mnemonic.compare(0, 2, "st") == 0) {
+        // exclusive stores write a status register first
+        bool exclusive = (mnemonic.find("xr") != std::string::npos
+            || mnemonic.find("xp") != std::string::npos);
+        written = exclusive ? 1 : 0;
+    }
+    else if(mnemonic == "cmp" || mnemonic == "cmn" || mnemonic == "tst"
+        || mnemonic == "fcmp" || mnemonic == "fcmpe" || mnemonic == "ccmp"
+        || mnemonic == "ccmn" || mnemonic == "fccmp" || mnemonic == "fccmpe"
+        || mnemonic == "prfm" || mnemonic == "prfum" || mnemonic == "nop"
+        || mnemonic == "hint" || mnemonic == "sys" || mnemonic == "dmb"
+        || mnemonic == "dsb" || mnemonic == "isb") {
+
+        written = 0;
+    }
+    else if(mnemonic == "msr") {
+        written = 0;
+        if(assembly->getOpStr().find("nzcv") != std::string::npos) {
+            def.set(RegisterBitVector::FLAGS);
+            kill.set(RegisterBitVector::FLAGS);
+        }
+    }
+    else if(mnemonic == "mrs") {
+        if(assembly->getOpStr().find("nzcv") != std::string::npos) {
+            use.set(RegisterBitVector::FLAGS);
+        }
+    }
+    else if(mnemonic == "ldp" || mnemonic == "ldnp" || mnemonic == "ldpsw"
+        || mnemonic == "ldxp" || mnemonic == "ldaxp") {
+
+        written = 2;
+    }
+    else if(mnemonic.size() >= 3 && mnemonic.compare(0, 2, "ld") == 0
+        && std::isdigit(mnemonic[2])) {
+
+        // ld1..ld4 may load single lanes; all listed registers are merged
+        written = static_cast<int>(count);
+        fullWrite = false;
+    }
+    else if(mnemonic == "movk" || mnemonic == "bfi" || mnemonic == "bfxil"
+        || mnemonic == "bfm" || mnemonic == "ins") {
+
+        fullWrite = false;
+    }
+    else {
+        static const char *accumulators[] = {
+            "fmla", "fmls", "mla", "mls", "bsl", "bit", "bif", "sli", "sri",
+            "tbx", "usra", "ssra", "ursra", "srsra", "smlal", "smlal2",
+            "umlal", "umlal2", "smlsl", "smlsl2", "umlsl", "umlsl2",
+            "sqdmlal", "sqdmlal2", "sqdmlsl", "sqdmlsl2", "sadalp", "uadalp",
+            "saba", "uaba", "sabal", "sabal2", "uabal", "uabal2", "fcmla",
+            "sdot", "udot"
+        };
+        for(auto name : accumulators) {
+            // scalar mla/mls take a separate addend as a fourth operand
+            if(mnemonic == name && count <= 3) fullWrite = false;
+        }
+        // narrowing "2" forms write only the upper half of the vector
+        if(!mnemonic.empty() && mnemonic.back() == '2') fullWrite = false;
+    }
+
+    for(size_t i = 0; i < count; i ++) {
+        auto &op = asmOps->getOperands()[i];
+        if(op.type == ARM64_OP_REG) {
+            if(static_cast<int>(i) < written) {
+                bool full = fullWrite && op.vector_index == -1;
+                if(!full) addUse(op.reg);
+                addDef(op.reg, full);
+            }
+            else addUse(op.reg);
+        }
+        else if(op.type == ARM64_OP_MEM) {
+            addUse(op.mem.base);
+            addUse(op.mem.index);
+            if(asmOps->getWriteback()) addDef(op.mem.base, false);
+        }
+    }
+#else
+    handleUnknown();
+#endif
+}
+
+LivenessAnalysis::LivenessAnalysis(Function *function, ControlFlowGraph *cfg,
+    InterproceduralLiveness *summaries)
+    : function(function), summaries(summaries) {
+
+    // make sure every callee reachable from here has a summary
+    if(summaries) summaries->getSummary(function);
+
+    size_t count = cfg->getCount();
+    gen.resize(count);
+    killed.resize(count);
+    liveIn.resize(count);
+    liveOut.resize(count);
+    for(size_t id = 0; id < count; id ++) {
+        auto block = cfg->get(id)->getBlock();
+        blockMapping[block] = id;
+        blockList.push_back(block);
+    }
+
+    for(size_t id = 0; id < count; id ++) {
+        computeLocal(id);
+    }
+    solve(cfg);
+
+    if(count > 0) entry = liveIn[0];
+}
+
+void LivenessAnalysis::computeLocal(int id) {
+    auto list = blockList[id]->getChildren()->getIterable();
+    for(int i = static_cast<int>(list->getCount()) - 1; i >= 0; i --) {
+        RegisterAccess access(list->get(i), summaries);
+        defined |= access.getDef();
+        gen[id].assignTransfer(access.getUse(), gen[id], access.getKill());
+        killed[id] |= access.getKill();
+    }
+}
+
+void LivenessAnalysis::solve(ControlFlowGraph *cfg) {
+    if(cfg->getCount() == 0) return;
+
+    // postorder visits successors first, which suits a backward problem
+    Postorder order(cfg);
+    order.genFull(0);
+
+    std::deque<int> worklist;
+    std::vector<bool> queued(cfg->getCount(), false);
+    for(const auto &list : order.get()) {
+        for(auto id : list) {
+            worklist.push_back(id);
+            queued[id] = true;
+        }
+    }
+
+    size_t iterations = 0;
+    while(!worklist.empty()) {
+        int id = worklist.front();
+        worklist.pop_front();
+        queued[id] = false;
+        iterations ++;
+
+        auto node = cfg->get(id);
+        RegisterBitVector out;
+        for(auto link : node->forwardLinks()) {
+            auto cfLink = static_cast<ControlFlowLink *>(&*link);
+            out |= getLiveAtOffset(cfLink->getTargetID(),
+                cfLink->getOffset());
+        }
+
+        bool changed = (out != liveOut[id]);
+        liveOut[id] = out;
+        changed |= liveIn[id].assignTransfer(gen[id], out, killed[id]);
+        if(!changed) continue;
+
+        for(auto link : node->backwardLinks()) {
+            int pred = link->getTargetID();
+            if(!queued[pred]) {
+                worklist.push_back(pred);
+                queued[pred] = true;
+            }
+        }
+    }
+
+    LOG(10, "liveness for " << function->getName() << " converged after "
+        << std::dec << iterations << " block visits");
+}
+
+RegisterBitVector LivenessAnalysis::getLiveAtOffset(int id, int offset) {
+    if(offset == 0) return liveIn[id];
+
+    // an edge into the middle of a block (not split by SplitBasicBlock)
+    auto block = blockList[id];
+    auto list = block->getChildren()->getIterable();
+    RegisterBitVector live = liveOut[id];
+    for(int i = static_cast<int>(list->getCount()) - 1; i >= 0; i --) {
+        auto instr = list->get(i);
+        RegisterAccess access(instr, summaries);
+        live.assignTransfer(access.getUse(), live, access.getKill());
+        if(instr->getAddress() - block->getAddress()
+            <= static_cast<address_t>(offset)) break;
+    }
+    return live;
+}
+
+RegisterBitVector LivenessAnalysis::getLiveAfter(Instruction *instr) {
+    auto block = dynamic_cast<Block *>(instr->getParent());
+    auto list = block->getChildren()->getIterable();
+    RegisterBitVector live = liveOut[blockMapping[block]];
+    for(int i = static_cast<int>(list->getCount()) - 1; i >= 0; i --) {
+        auto other = list->get(i);
+        if(other == instr) break;
+        RegisterAccess access(other, summaries);
+        live.assignTransfer(access.getUse(), live, access.getKill());
+    }
+    return live;
+}
+
+RegisterBitVector LivenessAnalysis::getLiveBefore(Instruction *instr) {
+    RegisterBitVector live = getLiveAfter(instr);
+    RegisterAccess access(instr, summaries);
+    live.assignTransfer(access.getUse(), live, access.getKill());
+    return live;
+}
+
+void LivenessAnalysis::dump() {
+    LOG(1, "liveness for " << function->getName());
+    for(size_t id = 0; id < blockList.size(); id ++) {
+        LOG0(1, "    " << blockList[id]->getName() << " in: ");
+        liveIn[id].dump();
+        LOG0(1, "    " << blockList[id]->getName() << " out:");
+        liveOut[id].dump();
+    }
+}
+
+InterproceduralLiveness::InterproceduralLiveness(CompactCallGraph *callGraph)
+    : callGraph(callGraph), summaryList(callGraph->getCount()),
+    computed(callGraph->getCount(), false) {
+
+}
+
+const RegisterSummary *InterproceduralLiveness::lookup(Function *function) {
+    auto id = callGraph->getID(function);
+    if(id == CompactCallGraph::INVALID_ID) {
+        auto it = extraMap.find(function);
+        return (it != extraMap.end()) ? &it->second : nullptr;
+    }
+    return computed[id] ? &summaryList[id] : nullptr;
+}
+
+const RegisterSummary *InterproceduralLiveness::getSummary(
+    Function *function) {
+
+    if(auto summary = lookup(function)) return summary;
+
+    auto id = callGraph->getID(function);
+    if(id == CompactCallGraph::INVALID_ID) {
+        // created after the call graph; its callees are summarized lazily
+        // as far as they already are
+        extraMap[function] = computeSummary(function);
+        return &extraMap[function];
+    }
+
+    // find the SCCs below this one that still need work; finished SCCs
+    // are not entered, so each call edge is followed once overall
+    std::vector<uint32_t> pending;
+    std::vector<uint32_t> work;
+    std::set<uint32_t> seen;
+    work.push_back(callGraph->getScc(id));
+    seen.insert(work.back());
+    while(!work.empty()) {
+        auto scc = work.back();
+        work.pop_back();
+        pending.push_back(scc);
+        for(auto member : callGraph->getSccMembers(scc)) {
+            for(auto callee : callGraph->getCallees(member)) {
+                auto calleeScc = callGraph->getScc(callee);
+                if(computed[callee]) continue;
+                if(seen.insert(calleeScc).second) work.push_back(calleeScc);
+            }
+        }
+    }
+
+    // SCC numbers are bottom-up, so this puts callees first
+    std::sort(pending.begin(), pending.end());
+    for(auto scc : pending) computeScc(scc);
+
+    return lookup(function);
+}
+
+void InterproceduralLiveness::computeScc(uint32_t scc) {
+    auto members = callGraph->getSccMembers(scc);
+
+    // start from the empty summary and grow to the least fixed point
+    for(auto id : members) {
+        summaryList[id] = RegisterSummary();
+        computed[id] = true;
+    }
+
+    bool recursive = callGraph->isRecursive(scc);
+    bool changed;
+    do {
+        changed = false;
+        for(auto id : members) {
+            auto summary = computeSummary(callGraph->getFunction(id));
+            if(!(summary == summaryList[id])) {
+                summaryList[id] = summary;
+                changed = true;
+            }
+        }
+    } while(changed && recursive);
+}
+
+RegisterSummary InterproceduralLiveness::computeSummary(Function *function) {
+    RegisterSummary summary;
+    if(function->getChildren()->getIterable()->getCount() == 0) {
+        summary.setLiveIn(RegisterBitVector::argumentRegisters());
+        summary.setClobbered(RegisterBitVector::callerSaved());
+        return summary;
+    }
+
+    ControlFlowGraph cfg(function);
+    LivenessAnalysis live(function, &cfg, this);
+
+    auto clobbered = live.getDefined();
+    clobbered.subtract(RegisterBitVector::calleeSaved());
+    clobbered.subtract(RegisterBitVector::stackPointer());
+    summary.setLiveIn(live.getLiveIn());
+    summary.setClobbered(clobbered);
+
+    LOG(10, "register summary for " << function->getName() << ": "
+        << std::dec << summary.getLiveIn().count() << " live in, "
+        << summary.getClobbered().count() << " clobbered");
+    return summary;
+}
@@ -0,0 +1,209 @@
+#ifndef EGALITO_ANALYSIS_LIVENESS_H
+#define EGALITO_ANALYSIS_LIVENESS_H
+
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <cstddef>
+
+class Function;
+class Block;
+class Instruction;
+class ControlFlowGraph;
+class CompactCallGraph;
+
+/** A fixed-width set of registers, kept as machine words so that the
+    dataflow equations are evaluated a whole word at a time.
+
+    Register indices are architecture specific. Integer registers use the
+    same numbering as X86Register / AARCH64GPRegister so the two can be
+    mixed freely. The width leaves room for the full vector register file
+    (zmm/ymm/xmm, or V/SVE Z registers) plus mask and predicate registers.
+
+    x86_64:  0-15 GP, 16 flags, 32-63 vector, 64-71 k0-k7 mask
+    aarch64: 0-31 X (31 is SP), 32-63 V, 64 NZCV, 65-81 reserved (SVE P/FFR)
+*/
+class RegisterBitVector {
+public:
+    enum {
+        BITS = 128,
+        WORDS = BITS / 64
+    };
+#ifdef ARCH_X86_64
+    enum {
+        FLAGS = 16,
+        VECTOR_BEGIN = 32,
+        MASK_BEGIN = 64
+    };
+#elif defined(ARCH_AARCH64)
+    enum {
+        VECTOR_BEGIN = 32,
+        FLAGS = 64
+    };
+#else
+    enum {
+        FLAGS = 0
+    };
+#endif
+private:
+    uint64_t word[WORDS];
+public:
+    RegisterBitVector() { clear(); }
+
+    void clear() { for(size_t i = 0; i < WORDS; i ++) word[i] = 0; }
+    void set(int reg) { word[reg / 64] |= (1ull << (reg % 64)); }
+    void reset(int reg) { word[reg / 64] &= ~(1ull << (reg % 64)); }
+    bool get(int reg) const { return (word[reg / 64] >> (reg % 64)) & 1; }
+    bool empty() const;
+    size_t count() const;
+
+    RegisterBitVector &operator |= (const RegisterBitVector &other);
+    RegisterBitVector &operator &= (const RegisterBitVector &other);
+    /** Removes every register in other (and-not). */
+    RegisterBitVector &subtract(const RegisterBitVector &other);
+    bool operator == (const RegisterBitVector &other) const;
+    bool operator != (const RegisterBitVector &other) const
+        { return !(*this == other); }
+
+    /** Computes use | (live & ~kill) in one pass; returns true if this
+        changed. This is the transfer function for a block or instruction.
+    */
+    bool assignTransfer(const RegisterBitVector &use,
+        const RegisterBitVector &live, const RegisterBitVector &kill);
+
+    template <typename FuncType>
+    void forEach(FuncType func) const {
+        for(size_t i = 0; i < WORDS; i ++) {
+            for(uint64_t w = word[i]; w; w &= w - 1) {
+                func(static_cast<int>(i * 64 + __builtin_ctzll(w)));
+            }
+        }
+    }
+
+    void dump() const;
+public:
+    /** Maps a capstone register to its index, or -1 if it is not tracked
+        (e.g. the instruction pointer, segment registers, the zero register).
+    */
+    static int getIndex(int reg);
+
+    static RegisterBitVector everything();
+    static RegisterBitVector callerSaved();
+    static RegisterBitVector calleeSaved();
+    static RegisterBitVector argumentRegisters();
+    static RegisterBitVector returnRegisters();
+    static RegisterBitVector stackPointer();
+};
+
+/** What a function needs from and does to its callers' registers. */
+class RegisterSummary {
+private:
+    RegisterBitVector liveIn;
+    RegisterBitVector clobbered;
+public:
+    const RegisterBitVector &getLiveIn() const { return liveIn; }
+    const RegisterBitVector &getClobbered() const { return clobbered; }
+    void setLiveIn(const RegisterBitVector &live) { liveIn = live; }
+    void setClobbered(const RegisterBitVector &regs) { clobbered = regs; }
+    bool operator == (const RegisterSummary &other) const
+        { return liveIn == other.liveIn && clobbered == other.clobbered; }
+};
+
+class InterproceduralLiveness;
+
+/** The registers read and written by one instruction.
+
+    use and def are over-approximations; kill only contains registers
+    whose full width is certainly overwritten. Calls and tail calls are
+    described using the callee's RegisterSummary if one is available,
+    otherwise using the calling convention.
+*/
+class RegisterAccess {
+private:
+    RegisterBitVector use;
+    RegisterBitVector def;
+    RegisterBitVector kill;
+public:
+    RegisterAccess(Instruction *instr,
+        InterproceduralLiveness *summaries = nullptr);
+
+    const RegisterBitVector &getUse() const { return use; }
+    const RegisterBitVector &getDef() const { return def; }
+    const RegisterBitVector &getKill() const { return kill; }
+private:
+    void handleAssembly(Instruction *instr);
+    void handleCall(Function *target, InterproceduralLiveness *summaries);
+    void handleTailCall(Function *target,
+        InterproceduralLiveness *summaries);
+    void handleReturn();
+    void handleUnknown();
+    void addUse(int reg);
+    void addDef(int reg, bool full);
+};
+
+/** Classic backward bit-vector liveness over a ControlFlowGraph.
+
+    Each block gets a gen/kill pair built from a single backward scan, and
+    the block equations are then iterated to a fixed point with a worklist
+    seeded in postorder. Queries for individual instructions rescan only
+    the enclosing block.
+*/
+class LivenessAnalysis {
+private:
+    Function *function;
+    InterproceduralLiveness *summaries;
+    std::map<Block *, int> blockMapping;
+    std::vector<Block *> blockList;
+    std::vector<RegisterBitVector> gen;
+    std::vector<RegisterBitVector> killed;
+    std::vector<RegisterBitVector> liveIn;
+    std::vector<RegisterBitVector> liveOut;
+    RegisterBitVector entry;
+    RegisterBitVector defined;
+public:
+    LivenessAnalysis(Function *function, ControlFlowGraph *cfg,
+        InterproceduralLiveness *summaries = nullptr);
+
+    const RegisterBitVector &getLiveIn(Block *block)
+        { return liveIn[blockMapping[block]]; }
+    const RegisterBitVector &getLiveOut(Block *block)
+        { return liveOut[blockMapping[block]]; }
+    /** Registers live on entry to the function. */
+    const RegisterBitVector &getLiveIn() const { return entry; }
+    /** Every register that may be written by this function itself. */
+    const RegisterBitVector &getDefined() const { return defined; }
+
+    RegisterBitVector getLiveBefore(Instruction *instr);
+    RegisterBitVector getLiveAfter(Instruction *instr);
+
+    void dump();
+private:
+    void computeLocal(int id);
+    void solve(ControlFlowGraph *cfg);
+    RegisterBitVector getLiveAtOffset(int id, int offset);
+};
+
+/** Per-function RegisterSummary values computed bottom-up over the
+    CompactCallGraph. Summaries are built on demand for the callees
+    reachable from the requested function; strongly connected components
+    are iterated until their summaries stop changing.
+*/
+class InterproceduralLiveness {
+private:
+    CompactCallGraph *callGraph;
+    std::vector<RegisterSummary> summaryList;   // indexed by call graph id
+    std::vector<bool> computed;
+    std::map<Function *, RegisterSummary> extraMap;  // not in the graph
+public:
+    InterproceduralLiveness(CompactCallGraph *callGraph);
+
+    /** Computes (if needed) and returns the summary for function. */
+    const RegisterSummary *getSummary(Function *function);
+    /** Returns the summary if it was already computed, else nullptr. */
+    const RegisterSummary *lookup(Function *function);
+private:
+    void computeScc(uint32_t scc);
+    RegisterSummary computeSummary(Function *function);
+};
+
+#endif
@@ -3,6 +3,7 @@
 #include "analysis/walker.h"
 #include "analysis/controlflow.h"
 #include "analysis/savedregister.h"
+#include "analysis/manager.h"
 #include "chunk/concrete.h"
 #include "instr/register.h"
 #include "instr/isolated.h"
@@ -11,31 +12,23 @@
 
 LiveInfo LiveRegister::getInfo(Function *function) {
     auto it = list.find(function);
-    if(it == list.end()) {
-        detect(function);
-    }
+    if(it != list.end()) return it->second;
+
+    detect(function);
     return list[function];
 }
 
 LiveInfo LiveRegister::getInfo(UDRegMemWorkingSet *working) {
     Function *function = working->getFunction();
     auto it = list.find(function);
-    if(it == list.end()) {
-        detect(working);
-    }
+    if(it != list.end()) return it->second;
+
+    detect(working);
     return list[function];
 }
 
 void LiveRegister::detect(Function *function) {
-    ControlFlowGraph cfg(function);
-    UDConfiguration config(&cfg);
-    UDRegMemWorkingSet working(function, &cfg);
-    UseDef usedef(&config, &working);
-
-    SccOrder order(&cfg);
-    order.genFull(0);
-    usedef.analyze(order.get());
-    detect(&working);
+    detect(AnalysisManager::getInstance()->getUseDef(function));
 }
 
 void LiveRegister::detect(UDRegMemWorkingSet *working) {
@@ -64,7 +57,7 @@ void LiveRegister::detect(UDRegMemWorkingSet *working) {
 
     // resurrect actually saved registers
     SavedRegister saved;
-    for(auto r : saved.getList(function)) {
+    for(auto r : saved.getList(working)) {
         info.live(r);
     }
 
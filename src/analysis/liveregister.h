@@ -27,6 +27,8 @@ private:
 public:
     LiveInfo getInfo(Function *function);
     LiveInfo getInfo(UDRegMemWorkingSet *working);
+    void setInfo(Function *function, const LiveInfo &info)
+        { list[function] = info; }
 
     void detect(Function *function);
     void detect(UDRegMemWorkingSet *working);
@@ -0,0 +1,231 @@
+#include <algorithm>
+#include "loops.h"
+#include "dominance.h"
+#include "chunk/concrete.h"
+
+#include "log/log.h"
+
+// Tarjan's algorithm, limited to the nodes in region and ignoring edges
+// into the nodes in cut. Iterative, since functions can be very large.
+static std::vector<std::vector<ControlFlow::id_t>> findSccs(
+    ControlFlowGraph *cfg, const std::vector<ControlFlow::id_t> &region,
+    const std::set<ControlFlow::id_t> &cut) {
+
+    size_t count = cfg->getCount();
+    std::vector<int> index(count, -1);
+    std::vector<int> lowlink(count, 0);
+    std::vector<bool> inRegion(count, false);
+    std::vector<bool> onStack(count, false);
+    for(auto id : region) inRegion[id] = true;
+
+    auto successors = [&] (ControlFlow::id_t id) {
+        std::vector<ControlFlow::id_t> list;
+        for(auto link : cfg->get(id)->forwardLinks()) {
+            auto target = link->getTargetID();
+            if(inRegion[target] && !cut.count(target)) list.push_back(target);
+        }
+        return list;
+    };
+
+    struct Frame {
+        ControlFlow::id_t id;
+        std::vector<ControlFlow::id_t> successors;
+        size_t next;
+    };
+
+    std::vector<std::vector<ControlFlow::id_t>> sccList;
+    std::vector<ControlFlow::id_t> stack;
+    int counter = 0;
+    for(auto root : region) {
+        if(index[root] != -1) continue;
+
+        std::vector<Frame> work;
+        auto visit = [&] (ControlFlow::id_t id) {
+            index[id] = lowlink[id] = counter ++;
+            stack.push_back(id);
+            onStack[id] = true;
+            work.push_back(Frame{id, successors(id), 0});
+        };
+        visit(root);
+
+        while(!work.empty()) {
+            auto &frame = work.back();
+            if(frame.next < frame.successors.size()) {
+                auto target = frame.successors[frame.next ++];
+                if(index[target] == -1) {
+                    visit(target);  // frame is no longer valid
+                }
+                else if(onStack[target]) {
+                    lowlink[frame.id] = std::min(lowlink[frame.id],
+                        index[target]);
+                }
+                continue;
+            }
+
+            auto id = frame.id;
+            work.pop_back();
+            if(lowlink[id] == index[id]) {
+                std::vector<ControlFlow::id_t> scc;
+                ControlFlow::id_t member;
+                do {
+                    member = stack.back();
+                    stack.pop_back();
+                    onStack[member] = false;
+                    scc.push_back(member);
+                } while(member != id);
+                sccList.push_back(std::move(scc));
+            }
+            if(!work.empty()) {
+                auto parent = work.back().id;
+                lowlink[parent] = std::min(lowlink[parent], lowlink[id]);
+            }
+        }
+    }
+
+    return sccList;
+}
+
+static bool hasSelfEdge(ControlFlowGraph *cfg, ControlFlow::id_t id,
+    const std::set<ControlFlow::id_t> &cut) {
+
+    if(cut.count(id)) return false;
+    for(auto link : cfg->get(id)->forwardLinks()) {
+        if(link->getTargetID() == id) return true;
+    }
+    return false;
+}
+
+LoopForest::LoopForest(ControlFlowGraph *cfg) {
+    Dominance dominance(cfg);
+
+    std::vector<id_t> region;
+    for(size_t id = 0; id < cfg->getCount(); id ++) {
+        region.push_back(id);
+    }
+    findLoops(cfg, &dominance, region, std::set<id_t>(), nullptr);
+
+    // outer loops come first, so inner loops overwrite them
+    for(auto loop : loopList) {
+        for(auto block : loop->getBlockList()) {
+            innermostMap[block] = loop;
+        }
+    }
+}
+
+LoopForest::~LoopForest() {
+    for(auto loop : loopList) {
+        delete loop;
+    }
+}
+
+void LoopForest::findLoops(ControlFlowGraph *cfg, Dominance *dominance,
+    const std::vector<id_t> &region, const std::set<id_t> &cut,
+    Loop *parent) {
+
+    auto sccList = findSccs(cfg, region, cut);
+
+    // Tarjan finds SCCs in reverse topological order
+    for(auto it = sccList.rbegin(); it != sccList.rend(); ++it) {
+        auto &scc = *it;
+        if(scc.size() == 1 && !hasSelfEdge(cfg, scc[0], cut)) continue;
+
+        std::sort(scc.begin(), scc.end());
+        makeLoop(cfg, dominance, scc, parent);
+    }
+}
+
+void LoopForest::makeLoop(ControlFlowGraph *cfg, Dominance *dominance,
+    const std::vector<id_t> &scc, Loop *parent) {
+
+    std::set<id_t> members(scc.begin(), scc.end());
+
+    std::set<id_t> headers;
+    for(auto id : scc) {
+        if(id == 0) headers.insert(id);
+        for(auto link : cfg->get(id)->backwardLinks()) {
+            if(!members.count(link->getTargetID())) headers.insert(id);
+        }
+    }
+    if(headers.empty()) headers.insert(scc.front());  // unreachable
+
+    std::vector<id_t> latches;
+    std::set<std::pair<id_t, id_t>> exits;
+    for(auto id : scc) {
+        bool isLatch = false;
+        for(auto link : cfg->get(id)->forwardLinks()) {
+            auto target = link->getTargetID();
+            if(headers.count(target)) isLatch = true;
+            if(!members.count(target)) exits.insert({id, target});
+        }
+        if(isLatch) latches.push_back(id);
+    }
+
+    bool irreducible = (headers.size() > 1);
+    if(!irreducible) {
+        auto header = *headers.begin();
+        for(auto latch : latches) {
+            if(!dominance->dominates(header, latch)) {
+                irreducible = true;
+                break;
+            }
+        }
+    }
+
+    auto loop = new Loop(parent, irreducible);
+    for(auto id : headers) {
+        loop->headerList.push_back(cfg->get(id)->getBlock());
+    }
+    for(auto id : latches) {
+        loop->latchList.push_back(cfg->get(id)->getBlock());
+    }
+    for(auto id : scc) {
+        auto block = cfg->get(id)->getBlock();
+        loop->blockList.push_back(block);
+        loop->blockSet.insert(block);
+    }
+    for(auto edge : exits) {
+        loop->exitList.emplace_back(cfg->get(edge.first)->getBlock(),
+            cfg->get(edge.second)->getBlock());
+    }
+
+    if(parent) parent->childList.push_back(loop);
+    else rootList.push_back(loop);
+    loopList.push_back(loop);
+
+    // whatever is still cyclic without the edges into the headers
+    findLoops(cfg, dominance, scc, headers, loop);
+}
+
+Loop *LoopForest::getLoopFor(Block *block) const {
+    auto it = innermostMap.find(block);
+    return (it != innermostMap.end()) ? it->second : nullptr;
+}
+
+int LoopForest::getDepth(Block *block) const {
+    auto loop = getLoopFor(block);
+    return loop ? loop->getDepth() : 0;
+}
+
+bool LoopForest::isHeader(Block *block) const {
+    auto loop = getLoopFor(block);
+    if(!loop) return false;
+
+    auto &list = loop->getHeaderList();
+    return std::find(list.begin(), list.end(), block) != list.end();
+}
+
+void Loop::dump() const {
+    LOG0(1, std::string(2 * depth, ' ')
+        << (irreducible ? "irreducible loop" : "loop") << " headers");
+    for(auto block : headerList) LOG0(1, " " << block->getName());
+    LOG0(1, ", " << blockList.size() << " blocks, latches");
+    for(auto block : latchList) LOG0(1, " " << block->getName());
+    LOG(1, ", " << exitList.size() << " exits");
+
+    for(auto child : childList) child->dump();
+}
+
+void LoopForest::dump() const {
+    LOG(1, "loop forest with " << loopList.size() << " loops");
+    for(auto loop : rootList) loop->dump();
+}
@@ -0,0 +1,101 @@
+#ifndef EGALITO_ANALYSIS_LOOPS_H
+#define EGALITO_ANALYSIS_LOOPS_H
+
+#include <vector>
+#include <set>
+#include <map>
+#include <utility>
+#include "controlflow.h"
+
+class Block;
+class Dominance;
+
+/** A cycle in the control flow graph, i.e. a strongly connected region.
+
+    A natural loop has exactly one header, which dominates every block in
+    the loop. An irreducible loop can be entered at several blocks; all of
+    them are listed as headers and none is guaranteed to run first.
+*/
+class Loop {
+public:
+    typedef std::pair<Block *, Block *> EdgeType;  // (inside, outside)
+private:
+    std::vector<Block *> headerList;
+    std::vector<Block *> latchList;
+    std::vector<Block *> blockList;
+    std::set<Block *> blockSet;
+    std::vector<EdgeType> exitList;
+    Loop *parent;
+    std::vector<Loop *> childList;
+    int depth;
+    bool irreducible;
+public:
+    Loop(Loop *parent, bool irreducible)
+        : parent(parent), depth(parent ? parent->depth + 1 : 1),
+        irreducible(irreducible) {}
+
+    Block *getHeader() const { return headerList.front(); }
+    const std::vector<Block *> &getHeaderList() const { return headerList; }
+    /** Blocks with an edge back to a header. */
+    const std::vector<Block *> &getLatchList() const { return latchList; }
+    /** Every block in the loop, including those of nested loops. */
+    const std::vector<Block *> &getBlockList() const { return blockList; }
+    /** Edges that leave the loop. */
+    const std::vector<EdgeType> &getExitList() const { return exitList; }
+
+    bool contains(Block *block) const { return blockSet.count(block) > 0; }
+    bool isIrreducible() const { return irreducible; }
+
+    Loop *getParent() const { return parent; }
+    const std::vector<Loop *> &getChildList() const { return childList; }
+    /** Outermost loops have depth 1. */
+    int getDepth() const { return depth; }
+
+    void dump() const;
+private:
+    friend class LoopForest;
+};
+
+/** The loop-nest forest of one function.
+
+    Loops are found by recursive decomposition into strongly connected
+    regions: every non-trivial region of the CFG is a loop, its entry
+    blocks are its headers, and the loops nested inside it are the regions
+    that remain once edges into those headers are removed. A region whose
+    only entry dominates all of its latches is a natural loop; anything
+    else is reported as irreducible.
+
+    The forest refers to Blocks rather than to the ControlFlowGraph, so it
+    remains usable for as long as the function is unchanged.
+*/
+class LoopForest {
+public:
+    using id_t = ControlFlow::id_t;
+private:
+    std::vector<Loop *> loopList;   // outer loops before inner ones
+    std::vector<Loop *> rootList;
+    std::map<Block *, Loop *> innermostMap;
+public:
+    LoopForest(ControlFlowGraph *cfg);
+    ~LoopForest();
+
+    const std::vector<Loop *> &getLoopList() const { return loopList; }
+    /** Loops that are not nested in any other loop. */
+    const std::vector<Loop *> &getRootList() const { return rootList; }
+
+    /** Returns the innermost loop containing block, or nullptr. */
+    Loop *getLoopFor(Block *block) const;
+    /** Number of loops containing block; 0 outside of any loop. */
+    int getDepth(Block *block) const;
+    bool isHeader(Block *block) const;
+
+    void dump() const;
+private:
+    void findLoops(ControlFlowGraph *cfg, Dominance *dominance,
+        const std::vector<id_t> &region, const std::set<id_t> &cut,
+        Loop *parent);
+    void makeLoop(ControlFlowGraph *cfg, Dominance *dominance,
+        const std::vector<id_t> &scc, Loop *parent);
+};
+
+#endif
@@ -0,0 +1,383 @@
+#include <iomanip>
+#include "manager.h"
+#include "analysis/controlflow.h"
+#include "analysis/usedef.h"
+#include "analysis/walker.h"
+#include "analysis/liveregister.h"
+#include "analysis/frametype.h"
+#include "analysis/framesummary.h"
+#include "analysis/savedregister.h"
+#include "analysis/call.h"
+#include "analysis/liveness.h"
+#include "analysis/compactcallgraph.h"
+#include "analysis/indirectcall.h"
+#include "analysis/loops.h"
+#include "chunk/concrete.h"
+#include "pass/chunkpass.h"
+
+#include "log/log.h"
+
+AnalysisManager AnalysisManager::instance;
+
+class AnalysisManager::UseDefResult : public AnalysisManager::ResultBase {
+private:
+    UDConfiguration config;
+    UDRegMemWorkingSet working;
+    UseDef usedef;
+public:
+    UseDefResult(Function *function, ControlFlowGraph *cfg)
+        : config(cfg), working(function, cfg), usedef(&config, &working) {
+
+        SccOrder order(cfg);
+        order.genFull(0);
+        usedef.analyze(order.get());
+    }
+    UDRegMemWorkingSet *get() { return &working; }
+};
+
+AnalysisManager::AnalysisManager() : modifiedAnything(false) {
+    for(size_t i = 0; i < ANALYSIS_KIND_COUNT; i ++) {
+        computeCount[i] = 0;
+        reuseCount[i] = 0;
+    }
+}
+
+AnalysisManager::~AnalysisManager() {
+    for(auto &kv : cache) {
+        delete kv.second;
+    }
+    for(auto result : retiredList) {
+        delete result;
+    }
+}
+
+AnalysisManager::Pin::Pin(AnalysisKind kind, Chunk *chunk) {
+    auto manager = AnalysisManager::getInstance();
+
+    // results this one was built from, e.g. the CFG under a use-def
+    for(size_t k = 0; k < ANALYSIS_KIND_COUNT; k ++) {
+        auto other = static_cast<AnalysisKind>(k);
+        if(other == kind || (manager->getDependents(other) & (1ul << kind))) {
+            if(auto result = manager->pin(other, chunk)) {
+                pinned.push_back(result);
+            }
+        }
+    }
+}
+
+AnalysisManager::Pin::~Pin() {
+    auto manager = AnalysisManager::getInstance();
+    for(auto result : pinned) {
+        manager->unpin(result);
+    }
+}
+
+template <typename ResultType>
+ResultType *AnalysisManager::lookup(AnalysisKind kind, Chunk *chunk) {
+    flushModified();
+
+    auto it = cache.find(KeyType(kind, chunk));
+    if(it == cache.end()) return nullptr;
+
+    reuseCount[kind] ++;
+    return static_cast<ResultType *>(it->second);
+}
+
+template <typename ResultType>
+ResultType *AnalysisManager::store(AnalysisKind kind, Chunk *chunk,
+    ResultType *value) {
+
+    computeCount[kind] ++;
+    cache[KeyType(kind, chunk)] = value;
+    return value;
+}
+
+ControlFlowGraph *AnalysisManager::getControlFlowGraph(Function *function) {
+    typedef Result<ControlFlowGraph> R;
+    if(auto r = lookup<R>(ANALYSIS_CONTROL_FLOW, function)) return r->get();
+
+    auto cfg = new ControlFlowGraph(function);
+    return store(ANALYSIS_CONTROL_FLOW, function, new R(cfg))->get();
+}
+
+UDRegMemWorkingSet *AnalysisManager::getUseDef(Function *function) {
+    if(auto r = lookup<UseDefResult>(ANALYSIS_USE_DEF, function)) {
+        return r->get();
+    }
+
+    auto cfg = getControlFlowGraph(function);
+    auto result = new UseDefResult(function, cfg);
+    return store(ANALYSIS_USE_DEF, function, result)->get();
+}
+
+LiveInfo *AnalysisManager::getLiveRegisters(Function *function) {
+    typedef Result<LiveInfo> R;
+    if(auto r = lookup<R>(ANALYSIS_LIVE_REGISTER, function)) return r->get();
+
+    LiveRegister live;
+    auto info = new LiveInfo(live.getInfo(getUseDef(function)));
+    return store(ANALYSIS_LIVE_REGISTER, function, new R(info))->get();
+}
+
+FrameType *AnalysisManager::getFrameType(Function *function) {
+    typedef Result<FrameType> R;
+    if(auto r = lookup<R>(ANALYSIS_FRAME_TYPE, function)) return r->get();
+
+    auto frame = new FrameType(function, *getFrameSummary(function));
+    return store(ANALYSIS_FRAME_TYPE, function, new R(frame))->get();
+}
+
+FrameSummary *AnalysisManager::getFrameSummary(Function *function) {
+    typedef Result<FrameSummary> R;
+    if(auto r = lookup<R>(ANALYSIS_FRAME_SUMMARY, function)) return r->get();
+
+    auto summary = new FrameSummary(function);
+    return store(ANALYSIS_FRAME_SUMMARY, function, new R(summary))->get();
+}
+
+void AnalysisManager::adoptFrameSummary(Function *function,
+    FrameSummary *summary) {
+
+    flushModified();  // so that earlier changes don't drop this one
+    drop(ANALYSIS_FRAME_SUMMARY, function);
+    store(ANALYSIS_FRAME_SUMMARY, function, new Result<FrameSummary>(summary));
+}
+
+#ifdef ARCH_AARCH64
+std::vector<int> *AnalysisManager::getSavedRegisters(Function *function) {
+    typedef Result<std::vector<int>> R;
+    if(auto r = lookup<R>(ANALYSIS_SAVED_REGISTER, function)) return r->get();
+
+    auto list = new std::vector<int>(SavedRegister().getList(
+        getUseDef(function)));
+    return store(ANALYSIS_SAVED_REGISTER, function, new R(list))->get();
+}
+#endif
+
+CallGraph *AnalysisManager::getCallGraph(Program *program) {
+    typedef Result<CallGraph> R;
+    if(auto r = lookup<R>(ANALYSIS_CALL_GRAPH, program)) return r->get();
+
+    auto graph = new CallGraph(program);
+    return store(ANALYSIS_CALL_GRAPH, program, new R(graph))->get();
+}
+
+IndirectCalleeList *AnalysisManager::getIndirectCalleeList(Module *module) {
+    typedef Result<IndirectCalleeList> R;
+    if(auto r = lookup<R>(ANALYSIS_INDIRECT_CALLEE, module)) return r->get();
+
+    auto list = new IndirectCalleeList(module);
+    return store(ANALYSIS_INDIRECT_CALLEE, module, new R(list))->get();
+}
+
+IndirectCalleeList *AnalysisManager::getIndirectCalleeList(Program *program) {
+    typedef Result<IndirectCalleeList> R;
+    if(auto r = lookup<R>(ANALYSIS_INDIRECT_CALLEE, program)) return r->get();
+
+    auto list = new IndirectCalleeList(program);
+    return store(ANALYSIS_INDIRECT_CALLEE, program, new R(list))->get();
+}
+
+LivenessAnalysis *AnalysisManager::getLiveness(Function *function) {
+    typedef Result<LivenessAnalysis> R;
+    if(auto r = lookup<R>(ANALYSIS_LIVENESS, function)) return r->get();
+
+    // the result does not keep the CFG, so it need not depend on it
+    auto live = new LivenessAnalysis(function, getControlFlowGraph(function));
+    return store(ANALYSIS_LIVENESS, function, new R(live))->get();
+}
+
+CompactCallGraph *AnalysisManager::getCompactCallGraph(Program *program) {
+    typedef Result<CompactCallGraph> R;
+    if(auto r = lookup<R>(ANALYSIS_COMPACT_CALL_GRAPH, program)) {
+        return r->get();
+    }
+
+    auto graph = new CompactCallGraph(program);
+    return store(ANALYSIS_COMPACT_CALL_GRAPH, program, new R(graph))->get();
+}
+
+IndirectCallTargets *AnalysisManager::getIndirectCallTargets(
+    Program *program) {
+
+    typedef Result<IndirectCallTargets> R;
+    if(auto r = lookup<R>(ANALYSIS_INDIRECT_CALL_TARGETS, program)) {
+        return r->get();
+    }
+
+    // the call graph is only used during construction
+    auto targets = new IndirectCallTargets(program,
+        getCompactCallGraph(program));
+    return store(ANALYSIS_INDIRECT_CALL_TARGETS, program,
+        new R(targets))->get();
+}
+
+LoopForest *AnalysisManager::getLoopForest(Function *function) {
+    typedef Result<LoopForest> R;
+    if(auto r = lookup<R>(ANALYSIS_LOOP_FOREST, function)) return r->get();
+
+    // the forest refers to Blocks, not to the CFG
+    auto forest = new LoopForest(getControlFlowGraph(function));
+    return store(ANALYSIS_LOOP_FOREST, function, new R(forest))->get();
+}
+
+bool AnalysisManager::isCached(AnalysisKind kind, Chunk *chunk) {
+    flushModified();
+    return cache.find(KeyType(kind, chunk)) != cache.end();
+}
+
+void AnalysisManager::notifyModified(Chunk *chunk) {
+    modifiedAnything = true;
+    for(Chunk *c = chunk; c; c = c->getParent()) {
+        if(auto function = dynamic_cast<Function *>(c)) {
+            modifiedFunctions.insert(function);
+            break;
+        }
+        // anything above a Function cannot have a Function as an ancestor
+        if(dynamic_cast<FunctionList *>(c) || dynamic_cast<Module *>(c)) break;
+    }
+}
+
+void AnalysisManager::invalidate(Function *function) {
+    modifiedFunctions.insert(function);
+    modifiedAnything = true;
+}
+
+void AnalysisManager::flushModified() {
+    if(!modifiedAnything) return;
+
+    for(auto function : modifiedFunctions) {
+        for(size_t k = 0; k < ANALYSIS_KIND_COUNT; k ++) {
+            drop(static_cast<AnalysisKind>(k), function);
+        }
+    }
+    modifiedFunctions.clear();
+
+    // whole-program results may depend on any function or data variable
+    dropKind(ANALYSIS_CALL_GRAPH);
+    dropKind(ANALYSIS_INDIRECT_CALLEE);
+    dropKind(ANALYSIS_COMPACT_CALL_GRAPH);
+    dropKind(ANALYSIS_INDIRECT_CALL_TARGETS);
+    modifiedAnything = false;
+}
+
+void AnalysisManager::invalidate(const PreservedAnalyses &preserved) {
+    unsigned long abandoned = 0;
+    for(size_t k = 0; k < ANALYSIS_KIND_COUNT; k ++) {
+        auto kind = static_cast<AnalysisKind>(k);
+        if(!preserved.isPreserved(kind)) {
+            abandoned |= (1ul << kind) | getDependents(kind);
+        }
+    }
+
+    // drop dependents (which have higher kind numbers) first
+    for(int k = ANALYSIS_KIND_COUNT - 1; k >= 0; k --) {
+        if(abandoned & (1ul << k)) {
+            dropKind(static_cast<AnalysisKind>(k));
+        }
+    }
+}
+
+void AnalysisManager::passFinished(ChunkPass *pass) {
+    invalidate(pass->getPreservedAnalyses());
+}
+
+void AnalysisManager::passFinished(ChunkVisitor *visitor) {
+    // not a ChunkPass, so we can't tell what it preserves
+    invalidateAll();
+}
+
+void AnalysisManager::drop(AnalysisKind kind, Chunk *chunk) {
+    auto it = cache.find(KeyType(kind, chunk));
+    if(it == cache.end()) return;
+
+    // results built on top of this one hold pointers into it
+    unsigned long dependents = getDependents(kind);
+    for(size_t k = 0; k < ANALYSIS_KIND_COUNT; k ++) {
+        if(dependents & (1ul << k)) {
+            drop(static_cast<AnalysisKind>(k), chunk);
+        }
+    }
+
+    release(it->second);
+    cache.erase(it);
+}
+
+void AnalysisManager::dropKind(AnalysisKind kind) {
+    for(auto it = cache.begin(); it != cache.end(); ) {
+        if(it->first.first == kind) {
+            release(it->second);
+            it = cache.erase(it);
+        }
+        else ++it;
+    }
+}
+
+void AnalysisManager::release(ResultBase *result) {
+    if(pinCount.count(result)) {
+        retiredList.insert(result);
+    }
+    else {
+        delete result;
+    }
+}
+
+// does not flush pending modifications, which could drop the result
+AnalysisManager::ResultBase *AnalysisManager::pin(AnalysisKind kind,
+    Chunk *chunk) {
+
+    auto it = cache.find(KeyType(kind, chunk));
+    if(it == cache.end()) return nullptr;
+
+    pinCount[it->second] ++;
+    return it->second;
+}
+
+void AnalysisManager::unpin(ResultBase *result) {
+    auto it = pinCount.find(result);
+    if(it == pinCount.end()) return;
+    if(-- it->second > 0) return;
+
+    pinCount.erase(it);
+    if(retiredList.erase(result)) delete result;
+}
+
+unsigned long AnalysisManager::getDependents(AnalysisKind kind) {
+    switch(kind) {
+    case ANALYSIS_CONTROL_FLOW:
+        return (1ul << ANALYSIS_USE_DEF) | getDependents(ANALYSIS_USE_DEF);
+    case ANALYSIS_USE_DEF:
+        return (1ul << ANALYSIS_LIVE_REGISTER)
+            | (1ul << ANALYSIS_SAVED_REGISTER);
+    default:
+        return 0;
+    }
+}
+
+const char *AnalysisManager::getKindName(AnalysisKind kind) {
+    switch(kind) {
+    case ANALYSIS_CONTROL_FLOW:     return "ControlFlowGraph";
+    case ANALYSIS_USE_DEF:          return "UDRegMemWorkingSet";
+    case ANALYSIS_LIVE_REGISTER:    return "LiveRegister";
+    case ANALYSIS_FRAME_TYPE:       return "FrameType";
+    case ANALYSIS_SAVED_REGISTER:   return "SavedRegister";
+    case ANALYSIS_CALL_GRAPH:       return "CallGraph";
+    case ANALYSIS_INDIRECT_CALLEE:  return "IndirectCalleeList";
+    case ANALYSIS_LIVENESS:         return "LivenessAnalysis";
+    case ANALYSIS_COMPACT_CALL_GRAPH: return "CompactCallGraph";
+    case ANALYSIS_INDIRECT_CALL_TARGETS: return "IndirectCallTargets";
+    case ANALYSIS_FRAME_SUMMARY:    return "FrameSummary";
+    case ANALYSIS_LOOP_FOREST:      return "LoopForest";
+    default:                        return "???";
+    }
+}
+
+void AnalysisManager::dumpStatistics() {
+    LOG(1, "analysis manager: computed / reused");
+    for(size_t k = 0; k < ANALYSIS_KIND_COUNT; k ++) {
+        auto kind = static_cast<AnalysisKind>(k);
+        LOG(1, "    " << std::left << std::setw(20) << getKindName(kind)
+            << std::right << std::dec << std::setw(8) << computeCount[k]
+            << " / " << reuseCount[k]);
+    }
+}
@@ -0,0 +1,188 @@
+#ifndef EGALITO_ANALYSIS_MANAGER_H
+#define EGALITO_ANALYSIS_MANAGER_H
+
+#include <map>
+#include <set>
+#include <vector>
+#include <utility>
+
+class Chunk;
+class Function;
+class Module;
+class Program;
+class ChunkPass;
+class ChunkVisitor;
+class ControlFlowGraph;
+class UDRegMemWorkingSet;
+class LiveInfo;
+class FrameType;
+class FrameSummary;
+class CallGraph;
+class IndirectCalleeList;
+class LivenessAnalysis;
+class CompactCallGraph;
+class IndirectCallTargets;
+class LoopForest;
+
+/** Every analysis whose results can be cached by the AnalysisManager. */
+enum AnalysisKind {
+    ANALYSIS_CONTROL_FLOW,      // per Function
+    ANALYSIS_USE_DEF,           // per Function, depends on CONTROL_FLOW
+    ANALYSIS_LIVE_REGISTER,     // per Function, depends on USE_DEF
+    ANALYSIS_FRAME_TYPE,        // per Function
+    ANALYSIS_SAVED_REGISTER,    // per Function, depends on USE_DEF
+    ANALYSIS_CALL_GRAPH,        // per Program
+    ANALYSIS_INDIRECT_CALLEE,   // per Module or Program
+    ANALYSIS_LIVENESS,          // per Function, calls use the ABI
+    ANALYSIS_COMPACT_CALL_GRAPH, // per Program
+    ANALYSIS_INDIRECT_CALL_TARGETS, // per Program
+    ANALYSIS_FRAME_SUMMARY,     // per Function, may be read from an archive
+    ANALYSIS_LOOP_FOREST,       // per Function
+    ANALYSIS_KIND_COUNT
+};
+
+/** The set of analyses that remain valid after a pass has run. Passes
+    override ChunkPass::getPreservedAnalyses() to declare this; the default
+    is to preserve nothing.
+*/
+class PreservedAnalyses {
+private:
+    unsigned long mask;
+public:
+    PreservedAnalyses(unsigned long mask = 0) : mask(mask) {}
+
+    static PreservedAnalyses none() { return PreservedAnalyses(0); }
+    static PreservedAnalyses all()
+        { return PreservedAnalyses((1ul << ANALYSIS_KIND_COUNT) - 1); }
+
+    PreservedAnalyses &preserve(AnalysisKind kind)
+        { mask |= (1ul << kind); return *this; }
+    PreservedAnalyses &abandon(AnalysisKind kind)
+        { mask &= ~(1ul << kind); return *this; }
+    bool isPreserved(AnalysisKind kind) const
+        { return (mask & (1ul << kind)) != 0; }
+    unsigned long getMask() const { return mask; }
+};
+
+/** Caches analysis results keyed by (AnalysisKind, Chunk), so that each
+    analysis is computed at most once until the code it describes changes.
+
+    Invalidation is lazy. ChunkMutator reports every structural change via
+    notifyModified(), which only records the enclosing Function; stale
+    results are dropped the next time any analysis is requested. Passes run
+    through RUN_PASS additionally drop every analysis they do not preserve.
+    Code that changes semantics without a ChunkMutator (e.g. setNonreturn()
+    or setSemantic()) must call invalidate() itself.
+
+    Returned pointers are owned by the manager. A result is freed by the
+    first request for any analysis after its Function has been modified,
+    or by the end of a pass that does not preserve it. Code that keeps
+    using a result across ChunkMutator changes or further requests must
+    hold an AnalysisManager::Pin for it.
+*/
+class AnalysisManager {
+private:
+    static AnalysisManager instance;
+public:
+    static AnalysisManager *getInstance() { return &instance; }
+private:
+    class ResultBase;
+public:
+    /** Keeps the result for (kind, chunk), and the results it was built
+        from, allocated for as long as the Pin exists. A pinned result that
+        is dropped is no longer returned by the manager, but it is only
+        freed when its last Pin goes away.
+    */
+    class Pin {
+    private:
+        std::vector<ResultBase *> pinned;
+    public:
+        Pin(AnalysisKind kind, Chunk *chunk);
+        ~Pin();
+        Pin(const Pin &other) = delete;
+        Pin &operator = (const Pin &other) = delete;
+    };
+private:
+    class ResultBase {
+    public:
+        virtual ~ResultBase() {}
+    };
+    template <typename ResultType>
+    class Result : public ResultBase {
+    private:
+        ResultType *value;
+    public:
+        Result(ResultType *value) : value(value) {}
+        virtual ~Result() { delete value; }
+        ResultType *get() const { return value; }
+    };
+    class UseDefResult;
+
+    typedef std::pair<AnalysisKind, Chunk *> KeyType;
+    std::map<KeyType, ResultBase *> cache;
+    std::set<Function *> modifiedFunctions;
+    bool modifiedAnything;
+    std::map<ResultBase *, unsigned long> pinCount;
+    std::set<ResultBase *> retiredList;     // dropped while pinned
+
+    unsigned long computeCount[ANALYSIS_KIND_COUNT];
+    unsigned long reuseCount[ANALYSIS_KIND_COUNT];
+public:
+    AnalysisManager();
+    ~AnalysisManager();
+
+    ControlFlowGraph *getControlFlowGraph(Function *function);
+    UDRegMemWorkingSet *getUseDef(Function *function);
+    LiveInfo *getLiveRegisters(Function *function);
+    FrameType *getFrameType(Function *function);
+    FrameSummary *getFrameSummary(Function *function);
+#ifdef ARCH_AARCH64
+    std::vector<int> *getSavedRegisters(Function *function);
+#endif
+    CallGraph *getCallGraph(Program *program);
+    IndirectCalleeList *getIndirectCalleeList(Module *module);
+    IndirectCalleeList *getIndirectCalleeList(Program *program);
+    LivenessAnalysis *getLiveness(Function *function);
+    CompactCallGraph *getCompactCallGraph(Program *program);
+    IndirectCallTargets *getIndirectCallTargets(Program *program);
+    LoopForest *getLoopForest(Function *function);
+
+    /** Takes ownership of a summary that describes function as it is now,
+        e.g. one just read from an archive.
+    */
+    void adoptFrameSummary(Function *function, FrameSummary *summary);
+
+    /** Returns true if a result for this analysis is cached and current. */
+    bool isCached(AnalysisKind kind, Chunk *chunk);
+
+    /** Records that chunk (or its enclosing Function) has been changed. */
+    void notifyModified(Chunk *chunk);
+
+    /** Drops every result computed for function, and any whole-program
+        result that may have depended on it.
+    */
+    void invalidate(Function *function);
+    /** Drops every cached result whose kind is not preserved. */
+    void invalidate(const PreservedAnalyses &preserved);
+    void invalidateAll() { invalidate(PreservedAnalyses::none()); }
+
+    void passFinished(ChunkPass *pass);
+    void passFinished(ChunkVisitor *visitor);
+
+    void dumpStatistics();
+private:
+    template <typename ResultType>
+    ResultType *lookup(AnalysisKind kind, Chunk *chunk);
+    template <typename ResultType>
+    ResultType *store(AnalysisKind kind, Chunk *chunk, ResultType *value);
+    void flushModified();
+    void drop(AnalysisKind kind, Chunk *chunk);
+    void dropKind(AnalysisKind kind);
+    void release(ResultBase *result);
+    ResultBase *pin(AnalysisKind kind, Chunk *chunk);
+    void unpin(ResultBase *result);
+    unsigned long getDependents(AnalysisKind kind);
+    const char *getKindName(AnalysisKind kind);
+};
+
+#endif
@@ -2,12 +2,15 @@
 #include <cassert>
 #include "pointerdetection.h"
 #include "analysis/slicingtree.h"
+#include "analysis/dataflow.h"
+#include "analysis/liveregister.h"
 #include "analysis/usedef.h"
 #include "analysis/walker.h"
 #include "chunk/concrete.h"
 #include "instr/isolated.h"
 #include "instr/linked-aarch64.h"
 #include "disasm/riscv-disas.h"
+#include "util/parallel.h"
 
 #include "log/log.h"
 #include "log/temp.h"
@@ -69,6 +72,49 @@ void PointerDetection::detect(UDRegMemWorkingSet *working) {
     }
 }
 
+void ModulePointerDetection::detect(Module *module, unsigned threads) {
+    std::vector<Function *> functionList;
+    for(auto function : CIter::functions(module)) {
+        functionList.push_back(function);
+    }
+    size_t count = functionList.size();
+
+    // these indices are built on first use, which must not happen in
+    // several threads at once
+    module->getFunctionList()->getChildren()->getNamed();
+    module->getFunctionList()->getChildren()->getSpatial();
+
+    DataFlow df;
+    df.addUseDefFor(functionList, threads);
+
+#ifdef ARCH_AARCH64
+    std::vector<LiveInfo> infoList(count);
+    parallelFor(count, threads, [&] (size_t i) {
+        LiveRegister local;
+        infoList[i] = local.getInfo(df.getWorkingSet(functionList[i]));
+    });
+    LiveRegister live;
+    for(size_t i = 0; i < count; i ++) {
+        live.setInfo(functionList[i], infoList[i]);
+    }
+
+    // only changes the use-def of the function itself
+    parallelFor(count, threads, [&] (size_t i) {
+        df.adjustCallUse(&live, functionList[i], module);
+    });
+#endif
+
+    std::vector<std::vector<std::pair<Instruction *, address_t>>> found(count);
+    parallelFor(count, threads, [&] (size_t i) {
+        PointerDetection pd;
+        pd.detect(df.getWorkingSet(functionList[i]));
+        found[i] = pd.getList();
+    });
+    for(auto &list : found) {
+        pointerList.insert(pointerList.end(), list.begin(), list.end());
+    }
+}
+
 #ifdef ARCH_AARCH64
 void PointerDetection::detectAtLDR(UDState *state) {
     for(auto& def : state->getRegDefList()) {
@@ -7,6 +7,7 @@
 #include "analysis/controlflow.h"
 #include "analysis/slicingmatch.h"
 
+class Module;
 class Function;
 class Instruction;
 class UDState;
@@ -34,6 +35,25 @@ private:
     #endif
 };
 
+/** Runs PointerDetection over every function of a module in one batch.
+
+    Use-def, live registers and the detection itself are each computed
+    exactly once per function, in parallel across functions. Only the
+    adjustment of call uses waits for every function's live registers.
+    Pointers are listed in function order whatever the number of threads,
+    so the Links can then be created in a single serial step.
+*/
+class ModulePointerDetection {
+private:
+    std::vector<std::pair<Instruction *, address_t>> pointerList;
+public:
+    /** Uses up to threads workers; 0 means one per hardware thread. */
+    void detect(Module *module, unsigned threads = 0);
+
+    const std::vector<std::pair<Instruction *, address_t>> &getList() const
+        { return pointerList; }
+};
+
 class PageOffsetList {
 private:
     typedef TreePatternBinary<TreeNodeAddition,
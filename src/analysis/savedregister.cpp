@@ -2,6 +2,7 @@
 #include "analysis/usedef.h"
 #include "analysis/walker.h"
 #include "analysis/controlflow.h"
+#include "analysis/manager.h"
 #include "chunk/concrete.h"
 #include "instr/register.h"
 #include "instr/isolated.h"
@@ -14,16 +15,7 @@
 #ifdef ARCH_AARCH64
 
 std::vector<int> SavedRegister::getList(Function *function) {
-    ControlFlowGraph cfg(function);
-    UDConfiguration config(&cfg);
-    UDRegMemWorkingSet working(function, &cfg);
-    UseDef usedef(&config, &working);
-
-    SccOrder order(&cfg);
-    order.genFull(0);
-    usedef.analyze(order.get());
-
-    return getList(&working);
+    return *AnalysisManager::getInstance()->getSavedRegisters(function);
 }
 
 std::vector<int> SavedRegister::getList(UDRegMemWorkingSet *working) {
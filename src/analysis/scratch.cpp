@@ -0,0 +1,103 @@
+#include "scratch.h"
+#include "manager.h"
+#include "chunk/concrete.h"
+#include "log/log.h"
+
+// full-width capstone register for each general-purpose index
+#ifdef ARCH_X86_64
+static const Register gpRegisters[] = {
+    X86_REG_RAX, X86_REG_RCX, X86_REG_RDX, X86_REG_RBX,
+    X86_REG_RSP, X86_REG_RBP, X86_REG_RSI, X86_REG_RDI,
+    X86_REG_R8,  X86_REG_R9,  X86_REG_R10, X86_REG_R11,
+    X86_REG_R12, X86_REG_R13, X86_REG_R14, X86_REG_R15
+};
+#elif defined(ARCH_AARCH64)
+static const Register gpRegisters[] = {
+    ARM64_REG_X0,  ARM64_REG_X1,  ARM64_REG_X2,  ARM64_REG_X3,
+    ARM64_REG_X4,  ARM64_REG_X5,  ARM64_REG_X6,  ARM64_REG_X7,
+    ARM64_REG_X8,  ARM64_REG_X9,  ARM64_REG_X10, ARM64_REG_X11,
+    ARM64_REG_X12, ARM64_REG_X13, ARM64_REG_X14, ARM64_REG_X15,
+    ARM64_REG_X16, ARM64_REG_X17, ARM64_REG_X18, ARM64_REG_X19,
+    ARM64_REG_X20, ARM64_REG_X21, ARM64_REG_X22, ARM64_REG_X23,
+    ARM64_REG_X24, ARM64_REG_X25, ARM64_REG_X26, ARM64_REG_X27,
+    ARM64_REG_X28, ARM64_REG_X29, ARM64_REG_X30
+};
+#endif
+
+static bool isReserved(int index) {
+#ifdef ARCH_X86_64
+    return index == X86Register::SP || index == X86Register::BP;
+#elif defined(ARCH_AARCH64)
+    // platform register, frame pointer, and SP
+    return index == AARCH64GPRegister::R18 || index == AARCH64GPRegister::FP
+        || index == AARCH64GPRegister::SP;
+#else
+    return true;
+#endif
+}
+
+ScratchRegisters::ScratchRegisters(Function *function) {
+    auto liveness = AnalysisManager::getInstance()->getLiveness(function);
+
+    for(auto block : CIter::children(function)) {
+        auto list = block->getChildren()->getIterable();
+        RegisterBitVector live = liveness->getLiveOut(block);
+        for(int i = static_cast<int>(list->getCount()) - 1; i >= 0; i --) {
+            auto instr = list->get(i);
+            RegisterAccess access(instr);
+            live.assignTransfer(access.getUse(), live, access.getKill());
+            liveMap[instr] = live;
+        }
+    }
+}
+
+RegisterBitVector ScratchRegisters::getLive(Instruction *point) const {
+    auto it = liveMap.find(point);
+    if(it == liveMap.end()) {
+        LOG(10, "no liveness for instruction " << point->getName());
+        return RegisterBitVector::everything();
+    }
+    return it->second;
+}
+
+bool ScratchRegisters::isDead(Instruction *point, Register reg) const {
+    int index = RegisterBitVector::getIndex(reg);
+    if(index < 0) return false;
+    if(index != RegisterBitVector::FLAGS && isReserved(index)) return false;
+
+    return !getLive(point).get(index);
+}
+
+bool ScratchRegisters::areFlagsDead(Instruction *point) const {
+    return !getLive(point).get(RegisterBitVector::FLAGS);
+}
+
+std::vector<Register> ScratchRegisters::getDeadRegisters(
+    Instruction *point) const {
+
+    std::vector<Register> result;
+#if defined(ARCH_X86_64) || defined(ARCH_AARCH64)
+    auto live = getLive(point);
+    auto callerSaved = RegisterBitVector::callerSaved();
+    const int count = sizeof(gpRegisters) / sizeof(*gpRegisters);
+
+    for(int pass = 0; pass < 2; pass ++) {
+        for(int index = 0; index < count; index ++) {
+            if(callerSaved.get(index) != (pass == 0)) continue;
+            if(isReserved(index) || live.get(index)) continue;
+
+            result.push_back(gpRegisters[index]);
+        }
+    }
+#endif
+    return result;
+}
+
+Register ScratchRegisters::findScratch(Instruction *point,
+    const std::vector<Register> &candidates) const {
+
+    for(auto reg : candidates) {
+        if(isDead(point, reg)) return reg;
+    }
+    return INVALID_REGISTER;
+}
@@ -0,0 +1,48 @@
+#ifndef EGALITO_ANALYSIS_SCRATCH_H
+#define EGALITO_ANALYSIS_SCRATCH_H
+
+#include <map>
+#include <vector>
+#include "liveness.h"
+#include "instr/register.h"
+
+class Function;
+class Instruction;
+
+/** Finds registers that code inserted before an instruction may overwrite
+    without saving them first.
+
+    Liveness before each instruction is computed once, by rescanning every
+    block backwards from the live-out sets that the AnalysisManager caches.
+    Create this before changing the function, and only query instructions
+    that existed at that time: ChunkMutator::insertBefore() may move an
+    instruction's semantic to a new Instruction.
+*/
+class ScratchRegisters {
+private:
+    std::map<Instruction *, RegisterBitVector> liveMap;
+public:
+    ScratchRegisters(Function *function);
+
+    /** Registers that are live just before point. Unknown instructions
+        are treated as if every register were live.
+    */
+    RegisterBitVector getLive(Instruction *point) const;
+
+    /** Whether reg (a capstone register) is dead just before point. The
+        stack and frame pointers are never considered dead.
+    */
+    bool isDead(Instruction *point, Register reg) const;
+    bool areFlagsDead(Instruction *point) const;
+
+    /** Dead general-purpose registers, caller-saved ones first. */
+    std::vector<Register> getDeadRegisters(Instruction *point) const;
+
+    /** Returns the first of candidates that is dead before point, or
+        INVALID_REGISTER if there is none.
+    */
+    Register findScratch(Instruction *point,
+        const std::vector<Register> &candidates) const;
+};
+
+#endif
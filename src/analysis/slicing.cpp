@@ -1371,19 +1371,7 @@ SlicingSearch::~SlicingSearch() {
 }
 
 bool SlicingSearch::shouldContinue(SearchState *currentState) {
-    bool stillSearching = false;
-    for(auto r : currentState->getRegs()) {
-        if(r) {
-            stillSearching = true;
-            break;
-        }
-    }
-    if(!stillSearching) {
-        if(currentState->getMems().size() > 0) {
-            stillSearching = true;
-        }
-    }
-
-    return stillSearching;
+    return currentState->getRegs().any()
+        || currentState->getMems().size() > 0;
 }
 
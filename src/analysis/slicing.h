@@ -4,6 +4,7 @@
 #include <vector>
 #include <map>
 #include <set>
+#include <bitset>
 #include "controlflow.h"
 #include "flow.h"
 #include "instr/register.h"
@@ -14,6 +15,9 @@ class TreeNode;
 class Memory;
 class SlicingInstructionState;
 
+/** One bit per capstone register id; copied along with every SearchState. */
+typedef std::bitset<REGISTER_ENDING> SlicingRegisterSet;
+
 class SearchState {
 private:
     typedef std::pair<TreeNode *, TreeNode *> memTreeType;
@@ -21,7 +25,7 @@ private:
     ControlFlowNode *node;
     Instruction *instruction;
     SlicingInstructionState *iState;
-    std::vector<bool> regs;
+    SlicingRegisterSet regs;
     std::vector<SearchState *> parents;
     std::map<int, TreeNode *> regTree;
     std::vector<memTreeType> memTree;
@@ -33,7 +37,7 @@ public:
           jumpTaken(false) {}
     SearchState(ControlFlowNode *node, Instruction *instruction)
         : node(node), instruction(instruction), iState(nullptr),
-          regs(REGISTER_ENDING), jumpTaken(false) {}
+          jumpTaken(false) {}
     SearchState(const SearchState &other)
         : node(other.node), instruction(other.instruction),
           iState(nullptr), regs(other.regs),
@@ -49,7 +53,7 @@ public:
     void setIState(SlicingInstructionState *iState)
         { this->iState = iState; }
 
-    const std::vector<bool> &getRegs() const { return regs; }
+    const SlicingRegisterSet &getRegs() const { return regs; }
     void addReg(int reg) { regs[reg] = true; }
     void removeReg(int reg) { regs[reg] = false; }
     bool getReg(int reg) { return regs[reg]; }
@@ -150,6 +150,7 @@ TreeFactory& TreeFactory::instance() {
 }
 
 TreeNodeRegister *TreeFactory::makeTreeNodeRegister(int reg) {
+    std::lock_guard<std::mutex> guard(mutex);
     auto i = regTrees.find(reg);
     if(i != regTrees.end()) {
         return i->second;
@@ -163,6 +164,7 @@ TreeNodeRegister *TreeFactory::makeTreeNodeRegister(int reg) {
 TreeNodePhysicalRegister *TreeFactory::makeTreeNodePhysicalRegister(
     Register reg, int width) {
 
+    std::lock_guard<std::mutex> guard(mutex);
     auto i = regPhysicalTrees.find(reg);
     if(i != regPhysicalTrees.end()) {
         return i->second;
@@ -174,12 +176,14 @@ TreeNodePhysicalRegister *TreeFactory::makeTreeNodePhysicalRegister(
 }
 
 void TreeFactory::clean() {
+    std::lock_guard<std::mutex> guard(mutex);
     for(auto t : trees) { delete t; }
     trees.clear();
 }
 
 void TreeFactory::cleanAll() {
     clean();
+    std::lock_guard<std::mutex> guard(mutex);
     for(auto t : regTrees) { delete t.second; }
     regTrees.clear();
     for(auto t : regPhysicalTrees) { delete t.second; }
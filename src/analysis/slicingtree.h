@@ -4,6 +4,7 @@
 #include <iosfwd>
 #include <vector>
 #include <map>
+#include <mutex>
 #include "instr/register.h"
 #include "types.h"
 
@@ -262,8 +263,12 @@ public:
     virtual bool equal(TreeNode *tree);
 };
 
+/** Owns every TreeNode. Safe to use from several threads at once, e.g.
+    while use-def is computed for many functions in parallel.
+*/
 class TreeFactory {
 private:
+    std::mutex mutex;
     std::vector<TreeNode *> trees;
     std::map<int, TreeNodeRegister *> regTrees;
     std::map<Register, TreeNodePhysicalRegister *> regPhysicalTrees;
@@ -274,6 +279,7 @@ public:
     template <typename TreeNodeType, typename... Args>
     TreeNodeType *make(Args... args) {
         TreeNodeType *n = new TreeNodeType(args...);
+        std::lock_guard<std::mutex> guard(mutex);
         trees.push_back(n);
         return n;
     }
@@ -0,0 +1,444 @@
+#include <streambuf>
+#include <istream>
+#include <sstream>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>  // for std::rename
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "analysisdb.h"
+#include "config.h"
+#include "stream.h"
+#include "chunk/concrete.h"
+#include "chunk/jumptable.h"
+#include "chunk/link.h"
+#include "elf/elfspace.h"
+#include "elf/elfmap.h"
+#include "instr/concrete.h"
+#include "operation/find.h"
+#include "analysis/jumptable.h"
+#include "analysis/manager.h"
+#include "util/feature.h"
+
+#include "log/log.h"
+
+void ModuleAnalysisRecord::recordJumpTables(Module *module) {
+    jumpTableList.clear();
+    if(!module->getJumpTableList()) return;
+
+    // one record per jump; records for a shared table differ only in jump
+    for(auto jumpTable : CIter::children(module->getJumpTableList())) {
+        auto descriptor = jumpTable->getDescriptor();
+        JumpTableRecord table;
+        table.address = descriptor->getAddress();
+        table.targetBase = descriptor->getTargetBaseLink()->getTargetAddress();
+        table.scale = descriptor->getScale();
+        table.entries = descriptor->getEntries();
+
+        auto jumpList = jumpTable->getJumpInstructionList();
+        if(jumpList.empty()) jumpList.push_back(descriptor->getInstruction());
+        for(auto jump : jumpList) {
+            table.jump = makeLocation(jump);
+            jumpTableList.push_back(table);
+        }
+    }
+}
+
+void ModuleAnalysisRecord::recordNonReturn(Module *module) {
+    nonReturnFunctionList.clear();
+    nonReturnCallList.clear();
+
+    for(auto function : CIter::functions(module)) {
+        if(!function->returns()) {
+            nonReturnFunctionList.push_back(function->getAddress());
+        }
+        for(auto block : CIter::children(function)) {
+            for(auto instr : CIter::children(block)) {
+                auto cfi = dynamic_cast<ControlFlowInstruction *>(
+                    instr->getSemantic());
+                if(cfi && !cfi->returns()) {
+                    nonReturnCallList.push_back(makeLocation(instr));
+                }
+            }
+        }
+    }
+}
+
+void ModuleAnalysisRecord::recordInferredLink(Instruction *instruction,
+    address_t target) {
+
+    LinkRecord link;
+    link.instruction = makeLocation(instruction);
+    link.target = target;
+    inferredLinkList.push_back(link);
+}
+
+void ModuleAnalysisRecord::applyNonReturn(Module *module) {
+    for(auto address : nonReturnFunctionList) {
+        auto function = findFunction(module, address);
+        function->setNonreturn();
+        AnalysisManager::getInstance()->invalidate(function);
+    }
+    for(const auto &location : nonReturnCallList) {
+        auto instr = findInstruction(module, location);
+        auto cfi = dynamic_cast<ControlFlowInstruction *>(
+            instr->getSemantic());
+        cfi->setNonreturn();
+        AnalysisManager::getInstance()->invalidate(
+            findFunction(module, location.function));
+    }
+}
+
+bool ModuleAnalysisRecord::validate(Module *module) const {
+    for(const auto &table : jumpTableList) {
+        auto instr = findInstruction(module, table.jump);
+        if(!instr || !dynamic_cast<IndirectJumpInstruction *>(
+            instr->getSemantic())) {
+
+            return false;
+        }
+    }
+    for(auto address : nonReturnFunctionList) {
+        if(!findFunction(module, address)) return false;
+    }
+    for(const auto &location : nonReturnCallList) {
+        auto instr = findInstruction(module, location);
+        if(!instr || !dynamic_cast<ControlFlowInstruction *>(
+            instr->getSemantic())) {
+
+            return false;
+        }
+    }
+    // inferred links are recorded after functions may have been split, so
+    // they are checked when they are applied
+    return true;
+}
+
+auto ModuleAnalysisRecord::makeLocation(Instruction *instruction)
+    -> Location {
+
+    auto function = instruction->getParent()->getParent();
+    return Location(function->getAddress(),
+        instruction->getAddress() - function->getAddress());
+}
+
+Function *ModuleAnalysisRecord::findFunction(Module *module,
+    address_t address) {
+
+    return CIter::spatial(module->getFunctionList())->find(address);
+}
+
+Instruction *ModuleAnalysisRecord::findInstruction(Module *module,
+    const Location &location) {
+
+    auto function = findFunction(module, location.function);
+    if(!function) return nullptr;
+    auto address = location.function + location.offset;
+    auto instr = dynamic_cast<Instruction *>(
+        ChunkFind().findInnermostAt(function, address));
+    if(!instr || instr->getAddress() != address) return nullptr;
+    return instr;
+}
+
+/** Lets an ArchiveStreamReader parse a mapped file without copying. */
+class MappedStreamBuffer : public std::streambuf {
+public:
+    MappedStreamBuffer(char *data, size_t size)
+        { setg(data, data, data + size); }
+};
+
+static const char magic[] = "EGALADB";  // 8 bytes with the terminator
+
+static void writeLocation(ArchiveStreamWriter &writer,
+    const ModuleAnalysisRecord::Location &location) {
+
+    writer.write<uint64_t>(location.function);
+    writer.write<uint32_t>(location.offset);
+}
+
+static ModuleAnalysisRecord::Location readLocation(
+    ArchiveStreamReader &reader) {
+
+    ModuleAnalysisRecord::Location location;
+    location.function = reader.read<uint64_t>();
+    location.offset = reader.read<uint32_t>();
+    return location;
+}
+
+AnalysisDatabase AnalysisDatabase::instance;
+
+AnalysisDatabase::AnalysisDatabase() : readOnly(false) {
+#ifdef CACHE_DIR
+    directory = CACHE_DIR;
+#endif
+    if(const char *env = getenv("EGALITO_ANALYSIS_DB")) {
+        directory = env;
+    }
+    readOnly = isFeatureEnabled("EGALITO_ANALYSIS_DB_READONLY");
+}
+
+ModuleAnalysisRecord *AnalysisDatabase::load(Module *module,
+    uint64_t dependencyHash) {
+
+    if(!isEnabled()) return nullptr;
+
+    uint64_t hash = hashModule(module);
+    auto filename = getFilename(hash);
+    int fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0) return nullptr;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return nullptr;
+    }
+    size_t size = st.st_size;
+    void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) return nullptr;
+
+    MappedStreamBuffer buffer(static_cast<char *>(map), size);
+    std::istream stream(&buffer);
+    ArchiveStreamReader reader(stream);
+
+    auto record = new ModuleAnalysisRecord(dependencyHash);
+    bool good = (reader.readFixedLengthBytes(sizeof(magic))
+        == std::string(magic, sizeof(magic)));
+    good = good && (reader.read<uint32_t>() == VERSION);
+    good = good && (reader.read<uint32_t>() == ANALYSIS_VERSION);
+    good = good && (reader.read<uint64_t>() == hash);
+    bool sameDependencies = good
+        && (reader.read<uint64_t>() == dependencyHash);
+    if(good && !sameDependencies) {
+        LOG(1, "analysis database: dependencies of [" << module->getName()
+            << "] have changed, ignoring its record");
+        good = false;
+    }
+    if(good) {
+        reader.readString();  // module name, for humans only
+
+        for(uint32_t n = reader.read<uint32_t>(); n > 0; n --) {
+            ModuleAnalysisRecord::JumpTableRecord table;
+            table.jump = readLocation(reader);
+            table.address = reader.read<uint64_t>();
+            table.targetBase = reader.read<uint64_t>();
+            table.scale = reader.read<uint32_t>();
+            table.entries = static_cast<int64_t>(reader.read<uint64_t>());
+            if(!reader.stillGood()) break;
+            record->addJumpTable(table);
+        }
+        for(uint32_t n = reader.read<uint32_t>(); n > 0; n --) {
+            address_t address = reader.read<uint64_t>();
+            if(!reader.stillGood()) break;
+            record->addNonReturnFunction(address);
+        }
+        for(uint32_t n = reader.read<uint32_t>(); n > 0; n --) {
+            auto location = readLocation(reader);
+            if(!reader.stillGood()) break;
+            record->addNonReturnCall(location);
+        }
+        for(uint32_t n = reader.read<uint32_t>(); n > 0; n --) {
+            ModuleAnalysisRecord::LinkRecord link;
+            link.instruction = readLocation(reader);
+            link.target = reader.read<uint64_t>();
+            if(!reader.stillGood()) break;
+            record->addInferredLink(link);
+        }
+        good = reader.stillGood();
+    }
+    munmap(map, size);
+
+    if(good && !record->validate(module)) {
+        LOG(1, "analysis database: record for [" << module->getName()
+            << "] does not match this parse, ignoring it");
+        good = false;
+    }
+    if(!good) {
+        delete record;
+        return nullptr;
+    }
+
+    LOG(1, "analysis database: loaded [" << module->getName() << "] from "
+        << filename);
+    return record;
+}
+
+bool AnalysisDatabase::save(Module *module,
+    const ModuleAnalysisRecord *record) {
+
+    if(!isEnabled() || readOnly) return false;
+
+    uint64_t hash = hashModule(module);
+    std::ostringstream stream;
+    ArchiveStreamWriter writer(stream);
+
+    writer.writeFixedLengthBytes(magic, sizeof(magic));
+    writer.write<uint32_t>(VERSION);
+    writer.write<uint32_t>(ANALYSIS_VERSION);
+    writer.write<uint64_t>(hash);
+    writer.write<uint64_t>(record->getDependencyHash());
+    writer.writeString(module->getName());
+
+    writer.write<uint32_t>(record->getJumpTableList().size());
+    for(const auto &table : record->getJumpTableList()) {
+        writeLocation(writer, table.jump);
+        writer.write<uint64_t>(table.address);
+        writer.write<uint64_t>(table.targetBase);
+        writer.write<uint32_t>(table.scale);
+        writer.write<uint64_t>(static_cast<uint64_t>(table.entries));
+    }
+    writer.write<uint32_t>(record->getNonReturnFunctionList().size());
+    for(auto address : record->getNonReturnFunctionList()) {
+        writer.write<uint64_t>(address);
+    }
+    writer.write<uint32_t>(record->getNonReturnCallList().size());
+    for(const auto &location : record->getNonReturnCallList()) {
+        writeLocation(writer, location);
+    }
+    writer.write<uint32_t>(record->getInferredLinkList().size());
+    for(const auto &link : record->getInferredLinkList()) {
+        writeLocation(writer, link.instruction);
+        writer.write<uint64_t>(link.target);
+    }
+
+    // the default CACHE_DIR may not exist yet; errors show up below
+    mkdir(directory.c_str(), 0755);
+    auto filename = getFilename(hash);
+    if(!writeFile(filename, stream.str())) return false;
+
+    LOG(1, "analysis database: saved [" << module->getName() << "] to "
+        << filename);
+    return true;
+}
+
+bool AnalysisDatabase::loadNonReturnExports(const std::string &path,
+    std::vector<std::string> &nameList) {
+
+    if(!isEnabled() || path.empty()) return false;
+
+    struct stat st;
+    if(stat(path.c_str(), &st) != 0) return false;
+
+    std::ifstream file(getExportsFilename(path), std::ios::binary);
+    if(!file) return false;
+    ArchiveStreamReader reader(file);
+
+    bool good = (reader.readFixedLengthBytes(sizeof(magic))
+        == std::string(magic, sizeof(magic)));
+    good = good && (reader.read<uint32_t>() == VERSION);
+    good = good && (reader.read<uint32_t>() == ANALYSIS_VERSION);
+    good = good && (reader.readString() == path);
+    // size and mtime, since the library itself may not be mapped yet
+    good = good && (reader.read<uint64_t>() == uint64_t(st.st_size));
+    good = good && (reader.read<uint64_t>() == uint64_t(st.st_mtime));
+    if(!good) return false;
+
+    std::vector<std::string> list;
+    for(uint32_t n = reader.read<uint32_t>(); n > 0; n --) {
+        auto name = reader.readString();
+        if(!reader.stillGood()) return false;
+        list.push_back(name);
+    }
+    if(!reader.stillGood()) return false;
+
+    nameList.insert(nameList.end(), list.begin(), list.end());
+    return true;
+}
+
+bool AnalysisDatabase::saveNonReturnExports(const std::string &path,
+    const std::vector<std::string> &nameList) {
+
+    if(!isEnabled() || readOnly || path.empty()) return false;
+
+    struct stat st;
+    if(stat(path.c_str(), &st) != 0) return false;
+
+    std::ostringstream stream;
+    ArchiveStreamWriter writer(stream);
+    writer.writeFixedLengthBytes(magic, sizeof(magic));
+    writer.write<uint32_t>(VERSION);
+    writer.write<uint32_t>(ANALYSIS_VERSION);
+    writer.writeString(path);
+    writer.write<uint64_t>(st.st_size);
+    writer.write<uint64_t>(st.st_mtime);
+    writer.write<uint32_t>(nameList.size());
+    for(const auto &name : nameList) {
+        writer.writeString(name);
+    }
+
+    return writeFile(getExportsFilename(path), stream.str());
+}
+
+bool AnalysisDatabase::writeFile(const std::string &filename,
+    const std::string &data) {
+
+    // write to a unique temporary file, then atomically replace
+    std::string temporary = filename + ".XXXXXX";
+    int fd = mkstemp(&temporary[0]);
+    if(fd < 0) {
+        LOG(1, "analysis database: cannot create " << temporary);
+        return false;
+    }
+
+    const char *p = data.c_str();
+    size_t left = data.length();
+    while(left > 0) {
+        ssize_t n = ::write(fd, p, left);
+        if(n <= 0) break;
+        p += n;
+        left -= n;
+    }
+    bool good = (left == 0) && (fsync(fd) == 0);
+    fchmod(fd, 0644);
+    close(fd);
+
+    if(!good || std::rename(temporary.c_str(), filename.c_str()) != 0) {
+        LOG(1, "analysis database: failed to write " << filename);
+        unlink(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::string AnalysisDatabase::getFilename(uint64_t hash) const {
+    std::ostringstream name;
+    name << directory << "/" << std::hex << hash << ".adb";
+    return name.str();
+}
+
+std::string AnalysisDatabase::getExportsFilename(
+    const std::string &path) const {
+
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for(auto c : path) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3ull;
+    }
+    std::ostringstream name;
+    name << directory << "/" << std::hex << hash << ".exports";
+    return name.str();
+}
+
+uint64_t AnalysisDatabase::hashModule(Module *module) {
+    // FNV-1a over the whole file, a 64-bit word at a time: the file is
+    // hashed on every parse, and byte steps cost too much for libc
+    auto elf = module->getElfSpace()->getElfMap();
+    auto data = static_cast<const char *>(elf->getCharmap());
+    size_t length = elf->getLength();
+    uint64_t hash = 0xcbf29ce484222325ull ^ length;
+    size_t i = 0;
+    for(; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        hash ^= word;
+        hash *= 0x100000001b3ull;
+    }
+    for(; i < length; i ++) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
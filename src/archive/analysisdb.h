@@ -0,0 +1,154 @@
+#ifndef EGALITO_ARCHIVE_ANALYSIS_DB_H
+#define EGALITO_ARCHIVE_ANALYSIS_DB_H
+
+#include <vector>
+#include <string>
+#include <utility>
+#include <cstdint>
+#include "types.h"
+
+class Module;
+class Function;
+class Instruction;
+
+/** Expensive per-module analysis results in a form that does not depend on
+    Chunk pointers: jump tables (including bounds found by JumpTableBounds
+    and JumpTableOverestimate), non-returning functions and calls, and
+    links inferred by InferLinksPass.
+
+    Code is identified by the address of its Function within the ELF file
+    plus an offset into that Function, so a record made from one parse can
+    be applied to any later parse of the same file. Each part is recorded
+    and applied at the same point in ConductorPasses::newElfPasses().
+
+    Non-returning functions also depend on the non-returning exports of
+    the module's dependencies, so the record keeps a fingerprint of those
+    (see NonReturnFunction::fingerprintExternal()).
+*/
+class ModuleAnalysisRecord {
+public:
+    struct Location {
+        address_t function;
+        uint32_t offset;
+
+        Location() : function(0), offset(0) {}
+        Location(address_t function, uint32_t offset)
+            : function(function), offset(offset) {}
+    };
+    struct JumpTableRecord {
+        Location jump;
+        address_t address;
+        address_t targetBase;
+        uint32_t scale;
+        int64_t entries;
+    };
+    struct LinkRecord {
+        Location instruction;
+        address_t target;  // only needed by aarch64
+    };
+private:
+    uint64_t dependencyHash;
+    std::vector<JumpTableRecord> jumpTableList;
+    std::vector<address_t> nonReturnFunctionList;
+    std::vector<Location> nonReturnCallList;
+    std::vector<LinkRecord> inferredLinkList;
+public:
+    ModuleAnalysisRecord(uint64_t dependencyHash = 0)
+        : dependencyHash(dependencyHash) {}
+
+    uint64_t getDependencyHash() const { return dependencyHash; }
+    const std::vector<JumpTableRecord> &getJumpTableList() const
+        { return jumpTableList; }
+    const std::vector<address_t> &getNonReturnFunctionList() const
+        { return nonReturnFunctionList; }
+    const std::vector<Location> &getNonReturnCallList() const
+        { return nonReturnCallList; }
+    const std::vector<LinkRecord> &getInferredLinkList() const
+        { return inferredLinkList; }
+
+    void addJumpTable(const JumpTableRecord &table)
+        { jumpTableList.push_back(table); }
+    void addNonReturnFunction(address_t function)
+        { nonReturnFunctionList.push_back(function); }
+    void addNonReturnCall(const Location &call)
+        { nonReturnCallList.push_back(call); }
+    void addInferredLink(const LinkRecord &link)
+        { inferredLinkList.push_back(link); }
+
+    /** Captures the descriptors of every JumpTable in module. */
+    void recordJumpTables(Module *module);
+    /** Captures every non-returning Function and call in module. */
+    void recordNonReturn(Module *module);
+    void recordInferredLink(Instruction *instruction, address_t target = 0);
+
+    /** Marks the recorded functions and calls as non-returning. */
+    void applyNonReturn(Module *module);
+
+    /** Returns true if every recorded location exists in module. */
+    bool validate(Module *module) const;
+
+    static Location makeLocation(Instruction *instruction);
+    static Function *findFunction(Module *module, address_t address);
+    static Instruction *findInstruction(Module *module,
+        const Location &location);
+};
+
+/** A directory of ModuleAnalysisRecords, one file per ELF file keyed by a
+    hash of its contents. Set EGALITO_ANALYSIS_DB to the directory to use;
+    otherwise CACHE_DIR from the platform config is used if it is defined
+    (as on aarch64), and the database is off if not. With
+    EGALITO_ANALYSIS_DB_READONLY=1 existing records are used but never
+    written, so one database can be shared by many workers.
+
+    Non-returning exports are kept per library path, next to the records.
+
+    Files are written to a temporary name and renamed into place, so
+    concurrent readers never see a partial record. Records are read through
+    mmap. A record whose version, hash or dependency fingerprint does not
+    match is ignored.
+*/
+class AnalysisDatabase {
+private:
+    static AnalysisDatabase instance;
+public:
+    static AnalysisDatabase *getInstance() { return &instance; }
+
+    enum {
+        VERSION = 3,            // the file format
+        /** Bump whenever a pass whose results are recorded changes (jump
+            table detection and bounds, NonReturnFunction, InferLinksPass),
+            so that results from the old code are not served.
+        */
+        ANALYSIS_VERSION = 1
+    };
+private:
+    std::string directory;
+    bool readOnly;
+public:
+    AnalysisDatabase();
+
+    bool isEnabled() const { return !directory.empty(); }
+    bool isReadOnly() const { return readOnly; }
+
+    /** Returns a new record for module, or nullptr if none is usable or
+        it was made against dependencies with other non-returning exports.
+    */
+    ModuleAnalysisRecord *load(Module *module, uint64_t dependencyHash);
+    bool save(Module *module, const ModuleAnalysisRecord *record);
+
+    /** Exported names of the library at path that never return, so that
+        modules parsed before it can see through their PLT calls. Fails if
+        the library has changed since the names were saved.
+    */
+    bool loadNonReturnExports(const std::string &path,
+        std::vector<std::string> &nameList);
+    bool saveNonReturnExports(const std::string &path,
+        const std::vector<std::string> &nameList);
+private:
+    std::string getFilename(uint64_t hash) const;
+    std::string getExportsFilename(const std::string &path) const;
+    bool writeFile(const std::string &filename, const std::string &data);
+    static uint64_t hashModule(Module *module);
+};
+
+#endif
@@ -8,7 +8,7 @@
 class EgalitoArchive {
 public:
     static const char *SIGNATURE;
-    static const uint32_t VERSION = 24;
+    static const uint32_t VERSION = 26;
 private:
     FlatChunkList flatList;
     std::string sourceFilename;
@@ -5,6 +5,8 @@
 #include "serializer.h"
 #include "visitor.h"
 #include "chunk/cache.h"
+#include "analysis/framesummary.h"
+#include "analysis/manager.h"
 #include "elf/symbol.h"
 #include "disasm/disassemble.h"
 #include "instr/writer.h"
@@ -86,6 +88,9 @@ void Function::serialize(ChunkSerializerOperations &op,
         }
     }
 #endif
+
+    // saves the stack-manipulating passes from recomputing this on load
+    AnalysisManager::getInstance()->getFrameSummary(this)->serialize(writer);
 }
 
 bool Function::deserialize(ChunkSerializerOperations &op,
@@ -151,6 +156,15 @@ bool Function::deserialize(ChunkSerializerOperations &op,
 
         ChunkMutator(this, true);  // recalculate addresses
     }
+
+    auto summary = new FrameSummary();
+    if(summary->deserialize(reader) && summary->matches(this)) {
+        AnalysisManager::getInstance()->adoptFrameSummary(this, summary);
+    }
+    else {
+        LOG(1, "WARNING: ignoring bad frame summary for " << getName());
+        delete summary;
+    }
     return reader.stillGood();
 }
 
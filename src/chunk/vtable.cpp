@@ -37,6 +37,7 @@ void VTable::serialize(ChunkSerializerOperations &op,
     ArchiveStreamWriter &writer) {
 
     writer.writeString(className);
+    writer.write(addressPoint);
     op.serializeChildren(this, writer);
 }
 
@@ -44,6 +45,7 @@ bool VTable::deserialize(ChunkSerializerOperations &op,
     ArchiveStreamReader &reader) {
 
     className = reader.readString();
+    addressPoint = reader.read<address_t>();
     op.deserializeChildren(this, reader);
     return reader.stillGood();
 }
@@ -28,14 +28,22 @@ class VTable : public ChunkSerializerImpl<TYPE_VTable,
     CompositeChunkImpl<VTableEntry>> {
 private:
     std::string className;
+    address_t addressPoint;
 public:
-    VTable() : className("???") {}
+    VTable() : className("???"), addressPoint(0) {}
 
     virtual std::string getName() const;
     std::string getClassName() const { return className; }
 
     void setClassName(const std::string &name) { className = name; }
 
+    /** Where objects' vtable pointers point: just past the offset-to-top
+        and typeinfo fields, so that entry i is at addressPoint + 8*i.
+        Zero if not known.
+    */
+    address_t getAddressPoint() const { return addressPoint; }
+    void setAddressPoint(address_t address) { addressPoint = address; }
+
     virtual void serialize(ChunkSerializerOperations &op,
         ArchiveStreamWriter &writer);
     virtual bool deserialize(ChunkSerializerOperations &op,
@@ -28,6 +28,7 @@
 #include "pass/updatelink.h"
 #include "pass/collectglobals.h"
 #include "analysis/jumptable.h"
+#include "archive/analysisdb.h"
 #include "log/log.h"
 #include "log/temp.h"
 
@@ -64,27 +65,55 @@ void ConductorPasses::newElfPasses(ElfSpace *space) {
         RUN_PASS(ExternalCalls(module->getPLTList()), module);
     }
 
+    auto library = conductor->getLibraryList()->find(space->getName());
+
     // all passes below here depend on data flow analysis and may need to
-    // be run multiple times
+    // be run multiple times. If this exact file has been parsed before,
+    // against dependencies with the same non-returning exports, their
+    // results are taken from the analysis database instead.
+    auto database = AnalysisDatabase::getInstance();
+    auto dependencyHash = NonReturnFunction::fingerprintExternal(
+        module, library);
+    auto record = database->load(module, dependencyHash);
+    bool cached = (record != nullptr);
+    if(!record) record = new ModuleAnalysisRecord(dependencyHash);
 
     // we need to run these before jump table passes, too
     RUN_PASS(SplitBasicBlock(), module);
-    RUN_PASS(NonReturnFunction(), module);
+    if(cached) {
+        record->applyNonReturn(module);
+    }
+    else {
+        RUN_PASS(NonReturnFunction(library), module);
+    }
 
-    RUN_PASS(JumpTablePass(), module);
+    RUN_PASS(JumpTablePass(module, cached ? record : nullptr), module);
+    if(!cached) {
 #ifdef ARCH_X86_64
-    RUN_PASS(JumpTableBounds(), module);
-    RUN_PASS(JumpTableOverestimate(), module);
+        RUN_PASS(JumpTableBounds(), module);
+        RUN_PASS(JumpTableOverestimate(), module);
 #endif
 #ifdef ARCH_RISCV
-    RUN_PASS(JumpTableOverestimate(), module);
+        RUN_PASS(JumpTableOverestimate(), module);
 #endif
+        record->recordJumpTables(module);
+    }
 
-    // run again with jump table information
-    RUN_PASS(SplitBasicBlock(), module);
-
-    // need SplitBasicBlock()
-    RUN_PASS(NonReturnFunction(), module);
+    // jump table targets are new block boundaries; only the functions
+    // that own tables need splitting again
+    SplitBasicBlock splitJumpTables(true);
+    module->accept(&splitJumpTables);
+
+    // only functions with jump tables have new CFG edges, so re-solve
+    // just those (and their callers) instead of the whole module
+    if(!cached) {
+        if(!splitJumpTables.getSplitList().empty()) {
+            RUN_PASS(NonReturnFunction(library,
+                splitJumpTables.getSplitList()), module);
+        }
+        record->recordNonReturn(module);
+    }
+    NonReturnFunction::publishExports(module, library, !cached);
 #ifdef ARCH_AARCH64
     if(!space->getSymbolList()) {
         RUN_PASS(SplitFunction(), module);
@@ -92,7 +121,10 @@ void ConductorPasses::newElfPasses(ElfSpace *space) {
         RUN_PASS(UpdateLink(), module);
     }
 #endif
-    RUN_PASS(InferLinksPass(elf), module);
+    RUN_PASS(InferLinksPass(elf, record, cached), module);
+
+    if(!cached) database->save(module, record);
+    delete record;
 
     // this can run pretty much whenever, but let's put it here for now.
     RUN_PASS(CollectGlobalsPass(), module);
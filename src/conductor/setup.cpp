@@ -7,6 +7,7 @@
 #include "conductor.h"
 #include "passes.h"
 #include "transform/generator.h"
+#include "transform/alignment.h"
 #include "load/segmap.h"
 #include "load/emulator.h"
 #include "chunk/dump.h"
@@ -301,6 +302,7 @@ bool ConductorSetup::generateStaticExecutable(const char *outputFile) {
     {
         //moveCode(sandbox, true);  // calls sandbox->finalize()
         moveCodeAssignAddresses(sandbox, true);
+        setHotTextSize(generator.getConfig(), backing);
         generator.afterAddressAssign();
         {
             // get data sections; allow links to change bytes in data sections
@@ -327,6 +329,7 @@ bool ConductorSetup::generateMirrorELF(const char *outputFile) {
     {
         //moveCode(sandbox, true);  // calls sandbox->finalize()
         moveCodeAssignAddresses(sandbox, true);
+        setHotTextSize(generator.getConfig(), backing);
         generator.afterAddressAssign();
         {
             // get data sections; allow links to change bytes in data sections
@@ -355,7 +358,10 @@ bool ConductorSetup::generateMirrorELF(const char *outputFile,
     {
         ////moveCode(sandbox, true);  // calls sandbox->finalize()
         //moveCodeAssignAddresses(sandbox, true);
-        Generator(sandbox, true).assignAddresses(conductor->getProgram(), order);
+        Generator assigner(sandbox, true);
+        assigner.setAlignmentPolicy(alignment);
+        assigner.assignAddresses(conductor->getProgram(), order);
+        setHotTextSize(generator.getConfig(), backing);
         generator.afterAddressAssign();
         {
             // get data sections; allow links to change bytes in data sections
@@ -397,6 +403,13 @@ bool ConductorSetup::generateKernel(const char *outputFile) {
     return true;
 }
 
+void ConductorSetup::setHotTextSize(ElfConfig *config,
+    MemoryBufferBacking *backing) {
+
+    if(!alignment || !alignment->getHotTextEnd()) return;
+    config->setHotTextSize(alignment->getHotTextEnd() - backing->getBase());
+}
+
 void ConductorSetup::moveCode(Sandbox *sandbox, bool useDisps) {
     // 1. assign new addresses to all code
     moveCodeAssignAddresses(sandbox, useDisps);
@@ -409,7 +422,9 @@ void ConductorSetup::moveCode(Sandbox *sandbox, bool useDisps) {
 }
 
 void ConductorSetup::moveCodeAssignAddresses(Sandbox *sandbox, bool useDisps) {
-    Generator(sandbox, useDisps).assignAddresses(conductor->getProgram());
+    Generator generator(sandbox, useDisps);
+    generator.setAlignmentPolicy(alignment);
+    generator.assignAddresses(conductor->getProgram());
 }
 
 void ConductorSetup::copyCodeToNewAddresses(Sandbox *sandbox, bool useDisps) {
@@ -11,6 +11,8 @@
 class Conductor;
 class Sandbox;
 class Symbol;
+class AlignmentPolicy;
+class ElfConfig;
 
 /** Main setup class for Egalito.
 
@@ -28,9 +30,10 @@ private:
     ElfMap *egalito;
     Conductor *conductor;
     address_t sandboxBase;
+    AlignmentPolicy *alignment;
 public:
     ConductorSetup() : elf(nullptr), egalito(nullptr), conductor(nullptr),
-        sandboxBase(SANDBOX_BASE_ADDRESS) {}
+        sandboxBase(SANDBOX_BASE_ADDRESS), alignment(nullptr) {}
     Module *parseElfFiles(const char *executable, bool withSharedLibs = true,
         bool injectEgalito = false);
     Module *injectElfFiles(const char *executable, bool withSharedLibs = true,
@@ -43,6 +46,9 @@ public:
         const std::vector<std::string> &filenames);
     void ensureBaseAddresses();
     void createNewProgram();  // optional
+    /** Used for all later code generation; not owned. */
+    void setAlignmentPolicy(AlignmentPolicy *alignment)
+        { this->alignment = alignment; }
     Sandbox *makeLoaderSandbox();
     ShufflingSandbox *makeShufflingSandbox();
     Sandbox *makeFileSandbox(const char *outputFile);
@@ -71,6 +77,7 @@ private:
     void findEntryPointFunction();
     void setBaseAddresses();
     bool setBaseAddress(Module *module, ElfMap *map, address_t base);
+    void setHotTextSize(ElfConfig *config, MemoryBufferBacking *backing);
 };
 
 #endif
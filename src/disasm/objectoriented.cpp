@@ -50,6 +50,7 @@ VTable *DisassembleVTables::makeVTable(ElfMap *elfMap,
     }
 
     auto vtable = new VTable();
+    vtable->setAddressPoint(vtableSymbol->getAddress() + 16);
 
     // assume 64-bit architecture here
     size_t index = 0;
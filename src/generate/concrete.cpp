@@ -521,9 +521,12 @@ void AssignSectionsToSegments::execute() {
 
 void TextSectionCreator::execute() {
     // this function assumes WatermarkAllocator being used.
+    auto hotSize = getConfig()->getHotTextSize();
+    if(getConfig()->isFreestandingKernel()) hotSize = 0;
 
-    // Before all LOAD segments, we need to put padding.
-    MakePaddingSection makePadding(0);
+    // Before all LOAD segments, we need to put padding. Huge-page text
+    // needs file offsets congruent to addresses modulo 2MB as well.
+    MakePaddingSection makePadding(0, true, hotSize ? 0x200000 : 0x1000);
     makePadding.setData(getData());
     makePadding.setConfig(getConfig());
     makePadding.execute();
@@ -536,20 +539,37 @@ void TextSectionCreator::execute() {
     LOG(1, "map " << std::hex << address << " size " << size);
 
 
-    auto textSection = new Section(".text", SHT_PROGBITS,
-        SHF_ALLOC | SHF_EXECINSTR);
-    DeferredString *textValue = nullptr;
     // Don't modify backing after this point to avoid invalidating c_str
     auto copy = new std::string(getData()->getBacking()->getBuffer());
-    textValue = new DeferredString(
-        reinterpret_cast<const char *>(copy->c_str()),
-        copy->length());
+    if(hotSize > copy->length()) hotSize = copy->length();
+
+    if(hotSize) {
+        LOG(1, "map hot text " << std::hex << address << " size " << hotSize);
+        auto hotSection = new Section(".text.hot", SHT_PROGBITS,
+            SHF_ALLOC | SHF_EXECINSTR);
+        hotSection->getHeader()->setAddress(address);
+        hotSection->setContent(new DeferredString(
+            reinterpret_cast<const char *>(copy->c_str()), hotSize));
+        getSectionList()->addSection(hotSection);
+
+        // the 2MB alignment is what tells the loader to align the segment
+        // for huge pages, and the runtime to remap it (see libhugetext.so)
+        auto hotSegment = new SegmentInfo(PT_LOAD, PF_R | PF_X, 0x200000);
+        hotSegment->addContains(hotSection);
+        phdrTable->add(hotSegment);
+    }
+
+    auto textSection = new Section(".text", SHT_PROGBITS,
+        SHF_ALLOC | SHF_EXECINSTR);
+    DeferredString *textValue = new DeferredString(
+        reinterpret_cast<const char *>(copy->c_str() + hotSize),
+        copy->length() - hotSize);
 
     if(getConfig()->isFreestandingKernel()) {
         textSection->getHeader()->setAddress(LINUX_KERNEL_CODE_BASE);
     }
     else {
-        textSection->getHeader()->setAddress(address);
+        textSection->getHeader()->setAddress(address + hotSize);
     }
     textSection->setContent(textValue);
 
@@ -939,6 +959,18 @@ void UpdatePLTLinks::execute() {
     getData()->getProgram()->accept(&updater);
 }
 
+// the section TextSectionCreator puts code at this address in
+static const char *getTextSectionName(ElfData *data, ElfConfig *config,
+    address_t address) {
+
+    auto hotSize = config->getHotTextSize();
+    auto base = data->getBacking()->getBase();
+    if(hotSize && address >= base && address < base + hotSize) {
+        return ".text.hot";
+    }
+    return ".text";
+}
+
 void CopyDynsym::execute() {
     // generating dynsym entries for functions
     auto dynsym = getData()->getSection(".dynsym")->castAs<SymbolTableContent *>();
@@ -947,17 +979,19 @@ void CopyDynsym::execute() {
             auto dsym = func->getDynamicSymbol();
             if(!dsym) continue;
 
+            std::string textName = getTextSectionName(getData(), getConfig(),
+                func->getAddress());
             auto value = dynsym->addSymbol(func, dsym);
-            value->addFunction([this] (ElfXX_Sym *symbol) {
-                symbol->st_shndx = getData()->getSectionList()->indexOf(".text");
+            value->addFunction([this, textName] (ElfXX_Sym *symbol) {
+                symbol->st_shndx = getData()->getSectionList()->indexOf(textName);
             });
 
             for(auto alias : dsym->getAliases()) {
                 /*LOG(1, "dynamic symbol alias [" << dsym->getName() << "] -> ["
                     << alias->getName() << "]");*/
                 auto value = dynsym->addSymbol(func, alias);
-                value->addFunction([this] (ElfXX_Sym *symbol) {
-                    symbol->st_shndx = getData()->getSectionList()->indexOf(".text");
+                value->addFunction([this, textName] (ElfXX_Sym *symbol) {
+                    symbol->st_shndx = getData()->getSectionList()->indexOf(textName);
                 });
             }
         }
@@ -1227,8 +1261,10 @@ void ElfFileWriter::serialize() {
     chmod(filename.c_str(), 0744);
 }
 
-MakePaddingSection::MakePaddingSection(size_t desiredAlignment, bool isIsolatedPadding)
-    : desiredAlignment(desiredAlignment), isIsolatedPadding(isIsolatedPadding) {
+MakePaddingSection::MakePaddingSection(size_t desiredAlignment,
+    bool isIsolatedPadding, size_t pageSize)
+    : desiredAlignment(desiredAlignment), isIsolatedPadding(isIsolatedPadding),
+    pageSize(pageSize) {
 
     setName(StreamAsString() << "MakePaddingSection{align=" << std::hex
         << desiredAlignment << ",isIsolated=" << (isIsolatedPadding ? '1':'0'));
@@ -1240,7 +1276,8 @@ void MakePaddingSection::execute() {
     auto paddingSection = new Section(
         isIsolatedPadding ? "=padding" : "=intra-padding");
     auto paddingContent = new PagePaddingContent(
-        getData()->getSectionList()->back(), desiredAlignment, isIsolatedPadding);
+        getData()->getSectionList()->back(), desiredAlignment, isIsolatedPadding,
+        pageSize);
     paddingSection->setContent(paddingContent);
     getData()->getSectionList()->addSection(paddingSection);
 }
@@ -140,8 +140,10 @@ class MakePaddingSection : public NormalElfOperation {
 private:
     size_t desiredAlignment;
     bool isIsolatedPadding;
+    size_t pageSize;
 public:
-    MakePaddingSection(size_t desiredAlignment, bool isIsolatedPadding = true);
+    MakePaddingSection(size_t desiredAlignment, bool isIsolatedPadding = true,
+        size_t pageSize = 0x1000);
 
     virtual void execute();
 };
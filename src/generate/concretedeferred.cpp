@@ -428,11 +428,11 @@ size_t PagePaddingContent::getSize() const {
 
     if(isIsolatedPadding) {
         // how much data is needed to round from lastByte to a page boundary?
-        size_t roundToPageBoundary = ((lastByte + PAGE_SIZE-1) & ~(PAGE_SIZE-1))
+        size_t roundToPageBoundary = ((lastByte + pageSize-1) & ~(pageSize-1))
             - lastByte;
         LOG(0, "desiredOffset = " << desiredOffset << ", got = "
-            << ((lastByte + (roundToPageBoundary + desiredOffset)) & (PAGE_SIZE-1)));
-        return (roundToPageBoundary + desiredOffset) & (PAGE_SIZE-1);
+            << ((lastByte + (roundToPageBoundary + desiredOffset)) & (pageSize-1)));
+        return (roundToPageBoundary + desiredOffset) & (pageSize-1);
     }
     else {
         static const address_t PAGE_SIZE = 0x1000;
@@ -122,10 +122,12 @@ private:
     Section *previousSection;
     address_t desiredOffset;
     bool isIsolatedPadding;  // true if data outside map region should be null
+    address_t pageSize;  // for isolated padding, e.g. 2MB for huge pages
 public:
     PagePaddingContent(Section *previousSection, address_t desiredOffset = 0,
-        bool isIsolatedPadding = true) : previousSection(previousSection),
-        desiredOffset(desiredOffset), isIsolatedPadding(isIsolatedPadding) {}
+        bool isIsolatedPadding = true, address_t pageSize = PAGE_SIZE)
+        : previousSection(previousSection), desiredOffset(desiredOffset),
+        isIsolatedPadding(isIsolatedPadding), pageSize(pageSize) {}
 
     virtual size_t getSize() const;
     virtual void writeTo(std::ostream &stream);
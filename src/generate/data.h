@@ -50,19 +50,24 @@ private:
     bool positionIndependent;
     bool unionOutput;
     bool freestandingKernel;
+    size_t hotTextSize;
 public:
     ElfConfig() : dynamicallyLinked(false), positionIndependent(false),
-        unionOutput(false), freestandingKernel(false) {}
+        unionOutput(false), freestandingKernel(false), hotTextSize(0) {}
 
     void setDynamicallyLinked(bool enable) { dynamicallyLinked = enable; }
     void setPositionIndependent(bool enable) { positionIndependent = enable; }
     void setUnionOutput(bool enable) { unionOutput = enable; }
     void setFreestandingKernel(bool enable) { freestandingKernel = enable; }
+    /** Size of the code at the start of the sandbox to map as huge-page
+        text, a multiple of 2MB; 0 for none. */
+    void setHotTextSize(size_t size) { hotTextSize = size; }
 
     bool isDynamicallyLinked() const { return dynamicallyLinked; }
     bool isPositionIndependent() const { return positionIndependent; }
     bool isUnionOutput() const { return unionOutput; }
     bool isFreestandingKernel() const { return freestandingKernel; }
+    size_t getHotTextSize() const { return hotTextSize; }
 };
 
 class ElfOperationTrace {
@@ -40,6 +40,7 @@ void MirrorGen::generateContent(const std::string &filename) {
         config.setRelocsForAbsoluteRefs(true);
         config.setCodeBacking(dynamic_cast<MemoryBufferBacking *>
             (getData()->getBacking()));
+        config.setHotTextSize(getConfig()->getHotTextSize());
         auto moduleGen = ModuleGen(config, module, getData()->getSectionList());
         moduleGen.makeDataSections();
         moduleGen.makeTextAccumulative();
@@ -396,6 +396,13 @@ void ModuleGen::makeTextAccumulative() {
     auto backing = config.getCodeBacking();
     auto address = backing->getBase();
     auto size = backing->getSize();
+    if(auto hot = config.getHotTextSize()) {
+        // TextSectionCreator splits the code at the end of the hot text
+        makeRelocSectionFor(".text.hot");
+        makeSymbolsAndRelocs(address, hot, ".text.hot");
+        address += hot;
+        size -= hot;
+    }
     makeRelocSectionFor(".text");
     makeSymbolsAndRelocs(address, size, ".text");
 }
@@ -26,10 +26,11 @@ public:
             directly from mmaps.
         */
         MemoryBufferBacking *backing;
+        size_t hotTextSize;  // see ElfConfig
     public:
         Config() : isDynamicallyLinked(false), uniqueSectionNames(false),
             relocsForAbsoluteRefs(false), isFreestandingKernel(false),
-            backing(nullptr) {}
+            backing(nullptr), hotTextSize(0) {}
 
         void setDynamicallyLinked(bool enable)
             { isDynamicallyLinked = enable; }
@@ -41,12 +42,14 @@ public:
             { this->backing = backing; }
         void setFreestandingKernel(bool enable)
             { this->isFreestandingKernel = enable; }
+        void setHotTextSize(size_t size) { hotTextSize = size; }
 
         bool getDynamicallyLinked() const { return isDynamicallyLinked; }
         bool getUniqueSectionNames() const { return uniqueSectionNames; }
         bool getRelocsForAbsoluteRefs() const { return relocsForAbsoluteRefs; }
         MemoryBufferBacking *getCodeBacking() const { return backing; }
         bool isKernel() const { return this->isFreestandingKernel; }
+        size_t getHotTextSize() const { return hotTextSize; }
     };
 private:
     Config config;
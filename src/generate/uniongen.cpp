@@ -37,6 +37,7 @@ void UnionGen::generateContent(const std::string &filename) {
         config.setUniqueSectionNames(true);
         config.setCodeBacking(dynamic_cast<MemoryBufferBacking *>
             (getData()->getBacking()));
+        config.setHotTextSize(getConfig()->getHotTextSize());
         auto moduleGen = ModuleGen(config, module, getData()->getSectionList());
         moduleGen.makeDataSections();
         moduleGen.makeTextAccumulative();
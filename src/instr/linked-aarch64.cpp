@@ -1,6 +1,5 @@
 #include <cstring>  // for memcpy
 #include <cassert>
-#include <fstream>
 #include "linked-aarch64.h"
 #include "config.h"
 #include "instr/instr.h"
@@ -8,8 +7,6 @@
 #include "analysis/controlflow.h"
 #include "analysis/slicing.h"
 #include "analysis/slicingmatch.h"
-#include "analysis/dataflow.h"
-#include "analysis/liveregister.h"
 #include "analysis/pointerdetection.h"
 #include "chunk/concrete.h"
 #include "chunk/link.h"
@@ -374,31 +371,17 @@ LinkedLiteralInstruction *LinkedLiteralInstruction::makeLinked(Module *module,
     return nullptr;
 }
 
-void LinkedInstruction::makeAllLinked(Module *module) {
-    std::vector<std::pair<Instruction *, address_t>>&& list
-        = loadFromFile(module);
+void LinkedInstruction::makeAllLinked(Module *module,
+    std::vector<std::pair<Instruction *, address_t>> *pointerList) {
 
-    if(list.size() > 0) {
-        resolveLinks(module, list);
+    if(pointerList && pointerList->size() > 0) {
+        resolveLinks(module, *pointerList);
     } else {
-        DataFlow df;
-        LiveRegister live;
-        PointerDetection pd;
-        for(auto func : CIter::functions(module)) {
-            df.addUseDefFor(func);
-        }
-        for(auto func : CIter::functions(module)) {
-            live.detect(df.getWorkingSet(func));
-        }
-        for(auto func : CIter::functions(module)) {
-            df.adjustCallUse(&live, func, module);
-        }
-        for(auto func : CIter::functions(module)) {
-            pd.detect(df.getWorkingSet(func));
-        }
+        ModulePointerDetection pd;
+        pd.detect(module);
 
         resolveLinks(module, pd.getList());
-        saveToFile(module, pd.getList());
+        if(pointerList) *pointerList = pd.getList();
     }
 
     for(auto f : CIter::functions(module)) {
@@ -455,63 +438,6 @@ void LinkedInstruction::resolveLinks(Module *module,
     }
 }
 
-void LinkedInstruction::saveToFile(Module *module,
-    const std::vector<std::pair<Instruction *, address_t>>& list) {
-
-    if(module->getName() == "module-(executable)") return;
-    if(module->getName() == "module-(egalito)") return;
-    if(module->getName() == "module-(addon)") return;
-
-    std::string filename(CACHE_DIR "/");
-    filename += module->getName() + "-inferredpointers";
-    std::ofstream f(filename.c_str(), std::ios::out);
-    for(auto it : list) {
-        auto instruction = it.first;
-        auto address = it.second;
-        f << instruction->getAddress() << '\n';
-        f << address << '\n';
-    }
-
-    f.close();
-}
-
-std::vector<std::pair<Instruction *, address_t>>
-LinkedInstruction::loadFromFile(Module *module) {
-    std::vector<std::pair<Instruction *, address_t>> list;
-
-    if(module->getName() == "module-(executable)") return list;
-    if(module->getName() == "module-(egalito)") return list;
-    if(module->getName() == "module-(addon)") return list;
-
-    std::string filename(CACHE_DIR "/");
-    filename += module->getName() + "-inferredpointers";
-    std::ifstream f(filename.c_str(), std::ios::in);
-
-    char line[128];
-    for(f.getline(line, 128); f.good(); f.getline(line, 128)) {
-        auto addr = std::stoull(line);
-        LOG(10, "instruction at 0x" << std::hex << addr);
-        auto fn =
-            CIter::spatial(module->getFunctionList())->findContaining(addr);
-        if(!fn) {
-            LOG(1, "LinkedInstruction: function not found at "
-                << std::hex << addr);
-        }
-        auto instr = dynamic_cast<Instruction *>(
-            ChunkFind().findInnermostAt(fn, addr));
-        if(!instr) {
-            LOG(1, "LinkedInstruction: instruction not found at "
-                << std::hex << addr);
-        }
-
-        f.getline(line, 128);
-        auto value = std::stoull(line);
-        LOG(10, "pointer to 0x" << std::hex << value);
-        list.emplace_back(instr, value);
-    }
-    return list;
-}
-
 void LinkedLiteralInstruction::writeTo(char *target) {
     *reinterpret_cast<uint32_t *>(target) = relocate();
 }
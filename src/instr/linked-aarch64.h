@@ -79,18 +79,19 @@ public:
     static LinkedInstruction *makeLinked(Module *module,
         Instruction *instruction, AssemblyPtr assembly, Reloc *reloc,
         bool resolveWeak);
-    static void makeAllLinked(Module *module);
+    /** Links every instruction that forms a pointer. If pointerList is
+        given and non-empty, it is used instead of pointer detection;
+        otherwise it receives the detected pointers.
+    */
+    static void makeAllLinked(Module *module,
+        std::vector<std::pair<Instruction *, address_t>> *pointerList
+            = nullptr);
 
     virtual void accept(InstructionVisitor *visitor) { visitor->visit(this); }
 private:
     static Mode getMode(const Assembly &assembly);
     static void resolveLinks(Module *module,
         const std::vector<std::pair<Instruction *, address_t>> &list);
-
-    static void saveToFile(Module *module,
-        const std::vector<std::pair<Instruction *, address_t>>& list);
-    static std::vector<std::pair<Instruction *, address_t>> loadFromFile(
-        Module *module);
 };
 
 class ControlFlowInstruction : public LinkedInstruction {
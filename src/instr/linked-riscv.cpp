@@ -6,8 +6,6 @@
 #include "chunk/link.h"
 #include "chunk/resolver.h"
 #include "chunk/concrete.h"
-#include "analysis/dataflow.h"
-#include "analysis/liveregister.h"
 #include "analysis/pointerdetection.h"
 #include "analysis/walker.h"
 
@@ -49,14 +47,8 @@ uint32_t LinkedInstruction::rebuild() {
 void LinkedInstruction::makeAllLinked(Module *module) {
     LOG(0, "Finding split pointers in module " << module->getName());
 
-    DataFlow df;
-    PointerDetection pd;
-    for(auto func : CIter::functions(module)) {
-        df.addUseDefFor(func);
-    }
-    for(auto func : CIter::functions(module)) {
-        pd.detect(df.getWorkingSet(func));
-    }
+    ModulePointerDetection pd;
+    pd.detect(module);
 
     resolveLinks(module, pd.getList());
 }
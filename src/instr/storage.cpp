@@ -34,6 +34,8 @@ AssemblyFactory AssemblyFactory::instance;
 AssemblyPtr AssemblyFactory::buildAssembly(InstructionStorage *storage,
     address_t address) {
 
+    // also guards the shared capstone handle
+    std::lock_guard<std::mutex> guard(mutex);
     static DisasmHandle handle(true);
     auto assembly = DisassembleInstruction(handle, true)
         .allocateAssembly(storage->getData(), address);
@@ -43,9 +45,11 @@ AssemblyPtr AssemblyFactory::buildAssembly(InstructionStorage *storage,
 }
 
 void AssemblyFactory::registerAssembly(AssemblyPtr assembly) {
+    std::lock_guard<std::mutex> guard(mutex);
     assemblyList.push_back(assembly);
 }
 
 void AssemblyFactory::clearCache() {
+    std::lock_guard<std::mutex> guard(mutex);
     assemblyList.clear();
 }
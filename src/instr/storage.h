@@ -1,6 +1,7 @@
 #ifndef EGALITO_INSTR_STORAGE_H
 #define EGALITO_INSTR_STORAGE_H
 
+#include <mutex>
 #include <string>
 #include <vector>
 #include "assembly.h"
@@ -13,6 +14,9 @@ public:
     const std::string &getData() const;
     size_t getSize() const;
 
+    /** Builds the Assembly if it is not cached. Different instructions may
+        be queried from different threads, but not the same one.
+    */
     AssemblyPtr getAssembly(address_t address);
 
     void setData(const std::string &data) { this->rawData = data; }
@@ -20,12 +24,18 @@ public:
     void clearAssembly() { assembly.reset(); }
 };
 
+/** Keeps every Assembly alive, since InstructionStorage only has a weak
+    reference. Instructions without a cached Assembly build one here on
+    demand, possibly from several threads at once (e.g. in parallelFor), so
+    every method takes a lock.
+*/
 class AssemblyFactory {
 private:
     static AssemblyFactory instance;
 public:
     static AssemblyFactory *getInstance() { return &instance; }
 private:
+    std::mutex mutex;
     std::vector<AssemblyPtr> assemblyList;
 public:
     AssemblyPtr buildAssembly(InstructionStorage *storage, address_t address);
@@ -2,7 +2,9 @@
 #include <algorithm>
 #include <capstone/x86.h>
 #include "addinline.h"
-#include "analysis/frametype.h"
+#include "analysis/framesummary.h"
+#include "analysis/manager.h"
+#include "analysis/scratch.h"
 #include "disasm/disassemble.h"
 #include "instr/register.h"
 #include "instr/semantic.h"
@@ -12,23 +14,43 @@
 #include "log/log.h"
 #include "log/temp.h"
 
+ChunkAddInline::ChunkAddInline(Modification *modification)
+    : modification(modification), scratch(nullptr) {
+
+}
+
 ChunkAddInline::ChunkAddInline(std::vector<Register> regList,
-    std::function<std::vector<Instruction *> (unsigned int)> generator) {
+    std::function<std::vector<Instruction *> (unsigned int)> generator)
+    : scratch(nullptr) {
 
     modification = new ModificationImpl(regList, generator);
 }
 
+ChunkAddInline::RegList ChunkAddInline::getSavedRegisters(Instruction *point) {
+    auto regList = modification->getClobberedRegisters();
+    if(!scratch) return regList;
+
+    RegList saved;
+    for(auto reg : regList) {
+        if(!scratch->isDead(point, reg)) saved.push_back(reg);
+    }
+    LOG(10, "saving " << saved.size() << " of " << regList.size()
+        << " registers at " << point->getName());
+    return saved;
+}
+
 std::vector<Instruction *> ChunkAddInline::getFullCode(Instruction *point) {
     auto function = dynamic_cast<Function *>(point->getParent()->getParent());
     assert(function != nullptr);
 
-    bool redzone = !FrameType::hasStackFrame(function);
+    bool redzone = !AnalysisManager::getInstance()
+        ->getFrameSummary(function)->hasFrame();
     SaveRestoreRegisters saveRestore(point, redzone);
 
-    auto regList = modification->getClobberedRegisters();
+    auto regList = getSavedRegisters(point);
     unsigned int stackBytesAdded = 0;
     stackBytesAdded += regList.size() * 8;  // for pushes
-    if(redzone) stackBytesAdded += 0x80;
+    if(redzone && regList.size() > 0) stackBytesAdded += 0x80;
 
     std::vector<Instruction *> instrList;
     extendList(instrList, saveRestore.getRegSaveCode(regList));
@@ -6,6 +6,8 @@
 #include "instr/instr.h"
 #include "instr/register.h"
 
+class ScratchRegisters;
+
 class ChunkAddInline {
 public:
     typedef std::vector<Instruction *> InstrList;
@@ -59,6 +61,7 @@ private:
     };
 private:
     Modification *modification;
+    ScratchRegisters *scratch;
 public:
     // allow this modification to be applied in multiple places.
     // takes ownership of modification and will free it.
@@ -67,10 +70,21 @@ public:
         std::function<std::vector<Instruction *> (unsigned int)> generator);
     ~ChunkAddInline() { delete modification; }
 
+    /** Clobbered registers that are dead at the insertion point will not
+        be saved and restored. scratch must describe the original code.
+    */
+    void setScratchRegisters(ScratchRegisters *scratch)
+        { this->scratch = scratch; }
+
     void insertBefore(Instruction *point, bool beforeJumpTo);
     void insertAfter(Instruction *point);
-private:
+
+    /** The new code wrapped in register saves and restores as needed at
+        point, without inserting it anywhere.
+    */
     std::vector<Instruction *> getFullCode(Instruction *point);
+private:
+    RegList getSavedRegisters(Instruction *point);
     void extendList(std::vector<Instruction *> &list,
         const std::vector<Instruction *> &additions);
 };
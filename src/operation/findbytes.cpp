@@ -0,0 +1,97 @@
+#include <algorithm>
+#include "findbytes.h"
+#include "find.h"
+#include "chunk/concrete.h"
+#include "elf/elfspace.h"
+#include "elf/elfmap.h"
+#include "instr/semantic.h"
+#include "instr/writer.h"
+#include "log/log.h"
+
+std::vector<Instruction *> ChunkFindBytes::find(Module *module) {
+    auto elfSpace = module->getElfSpace();
+    auto elfMap = elfSpace ? elfSpace->getElfMap() : nullptr;
+    if(!elfMap) {
+        // e.g. loaded from an archive: fall back to each function's bytes
+        std::vector<Instruction *> found;
+        for(auto function : CIter::functions(module)) {
+            auto list = find(function);
+            found.insert(found.end(), list.begin(), list.end());
+        }
+        return found;
+    }
+
+    std::vector<Instruction *> found;
+    for(auto section : elfMap->getSectionList()) {
+        auto header = section->getHeader();
+        if(!(header->sh_flags & SHF_EXECINSTR)) continue;
+        if(header->sh_type == SHT_NOBITS) continue;
+
+        auto data = reinterpret_cast<const char *>(section->getReadAddress());
+        auto hitList = scanner.findAll(data, section->getSize());
+        LOG(10, "found " << hitList.size() << " candidates in "
+            << section->getName() << " using "
+            << ByteScanner::getEngineName(scanner.getEngine()));
+
+        for(auto offset : hitList) {
+            auto address = section->getVirtualAddress() + offset;
+            auto instr = findInstructionAt(module, address);
+            if(instr && startsWithPattern(instr)) found.push_back(instr);
+        }
+    }
+
+    std::sort(found.begin(), found.end(),
+        [] (Instruction *a, Instruction *b) {
+            return a->getAddress() < b->getAddress();
+        });
+    return found;
+}
+
+std::vector<Instruction *> ChunkFindBytes::find(Function *function) {
+    std::string data;
+    std::vector<size_t> startList;
+    std::vector<Instruction *> instrList;
+    // getData() throws for control flow, so write the bytes out instead
+    InstrWriterCppString writer(data);
+    for(auto block : CIter::children(function)) {
+        for(auto instr : CIter::children(block)) {
+            startList.push_back(data.size());
+            instrList.push_back(instr);
+            instr->getSemantic()->accept(&writer);
+        }
+    }
+
+    // only keep hits that begin an instruction
+    std::vector<Instruction *> found;
+    for(auto offset : scanner.findAll(data.c_str(), data.size())) {
+        auto it = std::lower_bound(startList.begin(), startList.end(), offset);
+        if(it != startList.end() && *it == offset) {
+            found.push_back(instrList[it - startList.begin()]);
+        }
+    }
+    return found;
+}
+
+Instruction *ChunkFindBytes::findInstructionAt(Module *module,
+    address_t address) {
+
+    auto function = CIter::spatial(module->getFunctionList())
+        ->findContaining(address);
+    if(!function) return nullptr;
+
+    auto instr = dynamic_cast<Instruction *>(
+        ChunkFind().findInnermostAt(function, address));
+    if(!instr || instr->getAddress() != address) return nullptr;
+    return instr;
+}
+
+bool ChunkFindBytes::startsWithPattern(Instruction *instruction) {
+    const auto &pattern = scanner.getPattern();
+    InstrWriterGetData writer;
+    instruction->getSemantic()->accept(&writer);
+    auto data = writer.get();
+
+    // a pattern may span several instructions; check the part in this one
+    size_t length = std::min(pattern.size(), data.size());
+    return data.compare(0, length, pattern, 0, length) == 0;
+}
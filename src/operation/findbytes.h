@@ -0,0 +1,35 @@
+#ifndef EGALITO_OPERATION_FIND_BYTES_H
+#define EGALITO_OPERATION_FIND_BYTES_H
+
+#include <vector>
+#include <string>
+#include "types.h"
+#include "util/bytescan.h"
+
+class Module;
+class Function;
+class Instruction;
+
+/** Finds instructions by their machine code, using a ByteScanner.
+
+    A Module is swept through the executable sections of its ELF file, so
+    it only sees code as it was parsed. Each hit is mapped through the
+    spatial indices to the Instruction starting at that address, and kept
+    only if that instruction still begins with the same bytes. A Function
+    is searched in the current bytes of its instructions instead.
+*/
+class ChunkFindBytes {
+private:
+    ByteScanner scanner;
+public:
+    ChunkFindBytes(const std::string &pattern) : scanner(pattern) {}
+
+    /** Returns matching instructions in address order. */
+    std::vector<Instruction *> find(Module *module);
+    std::vector<Instruction *> find(Function *function);
+private:
+    Instruction *findInstructionAt(Module *module, address_t address);
+    bool startsWithPattern(Instruction *instruction);
+};
+
+#endif
@@ -3,6 +3,7 @@
 #include <cassert>
 #include "mutator.h"
 #include "chunk/position.h"
+#include "analysis/manager.h"
 #include "pass/positiondump.h"
 #include "instr/instr.h"
 #include "disasm/reassemble.h"
@@ -223,6 +224,7 @@ void ChunkMutator::remove(Chunk *child) {
 
     // remove from parent
     chunk->getChildren()->genericRemove(child);
+    AnalysisManager::getInstance()->notifyModified(child);
 
     // update sizes of parents and grandparents
     for(Chunk *c = chunk; c && !dynamic_cast<Module *>(c); c = c->getParent()) {
@@ -427,6 +429,9 @@ void ChunkMutator::updateSizesAndAuthorities(Chunk *child) {
 }
 
 void ChunkMutator::updateGenerationCounts(Chunk *child) {
+    // every structural change comes through here
+    AnalysisManager::getInstance()->notifyModified(child);
+
     if(!PositionFactory::getInstance()->needsGenerationTracking()) return;
 
     // first, find the max of all generations from child on up
@@ -1,6 +1,7 @@
 #include <vector>
 #include <cassert>
 #include "aflcoverage.h"
+#include "analysis/scratch.h"
 #include "disasm/disassemble.h"
 #include "instr/register.h"
 #include "instr/concrete.h"
@@ -91,7 +92,11 @@ void AFLCoveragePass::visit(Function *function) {
     // sphinx3, function does tail recursion to itself
     if(function->getName() == "mdef_phone_id") return;
 
+    // liveness must be computed before any block is instrumented
+    ScratchRegisters scratchRegisters(function);
+    scratch = &scratchRegisters;
     recurse(function);
+    scratch = nullptr;
 }
 
 void AFLCoveragePass::visit(Block *block) {
@@ -108,7 +113,20 @@ void AFLCoveragePass::visit(Block *block) {
 void AFLCoveragePass::addCoverageCode(Block *block) {
     blockID = std::rand(); //% SHM_REGION_SIZE;
 
-    ChunkAddInline ai({X86_REG_R10, X86_REG_EFLAGS}, [this] (unsigned int stackBytesAdded) {
+    auto instr1 = block->getChildren()->getIterable()->get(0);
+
+    // use a dead register if there is one, so it need not be saved. The
+    // encodings below only need the low 3 bits of r8-r15; r12 would need
+    // a SIB byte as a base register.
+    Register reg = X86_REG_R10;
+    if(scratch) {
+        auto dead = scratch->findScratch(instr1, {X86_REG_R10, X86_REG_R11,
+            X86_REG_R9, X86_REG_R8, X86_REG_R13, X86_REG_R14, X86_REG_R15});
+        if(dead != INVALID_REGISTER) reg = dead;
+    }
+    unsigned char r = X86Register::convertToPhysical(reg) - X86Register::R8;
+
+    ChunkAddInline ai({reg, X86_REG_EFLAGS}, [this, r] (unsigned int stackBytesAdded) {
 #if 1
 		//   0:   41 52                   push   %r10
 		//   2:   4c 8b 15 cc cc 0c 00    mov    0xccccc(%rip),%r10        # 0xcccd5
@@ -126,33 +144,39 @@ void AFLCoveragePass::addCoverageCode(Block *block) {
         auto mov1Instr = new Instruction();
         auto mov1Sem = new LinkedInstruction(mov1Instr);
         mov1Sem->setAssembly(DisassembleInstruction(handle).makeAssemblyPtr(
-            std::vector<unsigned char>{0x4c, 0x8b, 0x15, 0x00, 0x00, 0x00, 0x00}));
+            std::vector<unsigned char>{0x4c, 0x8b,
+                static_cast<unsigned char>(0x05 | (r << 3)), 0x00, 0x00, 0x00, 0x00}));
         mov1Sem->setLink(new UnresolvedRelativeLink(SHM_QUEUE_PTR));
         mov1Sem->setIndex(0);
         mov1Instr->setSemantic(mov1Sem);
 
 		//  17:   49 d1 ea                shr    %r10
-        auto shrInstr = Disassemble::instruction({0x49, 0xd1, 0xea});
+        auto shrInstr = Disassemble::instruction(
+            {0x49, 0xd1, static_cast<unsigned char>(0xe8 | r)});
 
 
 		//   c:   49 81 f2 11 11 11 11    xor    $0x11111111,%r10
-        auto xorInstr = Disassemble::instruction({0x49, 0x81, 0xf2, GET_BYTES(blockID)});
+        auto xorInstr = Disassemble::instruction(
+            {0x49, 0x81, static_cast<unsigned char>(0xf0 | r), GET_BYTES(blockID)});
 
 
         //  14:   4c 89 15 cc cc cc 00    mov    %r10,0xccccc(%rip)        # 0xddf8
         auto mov2Instr = new Instruction();
         auto mov2Sem = new LinkedInstruction(mov2Instr);
         mov2Sem->setAssembly(DisassembleInstruction(handle).makeAssemblyPtr(
-            std::vector<unsigned char>{0x4c, 0x89, 0x15, 0x00, 0x00, 0x00, 0x00}));
+            std::vector<unsigned char>{0x4c, 0x89,
+                static_cast<unsigned char>(0x05 | (r << 3)), 0x00, 0x00, 0x00, 0x00}));
         mov2Sem->setLink(new UnresolvedRelativeLink(SHM_QUEUE_PTR));
         mov2Sem->setIndex(1);
         mov2Instr->setSemantic(mov2Sem);
 
 		//  1a:   49 81 e2 ff ff 00 00    and    $0xffff,%r10
-        auto andInstr = Disassemble::instruction({0x49, 0x81, 0xe2, GET_BYTES(SHM_REGION_SIZE - 1)});
+        auto andInstr = Disassemble::instruction(
+            {0x49, 0x81, static_cast<unsigned char>(0xe0 | r), GET_BYTES(SHM_REGION_SIZE - 1)});
 
 		//  10:   41 fe 82 00 00 00 50    incb   0x50000000(%r10)
-        auto incInstr = Disassemble::instruction({0x41, 0xfe, 0x82, GET_BYTES(SHM_REGION)});
+        auto incInstr = Disassemble::instruction(
+            {0x41, 0xfe, static_cast<unsigned char>(0x80 | r), GET_BYTES(SHM_REGION)});
 
         return std::vector<Instruction *>{ mov1Instr, shrInstr, xorInstr, mov2Instr, andInstr, incInstr };
 #else  // 16-bit history version
@@ -169,28 +193,33 @@ void AFLCoveragePass::addCoverageCode(Block *block) {
         DisasmHandle handle(true);
 
 		//   2:   49 c7 c2 01 00 00 00    mov    $0x0001,%r10
-        auto mov1Instr = Disassemble::instruction({0x49, 0xc7, 0xc2, GET_BYTES(blockID)});
+        auto mov1Instr = Disassemble::instruction(
+            {0x49, 0xc7, static_cast<unsigned char>(0xc0 | r), GET_BYTES(blockID)});
 
 		//   9:   4c 33 15 cc cc 0c 00    xor    0xccccc(%rip),%r10        # 0xcccdc
         auto xorInstr = new Instruction();
         auto xorSem = new LinkedInstruction(xorInstr);
         xorSem->setAssembly(DisassembleInstruction(handle).makeAssemblyPtr(
-            std::vector<unsigned char>{0x4c, 0x33, 0x15, 0x00, 0x00, 0x00, 0x00}));
+            std::vector<unsigned char>{0x4c, 0x33,
+                static_cast<unsigned char>(0x05 | (r << 3)), 0x00, 0x00, 0x00, 0x00}));
         xorSem->setLink(new UnresolvedRelativeLink(SHM_QUEUE_PTR));
         xorSem->setIndex(0);
         xorInstr->setSemantic(xorSem);
 
 		//  10:   41 fe 82 00 00 00 50    incb   0x50000000(%r10)
-        auto incInstr = Disassemble::instruction({0x41, 0xfe, 0x82, GET_BYTES(SHM_REGION)});
+        auto incInstr = Disassemble::instruction(
+            {0x41, 0xfe, static_cast<unsigned char>(0x80 | r), GET_BYTES(SHM_REGION)});
 
 		//  17:   49 d1 ea                shr    %r10
-        auto shrInstr = Disassemble::instruction({0x49, 0xd1, 0xea});
+        auto shrInstr = Disassemble::instruction(
+            {0x49, 0xd1, static_cast<unsigned char>(0xe8 | r)});
 
         //  14:   4c 89 15 cc cc cc 00    mov    %r10,0xccccc(%rip)        # 0xddf8
         auto mov2Instr = new Instruction();
         auto mov2Sem = new LinkedInstruction(mov2Instr);
         mov2Sem->setAssembly(DisassembleInstruction(handle).makeAssemblyPtr(
-            std::vector<unsigned char>{0x4c, 0x89, 0x15, 0x00, 0x00, 0x00, 0x00}));
+            std::vector<unsigned char>{0x4c, 0x89,
+                static_cast<unsigned char>(0x05 | (r << 3)), 0x00, 0x00, 0x00, 0x00}));
         mov2Sem->setLink(new UnresolvedRelativeLink(SHM_QUEUE_PTR));
         mov2Sem->setIndex(1);
         mov2Instr->setSemantic(mov2Sem);
@@ -198,7 +227,7 @@ void AFLCoveragePass::addCoverageCode(Block *block) {
         return std::vector<Instruction *>{ mov1Instr, xorInstr, incInstr, shrInstr, mov2Instr };
 #endif
     });
-	auto instr1 = block->getChildren()->getIterable()->get(0);
+    ai.setScratchRegisters(scratch);
     ai.insertBefore(instr1, true);
 }
 
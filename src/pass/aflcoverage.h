@@ -3,12 +3,15 @@
 
 #include "chunkpass.h"
 
+class ScratchRegisters;
+
 class AFLCoveragePass : public ChunkPass {
 private:
     Function *entryPoint;
     unsigned long blockID;
+    ScratchRegisters *scratch;
 public:
-    AFLCoveragePass() : blockID(1) {}
+    AFLCoveragePass() : blockID(1), scratch(nullptr) {}
     virtual void visit(Program *program);
     virtual void visit(Module *module);
     virtual void visit(Function *function);
@@ -0,0 +1,323 @@
+#include <capstone/x86.h>
+#include "blockreorder.h"
+#include "promotejumps.h"
+#include "analysis/blocklayout.h"
+#include "analysis/controlflow.h"
+#include "analysis/manager.h"
+#include "chunk/concrete.h"
+#include "instr/concrete.h"
+#include "operation/mutator.h"
+
+#include "log/log.h"
+
+void BlockReorderPass::setProfile(Function *function,
+    const BlockCountMap &blockCount, const EdgeCountMap &edgeCount) {
+
+    profileMap[function] = Profile{blockCount, edgeCount};
+}
+
+void BlockReorderPass::visit(FunctionList *functionList) {
+    // cold functions are added to the list as we go
+    std::vector<Function *> functions;
+    for(auto function : CIter::children(functionList)) {
+        functions.push_back(function);
+    }
+    for(auto function : functions) {
+        function->accept(this);
+    }
+}
+
+#ifdef ARCH_X86_64
+// whether control can continue into the next block; calls are assumed to
+// return, since an extra jump after a call that does not is harmless
+static bool fallsThrough(Block *block) {
+    auto semantic = block->getChildren()->getIterable()->getLast()
+        ->getSemantic();
+    if(auto cfi = dynamic_cast<ControlFlowInstruction *>(semantic)) {
+        return cfi->getMnemonic() != "jmp";
+    }
+    if(auto ij = dynamic_cast<IndirectJumpInstruction *>(semantic)) {
+        return ij->getMnemonic() == "callq";
+    }
+    if(dynamic_cast<ReturnInstruction *>(semantic)) return false;
+    return true;
+}
+
+static Block *getTargetBlock(Link *link);
+
+// jrcxz and friends have no rel32 form, so their target must stay close
+static bool hasShortOnlyJump(Function *function) {
+    for(auto block : CIter::children(function)) {
+        for(auto instr : CIter::children(block)) {
+            auto cfi = dynamic_cast<ControlFlowInstruction *>(
+                instr->getSemantic());
+            if(!cfi) continue;
+            switch(cfi->getId()) {
+            case X86_INS_JCXZ:
+            case X86_INS_JECXZ:
+            case X86_INS_JRCXZ:
+                return true;
+            default:
+                break;
+            }
+        }
+    }
+    return false;
+}
+
+// jumps between the two halves of a split function are no longer
+// function-internal, and the cold half may end up anywhere in the output
+static void relinkAcrossSplit(Function *from, Function *to) {
+    for(auto block : CIter::children(from)) {
+        for(auto instr : CIter::children(block)) {
+            auto cfi = dynamic_cast<ControlFlowInstruction *>(
+                instr->getSemantic());
+            if(!cfi || cfi->getMnemonic() == "callq") continue;
+
+            auto target = getTargetBlock(cfi->getLink());
+            if(!target || target->getParent() != to) continue;
+
+            auto link = cfi->getLink();
+            cfi->setLink(new NormalLink(&*link->getTarget(),
+                Link::SCOPE_EXTERNAL_JUMP));
+            delete link;
+
+            if(cfi->getDisplacementSize() == 1) {
+                size_t oldSize = cfi->getSize();
+                cfi->setOpcode(PromoteJumpsPass::getWiderOpcode(cfi->getId()));
+                cfi->setDisplacementSize(4);
+                ChunkMutator(block).modifiedChildSize(instr,
+                    cfi->getSize() - oldSize);
+            }
+        }
+    }
+}
+
+static bool hasJumpTable(Function *function) {
+    for(auto block : CIter::children(function)) {
+        auto semantic = block->getChildren()->getIterable()->getLast()
+            ->getSemantic();
+        auto ij = dynamic_cast<IndirectJumpInstruction *>(semantic);
+        if(ij && ij->isForJumpTable()) return true;
+    }
+    return false;
+}
+#endif
+
+void BlockReorderPass::visit(Function *function) {
+#ifdef ARCH_X86_64
+    auto it = profileMap.find(function);
+    if(it == profileMap.end()) return;
+    const auto &profile = it->second;
+
+    std::vector<Block *> blockList;
+    std::map<address_t, int> indexOf;
+    for(auto block : CIter::children(function)) {
+        indexOf[block->getAddress() - function->getAddress()]
+            = blockList.size();
+        blockList.push_back(block);
+    }
+    const int n = static_cast<int>(blockList.size());
+
+    BlockChainLayout layout(n);
+    for(const auto &count : profile.blockCount) {
+        auto found = indexOf.find(count.first);
+        if(found == indexOf.end()) {
+            LOG(1, "profile of [" << function->getName()
+                << "] does not match its blocks, not reordering");
+            return;
+        }
+        layout.setCount(found->second, count.second);
+    }
+    auto entry = profile.blockCount.find(0);
+    if(entry == profile.blockCount.end() || entry->second == 0) return;
+
+    for(const auto &count : profile.edgeCount) {
+        auto from = indexOf.find(count.first.first);
+        auto to = indexOf.find(count.first.second);
+        if(from == indexOf.end() || to == indexOf.end()) continue;
+
+        bool fallThrough = (to->second == from->second + 1)
+            && fallsThrough(blockList[from->second]);
+        layout.addEdge(from->second, to->second, count.second, fallThrough);
+    }
+
+    // a block that nothing jumps to may be a landing pad
+    ControlFlowGraph cfg(function);
+    for(int i = 1; i < n; i ++) {
+        auto links = cfg.get(i)->backwardLinks();
+        if(links.begin() == links.end()) layout.setPinned(i);
+    }
+
+    size_t coldStart = 0;
+    auto order = layout.getOrder(&coldStart);
+    if(!splitCold || hasJumpTable(function) || hasShortOnlyJump(function)) {
+        coldStart = order.size();
+    }
+
+    bool changed = (coldStart < order.size());
+    for(int i = 0; i < n; i ++) {
+        if(order[i] != i) changed = true;
+    }
+    if(!changed) return;
+
+    LOG(10, "reordering " << n << " blocks of [" << function->getName()
+        << "], " << (order.size() - coldStart) << " cold");
+    rebuild(function, blockList, order, coldStart);
+    AnalysisManager::getInstance()->invalidate(function);
+#endif
+}
+
+void BlockReorderPass::rebuild(Function *function,
+    const std::vector<Block *> &blockList, const std::vector<int> &order,
+    size_t coldStart) {
+
+#ifdef ARCH_X86_64
+    // original fall-through successors, before anything moves
+    std::vector<Block *> fallThroughList(blockList.size(), nullptr);
+    for(size_t i = 0; i + 1 < blockList.size(); i ++) {
+        if(fallsThrough(blockList[i])) fallThroughList[i] = blockList[i + 1];
+    }
+
+    std::vector<Block *> layoutList;
+    Block *firstCold = nullptr;
+    for(size_t k = 0; k < order.size(); k ++) {
+        auto block = blockList[order[k]];
+        if(k == coldStart) firstCold = block;
+        layoutList.push_back(block);
+
+        // the last hot block has no next block in this function
+        Block *next = nullptr;
+        if(k + 1 < order.size() && k + 1 != coldStart) {
+            next = blockList[order[k + 1]];
+        }
+        auto fallThrough = fallThroughList[order[k]];
+        if(fallThrough && fallThrough != next
+            && !invertBranch(block, next, fallThrough)) {
+
+            layoutList.push_back(makeJumpBlock(fallThrough));
+        }
+    }
+
+    for(auto block : blockList) {
+        ChunkMutator(function, false).remove(block);
+    }
+
+    PositionFactory *positionFactory = PositionFactory::getInstance();
+    Chunk *prevChunk = nullptr;
+    for(auto block : layoutList) {
+        if(block->getPosition()) delete block->getPosition();
+        block->setPosition(positionFactory->makePosition(
+            prevChunk, block, function->getSize()));
+
+        ChunkMutator(function, false).append(block);
+        prevChunk = block;
+    }
+    {
+        ChunkMutator(function, true);
+    }
+
+    if(firstCold) {
+        ChunkMutator(function).splitFunctionBefore(firstCold);
+        auto cold = static_cast<Function *>(
+            function->getParent()->getChildren()->genericGetLast());
+        cold->setName(function->getName() + ".cold");
+        relinkAcrossSplit(function, cold);
+        relinkAcrossSplit(cold, function);
+        coldList.push_back(cold);
+    }
+#endif
+}
+
+#ifdef ARCH_X86_64
+static Block *getTargetBlock(Link *link) {
+    if(!link || !link->getTarget()) return nullptr;
+
+    auto target = &*link->getTarget();
+    if(auto block = dynamic_cast<Block *>(target)) return block;
+    auto instr = dynamic_cast<Instruction *>(target);
+    if(!instr) return nullptr;
+
+    // only jumps to the start of a block
+    auto block = dynamic_cast<Block *>(instr->getParent());
+    if(block && block->getChildren()->getIterable()->get(0) != instr) {
+        return nullptr;
+    }
+    return block;
+}
+
+// indexed by condition code, the low nibble of the opcode
+static const struct {
+    unsigned int id;
+    const char *mnemonic;
+} conditionList[] = {
+    {X86_INS_JO, "jo"}, {X86_INS_JNO, "jno"},
+    {X86_INS_JB, "jb"}, {X86_INS_JAE, "jae"},
+    {X86_INS_JE, "je"}, {X86_INS_JNE, "jne"},
+    {X86_INS_JBE, "jbe"}, {X86_INS_JA, "ja"},
+    {X86_INS_JS, "js"}, {X86_INS_JNS, "jns"},
+    {X86_INS_JP, "jp"}, {X86_INS_JNP, "jnp"},
+    {X86_INS_JL, "jl"}, {X86_INS_JGE, "jge"},
+    {X86_INS_JLE, "jle"}, {X86_INS_JG, "jg"},
+};
+
+static int getConditionCode(unsigned int id) {
+    for(int cc = 0; cc < 16; cc ++) {
+        if(conditionList[cc].id == id) return cc;
+    }
+    return -1;  // e.g. jrcxz
+}
+#endif
+
+bool BlockReorderPass::invertBranch(Block *block, Block *next,
+    Block *fallThrough) {
+
+#ifdef ARCH_X86_64
+    if(!next) return false;
+    auto instr = block->getChildren()->getIterable()->getLast();
+    auto cfi = dynamic_cast<ControlFlowInstruction *>(instr->getSemantic());
+    if(!cfi || getTargetBlock(cfi->getLink()) != next) return false;
+
+    int cc = getConditionCode(cfi->getId());
+    if(cc < 0) return false;
+    auto inverted = conditionList[cc ^ 1];
+
+    std::string opcode;
+    if(cfi->getDisplacementSize() == 1) {
+        opcode += static_cast<char>(0x70 | (cc ^ 1));
+    }
+    else {
+        opcode += static_cast<char>(0x0f);
+        opcode += static_cast<char>(0x80 | (cc ^ 1));
+    }
+
+    auto semantic = new ControlFlowInstruction(inverted.id, instr, opcode,
+        inverted.mnemonic, cfi->getDisplacementSize());
+    semantic->setLink(new NormalLink(
+        fallThrough->getChildren()->getIterable()->get(0),
+        Link::SCOPE_INTERNAL_JUMP));
+    instr->setSemantic(semantic);
+    delete cfi;
+    return true;
+#else
+    return false;
+#endif
+}
+
+Block *BlockReorderPass::makeJumpBlock(Block *target) {
+#ifdef ARCH_X86_64
+    auto block = new Block();
+    auto jump = new Instruction();
+    auto semantic = new ControlFlowInstruction(
+        X86_INS_JMP, jump, "\xe9", "jmp", 4);
+    semantic->setLink(new NormalLink(
+        target->getChildren()->getIterable()->get(0),
+        Link::SCOPE_INTERNAL_JUMP));
+    jump->setSemantic(semantic);
+
+    ChunkMutator(block, false).append(jump);
+    return block;
+#else
+    return nullptr;
+#endif
+}
@@ -0,0 +1,52 @@
+#ifndef EGALITO_PASS_BLOCK_REORDER_H
+#define EGALITO_PASS_BLOCK_REORDER_H
+
+#include <map>
+#include <utility>
+#include <vector>
+#include "chunkpass.h"
+
+/** Profile-guided block layout within functions (see BlockChainLayout).
+
+    Where a block's original fall-through successor is no longer next, its
+    conditional branch is inverted if that makes the new next block the
+    fall-through, and otherwise a jump block is added after it. Blocks that
+    never ran are split into a separate Function named "<name>.cold", which
+    Generator places after all other code. Functions with jump tables are
+    reordered but never split.
+
+    This whole pass is x86_64-specific.
+*/
+class BlockReorderPass : public ChunkPass {
+public:
+    // counts keyed by block offsets within the original function
+    typedef std::map<address_t, unsigned long> BlockCountMap;
+    typedef std::map<std::pair<address_t, address_t>, unsigned long>
+        EdgeCountMap;
+private:
+    struct Profile {
+        BlockCountMap blockCount;
+        EdgeCountMap edgeCount;
+    };
+private:
+    bool splitCold;
+    std::map<Function *, Profile> profileMap;
+    std::vector<Function *> coldList;
+public:
+    BlockReorderPass(bool splitCold = true) : splitCold(splitCold) {}
+
+    void setProfile(Function *function, const BlockCountMap &blockCount,
+        const EdgeCountMap &edgeCount);
+    /** The new cold functions, in the order they were created. */
+    const std::vector<Function *> &getColdList() const { return coldList; }
+
+    virtual void visit(FunctionList *functionList);
+    virtual void visit(Function *function);
+private:
+    void rebuild(Function *function, const std::vector<Block *> &blockList,
+        const std::vector<int> &order, size_t coldStart);
+    bool invertBranch(Block *block, Block *next, Block *fallThrough);
+    Block *makeJumpBlock(Block *target);
+};
+
+#endif
@@ -4,7 +4,8 @@
 #include "analysis/call.h"
 #include "analysis/dataflow.h"
 #include "analysis/walker.h"
-#include "analysis/frametype.h"
+#include "analysis/framesummary.h"
+#include "analysis/manager.h"
 #include "instr/concrete.h"
 #include "instr/semantic.h"
 #include "log/log.h"
@@ -30,13 +31,14 @@ RegisterSet& UnusedRegister::detect(Function *function) {
 #ifdef ARCH_AARCH64
     DataFlow df;
     auto working = df.getWorkingSet(function);
-    FrameType ft(function);
+    bool createsFrame = AnalysisManager::getInstance()
+        ->getFrameSummary(function)->hasFrame();
 
     //auto module = dynamic_cast<Module *>(function->getParent()->getParent());
 
     regset.setAll();
     for(const auto& state : working->getStateList()) {
-        if(ft.createsFrame() && StateGroup::isPushOrPop(&state)) continue;
+        if(createsFrame && StateGroup::isPushOrPop(&state)) continue;
         if(StateGroup::isCall(&state)) continue;
         // we must assume ABI use for unknown targets
         //if(StateGroup::isExternalJump(&state, module)) continue;
@@ -155,7 +157,9 @@ void CancelPushPass::optimize(const std::vector<Function *>& rootList) {
             for(auto vv : sccOrder.get()) {
                 for(auto v : vv) {
                     auto f = graph.getFunction(v);
-                    if(FrameType(f).createsFrame()) {
+                    auto frame = AnalysisManager::getInstance()
+                        ->getFrameSummary(f);
+                    if(frame->hasFrame()) {
                         LOG(10, "maybe optimize " << f->getName());
                     }
                 }
@@ -4,6 +4,7 @@
 #include "chunk/chunk.h"
 #include "chunk/concrete.h"
 #include "chunk/visitor.h"
+#include "analysis/manager.h"
 #include "run.h"
 
 class Conductor;  // used by many subclasses
@@ -17,6 +18,12 @@ protected:
         }
     }
 public:
+    /** Analyses still valid after this pass; the rest are dropped from the
+        AnalysisManager when the pass is run with RUN_PASS.
+    */
+    virtual PreservedAnalyses getPreservedAnalyses() const
+        { return PreservedAnalyses::none(); }
+
     virtual void visit(Program *program) { recurse(program); }
     virtual void visit(Module *module) { recurse(module); }
     virtual void visit(FunctionList *functionList) { recurse(functionList); }
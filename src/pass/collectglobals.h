@@ -5,6 +5,8 @@
 
 class CollectGlobalsPass : public ChunkPass {
 public:
+    virtual PreservedAnalyses getPreservedAnalyses() const
+        { return PreservedAnalyses::all(); }
     virtual void visit(Module *module);
 };
 
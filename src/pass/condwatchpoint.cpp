@@ -1,5 +1,6 @@
 #include <cstring>  // for memset
 #include "condwatchpoint.h"
+#include "analysis/scratch.h"
 #include "operation/addinline.h"
 #include "operation/mutator.h"
 #include "disasm/disassemble.h"
@@ -38,6 +39,18 @@ void CondWatchpointPass::visit(Function *function) {
     auto module = static_cast<Module *>(function->getParent()->getParent());
     auto sectionPair = createDataSection(module);
 
+    // the inserted code clobbers the flags and jumps past anything that
+    // could restore them, so it relies on them being dead at entry
+    {
+        auto block1 = function->getChildren()->getIterable()->get(0);
+        auto instr1 = block1->getChildren()->getIterable()->get(0);
+        if(!ScratchRegisters(function).areFlagsDead(instr1)) {
+            LOG(1, "WARNING: flags are live on entry to ["
+                << function->getName() << "], skipping watchpoint");
+            return;
+        }
+    }
+
     ChunkAddInline ai({}, [this, sectionPair, function] (unsigned int stackBytesAdded) {
         /*
            ff 05 f8 01 00 f0            incl   -0xffffe08(%rip)
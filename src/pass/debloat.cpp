@@ -1,6 +1,8 @@
 #include <cassert>
 #include "debloat.h"
-#include "analysis/walker.h"
+#include "analysis/call.h"
+#include "analysis/compactcallgraph.h"
+#include "analysis/manager.h"
 #include "chunk/concrete.h"
 #include "elf/elfspace.h"
 #include "elf/elfmap.h"
@@ -12,7 +14,9 @@
 #include "log/log.h"
 #include "log/temp.h"
 
-DebloatPass::DebloatPass(Program *program) : program(program), graph(program) {
+DebloatPass::DebloatPass(Program *program) : program(program),
+    graph(AnalysisManager::getInstance()->getCompactCallGraph(program)) {
+
     useFromDynamicInitFini();
     useFromEntry();
     useFromIndirectCallee();
@@ -126,8 +130,9 @@ void DebloatPass::useFromEntry() {
 }
 
 void DebloatPass::useFromIndirectCallee() {
-    IndirectCalleeList indirectCallees(program);
-    for(auto f : indirectCallees.getList()) {
+    auto indirectCallees
+        = AnalysisManager::getInstance()->getIndirectCalleeList(program);
+    for(auto f : indirectCallees->getList()) {
         markTreeAsUsed(f);
     }
 }
@@ -207,12 +212,21 @@ void DebloatPass::markTreeAsUsed(Function *root) {
     auto it = usedList.find(root);
     if(it != usedList.end()) return;
 
-    Preorder order(&graph);
-
-    auto id = graph.getNode(root)->getID();
-    order.gen(id);
+    auto id = graph->getID(root);
+    if(id == CompactCallGraph::INVALID_ID) {
+        usedList.insert(root);
+        return;
+    }
 
-    for(auto n : order.get()[0]) {
-        usedList.insert(graph.getFunction(n));
+    std::vector<CompactCallGraph::IDType> work{id};
+    usedList.insert(root);
+    while(!work.empty()) {
+        auto n = work.back();
+        work.pop_back();
+        for(auto callee : graph->getCallees(n)) {
+            if(usedList.insert(graph->getFunction(callee)).second) {
+                work.push_back(callee);
+            }
+        }
     }
 }
@@ -1,13 +1,15 @@
 #ifndef EGALITO_PASS_DEBLOAT_H
 #define EGALITO_PASS_DEBLOAT_H
 
+#include <set>
 #include "chunkpass.h"
-#include "analysis/call.h"
+
+class CompactCallGraph;
 
 class DebloatPass : public ChunkPass {
 private:
     Program *program;
-    CallGraph graph;
+    CompactCallGraph *graph;
     std::set<Function *> usedList;
 public:
     DebloatPass(Program *program);
@@ -0,0 +1,60 @@
+#include <vector>
+#include "devirtualize.h"
+#include "analysis/indirectcall.h"
+#include "analysis/manager.h"
+#include "chunk/concrete.h"
+#include "instr/concrete.h"
+#include "operation/mutator.h"
+
+#include "log/log.h"
+
+void DevirtualizePass::visit(Program *program) {
+    // rewriting invalidates the analysis, so collect every site first
+    auto targets = AnalysisManager::getInstance()
+        ->getIndirectCallTargets(program);
+    std::vector<std::pair<Instruction *, Function *>> siteList;
+    for(auto &kv : targets->getSites()) {
+        auto instr = kv.first;
+        auto target = targets->getSingleTarget(instr, useClassHierarchy);
+        if(!target) continue;
+
+        auto function = instr->getParent()->getParent();
+        if(target->getParent() != function->getParent()) continue;
+        siteList.emplace_back(instr, target);
+    }
+
+    size_t count = 0;
+    for(auto &site : siteList) {
+        LOG(10, "devirtualizing call at 0x" << std::hex
+            << site.first->getAddress() << " to " << site.second->getName());
+        if(devirtualize(site.first, site.second)) count ++;
+    }
+    LOG(1, "devirtualized " << std::dec << count << " of "
+        << targets->getSites().size() << " indirect calls and jumps");
+}
+
+bool DevirtualizePass::devirtualize(Instruction *instr, Function *target) {
+#ifdef ARCH_X86_64
+    auto semantic = instr->getSemantic();
+    ControlFlowInstruction *newSem = nullptr;
+    if(dynamic_cast<IndirectCallInstruction *>(semantic)) {
+        newSem = new ControlFlowInstruction(
+            X86_INS_CALL, instr, "\xe8", "callq", 4);
+    }
+    else if(dynamic_cast<IndirectJumpInstruction *>(semantic)) {
+        newSem = new ControlFlowInstruction(
+            X86_INS_JMP, instr, "\xe9", "jmp", 4);
+    }
+    else return false;
+
+    newSem->setLink(new NormalLink(target, Link::SCOPE_EXTERNAL_JUMP));
+    instr->setSemantic(newSem);
+    ChunkMutator(instr->getParent(), true).modifiedChildSize(instr,
+        newSem->getSize() - semantic->getSize());
+    delete semantic;
+    return true;
+#else
+    // building a bl/b needs an encoded Assembly; not done yet
+    return false;
+#endif
+}
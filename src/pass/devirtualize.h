@@ -0,0 +1,32 @@
+#ifndef EGALITO_PASS_DEVIRTUALIZE_H
+#define EGALITO_PASS_DEVIRTUALIZE_H
+
+#include "chunkpass.h"
+
+/** Turns indirect calls and indirect tail jumps that IndirectCallTargets
+    resolves to a single function into direct ones, removing the indirect
+    branch along with any CFI or GS table work it would have needed.
+
+    Sites resolved through a vtable slot are only rewritten when
+    useClassHierarchy is set, since that assumes no other classes can be
+    loaded. Targets must be in the caller's module, so the result can still
+    be emitted as separate ELF files.
+*/
+class DevirtualizePass : public ChunkPass {
+private:
+    bool useClassHierarchy;
+public:
+    DevirtualizePass(bool useClassHierarchy = false)
+        : useClassHierarchy(useClassHierarchy) {}
+
+    virtual PreservedAnalyses getPreservedAnalyses() const
+        { return PreservedAnalyses::all(); }  // invalidates what it changes
+    virtual void visit(Program *program);
+
+    /** Replaces the indirect call or jump instr with a direct one to target.
+        Returns false if that is not supported on this architecture.
+    */
+    static bool devirtualize(Instruction *instr, Function *target);
+};
+
+#endif
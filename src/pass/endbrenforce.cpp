@@ -1,12 +1,16 @@
 #include <vector>
 #include <cassert>
 #include "endbrenforce.h"
+#include "analysis/indirectcall.h"
+#include "analysis/manager.h"
 #include "disasm/disassemble.h"
 #include "instr/register.h"
 #include "instr/concrete.h"
 #include "operation/mutator.h"
 #include "types.h"
 
+#include "log/log.h"
+
 template <typename SemanticType>
 static Instruction *makeMovR11Instruction(SemanticType *semantic) {
 #ifdef ARCH_X86_64
@@ -90,6 +94,20 @@ static Instruction *makeMovR11Instruction(SemanticType *semantic) {
 #endif
 }
 
+void EndbrEnforcePass::visit(Program *program) {
+    // adding the checks invalidates the analysis, so copy what we need
+    auto targets = AnalysisManager::getInstance()
+        ->getIndirectCallTargets(program);
+    for(auto &kv : targets->getSites()) {
+        if(kv.second.getPrecision() == IndirectCallTargets::EXACT) {
+            trustedList.insert(kv.first);
+        }
+    }
+    LOG(1, "endbr enforcement: skipping " << std::dec << trustedList.size()
+        << " of " << targets->getSites().size() << " indirect branches");
+    recurse(program);
+}
+
 void EndbrEnforcePass::visit(Module *module) {
 #ifdef ARCH_X86_64
     auto instr = Disassemble::instruction({0x0f, 0x0b});  // ud2
@@ -126,6 +144,8 @@ void EndbrEnforcePass::visit(Function *function) {
 }
 
 void EndbrEnforcePass::visit(Instruction *instruction) {
+    if(trustedList.count(instruction)) return;
+
     auto semantic = instruction->getSemantic();
     if(auto v = dynamic_cast<IndirectJumpInstruction *>(semantic)) {
         if(!v->isForJumpTable()) {
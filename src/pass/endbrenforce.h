@@ -1,13 +1,21 @@
 #ifndef EGALITO_PASS_ENDBR_ENFORCE_H
 #define EGALITO_PASS_ENDBR_ENFORCE_H
 
+#include <set>
 #include "chunkpass.h"
 
+/** Checks that every indirect call or jump lands on an endbr64. Sites
+    whose targets IndirectCallTargets resolves exactly (from constants and
+    read-only data only) cannot be redirected and are left unchecked; this
+    is only known when the pass is run on the whole Program.
+*/
 class EndbrEnforcePass : public ChunkPass {
 private:
     Function *violationTarget;
+    std::set<Instruction *> trustedList;
 public:
     EndbrEnforcePass() : violationTarget(nullptr) {}
+    virtual void visit(Program *program);
     virtual void visit(Module *module);
     virtual void visit(Function *function);
     virtual void visit(Instruction *instruction);
@@ -1,28 +1,32 @@
 #include "findendbr.h"
-#include "instr/concrete.h"
+#include "chunk/concrete.h"
+#include "operation/findbytes.h"
 #include "log/log.h"
 
+static const char endbr64[] = "\xf3\x0f\x1e\xfa";
+
 void FindEndbrPass::visit(Module *module) {
     LOG(9, "Searching for endbr in [" << module->getName() << "]");
-    recurse(module);
-}
-
-void FindEndbrPass::visit(Function *function) {
-    currentFunction = function;
-    recurse(function);
-    if (brCount[function]) {
-        LOG(9, "Number of endbr instructions in [" << function->getName()
-            << "] is " << brCount[function]);
+#ifdef ARCH_X86_64
+    // the current bytes of each function, so that endbr64s added or moved
+    // by earlier passes are counted too
+    for(auto function : CIter::functions(module)) {
+        visit(function);
     }
+#endif
 }
 
-void FindEndbrPass::visit(Instruction *instruction) {
-    auto semantic = instruction->getSemantic();
-    if (auto v = dynamic_cast<IsolatedInstruction *>(semantic)) {
+void FindEndbrPass::visit(Function *function) {
 #ifdef ARCH_X86_64
-        if (v->getAssembly()->getId() == X86_INS_ENDBR64) {
-            brCount[currentFunction]++;
-        }
+    brCount[function] += ChunkFindBytes(endbr64).find(function).size();
+    report(function);
 #endif
+}
+
+void FindEndbrPass::report(Function *function) {
+    auto it = brCount.find(function);
+    if(it != brCount.end() && it->second) {
+        LOG(9, "Number of endbr instructions in [" << function->getName()
+            << "] is " << it->second);
     }
 }
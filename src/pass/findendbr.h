@@ -4,15 +4,18 @@
 #include <map>
 #include "chunkpass.h"
 
+/** Counts endbr64 instructions per function, by sweeping the current bytes
+    of each function for their encoding rather than decoding every
+    instruction. Instructions inserted by EndbrAddPass are included.
+*/
 class FindEndbrPass : public ChunkPass {
 private:
     std::map<Function *, int> brCount;
-    Function *currentFunction;
 public:
-    FindEndbrPass() : currentFunction(nullptr) {}
     virtual void visit(Module *module);
     virtual void visit(Function *function);
-    virtual void visit(Instruction *instruction);
+private:
+    void report(Function *function);
 };
 
 #endif
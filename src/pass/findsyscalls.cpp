@@ -8,6 +8,7 @@
 #include "analysis/walker.h"
 #include "chunk/dump.h"
 #include "conductor/conductor.h"
+#include "operation/findbytes.h"
 #include "log/log.h"
 
 void FindSyscalls::visit(Function *function) {
@@ -18,6 +19,12 @@ void FindSyscalls::visit(Function *function) {
     // equivalent to a syscall() instruction.
     if (isSyscallFunction(function)) return;
 
+    // only syscall instructions and calls to syscall() end up in
+    // numberMap, so skip building use-def chains for the (many) functions
+    // that contain neither
+    if (ChunkFindBytes("\x0f\x05").find(function).empty()
+        && !callsSyscallFunction(function)) return;
+
     auto graph = new ControlFlowGraph(function);
     auto config = new UDConfiguration(graph);
     auto working = new UDRegMemWorkingSet(function, graph);
@@ -59,7 +66,7 @@ void FindSyscalls::visit(Function *function) {
                 else {
                     func_target = dynamic_cast<Function *>(target);
                 }
-                if (func_target && isSyscallFunction(function)) {
+                if (func_target && isSyscallFunction(func_target)) {
                     LOG(10, "found call to syscall() function");
                     std::set<unsigned long> values;
                     seen.clear();
@@ -104,6 +111,21 @@ bool FindSyscalls::isSyscallFunction(Function *function) {
     return false;
 }
 
+// direct calls only, matching what visit() records; PLT calls are skipped
+bool FindSyscalls::callsSyscallFunction(Function *function) {
+    for (auto block : CIter::children(function)) {
+        for (auto instr : CIter::children(block)) {
+            auto cfi = dynamic_cast<ControlFlowInstruction *>(
+                instr->getSemantic());
+            if (!cfi || !cfi->getLink()) continue;
+            auto target = dynamic_cast<Function *>(
+                cfi->getLink()->getTarget());
+            if (target && isSyscallFunction(target)) return true;
+        }
+    }
+    return false;
+}
+
 bool FindSyscalls::getRegisterValue(UDState *state, int curreg, std::set<unsigned long> &valueSet) {
     bool all_constants = true;
     if (seen.find(state) == seen.end()) {
@@ -21,6 +21,7 @@ public:
         { return numberMap; }
 private:
     bool isSyscallFunction(Function *function);
+    bool callsSyscallFunction(Function *function);
     bool getRegisterValue(UDState *state, int curreg, std::set<unsigned long> &valueSet);
 };
 
@@ -1,14 +1,45 @@
 #include "inferlinks.h"
 #include "chunk/dump.h"
 #include "disasm/makesemantic.h"
+#include "archive/analysisdb.h"
 #include "log/log.h"
 
 void InferLinksPass::visit(Module *module) {
     this->module = module;
-#if defined(ARCH_AARCH64) || defined(ARCH_RISCV)
+#if defined(ARCH_AARCH64)
+    std::vector<std::pair<Instruction *, address_t>> pointerList;
+    if(record && cached) {
+        for(const auto &link : record->getInferredLinkList()) {
+            auto instr = ModuleAnalysisRecord::findInstruction(
+                module, link.instruction);
+            if(!instr) {
+                LOG(1, "InferLinksPass: recorded instruction not found");
+                pointerList.clear();
+                break;
+            }
+            pointerList.emplace_back(instr, link.target);
+        }
+    }
+    LinkedInstruction::makeAllLinked(module, &pointerList);
+    if(record && !cached) {
+        for(auto &pointer : pointerList) {
+            record->recordInferredLink(pointer.first, pointer.second);
+        }
+    }
+#elif defined(ARCH_RISCV)
     LinkedInstruction::makeAllLinked(module);
 #else
-    recurse(module);
+    if(record && cached) {
+        // only the instructions that were linked last time need a look
+        for(const auto &link : record->getInferredLinkList()) {
+            auto instr = ModuleAnalysisRecord::findInstruction(
+                module, link.instruction);
+            if(instr) visit(instr);
+        }
+    }
+    else {
+        recurse(module);
+    }
 #endif
 }
 
@@ -33,6 +64,7 @@ void InferLinksPass::visit(Instruction *instruction) {
     if(linked) {
         instruction->setSemantic(linked);
         delete semantic;
+        if(record && !cached) record->recordInferredLink(instruction);
     }
 #elif defined(ARCH_ARM)
     auto linked = LinkedInstruction::makeLinked(module, instruction, assembly);
@@ -4,12 +4,22 @@
 #include "chunkpass.h"
 #include "elf/elfmap.h"
 
+class ModuleAnalysisRecord;
+
+/** Creates links for instructions that refer to code or data. With a
+    ModuleAnalysisRecord, links found here are added to it; if the record
+    was loaded (cached is true), only the recorded instructions are visited.
+*/
 class InferLinksPass : public ChunkPass {
 private:
     ElfMap *elf;
     Module *module;
+    ModuleAnalysisRecord *record;
+    bool cached;
 public:
-    InferLinksPass(ElfMap *elf) : elf(elf), module(nullptr) {}
+    InferLinksPass(ElfMap *elf, ModuleAnalysisRecord *record = nullptr,
+        bool cached = false)
+        : elf(elf), module(nullptr), record(record), cached(cached) {}
     virtual void visit(Module *module);
     virtual void visit(Instruction *instruction);
 };
@@ -0,0 +1,240 @@
+#include <typeinfo>
+#include <capstone/x86.h>
+#include "inlinecalls.h"
+#include "chunk/concrete.h"
+#include "disasm/disassemble.h"
+#include "instr/concrete.h"
+#include "operation/mutator.h"
+
+#include "log/log.h"
+
+void InlineCallsPass::visit(Module *module) {
+    recurse(module->getFunctionList());
+    LOG(1, "inlined " << inlinedCount << " calls in [" << module->getName()
+        << "]");
+}
+
+void InlineCallsPass::visit(Function *function) {
+#ifdef ARCH_X86_64
+    if(function->getCache()) return;
+
+    std::vector<std::pair<Instruction *, Function *>> siteList;
+    for(auto block : CIter::children(function)) {
+        for(auto instr : CIter::children(block)) {
+            if(auto callee = getInlineTarget(function, instr)) {
+                siteList.emplace_back(instr, callee);
+            }
+        }
+    }
+
+    for(auto &site : siteList) {
+        LOG(10, "inlining [" << site.second->getName() << "] into ["
+            << function->getName() << "] at " << site.first->getName());
+        inlineCall(site.first, site.second);
+        inlinedCount ++;
+    }
+#endif
+}
+
+#ifdef ARCH_X86_64
+static Module *getModule(Chunk *chunk) {
+    while(chunk && !dynamic_cast<Module *>(chunk)) {
+        chunk = chunk->getParent();
+    }
+    return static_cast<Module *>(chunk);
+}
+
+static bool isStackPointer(unsigned int reg) {
+    return reg == X86_REG_RSP || reg == X86_REG_ESP
+        || reg == X86_REG_SP || reg == X86_REG_SPL;
+}
+
+// explicit or implicit use of the stack pointer, or an unlinked RIP-relative
+// operand (which could not be moved)
+static bool usesStackOrRIP(Assembly *assembly) {
+    for(size_t i = 0; i < assembly->getImplicitRegsReadCount(); i ++) {
+        if(isStackPointer(assembly->getImplicitRegsRead()[i])) return true;
+    }
+    for(size_t i = 0; i < assembly->getImplicitRegsWriteCount(); i ++) {
+        if(isStackPointer(assembly->getImplicitRegsWrite()[i])) return true;
+    }
+
+    auto asmOps = assembly->getAsmOperands();
+    for(size_t i = 0; i < asmOps->getOpCount(); i ++) {
+        auto &op = asmOps->getOperands()[i];
+        if(op.type == X86_OP_REG && isStackPointer(op.reg)) return true;
+        if(op.type == X86_OP_MEM) {
+            if(isStackPointer(op.mem.base) || isStackPointer(op.mem.index)) {
+                return true;
+            }
+            if(op.mem.base == X86_REG_RIP) return true;
+        }
+    }
+    return false;
+}
+
+// the link types that are safe to share between copies of an instruction;
+// returns nullptr for any other type
+static Link *copyLink(Link *link) {
+    if(!link) return nullptr;
+
+    const auto &type = typeid(*link);
+    if(type == typeid(NormalLink)) {
+        return new NormalLink(*static_cast<NormalLink *>(link));
+    }
+    if(type == typeid(AbsoluteNormalLink)) {
+        return new AbsoluteNormalLink(*static_cast<AbsoluteNormalLink *>(link));
+    }
+    if(type == typeid(DataOffsetLink)) {
+        return new DataOffsetLink(*static_cast<DataOffsetLink *>(link));
+    }
+    if(type == typeid(AbsoluteDataLink)) {
+        return new AbsoluteDataLink(*static_cast<AbsoluteDataLink *>(link));
+    }
+    if(type == typeid(TLSDataOffsetLink)) {
+        return new TLSDataOffsetLink(*static_cast<TLSDataOffsetLink *>(link));
+    }
+    return nullptr;
+}
+
+static bool isEndbr(Instruction *instr) {
+    auto assembly = instr->getSemantic()->getAssembly();
+    return assembly && assembly->getMnemonic() == "endbr64";
+}
+
+static bool isPlainReturn(Instruction *instr) {
+    if(!dynamic_cast<ReturnInstruction *>(instr->getSemantic())) return false;
+    auto assembly = instr->getSemantic()->getAssembly();
+    if(!assembly) return false;
+
+    // ret or repz ret, but not ret $imm
+    std::string bytes(assembly->getBytes(), assembly->getSize());
+    return bytes == "\xc3" || bytes == "\xf3\xc3";
+}
+
+static Instruction *copyInstruction(Instruction *instr) {
+    auto semantic = instr->getSemantic();
+    auto assembly = semantic->getAssembly();
+    std::vector<unsigned char> bytes(assembly->getBytes(),
+        assembly->getBytes() + assembly->getSize());
+
+    if(typeid(*semantic) == typeid(IsolatedInstruction)) {
+        return Disassemble::instruction(bytes);
+    }
+
+    auto linked = static_cast<LinkedInstruction *>(semantic);
+    DisasmHandle handle(true);
+    auto copy = new Instruction();
+    auto sem = new LinkedInstruction(copy);
+    sem->setAssembly(DisassembleInstruction(handle).makeAssemblyPtr(bytes));
+    sem->setLink(copyLink(linked->getLink()));
+    sem->setIndex(linked->getIndex());
+    copy->setSemantic(sem);
+    return copy;
+}
+#endif
+
+Function *InlineCallsPass::getInlineTarget(Function *caller,
+    Instruction *instruction) {
+
+#ifdef ARCH_X86_64
+    auto cfi = dynamic_cast<ControlFlowInstruction *>(
+        instruction->getSemantic());
+    if(!cfi || cfi->getId() != X86_INS_CALL || !cfi->getLink()) return nullptr;
+
+    Function *callee = nullptr;
+    if(auto pltLink = dynamic_cast<PLTLink *>(cfi->getLink())) {
+        auto trampoline = pltLink->getPLTTrampoline();
+        if(trampoline->isIFunc()) return nullptr;
+        callee = dynamic_cast<Function *>(trampoline->getTarget());
+    }
+    else if(auto target = cfi->getLink()->getTarget()) {
+        callee = dynamic_cast<Function *>(&*target);
+    }
+    if(!callee || callee == caller) return nullptr;
+    if(getModule(callee) == getModule(caller)) return nullptr;
+
+    return isInlinable(callee) ? callee : nullptr;
+#else
+    return nullptr;
+#endif
+}
+
+bool InlineCallsPass::isInlinable(Function *function) {
+#ifdef ARCH_X86_64
+    auto it = inlinableMap.find(function);
+    if(it != inlinableMap.end()) return it->second;
+
+    auto &result = inlinableMap[function];
+    result = false;
+    if(function->getSize() > maxSize) return false;
+    if(function->getChildren()->genericGetSize() != 1) return false;
+
+    auto block = function->getChildren()->getIterable()->get(0);
+    auto instrList = block->getChildren()->getIterable();
+    if(!isPlainReturn(instrList->getLast())) return false;
+
+    size_t bodySize = 0;
+    for(auto instr : CIter::children(block)) {
+        if(instr == instrList->getLast()) break;
+        if(isEndbr(instr)) continue;
+
+        auto semantic = instr->getSemantic();
+        auto assembly = semantic->getAssembly();
+        if(!assembly) return false;
+
+        const auto &type = typeid(*semantic);
+        if(type == typeid(IsolatedInstruction)) {
+            if(usesStackOrRIP(&*assembly)) return false;
+        }
+        else if(type == typeid(LinkedInstruction)) {
+            auto link = copyLink(semantic->getLink());
+            if(!link) return false;
+            delete link;
+
+            // the linked operand is RIP-relative; no other may use the stack
+            auto asmOps = assembly->getAsmOperands();
+            for(size_t i = 0; i < asmOps->getOpCount(); i ++) {
+                auto &op = asmOps->getOperands()[i];
+                if(op.type == X86_OP_REG && isStackPointer(op.reg)) {
+                    return false;
+                }
+                if(op.type == X86_OP_MEM && (isStackPointer(op.mem.base)
+                    || isStackPointer(op.mem.index))) return false;
+            }
+        }
+        else return false;  // any control flow, literals, etc
+        bodySize ++;
+    }
+
+    result = (bodySize > 0);
+    return result;
+#else
+    return false;
+#endif
+}
+
+void InlineCallsPass::inlineCall(Instruction *call, Function *callee) {
+#ifdef ARCH_X86_64
+    auto block = callee->getChildren()->getIterable()->get(0);
+    auto last = block->getChildren()->getIterable()->getLast();
+
+    std::vector<Instruction *> copyList;
+    for(auto instr : CIter::children(block)) {
+        if(instr == last) break;
+        if(isEndbr(instr)) continue;
+        copyList.push_back(copyInstruction(instr));
+    }
+
+    // anything that jumped to the call now reaches the first copy; each
+    // insertion moves the existing semantic one instruction later, so the
+    // call itself ends up in the last copy
+    auto parent = call->getParent();
+    ChunkMutator(parent).insertBefore(call, copyList, true);
+
+    auto moved = copyList.back();
+    ChunkMutator(parent).remove(moved);
+    delete moved->getSemantic();
+    delete moved;
+#endif
+}
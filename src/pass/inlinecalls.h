@@ -0,0 +1,41 @@
+#ifndef EGALITO_PASS_INLINE_CALLS_H
+#define EGALITO_PASS_INLINE_CALLS_H
+
+#include <map>
+#include "chunkpass.h"
+
+/** Inlines small leaf functions from other modules at their call sites,
+    for uniongen output (in mirrorgen each module is a separate ELF, so
+    code copied across modules would refer to the wrong data).
+
+    A callee qualifies if it is a single block of at most maxSize bytes
+    ending in a plain ret, and it neither calls nor jumps anywhere, nor
+    touches the stack pointer. Such code never sees the return address or
+    the caller's frame, so dropping the call and ret needs no stack fixups;
+    the clobbered registers are the same as for the call. A leading endbr64
+    is dropped, since the copy is not an indirect branch target. Calls go
+    through PLT entries or direct links (after CollapsePLTPass).
+
+    The inlined code is ordinary straight-line code, so later passes
+    (CFI, shadow stacks) treat it like the rest of the caller. This whole
+    pass is x86_64-specific.
+*/
+class InlineCallsPass : public ChunkPass {
+private:
+    size_t maxSize;
+    size_t inlinedCount;
+    std::map<Function *, bool> inlinableMap;
+public:
+    InlineCallsPass(size_t maxSize = 32) : maxSize(maxSize), inlinedCount(0) {}
+
+    size_t getInlinedCount() const { return inlinedCount; }
+
+    virtual void visit(Module *module);
+    virtual void visit(Function *function);
+private:
+    Function *getInlineTarget(Function *caller, Instruction *instruction);
+    bool isInlinable(Function *function);
+    void inlineCall(Instruction *call, Function *callee);
+};
+
+#endif
@@ -1,5 +1,4 @@
 #include <algorithm>
-#include <fstream>
 #include <cassert>
 #include "jumptablepass.h"
 #include "analysis/jumptable.h"
@@ -12,22 +11,23 @@
 #include "operation/find2.h"
 #include "operation/mutator.h"
 #include "elf/elfspace.h"
+#include "archive/analysisdb.h"
 
 #undef DEBUG_GROUP
 #define DEBUG_GROUP djumptable
 #include "log/log.h"
 #include "log/temp.h"
 
-//#define CACHE_DIR "/tmp/egalito-cache"
-
 void JumpTablePass::visit(Module *module) {
     this->module = module;
     auto jumpTableList = new JumpTableList();
     module->getChildren()->add(jumpTableList);
     module->setJumpTableList(jumpTableList);
-    if(!loadFromFile(jumpTableList)) {
+    if(record) {
+        loadFromRecord(jumpTableList);
+    }
+    else {
         visit(jumpTableList);
-        saveToFile();
     }
 }
 
@@ -37,6 +37,8 @@ void JumpTablePass::visit(JumpTableList *jumpTableList) {
 
     JumptableDetection search(module);
     search.detect(module);
+    // later rounds visit the same jumps again
+    auto statistics = search.getStatistics();
 
     auto count1 = search.getTableList().size();
     while(1) {
@@ -47,6 +49,7 @@ void JumpTablePass::visit(JumpTableList *jumpTableList) {
         if(count1 == count2) break;
         count1 = count2;
     }
+    dumpStatistics(statistics);
 
 #ifdef ARCH_X86_64
     // we cannot detect all the bounds in hand written assembly functions
@@ -68,6 +71,23 @@ void JumpTablePass::visit(JumpTableList *jumpTableList) {
 #endif
 }
 
+void JumpTablePass::dumpStatistics(
+    const JumptableDetection::Statistics &stats) const {
+
+    auto jumps = stats.fastJumps + stats.fullJumps;
+    if(jumps == 0) return;
+
+    LOG(1, "jump table detection in [" << module->getName() << "]: "
+        << std::dec << stats.fastJumps << " of " << jumps
+        << " indirect jumps (" << (100 * stats.fastJumps / jumps)
+        << "%) matched the fast path");
+    // measured times; the fast path time includes scans that failed
+    LOG(1, "    fast path: " << stats.fastFunctions << " functions, "
+        << stats.fastMicroseconds << " us including failed scans");
+    LOG(1, "    use-def analysis: " << stats.fullFunctions << " functions, "
+        << stats.fullMicroseconds << " us");
+}
+
 void JumpTablePass::makeJumpTable(JumpTableList *jumpTableList,
     const std::vector<JumpTableDescriptor *> &tables) {
 
@@ -193,95 +213,59 @@ size_t JumpTablePass::makeChildren(JumpTable *jumpTable, int count) {
     return count;
 }
 
-void JumpTablePass::saveToFile() const {
-#ifdef CACHE_DIR
-    if(module->getName() == "module-(executable)") return;
-    if(module->getName() == "module-(egalito)") return;
-    if(module->getName() == "module-(addon)") return;
-
-    std::string filename(CACHE_DIR "/");
-    filename += module->getName() + "-jumptable";
-    std::ofstream f(filename.c_str(), std::ios::out);
-
-    // keep it ascii now for debugging
-    auto jumptablelist = module->getJumpTableList();
-    for(auto& jt : CIter::children(jumptablelist)) {
-        auto d = jt->getDescriptor();
-        f << d->getInstruction()->getAddress() << '\n';
-        f << d->getAddress() << '\n';
-        f << d->getTargetBaseLink()->getTargetAddress() << '\n';
-        f << d->getScale() << '\n';
-        f << d->getEntries() << '\n';
-    }
-
-    f.close();
-#endif
-}
-
-bool JumpTablePass::loadFromFile(JumpTableList *jumpTableList) {
-#ifdef CACHE_DIR
-    if(module->getName() == "module-(executable)") return false;
-    if(module->getName() == "module-(egalito)") return false;
-    if(module->getName() == "module-(addon)") return false;
-
-    std::string filename(CACHE_DIR "/");
-    filename += module->getName() + "-jumptable";
-    std::ifstream f(filename.c_str(), std::ios::in);
-
-    bool loaded = false;
-    char line[128];
-    // the only way to get Function * is by address; name can not be used,
-    // because there may be multiple local functions with the same name.
-    for(f.getline(line, 128); f.good(); f.getline(line, 128)) {
-        auto brAddr = std::stoull(line);
-        LOG(10, "instruction at 0x" << std::hex << brAddr);
-        auto fn =
-            CIter::spatial(module->getFunctionList())->findContaining(brAddr);
-        auto instr = dynamic_cast<Instruction *>(
-            ChunkFind().findInnermostAt(fn, brAddr));
-        if(!instr) {
-            LOG(1, "JumpTablePass: instruction not found");
+void JumpTablePass::loadFromRecord(JumpTableList *jumpTableList) {
+    for(const auto &table : record->getJumpTableList()) {
+        // the record has already been validated against this module
+        auto instr = ModuleAnalysisRecord::findInstruction(module, table.jump);
+        auto it = tableMap.find(table.address);
+        if(it != tableMap.end()) {
+            // another jump through a table we already built
+            (*it).second->addJumpInstruction(instr);
+            continue;
         }
 
-        f.getline(line, 128);
-        auto addr = std::stoll(line);
-        LOG(10, "address 0x" << std::hex << addr);
-        f.getline(line, 128);
-        auto targetBase = std::stoll(line);
-        LOG(10, "target address 0x" << std::hex << targetBase);
-        f.getline(line, 128);
-        auto scale = std::stoi(line);
-        LOG(10, "scale " << scale);
-        f.getline(line, 128);
-        auto entries = std::stoi(line);
-        LOG(10, "entries " << entries);
+        auto function = ModuleAnalysisRecord::findFunction(module,
+            table.jump.function);
+        LOG(10, "loading jump table at 0x" << std::hex << table.address
+            << " for jump at 0x" << instr->getAddress());
 
-        auto d = new JumpTableDescriptor(fn, instr);
-        d->setAddress(addr);
+        auto d = new JumpTableDescriptor(function, instr);
+        d->setAddress(table.address);
         Link *link = nullptr;
-        if(addr == targetBase) {
-            link = LinkFactory::makeDataLink(module, targetBase, true);
+        if(table.address == table.targetBase) {
+            link = LinkFactory::makeDataLink(module, table.targetBase, true);
         }
         else {
-            auto function
-                = dynamic_cast<Function *>(instr->getParent()->getParent());
-            auto target = ChunkFind().findInnermostAt(function, targetBase);
-            link = LinkFactory::makeNormalLink(target, true, false);
+            auto target = ChunkFind().findInnermostAt(function,
+                table.targetBase);
+            if(target) {
+                link = LinkFactory::makeNormalLink(target, true, false);
+            }
+            else {
+                link = module->getMarkerList()
+                    ->createTableJumpTargetMarkerLink(
+                        instr, instr->getSize(), module, false);
+            }
         }
         assert(link);
         d->setTargetBaseLink(link);
+        d->setScale(table.scale);
+        d->setEntries(table.entries);
+        d->setContentSection(module->getDataRegionList()
+            ->findDataSectionContaining(table.address));
 
-        d->setScale(scale);
-        d->setEntries(entries);
         auto jumpTable = new JumpTable(module->getElfSpace()->getElfMap(), d);
         jumpTableList->getChildren()->add(jumpTable);
-        auto n = makeChildren(jumpTable, entries);
-        assert(n == (size_t)entries);
-        loaded = true;
+        tableMap[jumpTable->getAddress()] = jumpTable;
+        jumpTable->addJumpInstruction(instr);
+        if(table.entries > 0) {
+            auto n = makeChildren(jumpTable, table.entries);
+            if(n != static_cast<size_t>(table.entries)) {
+                LOG(1, "WARNING: jump table at 0x" << std::hex
+                    << table.address << " has only " << std::dec << n
+                    << " of " << table.entries << " recorded entries");
+                d->setEntries(n);
+            }
+        }
     }
-
-    return loaded;
-#else
-    return false;
-#endif
 }
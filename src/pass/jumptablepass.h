@@ -3,14 +3,23 @@
 
 #include <map>
 #include "chunkpass.h"
+#include "analysis/jumptabledetection.h"
 
-/** Constructs jump table data structures in the given Module. */
+class ModuleAnalysisRecord;
+
+/** Constructs jump table data structures in the given Module. If a record
+    from the AnalysisDatabase is given, the tables are rebuilt from it
+    without any analysis.
+*/
 class JumpTablePass : public ChunkPass {
 private:
     Module *module;
+    ModuleAnalysisRecord *record;
     std::map<address_t, JumpTable *> tableMap;
 public:
-    JumpTablePass(Module *module = nullptr) : module(module) {}
+    JumpTablePass(Module *module = nullptr,
+        ModuleAnalysisRecord *record = nullptr)
+        : module(module), record(record) {}
     virtual void visit(Module *module);
     virtual void visit(JumpTableList *jumpTableList);
 
@@ -22,8 +31,8 @@ public:
 private:
     void makeJumpTable(JumpTableList *jumpTableList,
         const std::vector<JumpTableDescriptor *> &tables);
-    void saveToFile() const;
-    bool loadFromFile(JumpTableList *jumpTableList);
+    void dumpStatistics(const JumptableDetection::Statistics &stats) const;
+    void loadFromRecord(JumpTableList *jumpTableList);
 };
 
 #endif
@@ -0,0 +1,309 @@
+#include <set>
+#include <capstone/x86.h>
+#include "jumpthread.h"
+#include "promotejumps.h"
+#include "analysis/manager.h"
+#include "chunk/concrete.h"
+#include "chunk/jumptable.h"
+#include "disasm/disassemble.h"
+#include "instr/concrete.h"
+#include "operation/mutator.h"
+
+#include "log/log.h"
+
+void JumpThreadPass::visit(Module *module) {
+    jumpTableMap.clear();
+    if(auto jumpTableList = module->getJumpTableList()) {
+        for(auto jumpTable : CIter::children(jumpTableList)) {
+            // without a bound there may be entries we do not know about
+            if(jumpTable->getEntryCount() < 0) continue;
+            jumpTableMap[jumpTable->getFunction()].push_back(jumpTable);
+        }
+    }
+
+    size_t threaded = threadedCount;
+    size_t duplicated = duplicatedCount;
+    size_t added = addedBytes;
+    recurse(module->getFunctionList());
+
+    LOG(1, "threaded " << std::dec << (threadedCount - threaded)
+        << " jumps and duplicated " << (duplicatedCount - duplicated)
+        << " tail blocks (+" << (addedBytes - added) << " bytes) in ["
+        << module->getName() << "]");
+}
+
+void JumpThreadPass::visit(Function *function) {
+#ifdef ARCH_X86_64
+    if(function->getCache()) return;
+
+    bool changed = threadJumps(function);
+    if(duplicateTails(function)) changed = true;
+
+    if(changed) AnalysisManager::getInstance()->invalidate(function);
+#endif
+}
+
+#ifdef ARCH_X86_64
+static Instruction *getTargetInstruction(Link *link) {
+    if(!dynamic_cast<NormalLink *>(link) || !link->getTarget()) return nullptr;
+
+    auto target = &*link->getTarget();
+    if(auto block = dynamic_cast<Block *>(target)) {
+        return block->getChildren()->getIterable()->get(0);
+    }
+    return dynamic_cast<Instruction *>(target);
+}
+
+// only jumps to the start of a block
+static Block *getTargetBlock(Link *link) {
+    auto instr = getTargetInstruction(link);
+    if(!instr) return nullptr;
+
+    auto block = dynamic_cast<Block *>(instr->getParent());
+    if(block && block->getChildren()->getIterable()->get(0) != instr) {
+        return nullptr;
+    }
+    return block;
+}
+
+static ControlFlowInstruction *getJump(Instruction *instr) {
+    auto cfi = dynamic_cast<ControlFlowInstruction *>(instr->getSemantic());
+    return (cfi && cfi->getMnemonic() == "jmp") ? cfi : nullptr;
+}
+
+// where a block consisting of a single jmp goes, within function
+static Block *getTrampolineTarget(Function *function, Block *block) {
+    auto list = block->getChildren()->getIterable();
+    if(list->getCount() != 1) return nullptr;
+
+    auto cfi = getJump(list->get(0));
+    if(!cfi) return nullptr;
+    auto target = getTargetBlock(cfi->getLink());
+    if(!target || target->getParent() != function) return nullptr;
+    return target;
+}
+
+// the opcode must be a plain short or near form, which we can rewrite
+static bool canRetarget(ControlFlowInstruction *cfi) {
+    if(cfi->getMnemonic() == "callq") return false;
+    auto wider = PromoteJumpsPass::getWiderOpcode(cfi->getId());
+    if(wider.empty()) return false;
+
+    switch(cfi->getDisplacementSize()) {
+    case 1:  return cfi->getOpcode().size() == 1;
+    case 4:  return cfi->getOpcode() == wider;
+    default: return false;
+    }
+}
+
+// the new target may be too far away for a rel8
+static void widen(Instruction *instr, ControlFlowInstruction *cfi) {
+    size_t oldSize = cfi->getSize();
+    cfi->setOpcode(PromoteJumpsPass::getWiderOpcode(cfi->getId()));
+    cfi->setDisplacementSize(4);
+
+    ChunkMutator(instr->getParent())
+        .modifiedChildSize(instr, cfi->getSize() - oldSize);
+}
+
+// an unlinked RIP-relative operand would refer elsewhere once copied
+static bool usesRIP(Assembly *assembly) {
+    auto asmOps = assembly->getAsmOperands();
+    for(size_t i = 0; i < asmOps->getOpCount(); i ++) {
+        auto &op = asmOps->getOperands()[i];
+        if(op.type == X86_OP_MEM && op.mem.base == X86_REG_RIP) return true;
+    }
+    return false;
+}
+
+static Instruction *copyInstruction(Instruction *instr) {
+    auto semantic = instr->getSemantic();
+    if(auto cfi = dynamic_cast<ControlFlowInstruction *>(semantic)) {
+        auto link = cfi->getLink();
+        auto copy = new Instruction();
+        auto copySemantic = new ControlFlowInstruction(
+            X86_INS_JMP, copy, "\xe9", "jmp", 4);
+        copySemantic->setLink(
+            new NormalLink(&*link->getTarget(), link->getScope()));
+        copy->setSemantic(copySemantic);
+        return copy;
+    }
+
+    auto assembly = semantic->getAssembly();
+    std::vector<unsigned char> bytes(assembly->getBytes(),
+        assembly->getBytes() + assembly->getSize());
+    return Disassemble::instruction(bytes);
+}
+#endif
+
+Instruction *JumpThreadPass::getFinalTarget(Function *function,
+    Instruction *target) {
+
+#ifdef ARCH_X86_64
+    if(!target) return nullptr;
+    auto block = dynamic_cast<Block *>(target->getParent());
+    if(!block || block->getParent() != function) return nullptr;
+    if(block->getChildren()->getIterable()->get(0) != target) return nullptr;
+
+    std::set<Block *> seen{block};
+    Block *final = nullptr;
+    while(auto next = getTrampolineTarget(function, block)) {
+        // a cycle of jumps, leave it alone
+        if(seen.count(next)) return nullptr;
+        seen.insert(next);
+        block = final = next;
+    }
+    return final ? final->getChildren()->getIterable()->get(0) : nullptr;
+#else
+    return nullptr;
+#endif
+}
+
+bool JumpThreadPass::threadJumps(Function *function) {
+#ifdef ARCH_X86_64
+    size_t count = 0;
+    for(auto block : CIter::children(function)) {
+        for(auto instr : CIter::children(block)) {
+            auto cfi = dynamic_cast<ControlFlowInstruction *>(
+                instr->getSemantic());
+            if(!cfi || !canRetarget(cfi)) continue;
+
+            auto link = cfi->getLink();
+            auto final = getFinalTarget(function, getTargetInstruction(link));
+            if(!final) continue;
+
+            LOG(10, "thread jump at 0x" << std::hex << instr->getAddress()
+                << " to 0x" << final->getAddress());
+            cfi->setLink(new NormalLink(final, Link::SCOPE_INTERNAL_JUMP));
+            delete link;
+            if(cfi->getDisplacementSize() == 1) widen(instr, cfi);
+            count ++;
+        }
+    }
+
+    auto it = jumpTableMap.find(function);
+    if(it != jumpTableMap.end()) {
+        for(auto jumpTable : (*it).second) {
+            for(auto entry : CIter::children(jumpTable)) {
+                auto link = entry->getLink();
+                auto final = getFinalTarget(function,
+                    getTargetInstruction(link));
+                if(!final) continue;
+
+                entry->setLink(new NormalLink(final,
+                    Link::SCOPE_WITHIN_MODULE));
+                delete link;
+                count ++;
+            }
+        }
+    }
+
+    threadedCount += count;
+    return count > 0;
+#else
+    return false;
+#endif
+}
+
+bool JumpThreadPass::duplicateTails(Function *function) {
+#ifdef ARCH_X86_64
+    long budget = function->getSize() * growthPercent / 100;
+    if(budget < static_cast<long>(maxTailSize)) budget = maxTailSize;
+
+    // duplicating changes the block sizes, but not the list of blocks
+    std::vector<Block *> blockList;
+    for(auto block : CIter::children(function)) blockList.push_back(block);
+
+    long added = 0;
+    size_t count = 0;
+    for(auto block : blockList) {
+        auto last = block->getChildren()->getIterable()->getLast();
+        auto cfi = getJump(last);
+        if(!cfi) continue;
+        auto tail = getTargetBlock(cfi->getLink());
+        if(!tail || !canDuplicate(function, block, tail)) continue;
+
+        long growth = static_cast<long>(tail->getSize())
+            - static_cast<long>(cfi->getSize());
+        if(added + growth > budget) continue;
+
+        LOG(10, "duplicate block at 0x" << std::hex << tail->getAddress()
+            << " into 0x" << block->getAddress());
+        duplicate(block, tail);
+        added += growth;
+        count ++;
+    }
+
+    duplicatedCount += count;
+    if(added > 0) addedBytes += added;
+    return count > 0;
+#else
+    return false;
+#endif
+}
+
+bool JumpThreadPass::canDuplicate(Function *function, Block *block,
+    Block *tail) {
+
+#ifdef ARCH_X86_64
+    if(tail == block || tail->getParent() != function) return false;
+    if(tail->getSize() > maxTailSize) return false;
+
+    // anything with a link or that transfers control is left where it is
+    auto list = tail->getChildren()->getIterable();
+    size_t count = list->getCount();
+    for(size_t i = 0; i + 1 < count; i ++) {
+        auto semantic = list->get(i)->getSemantic();
+        if(!dynamic_cast<IsolatedInstruction *>(semantic)) return false;
+        if(semantic->isControlFlow()) return false;
+        if(dynamic_cast<BreakInstruction *>(semantic)) return false;
+        auto assembly = semantic->getAssembly();
+        if(!assembly || usesRIP(&*assembly)) return false;
+    }
+
+    auto semantic = list->getLast()->getSemantic();
+    if(dynamic_cast<ReturnInstruction *>(semantic)) {
+        return semantic->getAssembly() != nullptr;
+    }
+    auto cfi = getJump(list->getLast());
+    return cfi && dynamic_cast<NormalLink *>(cfi->getLink())
+        && cfi->getLink()->getTarget();
+#else
+    return false;
+#endif
+}
+
+void JumpThreadPass::duplicate(Block *block, Block *tail) {
+#ifdef ARCH_X86_64
+    auto jump = block->getChildren()->getIterable()->getLast();
+    auto oldSemantic = jump->getSemantic();
+    auto oldLink = oldSemantic->getLink();
+
+    std::vector<Instruction *> copyList;
+    for(auto instr : CIter::children(tail)) {
+        copyList.push_back(copyInstruction(instr));
+    }
+
+    // the jump keeps its Instruction, since links may point at it
+    auto first = copyList[0];
+    auto semantic = first->getSemantic();
+    jump->setSemantic(semantic);
+    if(auto cfi = dynamic_cast<ControlFlowInstruction *>(semantic)) {
+        cfi->setSource(jump);
+    }
+    ChunkMutator(block).modifiedChildSize(jump,
+        static_cast<int>(semantic->getSize())
+        - static_cast<int>(oldSemantic->getSize()));
+    first->setSemantic(nullptr);
+    delete first;
+    delete oldLink;
+    delete oldSemantic;
+
+    ChunkMutator mutator(block);
+    Instruction *prev = jump;
+    for(size_t i = 1; i < copyList.size(); i ++) {
+        mutator.insertAfter(prev, copyList[i]);
+        prev = copyList[i];
+    }
+#endif
+}
@@ -0,0 +1,56 @@
+#ifndef EGALITO_PASS_JUMP_THREAD_H
+#define EGALITO_PASS_JUMP_THREAD_H
+
+#include <map>
+#include <vector>
+#include "chunkpass.h"
+
+/** Removes jumps left behind by block layout, splitting and debloating.
+
+    Jump threading: a jmp or jcc, or a jump table entry, that targets a
+    block consisting of a single jmp is pointed at that jmp's final target
+    instead, following chains of such blocks.
+
+    Tail duplication: a block that ends in a jmp to a small block that
+    ends in a ret or jmp gets a copy of that block in place of the jmp,
+    so the path through them runs straight. Only plain instructions are
+    copied. The bytes added to each function are limited to growthPercent
+    of its size, but at least one copy of maxTailSize bytes is allowed.
+
+    Both only consider targets within the same function, so the cold parts
+    made by BlockReorderPass or SplitFunction are threaded separately.
+    Blocks are never removed, since one that is no longer jumped to may
+    still be a landing pad. Functions with a ChunkCache are skipped.
+
+    This whole pass is x86_64-specific.
+*/
+class JumpThreadPass : public ChunkPass {
+private:
+    size_t maxTailSize;
+    unsigned growthPercent;
+    std::map<Function *, std::vector<JumpTable *>> jumpTableMap;
+    size_t threadedCount;
+    size_t duplicatedCount;
+    size_t addedBytes;
+public:
+    JumpThreadPass(size_t maxTailSize = 16, unsigned growthPercent = 5)
+        : maxTailSize(maxTailSize), growthPercent(growthPercent),
+        threadedCount(0), duplicatedCount(0), addedBytes(0) {}
+
+    /** Jumps and jump table entries that now skip at least one block. */
+    size_t getThreadedCount() const { return threadedCount; }
+    /** Blocks copied in place of a jump, and the bytes this added. */
+    size_t getDuplicatedCount() const { return duplicatedCount; }
+    size_t getAddedBytes() const { return addedBytes; }
+
+    virtual void visit(Module *module);
+    virtual void visit(Function *function);
+private:
+    bool threadJumps(Function *function);
+    bool duplicateTails(Function *function);
+    Instruction *getFinalTarget(Function *function, Instruction *target);
+    bool canDuplicate(Function *function, Block *block, Block *tail);
+    void duplicate(Block *block, Block *tail);
+};
+
+#endif
@@ -1,10 +1,15 @@
 #include "nonreturn.h"
+#include "analysis/compactcallgraph.h"
 #include "analysis/controlflow.h"
 #include "analysis/dominance.h"
+#include "analysis/manager.h"
 #include "analysis/usedef.h"
 #include "analysis/usedefutil.h"
 #include "analysis/walker.h"
+#include "archive/analysisdb.h"
 #include "chunk/concrete.h"
+#include "chunk/library.h"
+#include "elf/symbol.h"
 #ifdef ARCH_X86_64
     #include "instr/linked-x86_64.h"
 #endif
@@ -30,16 +35,112 @@ const std::vector<std::string> NonReturnFunction::knownList = {
     "_ZSt24__throw_invalid_argumentPKc"
 };
 
-void NonReturnFunction::visit(FunctionList *functionList) {
-    size_t size = 0;
+std::map<std::string, std::vector<std::string>>
+    NonReturnFunction::exportMap;
 
+void NonReturnFunction::visit(FunctionList *functionList) {
     //TemporaryLogLevel tll("pass", 10);
     //TemporaryLogLevel tll2("analysis", 10);
 
-    do {
-        size = nonReturnList.size();
-        recurse(functionList);
-    } while(size != nonReturnList.size());
+    auto module = dynamic_cast<Module *>(functionList->getParent());
+    collectExternal(module);
+
+    CompactCallGraph graph(module);
+    std::vector<bool> pending(graph.getCount(), changedList.empty());
+    for(auto function : changedList) {
+        auto id = graph.getID(function);
+        if(id != CompactCallGraph::INVALID_ID) pending[id] = true;
+    }
+
+    // SCCs are numbered bottom-up, so every callee outside the current SCC
+    // already has its final answer
+    for(size_t scc = 0; scc < graph.getSccCount(); scc ++) {
+        auto members = graph.getSccMembers(scc);
+        bool recursive = graph.isRecursive(scc);
+        bool changed;
+        do {
+            changed = false;
+            for(auto id : members) {
+                auto function = graph.getFunction(id);
+                if(!pending[id] || !function->returns()) continue;
+                pending[id] = false;
+
+                visit(function);
+                if(!function->returns()) {
+                    for(auto caller : graph.getCallers(id)) {
+                        pending[caller] = true;
+                    }
+                    changed = true;
+                }
+            }
+        } while(changed && recursive);
+    }
+
+    LOG(10, "found " << std::dec << nonReturnList.size()
+        << " non-returning functions");
+}
+
+void NonReturnFunction::publishExports(Module *module, Library *library,
+    bool save) {
+
+    if(!library || library->getResolvedPath().empty()) return;
+
+    std::vector<std::string> nameList;
+    for(auto function : CIter::functions(module)) {
+        if(function->returns()) continue;
+        auto symbol = function->getDynamicSymbol();
+        if(!symbol) continue;
+        nameList.push_back(symbol->getName());
+        for(auto alias : symbol->getAliases()) {
+            nameList.push_back(alias->getName());
+        }
+    }
+
+    exportMap[library->getResolvedPath()] = nameList;
+    if(save) {
+        AnalysisDatabase::getInstance()->saveNonReturnExports(
+            library->getResolvedPath(), nameList);
+    }
+}
+
+void NonReturnFunction::collectExternal(Module *module) {
+    externalList.clear();
+    externalList.insert(knownList.begin(), knownList.end());
+
+    if(!library && module) library = module->getLibrary();
+    if(!library) return;
+
+    for(auto dependency : library->getDependencies()) {
+        auto path = dependency->getResolvedPath();
+        auto it = exportMap.find(path);
+        if(it == exportMap.end()) {
+            std::vector<std::string> nameList;
+            if(!AnalysisDatabase::getInstance()->loadNonReturnExports(
+                path, nameList)) {
+
+                continue;  // parsed later; only knownList applies
+            }
+            it = exportMap.emplace(path, nameList).first;
+        }
+        externalList.insert(it->second.begin(), it->second.end());
+    }
+}
+
+uint64_t NonReturnFunction::fingerprintExternal(Module *module,
+    Library *library) {
+
+    NonReturnFunction pass(library);
+    pass.collectExternal(module);
+
+    // 64-bit FNV-1a over the sorted names, each with its terminator
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for(const auto &name : pass.externalList) {
+        for(size_t i = 0; i <= name.length(); i ++) {
+            hash ^= static_cast<unsigned char>(name.c_str()[i]);
+            hash *= 0x100000001b3ull;
+        }
+    }
+    return hash;
 }
 
 // Since Dominance requires an exit node to be spotted in the control flow
@@ -62,6 +163,7 @@ void NonReturnFunction::visit(Function *function) {
                     LOG(10, "non-returning call at "
                         << std::hex << instr->getAddress());
                     cfi->setNonreturn();
+                    AnalysisManager::getInstance()->invalidate(function);
                     continue;
                 }
 
@@ -73,33 +175,30 @@ void NonReturnFunction::visit(Function *function) {
     }
 
     if(!GNUErrorCalls.empty()) {
-        ControlFlowGraph cfg(function);
-        UDConfiguration config(&cfg);
-        UDRegMemWorkingSet working(function, &cfg);
-        UseDef usedef(&config, &working);
-
-        SccOrder order(&cfg);
-        order.genFull(0);
-        usedef.analyze(order.get());
+        auto working = AnalysisManager::getInstance()->getUseDef(function);
 
+        bool changed = false;
         for(auto instr : GNUErrorCalls) {
             bool found;
             int value;
-            std::tie(found, value) = getArg0Value(working.getState(instr));
+            std::tie(found, value) = getArg0Value(working->getState(instr));
             if(found && value != 0) {
                 LOG(10, "non-returning call at "
                     << std::hex << instr->getAddress());
                 auto cfi = dynamic_cast<ControlFlowInstruction *>(
                     instr->getSemantic());
                 cfi->setNonreturn();
+                changed = true;
             }
         }
+        if(changed) AnalysisManager::getInstance()->invalidate(function);
     }
 
     // step-2
     if(neverReturns(function)) {
         LOG(10, "=== " << function->getName() << " never returns");
         function->setNonreturn();
+        AnalysisManager::getInstance()->invalidate(function);
         nonReturnList.insert(function);
     }
 }
@@ -107,13 +206,18 @@ void NonReturnFunction::visit(Function *function) {
 bool NonReturnFunction::neverReturns(Function *function) {
     ControlFlowGraph *cfg = nullptr;
     Dominance *dom = nullptr;
+    // the CFG only changes when one of our calls is marked non-returning,
+    // so the cached graph survives most fixpoint iterations
     for(auto block : CIter::children(function)) {
         for(auto instr : CIter::children(block)) {
             if(auto cfi = dynamic_cast<ControlFlowInstruction *>(
                 instr->getSemantic())) {
 
                 if(!cfi->returns()) {
-                    if(!cfg) cfg = new ControlFlowGraph(function);
+                    if(!cfg) {
+                        cfg = AnalysisManager::getInstance()
+                            ->getControlFlowGraph(function);
+                    }
                     //ControlFlowGraph cfg(function);
                     LOG(11, "--Function " << function->getName());
                     IF_LOG(11) {
@@ -131,14 +235,12 @@ bool NonReturnFunction::neverReturns(Function *function) {
                         continue;
                     }
 
-                    delete cfg;
                     delete dom;
                     return true;
                 }
             }
         }
     }
-    delete cfg;
     delete dom;
     return false;
 }
@@ -147,17 +249,12 @@ bool NonReturnFunction::hasLinkToNeverReturn(ControlFlowInstruction *cfi) {
     if(auto pltLink = dynamic_cast<PLTLink *>(cfi->getLink())) {
         auto trampoline = pltLink->getPLTTrampoline();
         auto pltName = trampoline->getExternalSymbol()->getName();
-        for(auto name : knownList) {
-            if(pltName == name) {
-                return true;
-            }
-        }
+        return externalList.count(pltName) > 0;
     }
     else if(auto target = dynamic_cast<Function *>(
         &*cfi->getLink()->getTarget())) {
 
         if(!target->returns()) return true;
-        if(inList(target)) return true;
         for(auto name : knownList) {
             if(target->hasName(name)) return true;
         }
@@ -203,12 +300,3 @@ std::tuple<bool, int> NonReturnFunction::getArg0Value(UDState *state) {
     return std::make_tuple(found, value);
 
 }
-
-bool NonReturnFunction::inList(Function *function) {
-    if(std::find(nonReturnList.begin(), nonReturnList.end(), function)
-        != nonReturnList.end()) {
-
-        return true;
-    }
-    return false;
-}
@@ -2,24 +2,61 @@
 #define EGALITO_PASS_NONRETURN_H
 
 #include <set>
+#include <map>
+#include <string>
 #include "chunkpass.h"
 
 class ControlFlowInstruction;
 class UDState;
+class Library;
 
+/** Finds functions that never return, and calls (including tail calls) to
+    them. Functions are solved bottom-up over a CompactCallGraph of the
+    module, iterating only within recursive SCCs, so a single run reaches
+    the fixpoint.
+
+    Calls through the PLT are resolved by name: against knownList, and
+    against the non-returning exports of the library's dependencies that
+    have already been parsed in this process or saved to the
+    AnalysisDatabase by an earlier run.
+*/
 class NonReturnFunction : public ChunkPass {
 private:
     const static std::vector<std::string> knownList;
-    std::set<Function *> nonReturnList;
+    // non-returning exports, by library path
+    static std::map<std::string, std::vector<std::string>> exportMap;
 
+    Library *library;
+    std::set<Function *> changedList;
+    std::set<std::string> externalList;
+    std::set<Function *> nonReturnList;
 public:
-    NonReturnFunction() {}
+    NonReturnFunction(Library *library = nullptr) : library(library) {}
+    /** Only re-solves changedList (e.g. functions whose CFG gained edges)
+        and the callers of anything that turns out not to return.
+    */
+    NonReturnFunction(Library *library,
+        const std::set<Function *> &changedList)
+        : library(library), changedList(changedList) {}
+
+    virtual PreservedAnalyses getPreservedAnalyses() const
+        { return PreservedAnalyses::all(); }  // invalidates what it changes
     virtual void visit(FunctionList *functionList);
     virtual void visit(Function *function);
+
+    /** A hash of the external names that would be treated as
+        non-returning for module, i.e. knownList and the exports of its
+        dependencies. It changes when a dependency does.
+    */
+    static uint64_t fingerprintExternal(Module *module, Library *library);
+
+    /** Makes module's non-returning exports visible to later modules. */
+    static void publishExports(Module *module, Library *library,
+        bool save = true);
 private:
+    void collectExternal(Module *module);
     bool neverReturns(Function *function);
     bool hasLinkToNeverReturn(ControlFlowInstruction *cfi);
-    bool inList(Function *function);
 
     bool hasLinkToGNUError(ControlFlowInstruction *cfi);
     std::tuple<bool, int> getArg0Value(UDState *state);
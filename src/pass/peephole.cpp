@@ -0,0 +1,473 @@
+#include <algorithm>
+#include <ostream>
+#include <iomanip>
+#include "peephole.h"
+#include "analysis/liveness.h"
+#include "analysis/manager.h"
+#include "chunk/concrete.h"
+#include "disasm/disassemble.h"
+#include "instr/concrete.h"
+#include "instr/register.h"
+#include "operation/mutator.h"
+
+#include "log/log.h"
+
+// how far apart a push and its pop may be
+#define PUSH_POP_WINDOW 8
+
+// tried in this order at each instruction
+const PeepholePass::Pattern PeepholePass::patternList[] = {
+#ifdef ARCH_X86_64
+    {"push-pop",        &PeepholePass::removePushPop},
+    {"move-back",       &PeepholePass::removeMoveBack},
+    {"move-chain",      &PeepholePass::removeMoveChain},
+#endif
+    {"self-move",       &PeepholePass::removeSelfMove},
+    {"jump-to-next",    &PeepholePass::removeJumpToNext},
+    {"dead-move",       &PeepholePass::removeDeadMove},
+};
+
+size_t PeepholePass::getTotalCount() const {
+    size_t total = 0;
+    for(const auto &kv : countMap) total += kv.second;
+    return total;
+}
+
+void PeepholePass::printReport(std::ostream &stream) const {
+    for(const auto &kv : countMap) {
+        stream << std::setw(8) << std::dec << kv.second
+            << "  " << kv.first << "\n";
+    }
+    stream << "peephole: eliminated " << getTotalCount() << " instructions\n";
+}
+
+void PeepholePass::visit(Module *module) {
+    size_t before = getTotalCount();
+    recurse(module->getFunctionList());
+    LOG(1, "peephole: eliminated " << (getTotalCount() - before)
+        << " instructions in [" << module->getName() << "]");
+}
+
+void PeepholePass::visit(Function *function) {
+    if(function->getCache()) return;
+
+    liveness = AnalysisManager::getInstance()->getLiveness(function);
+    findTargets(function);
+
+    for(auto block : CIter::children(function)) {
+        auto list = block->getChildren()->getIterable();
+        // every match eliminates an instruction, so this terminates; back
+        // up after one, since it may complete a pattern that starts earlier
+        for(size_t i = 0; i < list->getCount(); ) {
+            size_t eliminated = 0;
+            for(const auto &pattern : patternList) {
+                eliminated = (this->*pattern.apply)(block, i);
+                if(eliminated) {
+                    LOG(10, "peephole: " << pattern.name << " in ["
+                        << function->getName() << "]");
+                    countMap[pattern.name] += eliminated;
+                    break;
+                }
+            }
+            if(!eliminated) i ++;
+            else i = (i > PUSH_POP_WINDOW) ? i - PUSH_POP_WINDOW : 0;
+        }
+    }
+
+    liveness = nullptr;
+    targetSet.clear();
+}
+
+void PeepholePass::findTargets(Function *function) {
+    targetSet.clear();
+    for(auto block : CIter::children(function)) {
+        for(auto instr : CIter::children(block)) {
+            auto link = instr->getSemantic()->getLink();
+            if(!link || !link->getTarget()) continue;
+
+            auto target = &*link->getTarget();
+            if(auto targetBlock = dynamic_cast<Block *>(target)) {
+                auto children = targetBlock->getChildren()->getIterable();
+                if(children->getCount() == 0) continue;
+                target = children->get(0);
+            }
+            if(auto targetInstr = dynamic_cast<Instruction *>(target)) {
+                targetSet.insert(targetInstr);
+            }
+        }
+    }
+}
+
+bool PeepholePass::canRemove(Block *block, size_t index) {
+    auto list = block->getChildren()->getIterable();
+    auto instr = list->get(index);
+    if(index > 0 && !targetSet.count(instr)) return true;
+
+    // the next instruction's semantic would be moved into this one
+    return index + 1 < list->getCount()
+        && !targetSet.count(list->get(index + 1));
+}
+
+void PeepholePass::remove(Block *block, size_t index) {
+    auto list = block->getChildren()->getIterable();
+    auto instr = list->get(index);
+    if(index > 0 && !targetSet.count(instr)) {
+        ChunkMutator(block).remove(instr);
+        delete instr->getSemantic();
+        delete instr;
+        return;
+    }
+
+    // keep the instruction object that links point at
+    auto next = list->get(index + 1);
+    auto oldSemantic = instr->getSemantic();
+    auto semantic = next->getSemantic();
+    ChunkMutator(block).remove(next);
+    instr->setSemantic(semantic);
+#ifdef ARCH_X86_64
+    if(auto linked = dynamic_cast<LinkedInstructionBase *>(semantic)) {
+        linked->setInstruction(instr);
+    }
+    if(auto linked = dynamic_cast<ControlFlowInstructionBase *>(semantic)) {
+        linked->setSource(instr);
+    }
+#else
+    if(auto linked = dynamic_cast<LinkedInstruction *>(semantic)) {
+        linked->setInstruction(instr);
+    }
+#endif
+    ChunkMutator(block).modifiedChildSize(instr,
+        static_cast<int>(semantic->getSize())
+            - static_cast<int>(oldSemantic->getSize()));
+    AnalysisManager::getInstance()->notifyModified(instr);
+
+    delete oldSemantic;
+    delete next;
+}
+
+bool PeepholePass::isDeadAfter(Instruction *instruction, int reg) {
+    int index = RegisterBitVector::getIndex(reg);
+    if(index < 0) return false;
+    if(RegisterBitVector::stackPointer().get(index)) return false;
+    return !liveness->getLiveAfter(instruction).get(index);
+}
+
+// a whole 64-bit general-purpose register
+static bool isFullRegister(Register reg) {
+#ifdef ARCH_X86_64
+    int pid = X86Register::convertToPhysical(reg);
+    return X86Register::isInteger(pid) && X86Register::getWidth(pid, reg) == 8;
+#elif defined(ARCH_AARCH64)
+    if(reg == ARM64_REG_XZR) return false;
+    int pid = AARCH64GPRegister::convertToPhysical(reg);
+    return AARCH64GPRegister::isInteger(pid)
+        && AARCH64GPRegister::getWidth(pid, reg) == 8;
+#else
+    return false;
+#endif
+}
+
+// mov %src,%dst between whole 64-bit registers
+static bool getRegisterMove(Instruction *instr, Register *src,
+    Register *dst) {
+
+    if(!dynamic_cast<IsolatedInstruction *>(instr->getSemantic())) {
+        return false;
+    }
+    auto assembly = instr->getSemantic()->getAssembly();
+    if(!assembly) return false;
+    auto asmOps = assembly->getAsmOperands();
+    if(asmOps->getOpCount() != 2) return false;
+
+#ifdef ARCH_X86_64
+    auto &from = asmOps->getOperands()[0];
+    auto &to = asmOps->getOperands()[1];
+    if(assembly->getId() != X86_INS_MOV) return false;
+    if(from.type != X86_OP_REG || to.type != X86_OP_REG) return false;
+#elif defined(ARCH_AARCH64)
+    auto &to = asmOps->getOperands()[0];
+    auto &from = asmOps->getOperands()[1];
+    if(assembly->getId() != ARM64_INS_MOV) return false;
+    if(from.type != ARM64_OP_REG || to.type != ARM64_OP_REG) return false;
+#else
+    return false;
+#endif
+    *src = static_cast<Register>(from.reg);
+    *dst = static_cast<Register>(to.reg);
+    return isFullRegister(*src) && isFullRegister(*dst);
+}
+
+// the register written by a move with no other effect, or INVALID_REGISTER
+static Register getMoveDestination(Instruction *instr) {
+    auto semantic = instr->getSemantic();
+    if(!dynamic_cast<IsolatedInstruction *>(semantic)
+        && !dynamic_cast<LinkedInstruction *>(semantic)) {
+
+        return INVALID_REGISTER;
+    }
+    auto assembly = semantic->getAssembly();
+    if(!assembly) return INVALID_REGISTER;
+    auto asmOps = assembly->getAsmOperands();
+    if(asmOps->getOpCount() != 2) return INVALID_REGISTER;
+
+#ifdef ARCH_X86_64
+    auto &from = asmOps->getOperands()[0];
+    auto &to = asmOps->getOperands()[1];
+    switch(assembly->getId()) {
+    case X86_INS_LEA:
+        break;
+    case X86_INS_MOV:
+    case X86_INS_MOVABS:
+    case X86_INS_MOVZX:
+    case X86_INS_MOVSX:
+    case X86_INS_MOVSXD:
+        // a load may fault, so it is not free to drop
+        if(from.type == X86_OP_MEM) return INVALID_REGISTER;
+        break;
+    default:
+        return INVALID_REGISTER;
+    }
+    if(to.type != X86_OP_REG) return INVALID_REGISTER;
+    if(!X86Register::isInteger(X86Register::convertToPhysical(to.reg))) {
+        return INVALID_REGISTER;
+    }
+    return to.reg;
+#elif defined(ARCH_AARCH64)
+    auto &to = asmOps->getOperands()[0];
+    switch(assembly->getId()) {
+    case ARM64_INS_MOV:
+    case ARM64_INS_MOVZ:
+        break;
+    default:
+        return INVALID_REGISTER;
+    }
+    if(to.type != ARM64_OP_REG || to.reg == ARM64_REG_XZR
+        || to.reg == ARM64_REG_WZR) {
+
+        return INVALID_REGISTER;
+    }
+    if(!AARCH64GPRegister::isInteger(
+        AARCH64GPRegister::convertToPhysical(to.reg))) {
+
+        return INVALID_REGISTER;
+    }
+    return static_cast<Register>(to.reg);
+#else
+    return INVALID_REGISTER;
+#endif
+}
+
+#ifdef ARCH_X86_64
+// push %reg or pop %reg on a whole register
+static Register getStackRegister(Instruction *instr, unsigned int id) {
+    if(!dynamic_cast<IsolatedInstruction *>(instr->getSemantic())) {
+        return INVALID_REGISTER;
+    }
+    auto assembly = instr->getSemantic()->getAssembly();
+    if(!assembly || assembly->getId() != id) return INVALID_REGISTER;
+    auto asmOps = assembly->getAsmOperands();
+    if(asmOps->getOpCount() != 1) return INVALID_REGISTER;
+    auto &op = asmOps->getOperands()[0];
+    if(op.type != X86_OP_REG || !isFullRegister(op.reg)) {
+        return INVALID_REGISTER;
+    }
+    return op.reg;
+}
+
+// in AT&T order the destination is the last operand
+static bool writesMemory(Assembly *assembly) {
+    auto asmOps = assembly->getAsmOperands();
+    size_t count = asmOps->getOpCount();
+    if(count == 0) return false;
+
+    switch(assembly->getId()) {
+    case X86_INS_CMP:
+    case X86_INS_TEST:
+    case X86_INS_BT:
+        return false;
+    default:
+        return asmOps->getOperands()[count - 1].type == X86_OP_MEM;
+    }
+}
+
+// replaces the semantic of instr with mov %src,%dst
+static void setRegisterMove(Instruction *instr, Register src, Register dst) {
+    int s = X86Register::convertToPhysical(src);
+    int d = X86Register::convertToPhysical(dst);
+    std::vector<unsigned char> bytes = {
+        static_cast<unsigned char>(0x48 | (s >= 8 ? 0x4 : 0) | (d >= 8 ? 0x1 : 0)),
+        0x89,
+        static_cast<unsigned char>(0xc0 | ((s & 7) << 3) | (d & 7))
+    };
+
+    DisasmHandle handle(true);
+    auto semantic = new IsolatedInstruction();
+    semantic->setAssembly(DisassembleInstruction(handle).makeAssemblyPtr(bytes));
+
+    auto oldSemantic = instr->getSemantic();
+    instr->setSemantic(semantic);
+    ChunkMutator(instr->getParent()).modifiedChildSize(instr,
+        static_cast<int>(semantic->getSize())
+            - static_cast<int>(oldSemantic->getSize()));
+    AnalysisManager::getInstance()->notifyModified(instr);
+    delete oldSemantic;
+}
+#endif
+
+size_t PeepholePass::removePushPop(Block *block, size_t index) {
+#ifdef ARCH_X86_64
+    auto list = block->getChildren()->getIterable();
+    auto push = list->get(index);
+    auto reg = getStackRegister(push, X86_INS_PUSH);
+    if(reg == INVALID_REGISTER) return 0;
+    int regIndex = RegisterBitVector::getIndex(reg);
+    auto stackPointer = RegisterBitVector::stackPointer();
+
+    bool clobbered = false;
+    bool memoryWritten = false;
+    size_t end = std::min(list->getCount(), index + 2 + PUSH_POP_WINDOW);
+    for(size_t i = index + 1; i < end; i ++) {
+        auto instr = list->get(i);
+        if(getStackRegister(instr, X86_INS_POP) == reg) {
+            if((clobbered || memoryWritten) && !isDeadAfter(instr, reg)) {
+                return 0;
+            }
+
+            // the pop goes first; then the push's successor is the one after
+            if(targetSet.count(instr)) return 0;
+            if(index == 0 || targetSet.count(push)) {
+                size_t after = (i == index + 1) ? i + 1 : index + 1;
+                if(after >= list->getCount()) return 0;
+                if(targetSet.count(list->get(after))) return 0;
+            }
+            remove(block, i);
+            remove(block, index);
+            return 2;
+        }
+
+        // only straight-line code that leaves the stack alone
+        auto semantic = instr->getSemantic();
+        if(!dynamic_cast<IsolatedInstruction *>(semantic)
+            && !dynamic_cast<LinkedInstruction *>(semantic)) return 0;
+        auto assembly = semantic->getAssembly();
+        if(!assembly) return 0;
+
+        RegisterAccess access(instr);
+        auto touched = access.getUse();
+        touched |= access.getDef();
+        touched &= stackPointer;
+        if(!touched.empty()) return 0;
+
+        if(access.getDef().get(regIndex)) clobbered = true;
+        if(writesMemory(&*assembly)) memoryWritten = true;
+    }
+#endif
+    return 0;
+}
+
+size_t PeepholePass::removeMoveBack(Block *block, size_t index) {
+#ifdef ARCH_X86_64
+    auto list = block->getChildren()->getIterable();
+    if(index + 1 >= list->getCount()) return 0;
+
+    Register a, b, c, d;
+    if(!getRegisterMove(list->get(index), &a, &b) || a == b) return 0;
+    if(!getRegisterMove(list->get(index + 1), &c, &d)) return 0;
+    if(c != b || d != a) return 0;
+    if(!canRemove(block, index + 1)) return 0;
+
+    remove(block, index + 1);
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+size_t PeepholePass::removeMoveChain(Block *block, size_t index) {
+#ifdef ARCH_X86_64
+    auto list = block->getChildren()->getIterable();
+    if(index + 1 >= list->getCount()) return 0;
+
+    Register a, b, c, d;
+    auto second = list->get(index + 1);
+    if(!getRegisterMove(list->get(index), &a, &b) || a == b) return 0;
+    if(!getRegisterMove(second, &c, &d) || c != b) return 0;
+    if(d == a || d == b) return 0;
+    if(!isDeadAfter(second, b)) return 0;
+    if(!canRemove(block, index + 1)) return 0;
+
+    setRegisterMove(list->get(index), a, d);
+    remove(block, index + 1);
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+size_t PeepholePass::removeSelfMove(Block *block, size_t index) {
+    auto list = block->getChildren()->getIterable();
+    Register src, dst;
+    if(!getRegisterMove(list->get(index), &src, &dst)) return 0;
+    if(src != dst || !canRemove(block, index)) return 0;
+
+    remove(block, index);
+    return 1;
+}
+
+static Block *getTargetBlock(Link *link) {
+    if(!link || !link->getTarget()) return nullptr;
+
+    auto target = &*link->getTarget();
+    if(auto block = dynamic_cast<Block *>(target)) return block;
+    auto instr = dynamic_cast<Instruction *>(target);
+    if(!instr) return nullptr;
+
+    // only jumps to the start of a block
+    auto block = dynamic_cast<Block *>(instr->getParent());
+    if(block && block->getChildren()->getIterable()->get(0) != instr) {
+        return nullptr;
+    }
+    return block;
+}
+
+// a direct jump, conditional or not, with no other effect
+static bool isPlainJump(ControlFlowInstruction *cfi) {
+#ifdef ARCH_X86_64
+    std::string mnemonic = cfi->getMnemonic();
+    return mnemonic != "callq" && mnemonic.compare(0, 4, "loop") != 0;
+#elif defined(ARCH_AARCH64)
+    std::string mnemonic = cfi->getAssembly()->getMnemonic();
+    return mnemonic == "b" || mnemonic.compare(0, 2, "b.") == 0
+        || mnemonic == "cbz" || mnemonic == "cbnz"
+        || mnemonic == "tbz" || mnemonic == "tbnz";
+#else
+    return false;
+#endif
+}
+
+size_t PeepholePass::removeJumpToNext(Block *block, size_t index) {
+    auto list = block->getChildren()->getIterable();
+    if(index + 1 != list->getCount()) return 0;
+
+    auto cfi = dynamic_cast<ControlFlowInstruction *>(
+        list->get(index)->getSemantic());
+    if(!cfi || !isPlainJump(cfi)) return 0;
+
+    auto next = dynamic_cast<Block *>(block->getNextSibling());
+    if(!next || getTargetBlock(cfi->getLink()) != next) return 0;
+    if(!canRemove(block, index)) return 0;
+
+    remove(block, index);
+    return 1;
+}
+
+size_t PeepholePass::removeDeadMove(Block *block, size_t index) {
+    auto list = block->getChildren()->getIterable();
+    auto instr = list->get(index);
+    auto reg = getMoveDestination(instr);
+    if(reg == INVALID_REGISTER || !isDeadAfter(instr, reg)) return 0;
+    if(!canRemove(block, index)) return 0;
+
+    remove(block, index);
+    return 1;
+}
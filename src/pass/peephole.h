@@ -0,0 +1,76 @@
+#ifndef EGALITO_PASS_PEEPHOLE_H
+#define EGALITO_PASS_PEEPHOLE_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <iosfwd>
+#include "chunkpass.h"
+
+class LivenessAnalysis;
+
+/** Removes redundant instructions left behind by instrumentation and other
+    rewriting passes, by matching a table of short, architecture-specific
+    patterns against the instructions of each block.
+
+    LivenessAnalysis decides whether a register is read again after a
+    pattern; between the two ends of a pattern, definitions and uses are
+    tracked within the block using RegisterAccess.
+
+        x86_64   push-pop      push %r ... pop %r, where the code between
+                               leaves %r, the stack and memory alone, or
+                               %r is dead after the pop
+                 move-back     mov %a,%b; mov %b,%a drops the second mov
+                 move-chain    mov %a,%b; mov %b,%c becomes mov %a,%c if %b
+                               is dead afterwards
+        both     self-move     mov %r,%r on a 64-bit register
+                 jump-to-next  a jump to the block that follows anyway
+                 dead-move     a move into a dead register
+
+    Since links may point at the first instruction of a block, or at any
+    instruction targeted by a link in the same function, those instruction
+    objects are never removed; the semantic of the following instruction is
+    moved into them instead. Functions with a ChunkCache are skipped.
+
+    Run this after instrumentation and before code generation.
+*/
+class PeepholePass : public ChunkPass {
+public:
+    typedef std::map<std::string, size_t> CountMap;
+private:
+    // returns the number of instructions eliminated at index
+    typedef size_t (PeepholePass::*PatternType)(Block *block, size_t index);
+    struct Pattern {
+        const char *name;
+        PatternType apply;
+    };
+    static const Pattern patternList[];
+private:
+    LivenessAnalysis *liveness;
+    std::set<Instruction *> targetSet;
+    CountMap countMap;
+public:
+    PeepholePass() : liveness(nullptr) {}
+
+    /** Instructions eliminated by each pattern, over all visited functions. */
+    const CountMap &getCountMap() const { return countMap; }
+    size_t getTotalCount() const;
+    void printReport(std::ostream &stream) const;
+
+    virtual void visit(Module *module);
+    virtual void visit(Function *function);
+private:
+    void findTargets(Function *function);
+    bool canRemove(Block *block, size_t index);
+    void remove(Block *block, size_t index);
+    bool isDeadAfter(Instruction *instruction, int reg);
+
+    size_t removePushPop(Block *block, size_t index);
+    size_t removeMoveBack(Block *block, size_t index);
+    size_t removeMoveChain(Block *block, size_t index);
+    size_t removeSelfMove(Block *block, size_t index);
+    size_t removeJumpToNext(Block *block, size_t index);
+    size_t removeDeadMove(Block *block, size_t index);
+};
+
+#endif
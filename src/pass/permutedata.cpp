@@ -141,17 +141,11 @@ void PermuteDataPass::visit(Module *module) {
         ranges.push_back(Range::fromEndpoints(prev, ds->getSize()));
     }
 
-    // generate random new layout
     newlayout.clear();
-    std::vector<Range> shuffle = ranges;
-    std::random_shuffle(shuffle.begin(), shuffle.end());
-    address_t lastend = 0;
-
-    for(auto nr : shuffle) {
-        address_t newend = lastend + nr.getSize();
-        newlayout[nr.getStart()] = Range::fromEndpoints(lastend, newend);
-        lastend = newend;
-    }
+    address_t newSize = accessMap.empty()
+        ? makeRandomLayout(ranges) : makeProfileLayout(ranges);
+    nds->setSize(newSize);
+    ndr->setSize(newSize);
 
     // step 5a: re-create all globalvariables in new datasection
     std::map<address_t, GlobalVariable *> newglobals;
@@ -251,21 +245,18 @@ void PermuteDataPass::visit(Module *module) {
     // NOTE: this only needs to be done for .data, not for (eventually) .bss
     auto dr = (DataRegion *)ds->getParent();
     const std::string &old_data = dr->getDataBytes();
-    std::string new_data(ds->getSize(), '\x00');
+    std::string new_data(newSize, '\x00');
 
-    lastend = 0;
+    for(auto kv : newlayout) {
+        const Range &nr = kv.second;
 
-    for(auto nr : shuffle) {
-        address_t newend = lastend + nr.getSize();
-
-        LOG(1, "Moving data block " << nr << " to 0x" << std::hex << lastend);
+        LOG(1, "Moving data block at 0x" << std::hex << kv.first
+            << " to 0x" << nr.getStart());
         std::copy(
-            old_data.begin() + ds->getOriginalOffset() + nr.getStart(),
-            old_data.begin() + ds->getOriginalOffset() + nr.getEnd(),
-            new_data.begin() + lastend);
-
-        // newlayout[nr.getStart()] = Range::fromEndpoints(lastend, newend);
-        lastend = newend;
+            old_data.begin() + ds->getOriginalOffset() + kv.first,
+            old_data.begin() + ds->getOriginalOffset() + kv.first
+                + nr.getSize(),
+            new_data.begin() + nr.getStart());
     }
 
     ndr->saveDataBytes(new_data);
@@ -274,6 +265,86 @@ void PermuteDataPass::visit(Module *module) {
     curModule = nullptr;
 }
 
+address_t PermuteDataPass::makeRandomLayout(const std::vector<Range> &ranges) {
+    std::vector<Range> shuffle = ranges;
+    std::random_shuffle(shuffle.begin(), shuffle.end());
+    address_t lastend = 0;
+
+    for(auto nr : shuffle) {
+        address_t newend = lastend + nr.getSize();
+        newlayout[nr.getStart()] = Range::fromEndpoints(lastend, newend);
+        lastend = newend;
+    }
+    return lastend;
+}
+
+// a variable counts as read-mostly if it is read this many times as often
+// as it is written
+#define READ_MOSTLY_RATIO 16
+#define CACHE_LINE_SIZE 64
+
+address_t PermuteDataPass::makeProfileLayout(const std::vector<Range> &ranges) {
+    std::map<address_t, size_t> indexOf;  // range start -> index in ranges
+    for(size_t i = 0; i < ranges.size(); i ++) {
+        indexOf[ranges[i].getStart()] = i;
+    }
+
+    std::vector<AccessCount> countList(ranges.size(), AccessCount{0, 0});
+    const address_t ds_begin = ds->getAddress();
+    for(const auto &access : accessMap) {
+        if(access.first < ds_begin
+            || access.first >= ds_begin + ds->getSize()) continue;
+
+        auto it = indexOf.upper_bound(access.first - ds_begin);
+        if(it == indexOf.begin()) continue;
+        auto &count = countList[(--it)->second];
+        count.reads += access.second.reads;
+        count.writes += access.second.writes;
+    }
+
+    // 0: written, 1: read-mostly, 2: never accessed
+    auto getGroup = [&countList] (size_t i) {
+        const auto &count = countList[i];
+        if(count.reads + count.writes == 0) return 2;
+        return (count.writes * READ_MOSTLY_RATIO < count.reads) ? 1 : 0;
+    };
+    std::vector<size_t> order;
+    for(size_t i = 0; i < ranges.size(); i ++) order.push_back(i);
+    std::stable_sort(order.begin(), order.end(),
+        [&] (size_t a, size_t b) {
+            int ga = getGroup(a), gb = getGroup(b);
+            if(ga != gb) return ga < gb;
+            if(ga == 2) return false;
+            return countList[a].reads + countList[a].writes
+                > countList[b].reads + countList[b].writes;
+        });
+
+    // the new section is page-aligned, so aligning offsets is enough
+    address_t lastend = 0;
+    int lastGroup = 0;
+    for(auto i : order) {
+        const auto &nr = ranges[i];
+        address_t align = 1;
+        while(align < CACHE_LINE_SIZE && !((ds_begin + nr.getStart()) & align)) {
+            align <<= 1;
+        }
+        int group = getGroup(i);
+        if(group != lastGroup) {
+            align = CACHE_LINE_SIZE;
+            lastGroup = group;
+        }
+
+        address_t start = (lastend + align - 1) & ~(align - 1);
+        LOG(1, "\tprofile layout: offset 0x" << std::hex << nr.getStart()
+            << " -> 0x" << start << " group " << std::dec << group
+            << " reads " << countList[i].reads
+            << " writes " << countList[i].writes);
+        newlayout[nr.getStart()] = Range(start, nr.getSize());
+        lastend = start + nr.getSize();
+    }
+    return lastend;
+}
+
 void PermuteDataPass::visit(Instruction *instr) {
     auto semantic = instr->getSemantic();
     auto li = dynamic_cast<LinkedInstructionBase *>(semantic);
@@ -1,10 +1,29 @@
 #ifndef EGALITO_PASS_PERMUTEDATA_H
 #define EGALITO_PASS_PERMUTEDATA_H
 
+#include <map>
+#include <vector>
 #include "chunk/module.h"
 #include "chunkpass.h"
 
+/** Moves the global variables of .data into a new section, either in a
+    random order or, given access counts, in a profile-guided one.
+
+    The profile-guided layout puts variables that are written often first,
+    then read-mostly variables, each group hottest first and starting on its
+    own cache line so that writes do not invalidate lines full of
+    read-mostly data. Variables that were never accessed come last, in their
+    original order. Unlike the random layout, it keeps each variable's
+    original alignment (up to a cache line).
+*/
 class PermuteDataPass : public ChunkPass {
+public:
+    struct AccessCount {
+        unsigned long reads;
+        unsigned long writes;
+    };
+    // keyed by the address accessed
+    typedef std::map<address_t, AccessCount> AccessMap;
 private:
     // old data section, new data section
     DataSection *ds, *nds;
@@ -16,10 +35,16 @@ private:
     std::map<Range, GlobalVariable *> immobileVariables;
     Module *curModule;
     GlobalVariable *lastVariable;
+    AccessMap accessMap;
 public:
+    void setAccessProfile(const AccessMap &accesses) { accessMap = accesses; }
+
     virtual void visit(Module *module);
     virtual void visit(Instruction *instr);
 private:
+    // these fill in newlayout and return the size of the new section
+    address_t makeRandomLayout(const std::vector<Range> &ranges);
+    address_t makeProfileLayout(const std::vector<Range> &ranges);
     Link *updatedLink(Link *link);
 private:
     address_t newAddress(address_t address);
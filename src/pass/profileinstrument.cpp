@@ -1,5 +1,12 @@
 #include <cstring>  // for memset
+#include <map>
+#include <sstream>
 #include "profileinstrument.h"
+#include "analysis/controlflow.h"
+#include "analysis/edgeprofile.h"
+#include "analysis/loops.h"
+#include "analysis/manager.h"
+#include "analysis/scratch.h"
 #include "operation/addinline.h"
 #include "operation/mutator.h"
 #include "disasm/disassemble.h"
@@ -7,6 +14,20 @@
 #include "instr/concrete.h"
 #include "log/log.h"
 
+/** Where the code for one edge counter goes. */
+struct ProfileInstrumentPass::CounterSite {
+    enum Kind {
+        BEFORE,         // before point; jumps to point run the counter too
+        TAKEN,          // new block at the end, reached by redirecting branch
+        FALL_THROUGH    // new block between source and its successor
+    };
+    Kind kind;
+    Instruction *point;             // liveness is taken from here
+    ControlFlowInstruction *branch; // TAKEN only
+    Block *source;                  // FALL_THROUGH only
+    std::string name;
+};
+
 void ProfileInstrumentPass::visit(Function *function) {
     if(function->getName() == "_init") return;
     if(function->getName() == "_fini") return;
@@ -14,25 +35,20 @@ void ProfileInstrumentPass::visit(Function *function) {
     if(function->getName() == "__libc_csu_fini") return;
 
     auto module = static_cast<Module *>(function->getParent()->getParent());
-    auto sectionPair = createDataSection(module);
-
-    ChunkAddInline ai({}, [this, sectionPair, function] (unsigned int stackBytesAdded) {
-        /*
-           ff 05 f8 01 00 f0            incl   -0xffffe08(%rip)
-
-           48 ff 05 f8 01 00 f0         incq   -0xffffe08(%rip)
-        */
-
-        //auto instr = Disassemble::instruction({0xff, 0x05, 0x00, 0x00, 0x00, 0x00});
-        DisasmHandle handle(true);
-        auto instr = new Instruction();
-        auto sem = new LinkedInstruction(instr);
-        sem->setAssembly(DisassembleInstruction(handle).makeAssemblyPtr(
-            std::vector<unsigned char>{0x48, 0xff, 0x05, 0x00, 0x00, 0x00, 0x00}));
-        sem->setLink(addVariable(sectionPair.first, function));
-        sem->setIndex(0);
-        instr->setSemantic(sem);
-        appendFunctionName(sectionPair.second, function->getName());
+    auto sections = createDataSection(module);
+
+    counterList.clear();
+    if(mode == MODE_EDGE && instrumentEdges(function, sections)) return;
+    instrumentEntry(function, sections);
+}
+
+void ProfileInstrumentPass::instrumentEntry(Function *function,
+    const DataSections &sections) {
+
+    ChunkAddInline ai({}, [this, sections, function] (unsigned int stackBytesAdded) {
+        auto instr = makeIncrement(addVariable(sections.counters,
+            "__counter_" + function->getName()));
+        appendString(sections.names, function->getName());
 
         return std::vector<Instruction *>{ instr };
     });
@@ -48,76 +64,331 @@ void ProfileInstrumentPass::visit(Function *function) {
     auto sem = static_cast<LinkedInstruction *>(instr0->getSemantic());
     sem->regenerateAssembly();
     LOG(0, "adding profiling to function [" << function->getName()
-        << "] using global var " 
+        << "] using global var "
         << std::hex << sem->getLink()->getTargetAddress());
 }
 
+Instruction *ProfileInstrumentPass::makeIncrement(Link *counter) {
+    /*
+       ff 05 f8 01 00 f0            incl   -0xffffe08(%rip)
+
+       48 ff 05 f8 01 00 f0         incq   -0xffffe08(%rip)
+    */
+
+    //auto instr = Disassemble::instruction({0xff, 0x05, 0x00, 0x00, 0x00, 0x00});
+    DisasmHandle handle(true);
+    auto instr = new Instruction();
+    auto sem = new LinkedInstruction(instr);
+    sem->setAssembly(DisassembleInstruction(handle).makeAssemblyPtr(
+        std::vector<unsigned char>{0x48, 0xff, 0x05, 0x00, 0x00, 0x00, 0x00}));
+    sem->setLink(counter);
+    sem->setIndex(0);
+    instr->setSemantic(sem);
+    counterList.push_back(sem);
+    return instr;
+}
+
+#ifdef ARCH_X86_64
+static Block *getTargetBlock(Link *link) {
+    if(!link || !link->getTarget()) return nullptr;
+
+    auto target = &*link->getTarget();
+    if(auto block = dynamic_cast<Block *>(target)) return block;
+    if(auto instr = dynamic_cast<Instruction *>(target)) {
+        return dynamic_cast<Block *>(instr->getParent());
+    }
+    return nullptr;
+}
+
+// a direct jump (conditional or not) that leaves the function
+static bool jumpsOut(Function *function, Instruction *instr) {
+    auto cfi = dynamic_cast<ControlFlowInstruction *>(instr->getSemantic());
+    if(!cfi || cfi->getMnemonic() == "callq") return false;
+
+    auto block = getTargetBlock(cfi->getLink());
+    return !block || block->getParent() != function;
+}
+
+static bool isConditional(ControlFlowInstruction *cfi) {
+    return cfi && cfi->getMnemonic() != "jmp" && cfi->getMnemonic() != "callq";
+}
+
+// true if nothing can fall through past the end of the function
+static bool endsWithJump(Function *function) {
+    auto block = function->getChildren()->getIterable()->getLast();
+    auto semantic = block->getChildren()->getIterable()->getLast()->getSemantic();
+    if(dynamic_cast<ReturnInstruction *>(semantic)) return true;
+    if(auto ij = dynamic_cast<IndirectJumpInstruction *>(semantic)) {
+        return ij->getMnemonic() != "callq";
+    }
+    auto cfi = dynamic_cast<ControlFlowInstruction *>(semantic);
+    return cfi && cfi->getMnemonic() == "jmp";
+}
+#endif
+
+bool ProfileInstrumentPass::planEdges(Function *function, ControlFlowGraph *cfg,
+    EdgeProfile &profile, std::vector<CounterSite> &siteList,
+    int firstCounter) {
+
+#ifdef ARCH_X86_64
+    LoopForest forest(cfg);
+    const int exitID = static_cast<int>(cfg->getCount());
+    const bool canAppend = endsWithJump(function);
+
+    // successors without duplicates, mapped to their largest offset
+    std::vector<std::map<int, int>> successors(cfg->getCount());
+    std::vector<int> predecessors(cfg->getCount() + 1, 0);
+    predecessors[0] ++;     // from the caller
+    for(size_t id = 0; id < cfg->getCount(); id ++) {
+        auto node = cfg->get(id);
+        profile.addBlock(node->getBlock()->getAddress()
+            - function->getAddress());
+
+        auto &targets = successors[id];
+        for(auto link : node->forwardLinks()) {
+            auto cflink = dynamic_cast<ControlFlowLink *>(&*link);
+            auto &offset = targets[link->getTargetID()];
+            offset = std::max(offset, cflink->getOffset());
+        }
+        auto last = node->getBlock()->getChildren()->getIterable()->getLast();
+        if(targets.empty() || jumpsOut(function, last)) targets[exitID] = 0;
+
+        for(auto &target : targets) predecessors[target.first] ++;
+    }
+
+    auto getDepth = [&] (int id) {
+        return (id == exitID) ? 0 : forest.getDepth(cfg->get(id)->getBlock());
+    };
+
+    std::vector<CounterSite> candidateList;
+    std::vector<unsigned long> weight;
+    std::vector<bool> fixed;
+    for(size_t id = 0; id < cfg->getCount(); id ++) {
+        auto block = cfg->get(id)->getBlock();
+        auto last = block->getChildren()->getIterable()->getLast();
+        auto cfi = dynamic_cast<ControlFlowInstruction *>(last->getSemantic());
+        auto &targets = successors[id];
+
+        for(auto &target : targets) {
+            int to = target.first;
+            profile.addEdge(id, to);
+
+            // loop depth approximates frequency: keep inner edges in the tree
+            int depth = std::min(getDepth(id), getDepth(to));
+            unsigned long w = 1;
+            for(int i = 0; i < depth && i < 12; i ++) w *= 10;
+            weight.push_back(w);
+
+            std::ostringstream name;
+            name << function->getName() << "#" << id << "->";
+            if(to == exitID) name << "exit";
+            else name << to;
+
+            Block *toBlock = (to == exitID) ? nullptr : cfg->get(to)->getBlock();
+            Instruction *toFirst = toBlock
+                ? toBlock->getChildren()->getIterable()->get(0) : nullptr;
+            bool toStart = toBlock && target.second == 0;
+
+            CounterSite site{CounterSite::BEFORE, nullptr, nullptr, nullptr,
+                name.str()};
+            if(targets.size() == 1) {
+                site.point = last;
+            }
+            else if(toStart && predecessors[to] == 1) {
+                site.point = toFirst;
+            }
+            else if(toStart && isConditional(cfi) && canAppend
+                && getTargetBlock(cfi->getLink()) == toBlock) {
+
+                site.kind = CounterSite::TAKEN;
+                site.point = toFirst;
+                site.branch = cfi;
+            }
+            else if(toStart && isConditional(cfi)
+                && function->getChildren()->getIterable()->indexOf(block) + 1
+                    == function->getChildren()->getIterable()->indexOf(toBlock)) {
+
+                site.kind = CounterSite::FALL_THROUGH;
+                site.point = toFirst;
+                site.source = block;
+            }
+            // e.g. jump table entries and jumps into the middle of a block
+            fixed.push_back(site.point == nullptr);
+            candidateList.push_back(site);
+        }
+    }
+
+    if(!profile.placeCounters(weight, fixed, firstCounter)) {
+        LOG(1, "edges of [" << function->getName()
+            << "] cannot be reconstructed, counting calls instead");
+        return false;
+    }
+
+    auto &edgeList = profile.getEdgeList();
+    for(size_t i = 0; i < edgeList.size(); i ++) {
+        if(edgeList[i].counter >= 0) siteList.push_back(candidateList[i]);
+    }
+    return true;
+#else
+    LOG(1, "edge profiling is only supported on x86_64");
+    return false;
+#endif
+}
+
+bool ProfileInstrumentPass::instrumentEdges(Function *function,
+    const DataSections &sections) {
+
+#ifdef ARCH_X86_64
+    ControlFlowGraph cfg(function);
+    EdgeProfile profile(function->getName());
+    std::vector<CounterSite> siteList;
+    int firstCounter = sections.counters->getSize() / 8;
+    if(!planEdges(function, &cfg, profile, siteList, firstCounter)) {
+        return false;
+    }
+
+    // generate all counter code against the original function first
+    std::vector<std::vector<Instruction *>> codeList;
+    {
+        ScratchRegisters scratch(function);
+        for(size_t i = 0; i < siteList.size(); i ++) {
+            auto &site = siteList[i];
+            auto counter = addVariable(sections.counters, "__counter_"
+                + function->getName() + "_" + std::to_string(firstCounter + i));
+            appendString(sections.names, site.name);
+
+            ChunkAddInline ai({X86_REG_EFLAGS},
+                [this, counter] (unsigned int stackBytesAdded) {
+                    return std::vector<Instruction *>{ makeIncrement(counter) };
+                });
+            ai.setScratchRegisters(&scratch);
+            codeList.push_back(ai.getFullCode(site.point));
+        }
+    }
+
+    PositionFactory *positionFactory = PositionFactory::getInstance();
+    auto lastBlock = function->getChildren()->getIterable()->getLast();
+    for(size_t i = 0; i < siteList.size(); i ++) {
+        auto &site = siteList[i];
+        auto &code = codeList[i];
+        if(site.kind == CounterSite::BEFORE) {
+            auto block = static_cast<Block *>(site.point->getParent());
+            ChunkMutator(block, true).insertBefore(site.point, code, true);
+            continue;
+        }
+
+        auto block = new Block();
+        auto prev = (site.kind == CounterSite::TAKEN) ? lastBlock : site.source;
+        block->setPosition(positionFactory->makePosition(
+            prev, block, function->getSize()));
+        {
+            ChunkMutator m(block, true);
+            for(auto instr : code) m.append(instr);
+        }
+
+        if(site.kind == CounterSite::TAKEN) {
+            // the counter block jumps to the original target
+            auto jump = new Instruction();
+            auto semantic = new ControlFlowInstruction(
+                X86_INS_JMP, jump, "\xe9", "jmp", 4);
+            semantic->setLink(site.branch->getLink());
+            jump->setSemantic(semantic);
+            ChunkMutator(block, true).append(jump);
+
+            site.branch->setLink(
+                new NormalLink(block, Link::SCOPE_INTERNAL_JUMP));
+            lastBlock = block;
+        }
+        ChunkMutator(function).insertAfter(prev, block);
+    }
+    AnalysisManager::getInstance()->invalidate(function);
+
+    {
+        ChunkMutator(function, true);
+    }
+    for(auto sem : counterList) sem->regenerateAssembly();
+
+    appendString(sections.edges, profile.encode());
+    LOG(0, "adding " << siteList.size() << " edge counters to function ["
+        << function->getName() << "] for " << profile.getEdgeList().size()
+        << " edges");
+    return true;
+#else
+    return false;
+#endif
+}
+
 #define DATA_REGION_ADDRESS 0x30000000
 #define DATA_NAMEREGION_ADDRESS 0x31000000
+#define DATA_EDGEREGION_ADDRESS 0x32000000
 #define DATA_SECTION_NAME ".profiling"
 #define DATA_NAMESECTION_NAME ".profiling.names"
+#define DATA_EDGESECTION_NAME ".profiling.edges"
 
-std::pair<DataSection *, DataSection *> ProfileInstrumentPass
+ProfileInstrumentPass::DataSections ProfileInstrumentPass
     ::createDataSection(Module *module) {
 
     auto regionList = module->getDataRegionList();
-    if(auto section = regionList->findDataSection(DATA_SECTION_NAME)) {
-        if(auto nameSection = regionList->findDataSection(DATA_NAMESECTION_NAME)) {
-            return std::make_pair(section, nameSection);
-        }
+    auto section = regionList->findDataSection(DATA_SECTION_NAME);
+    auto nameSection = regionList->findDataSection(DATA_NAMESECTION_NAME);
+    auto edgeSection = regionList->findDataSection(DATA_EDGESECTION_NAME);
+
+    if(!section || !nameSection) {
+        section = createSection(regionList, DATA_REGION_ADDRESS,
+            DATA_SECTION_NAME, 0x8, true);
+        nameSection = createSection(regionList, DATA_NAMEREGION_ADDRESS,
+            DATA_NAMESECTION_NAME, 0x1, false);
+    }
+    if(!edgeSection && mode == MODE_EDGE) {
+        edgeSection = createSection(regionList, DATA_EDGEREGION_ADDRESS,
+            DATA_EDGESECTION_NAME, 0x1, false);
     }
 
-    auto region = new DataRegion(DATA_REGION_ADDRESS);
-    region->setPosition(new AbsolutePosition(DATA_REGION_ADDRESS));
+    return DataSections{section, nameSection, edgeSection};
+}
+
+DataSection *ProfileInstrumentPass::createSection(DataRegionList *regionList,
+    address_t address, const char *name, size_t alignment, bool writable) {
+
+    auto region = new DataRegion(address);
+    region->setPosition(new AbsolutePosition(address));
     regionList->getChildren()->add(region);
     region->setParent(regionList);
 
     auto section = new DataSection();
-    section->setName(DATA_SECTION_NAME);
-    section->setAlignment(0x8);
-    section->setPermissions(SHF_WRITE | SHF_ALLOC);
+    section->setName(name);
+    section->setAlignment(alignment);
+    section->setPermissions(writable ? (SHF_WRITE | SHF_ALLOC) : SHF_ALLOC);
     section->setPosition(new AbsoluteOffsetPosition(section, 0));
     section->setType(DataSection::TYPE_DATA);
     region->getChildren()->add(section);
     section->setParent(region);
 
-    auto nameRegion = new DataRegion(DATA_NAMEREGION_ADDRESS);
-    nameRegion->setPosition(new AbsolutePosition(DATA_NAMEREGION_ADDRESS));
-    regionList->getChildren()->add(nameRegion);
-    nameRegion->setParent(regionList);
-
-    auto nameSection = new DataSection();
-    nameSection->setName(DATA_NAMESECTION_NAME);
-    nameSection->setAlignment(0x1);
-    nameSection->setPermissions(SHF_ALLOC);
-    nameSection->setPosition(new AbsoluteOffsetPosition(nameSection, 0));
-    nameSection->setType(DataSection::TYPE_DATA);
-    nameRegion->getChildren()->add(nameSection);
-    nameSection->setParent(nameRegion);
-
-    return std::make_pair(section, nameSection);
+    return section;
 }
 
-Link *ProfileInstrumentPass::addVariable(DataSection *section, Function *function) {
+Link *ProfileInstrumentPass::addVariable(DataSection *section,
+    const std::string &name) {
+
     auto region = static_cast<DataRegion *>(section->getParent());
     auto offset = section->getSize();
 
     const size_t VAR_SIZE = 8;
 
-    auto var = new GlobalVariable("__counter_" + function->getName());
+    auto var = new GlobalVariable(name);
     var->setPosition(new AbsolutePosition(section->getAddress()+section->getSize()));
 
-    char *name = new char[var->getName().length() + 1];
-    std::strcpy(name, var->getName().c_str());
+    char *symbolName = new char[var->getName().length() + 1];
+    std::strcpy(symbolName, var->getName().c_str());
 
     auto nsymbol = new Symbol(
-        var->getAddress(), VAR_SIZE, name,
+        var->getAddress(), VAR_SIZE, symbolName,
         Symbol::TYPE_OBJECT, Symbol::BIND_LOCAL, 0, 0);
     var->setSymbol(nsymbol);
 
     section->addGlobalVariable(var);
 
-    LOG(0, name << " is a global symbol");
+    LOG(0, symbolName << " is a global symbol");
 
     section->setSize(section->getSize() + 8);
     region->setSize(region->getSize() + 8);
@@ -125,12 +396,12 @@ Link *ProfileInstrumentPass::addVariable(DataSection *section, Function *functio
     return new DataOffsetLink(section, offset, Link::SCOPE_INTERNAL_DATA);
 }
 
-void ProfileInstrumentPass::appendFunctionName(DataSection *nameSection,
+void ProfileInstrumentPass::appendString(DataSection *section,
     const std::string &name) {
 
-    auto region = static_cast<DataRegion *>(nameSection->getParent());
+    auto region = static_cast<DataRegion *>(section->getParent());
     region->setSize(region->getSize() + name.length() + 1);
-    nameSection->setSize(nameSection->getSize() + name.length() + 1);
+    section->setSize(section->getSize() + name.length() + 1);
 
     auto bytes = region->getDataBytes();
     bytes.append(name.c_str(), name.length() + 1);
@@ -2,17 +2,52 @@
 #define EGALITO_PASS_PROFILE_INSTRUMENT_H
 
 #include <utility>
+#include <vector>
 #include "chunkpass.h"
 #include "chunk/dataregion.h"
 #include "chunk/function.h"
 
+class ControlFlowGraph;
+class EdgeProfile;
+class LinkedInstruction;
+class ScratchRegisters;
+
+/** Adds a counter to every function, or with MODE_EDGE, to the edges of
+    each function's CFG that are needed to recover all edge counts (see
+    EdgeProfile). Edge layouts are stored in .profiling.edges for etprofile.
+*/
 class ProfileInstrumentPass : public ChunkPass {
 public:
+    enum Mode {
+        MODE_FUNCTION,
+        MODE_EDGE       // x86_64 only
+    };
+private:
+    struct DataSections {
+        DataSection *counters;
+        DataSection *names;
+        DataSection *edges;
+    };
+    struct CounterSite;
+private:
+    Mode mode;
+    std::vector<LinkedInstruction *> counterList;
+public:
+    ProfileInstrumentPass(Mode mode = MODE_FUNCTION) : mode(mode) {}
     virtual void visit(Function *function);
 private:
-    std::pair<DataSection *, DataSection*> createDataSection(Module *module);
-    Link *addVariable(DataSection *section, Function *function);
-    void appendFunctionName(DataSection *nameSection, const std::string &name);
+    void instrumentEntry(Function *function, const DataSections &sections);
+    bool instrumentEdges(Function *function, const DataSections &sections);
+    bool planEdges(Function *function, ControlFlowGraph *cfg,
+        EdgeProfile &profile, std::vector<CounterSite> &siteList,
+        int firstCounter);
+    Instruction *makeIncrement(Link *counter);
+
+    DataSections createDataSection(Module *module);
+    DataSection *createSection(DataRegionList *regionList, address_t address,
+        const char *name, size_t alignment, bool writable);
+    Link *addVariable(DataSection *section, const std::string &name);
+    void appendString(DataSection *section, const std::string &name);
 };
 
 #endif
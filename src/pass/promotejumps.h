@@ -14,9 +14,13 @@ public:
 
     template <typename NarrowType>
     static bool fitsIn(address_t address);
+
+    /** The rel32 opcode for a jump with this capstone id, or an empty
+        string if there is none (jrcxz and friends).
+    */
+    static std::string getWiderOpcode(unsigned int id);
 private:
     void promote(Instruction *instruction);
-    static std::string getWiderOpcode(unsigned int id);
 };
 
 template <typename NarrowType>
@@ -4,6 +4,7 @@
 #include <map>
 #include "reorderpush.h"
 #include "analysis/frametype.h"
+#include "analysis/manager.h"
 #include "analysis/reachingdef.h"
 #include "chunk/module.h"
 #include "chunk/function.h"
@@ -29,7 +30,7 @@ void ReorderPush::visit(Function *function) {
 #ifdef ARCH_X86_64
     LOG(1, "ReorderPush for [" << function->getName());
 
-    FrameType frameType(function);
+    FrameType frameType(*AnalysisManager::getInstance()->getFrameType(function));
     //frameType.dump();
 
     auto prologueEnd = frameType.getSetSPInstr();
@@ -2,6 +2,7 @@
 #define EGALITO_PASS_RUN_H
 
 #include "util/timing.h"
+#include "analysis/manager.h"
 
 #if 1  // enable pass profiling
     #define RUN_PASS(passConstructor, module) \
@@ -9,12 +10,14 @@
             EgalitoTiming timing(#passConstructor); \
             auto pass = passConstructor; \
             module->accept(&pass); \
+            AnalysisManager::getInstance()->passFinished(&pass); \
         }
 #else
     #define RUN_PASS(passConstructor, module) \
         { \
             auto pass = passConstructor; \
             module->accept(&pass); \
+            AnalysisManager::getInstance()->passFinished(&pass); \
         }
 #endif
 
@@ -0,0 +1,72 @@
+#include "schedule.h"
+#include "analysis/dependencedag.h"
+#include "analysis/manager.h"
+#include "chunk/concrete.h"
+#include "instr/concrete.h"
+#include "operation/mutator.h"
+
+#include "log/log.h"
+
+// the DAG is quadratic in the worst case (e.g. many memory accesses)
+#define MAX_BLOCK_SIZE  256
+
+void InstructionSchedulePass::visit(Module *module) {
+    recurse(module);
+    LOG(1, "rescheduled " << std::dec << blocksChanged
+        << " blocks, saving an estimated " << cyclesSaved << " cycles");
+}
+
+void InstructionSchedulePass::visit(Function *function) {
+    size_t before = blocksChanged;
+    recurse(function);
+    if(blocksChanged != before) {
+        AnalysisManager::getInstance()->invalidate(function);
+    }
+}
+
+void InstructionSchedulePass::visit(Block *block) {
+    size_t count = block->getChildren()->getIterable()->getCount();
+    if(count < 2 || count > MAX_BLOCK_SIZE) return;
+
+    DependenceDAG dag(block);
+    ListScheduler scheduler(&dag, issueWidth);
+    if(!deferList.empty()) {
+        scheduler.setPriority([this, &dag] (uint32_t id) {
+            if(deferList.count(dag.getInstruction(id))) return -1;
+            return static_cast<int>(dag.getHeight(id));
+        });
+    }
+
+    std::vector<uint32_t> original;
+    for(uint32_t i = 0; i < count; i ++) original.push_back(i);
+    uint32_t oldLength = ListScheduler::simulate(&dag, original, issueWidth);
+
+    auto order = scheduler.schedule();
+    uint32_t newLength = ListScheduler::simulate(&dag, order, issueWidth);
+    if(newLength >= oldLength) return;
+
+    LOG(10, "rescheduling " << block->getName() << ": " << std::dec
+        << oldLength << " -> " << newLength << " cycles");
+
+    std::vector<InstructionSemantic *> newOrder;
+    for(auto id : order) {
+        newOrder.push_back(dag.getInstruction(id)->getSemantic());
+    }
+
+    ChunkMutator mutator(block, true);
+    for(size_t n = 0; n < count; n ++) {
+        auto ins = block->getChildren()->getIterable()->get(n);
+        auto old = ins->getSemantic();
+        auto s = newOrder[n];
+        if(s == old) continue;
+
+        ins->setSemantic(s);
+        if(auto linked = dynamic_cast<LinkedInstruction *>(s)) {
+            linked->setInstruction(ins);
+        }
+        mutator.modifiedChildSize(ins, s->getSize() - old->getSize());
+    }
+
+    blocksChanged ++;
+    cyclesSaved += oldLength - newLength;
+}
@@ -0,0 +1,40 @@
+#ifndef EGALITO_PASS_SCHEDULE_H
+#define EGALITO_PASS_SCHEDULE_H
+
+#include <set>
+#include "chunkpass.h"
+
+/** Reorders the instructions of each basic block with ListScheduler to
+    shorten the dependence chains a simple in-order machine would stall on.
+
+    Instructions in deferList (typically instrumentation inserted by an
+    earlier pass) get the lowest priority, so they are moved into cycles
+    that would otherwise be idle rather than delaying the original code.
+    A block is only rewritten if its estimated length goes down.
+
+    Instructions keep their positions and trade semantics, as in
+    ReorderPush, so Instruction pointers held elsewhere (including the
+    deferList itself) refer to whatever ends up at that position.
+*/
+class InstructionSchedulePass : public ChunkPass {
+private:
+    std::set<Instruction *> deferList;
+    unsigned issueWidth;
+    size_t blocksChanged;
+    size_t cyclesSaved;
+public:
+    InstructionSchedulePass(unsigned issueWidth = 4)
+        : issueWidth(issueWidth), blocksChanged(0), cyclesSaved(0) {}
+    InstructionSchedulePass(const std::set<Instruction *> &deferList,
+        unsigned issueWidth = 4) : deferList(deferList),
+        issueWidth(issueWidth), blocksChanged(0), cyclesSaved(0) {}
+
+    virtual PreservedAnalyses getPreservedAnalyses() const
+        { return PreservedAnalyses::all(); }  // invalidates what it changes
+    virtual void visit(Module *module);
+    virtual void visit(Function *function);
+    virtual void visit(Block *block);
+    virtual void visit(Instruction *instruction) {}
+};
+
+#endif
@@ -1,6 +1,10 @@
 #include <vector>
 #include <cassert>
 #include "shadowstack.h"
+#include "analysis/checkelision.h"
+#include "analysis/framesummary.h"
+#include "analysis/manager.h"
+#include "analysis/scratch.h"
 #include "disasm/disassemble.h"
 #include "instr/register.h"
 #include "instr/concrete.h"
@@ -10,6 +14,8 @@
 #include "pass/switchcontext.h"
 #include "types.h"
 
+#include "log/log.h"
+
 void ShadowStackPass::visit(Program *program) {
     auto allocateFunc = ChunkFind2(program).findFunction(
         mode == MODE_GS ? "egalito_allocate_shadow_stack_gs"
@@ -44,6 +50,11 @@ void ShadowStackPass::visit(Program *program) {
     }
 
     recurse(program);
+
+    if(elideChecks) {
+        LOG(1, "shadow stack: skipped " << std::dec << elidedCount
+            << " leaf functions that cannot overwrite their return address");
+    }
 }
 
 void ShadowStackPass::visit(Module *module) {
@@ -109,36 +120,25 @@ void ShadowStackPass::visit(Function *function) {
     // sphinx3, function does tail recursion to itself
     if(function->getName() == "mdef_phone_id") return;
 
-    pushToShadowStack(function);
-    recurse(function);
-}
+    if(elideChecks && CheckElision::isSafeLeaf(function)) {
+        LOG(10, "shadow stack: skipping leaf [" << function->getName() << "]");
+        elidedCount ++;
+        return;
+    }
 
+    // find the exits and dead registers before the prologue changes the
+    // function
+    auto summary = AnalysisManager::getInstance()->getFrameSummary(function);
+    auto exitList = FrameSummary::getInstructions(
+        FrameSummary::getInstructionList(function), summary->getExitList());
+    ScratchRegisters scratchRegisters(function);
+    scratch = &scratchRegisters;
 
-void ShadowStackPass::visit(Instruction *instruction) {
-    auto semantic = instruction->getSemantic();
-    if(/*auto v = */dynamic_cast<ReturnInstruction *>(semantic)) {
+    pushToShadowStack(function);
+    for(auto instruction : exitList) {
         popFromShadowStack(instruction);
     }
-    else if(auto v = dynamic_cast<ControlFlowInstruction *>(semantic)) {
-        if(v->getMnemonic() != "callq"
-            && v->getLink() && v->getLink()->isExternalJump()) {  // tail recursion
-
-            popFromShadowStack(instruction);
-        }
-    }
-    else if(auto v = dynamic_cast<IndirectJumpInstruction *>(semantic)) {
-        if(!v->isForJumpTable()) {  // indirect tail recursion
-            popFromShadowStack(instruction);
-        }
-    }
-    else if(auto v = dynamic_cast<DataLinkedControlFlowInstruction *>(semantic)) {
-        if(!v->isCall()) {
-            popFromShadowStack(instruction);
-        }
-    }
-    /*else if(dynamic_cast<IndirectCallInstruction *>(semantic)) {
-        popFromShadowStack(instruction);
-    }*/
+    scratch = nullptr;
 }
 
 void ShadowStackPass::pushToShadowStack(Function *function) {
@@ -180,6 +180,7 @@ void ShadowStackPass::pushToShadowStackConst(Function *function) {
     });
 	auto block1 = function->getChildren()->getIterable()->get(0);
 	auto instr1 = block1->getChildren()->getIterable()->get(0);
+    ai.setScratchRegisters(scratch);
     ai.insertBefore(instr1, false);
 }
 
@@ -217,6 +218,7 @@ void ShadowStackPass::pushToShadowStackGS(Function *function) {
     });
 	auto block1 = function->getChildren()->getIterable()->get(0);
 	auto instr1 = block1->getChildren()->getIterable()->get(0);
+    ai.setScratchRegisters(scratch);
     ai.insertBefore(instr1, false);
 }
 
@@ -263,6 +265,7 @@ void ShadowStackPass::popFromShadowStackConst(Instruction *instruction) {
         jne->setSemantic(jneSem);
         return std::vector<Instruction *>{ movInstr, cmpInstr, jne };
     });
+    ai.setScratchRegisters(scratch);
     ai.insertBefore(instruction, true);
 }
 
@@ -306,6 +309,7 @@ void ShadowStackPass::popFromShadowStackGS(Instruction *instruction) {
 
         return std::vector<Instruction *>{ mov1Instr, mov2Instr, cmpInstr, jne, leaInstr, mov3Instr };
     });
+    ai.setScratchRegisters(scratch);
     ai.insertBefore(instruction, true);
 }
 
@@ -3,6 +3,12 @@
 
 #include "chunkpass.h"
 
+class ScratchRegisters;
+
+/** Saves each return address on a shadow stack in the prologue and checks
+    it before every exit. With elideChecks, leaf functions that cannot
+    overwrite their own return address (see CheckElision) are skipped.
+*/
 class ShadowStackPass : public ChunkPass {
 public:
     enum Mode {
@@ -11,15 +17,21 @@ public:
     };
 private:
     Mode mode;
+    bool elideChecks;
+    size_t elidedCount;
     Function *violationTarget;
     Function *entryPoint;
+    ScratchRegisters *scratch;
 public:
-    ShadowStackPass(Mode mode = MODE_CONST) : mode(mode),
-        violationTarget(nullptr), entryPoint(nullptr) {}
+    ShadowStackPass(Mode mode = MODE_CONST, bool elideChecks = false)
+        : mode(mode), elideChecks(elideChecks), elidedCount(0),
+        violationTarget(nullptr), entryPoint(nullptr), scratch(nullptr) {}
+
+    /** Functions left uninstrumented by elideChecks. */
+    size_t getElidedCount() const { return elidedCount; }
     virtual void visit(Program *program);
     virtual void visit(Module *module);
     virtual void visit(Function *function);
-    virtual void visit(Instruction *instruction);
 private:
     void pushToShadowStack(Function *function);
     void pushToShadowStackConst(Function *function);
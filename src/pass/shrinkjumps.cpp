@@ -0,0 +1,106 @@
+#include <capstone/x86.h>
+#include "shrinkjumps.h"
+#include "promotejumps.h"
+#include "operation/mutator.h"
+#include "instr/concrete.h"
+
+#include "log/log.h"
+
+#ifdef ARCH_X86_64
+static Function *getEnclosingFunction(Chunk *chunk) {
+    while(chunk && !dynamic_cast<Function *>(chunk)) {
+        chunk = chunk->getParent();
+    }
+    return static_cast<Function *>(chunk);
+}
+
+// rel32 opcodes are e9 and 0f 8x, rel8 opcodes are eb and 7x
+static std::string getNarrowerOpcode(const std::string &wide) {
+    std::string opcode;
+    if(wide.size() == 1) {
+        opcode += static_cast<char>(0xeb);
+    }
+    else {
+        opcode += static_cast<char>(0x70 | (wide[1] & 0x0f));
+    }
+    return opcode;
+}
+#endif
+
+void ShrinkJumpsPass::visit(Function *function) {
+#ifdef ARCH_X86_64
+    if(function->getCache()) return;
+
+    std::vector<Instruction *> shrunkList;
+    for(auto block : CIter::children(function)) {
+        for(auto instr : CIter::children(block)) {
+            if(!isCandidate(function, instr)) continue;
+
+            auto cfi = static_cast<ControlFlowInstruction *>(
+                instr->getSemantic());
+            resize(instr, getNarrowerOpcode(cfi->getOpcode()), 1);
+            shrunkList.push_back(instr);
+        }
+    }
+    if(shrunkList.empty()) return;
+
+    // each round widens at least one jump, so this takes at most
+    // shrunkList.size() rounds
+    size_t widened = 0;
+    for(bool changed = true; changed; ) {
+        changed = false;
+        for(auto instr : shrunkList) {
+            auto cfi = static_cast<ControlFlowInstruction *>(
+                instr->getSemantic());
+            if(cfi->getDisplacementSize() != 1) continue;
+            if(PromoteJumpsPass::fitsIn<signed char>(
+                cfi->calculateDisplacement())) continue;
+
+            resize(instr, PromoteJumpsPass::getWiderOpcode(cfi->getId()), 4);
+            changed = true;
+            widened ++;
+        }
+    }
+
+    LOG(10, "shrank " << (shrunkList.size() - widened) << " of "
+        << shrunkList.size() << " jumps in [" << function->getName() << "]");
+    shrunkCount += shrunkList.size() - widened;
+#endif
+}
+
+bool ShrinkJumpsPass::isCandidate(Function *function,
+    Instruction *instruction) {
+
+#ifdef ARCH_X86_64
+    auto cfi = dynamic_cast<ControlFlowInstruction *>(
+        instruction->getSemantic());
+    if(!cfi || cfi->getDisplacementSize() != 4) return false;
+    if(cfi->getId() == X86_INS_CALL) return false;
+
+    // skips anything with a prefix, such as bnd jmp
+    auto wide = PromoteJumpsPass::getWiderOpcode(cfi->getId());
+    if(wide.empty() || cfi->getOpcode() != wide) return false;
+
+    auto link = cfi->getLink();
+    if(!link || link->isExternalJump() || !link->getTarget()) return false;
+    return getEnclosingFunction(&*link->getTarget()) == function;
+#else
+    return false;
+#endif
+}
+
+void ShrinkJumpsPass::resize(Instruction *instruction,
+    const std::string &opcode, int displacementSize) {
+
+#ifdef ARCH_X86_64
+    auto cfi = static_cast<ControlFlowInstruction *>(
+        instruction->getSemantic());
+    size_t oldSize = cfi->getSize();
+
+    cfi->setOpcode(opcode);
+    cfi->setDisplacementSize(displacementSize);
+
+    ChunkMutator(instruction->getParent())
+        .modifiedChildSize(instruction, cfi->getSize() - oldSize);
+#endif
+}
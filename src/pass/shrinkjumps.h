@@ -0,0 +1,37 @@
+#ifndef EGALITO_PASS_SHRINK_JUMPS_H
+#define EGALITO_PASS_SHRINK_JUMPS_H
+
+#include <vector>
+#include "chunkpass.h"
+
+/** Gives every direct jump within a function the smallest encoding that
+    reaches its target (branch relaxation), the inverse of PromoteJumpsPass.
+
+    All rel32 jmp/jcc instructions whose target is in the same function are
+    first made rel8, then any that no longer reach are widened again until
+    nothing changes. Jumps only ever grow in the second phase, so this
+    cannot oscillate and ends with the smallest layout reachable this way.
+    Jumps that leave the function are left alone, since their displacement
+    depends on where Generator places the functions.
+
+    Functions with a ChunkCache are skipped, since their code is copied
+    verbatim. This whole pass is x86_64-specific.
+*/
+class ShrinkJumpsPass : public ChunkPass {
+private:
+    size_t shrunkCount;
+public:
+    ShrinkJumpsPass() : shrunkCount(0) {}
+
+    /** Number of jumps that ended up smaller, over all visited functions. */
+    size_t getShrunkCount() const { return shrunkCount; }
+
+    virtual void visit(Module *module) { recurse(module->getFunctionList()); }
+    virtual void visit(Function *function);
+private:
+    bool isCandidate(Function *function, Instruction *instruction);
+    void resize(Instruction *instruction, const std::string &opcode,
+        int displacementSize);
+};
+
+#endif
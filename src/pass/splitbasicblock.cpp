@@ -37,6 +37,25 @@ void SplitBasicBlock::considerSplittingFor(Function *function,
     splitPoints.insert(target);
 }
 
+void SplitBasicBlock::visit(Module *module) {
+    if(!jumpTablesOnly) {
+        recurse(module);
+        return;
+    }
+
+    auto jumpTableList = module->getJumpTableList();
+    if(!jumpTableList) return;
+
+    std::set<Function *> functionList;
+    for(auto jt : CIter::children(jumpTableList)) {
+        functionList.insert(jt->getFunction());
+    }
+    for(auto function : functionList) {
+        function->accept(this);
+    }
+    splitList.insert(functionList.begin(), functionList.end());
+}
+
 void SplitBasicBlock::visit(Function *function) {
     //TemporaryLogLevel tll("pass", 20);
 
@@ -90,6 +109,7 @@ void SplitBasicBlock::visit(Function *function) {
         << splitPoints.size() << " new points");*/
 
     {std::string foo=StreamAsString()<<"SplitBasicBlock part 3 for " << function->getName();EgalitoTiming timing(foo.c_str(), 100);
+    if(!splitPoints.empty()) splitList.insert(function);
     ChunkMutator m(function);
     for(auto it = splitPoints.rbegin(); it != splitPoints.rend(); it ++) {
         auto instr = *it;
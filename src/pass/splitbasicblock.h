@@ -7,10 +7,24 @@
 
 class SplitBasicBlock : public ChunkPass {
 private:
+    bool jumpTablesOnly;
     std::set<Instruction *> splitPoints;
+    std::set<Function *> splitList;
 public:
-    SplitBasicBlock() {}
+    /** With jumpTablesOnly, only functions that own a JumpTable are
+        visited; every other function was already split by an earlier run.
+    */
+    SplitBasicBlock(bool jumpTablesOnly = false)
+        : jumpTablesOnly(jumpTablesOnly) {}
+    virtual PreservedAnalyses getPreservedAnalyses() const
+        { return PreservedAnalyses::all(); }  // ChunkMutator reports splits
+    virtual void visit(Module *module);
     virtual void visit(Function *function);
+
+    /** Functions that gained new blocks, or any jump table edges when
+        jumpTablesOnly is set.
+    */
+    const std::set<Function *> &getSplitList() const { return splitList; }
 private:
     void considerSplittingFor(Function *function, NormalLink *link);
 };
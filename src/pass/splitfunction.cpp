@@ -1,6 +1,7 @@
 #include <capstone/capstone.h>
 #include "splitfunction.h"
 #include "analysis/controlflow.h"
+#include "analysis/manager.h"
 #include "analysis/walker.h"
 #include "chunk/concrete.h"
 #include "instr/semantic.h"
@@ -33,8 +34,10 @@ void SplitFunction::visit(Function *function) {
 
     //TemporaryLogLevel tll("pass", 10);
 
-    ControlFlowGraph cfg(function);
-    Preorder order(&cfg);
+    // the function is split below while the graph is still in use
+    auto cfg = AnalysisManager::getInstance()->getControlFlowGraph(function);
+    AnalysisManager::Pin pin(ANALYSIS_CONTROL_FLOW, function);
+    Preorder order(cfg);
     order.genFull(0);
 
     auto v = order.get();
@@ -45,7 +48,7 @@ void SplitFunction::visit(Function *function) {
             << " might contain " << v.size() << " functions");
 
         IF_LOG(10) {
-            cfg.dumpDot();
+            cfg->dumpDot();
             ChunkDumper dump;
             function->accept(&dump);
         }
@@ -53,15 +56,15 @@ void SplitFunction::visit(Function *function) {
         LOG(10, "orders");
         for(auto o : v) {
             for(auto i : o) {
-                LOG0(10, " " << cfg.get(i)->getBlock()->getAddress()
-                     << "(" << cfg.get(i)->getBlock()->getSize() << ")");
+                LOG0(10, " " << cfg->get(i)->getBlock()->getAddress()
+                     << "(" << cfg->get(i)->getBlock()->getSize() << ")");
             }
             LOG(10, "");
         }
 #endif
 
         for(size_t i = v.size() - 1; i > 0; --i) {
-            auto block = cfg.get(v[i][0])->getBlock();
+            auto block = cfg->get(v[i][0])->getBlock();
             auto instr = static_cast<Instruction *>(
                 block->getChildren()->getIterable()->get(0));
             auto semantic = instr->getSemantic();
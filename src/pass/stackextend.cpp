@@ -3,11 +3,13 @@
 #include <assert.h>
 #include "stackextend.h"
 #include "analysis/frametype.h"
+#include "analysis/manager.h"
 #include "analysis/jumptable.h"
 #include "analysis/usedefutil.h"
 #include "analysis/controlflow.h"
 #include "analysis/usedef.h"
 #include "analysis/walker.h"
+#include "analysis/liveness.h"
 #include "chunk/chunk.h"
 #include "chunk/concrete.h"
 #include "chunk/dump.h"
@@ -41,10 +43,20 @@ void StackExtendPass::visit(Module *module) {
 void StackExtendPass::visit(Function *function) {
     if(!shouldApply(function)) return;
 
-    FrameType frame(function);
+    // copy, since the cached FrameType is dropped once we mutate function
+    FrameType frame(*AnalysisManager::getInstance()->getFrameType(function));
     IF_LOG(10) frame.dump();
 
-    if(extendSize > 0) {
+    currentSaveList = saveList;
+    currentExtendSize = extendSize;
+#ifdef ARCH_X86_64
+    if(skipUnclobbered && !saveList.empty()) {
+        currentSaveList = pruneSaveList(function);
+        currentExtendSize = currentSaveList.size() * 8;
+    }
+#endif
+
+    if(currentExtendSize > 0) {
 #ifdef ARCH_X86_64
         extendStack(function, &frame);
 #else
@@ -57,6 +69,33 @@ void StackExtendPass::visit(Function *function) {
     IF_LOG(10) frame.dump();
 }
 
+std::vector<int> StackExtendPass::pruneSaveList(Function *function) {
+    auto module = dynamic_cast<Module *>(function->getParent()->getParent());
+    auto program = module ? dynamic_cast<Program *>(module->getParent())
+        : nullptr;
+    if(!program) return saveList;
+
+    // the call graph is only needed until the summary has been computed
+    InterproceduralLiveness summaries(
+        AnalysisManager::getInstance()->getCompactCallGraph(program));
+    auto clobbered = summaries.getSummary(function)->getClobbered();
+
+    std::vector<int> list;
+    std::vector<int> unused;
+    for(auto r : saveList) {
+        if(clobbered.get(r)) list.push_back(r);
+        else unused.push_back(r);
+    }
+
+    // keep the original parity, since saveList preserves stack alignment
+    if(!list.empty() && (list.size() % 2) != (saveList.size() % 2)) {
+        list.insert(list.begin(), unused.front());
+    }
+    LOG(10, "saving " << list.size() << " of " << saveList.size()
+        << " registers in " << function->getName());
+    return list;
+}
+
 #ifdef ARCH_X86_64
 static std::tuple<bool, size_t> getStackOffset(UDState *state) {
     typedef TreePatternBinary<TreeNodeAddition,
@@ -166,7 +205,7 @@ void StackExtendPass::adjustOffset(Instruction *instruction) {
     auto semantic = instruction->getSemantic();
 
     auto sfi = new StackFrameInstruction(semantic->getAssembly());
-    sfi->addToDisplacementValue(extendSize);
+    sfi->addToDisplacementValue(currentExtendSize);
     instruction->setSemantic(sfi);
     delete semantic;
 #endif
@@ -214,8 +253,8 @@ void StackExtendPass::extendStack(Function *function, FrameType *frame) {
 
     // prologue -- sub $0x8,%rsp
     auto firstB = function->getChildren()->getIterable()->get(0);
-    if(!saveList.empty()) {
-        for(auto r : saveList) {
+    if(!currentSaveList.empty()) {
+        for(auto r : currentSaveList) {
             std::vector<unsigned char> pushBin;
             if(r >= 8) {
                 pushBin.push_back(0x41);
@@ -231,19 +270,19 @@ void StackExtendPass::extendStack(Function *function, FrameType *frame) {
     else {
         std::vector<unsigned char> bin_sub = {0x48, 0x83, 0xec};
         for(int s = sizeof(int) * 4 - 8; s >= 0; s -= 8) {
-            unsigned char c = (extendSize >> s) & 0xff;
+            unsigned char c = (currentExtendSize >> s) & 0xff;
             if(c) bin_sub.push_back(c);
         }
         ChunkMutator(firstB).prepend(Disassemble::instruction(bin_sub));
     }
 
     // epilogue -- add $0x8,%rsp
-    if(!saveList.empty()) {
+    if(!currentSaveList.empty()) {
         for(auto ins : frame->getEpilogueInstrs()) {
             // Note: we use insertBeforeJumpTo, so we have to keep changing the
             // insertion point to be equivalent to insertBefore(ins, .)
             auto insPoint = ins;
-            for(auto r : saveList) {
+            for(auto r : currentSaveList) {
                 std::vector<unsigned char> popBin;
                 if(r >= 8) {
                     popBin.push_back(0x41);
@@ -261,7 +300,7 @@ void StackExtendPass::extendStack(Function *function, FrameType *frame) {
     else {
         std::vector<unsigned char> bin_add = {0x48, 0x83, 0xc4};
         for(int s = sizeof(int) * 4 - 8; s >= 0; s -= 8) {
-            unsigned char c = (extendSize >> s) & 0xff;
+            unsigned char c = (currentExtendSize >> s) & 0xff;
             if(c) bin_add.push_back(c);
         }
         for(auto ins : frame->getEpilogueInstrs()) {
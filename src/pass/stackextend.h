@@ -15,10 +15,21 @@ class StackExtendPass : public ChunkPass {
 private:
     size_t extendSize;
     const std::vector<int> saveList;
+    bool skipUnclobbered;
+    // per-function copies of the above, possibly pruned (X86_64)
+    std::vector<int> currentSaveList;
+    size_t currentExtendSize;
 
 public:
     StackExtendPass(size_t extendSize, const std::vector<int> saveList={})
-        : extendSize(extendSize), saveList(saveList) {}
+        : extendSize(extendSize), saveList(saveList), skipUnclobbered(false),
+          currentSaveList(saveList), currentExtendSize(extendSize) {}
+
+    /** Only save registers in saveList that the function (or one of its
+        callees) may actually overwrite, according to the register summary
+        from InterproceduralLiveness. X86_64 only.
+    */
+    void setSkipUnclobbered(bool skip) { skipUnclobbered = skip; }
 
     virtual void visit(Module *module);
     virtual void visit(Function *function);
@@ -32,6 +43,7 @@ private:
     // X86_64
     void extendStack(Function *function, FrameType *frame);
     void adjustOffset(Instruction *instruction);
+    std::vector<int> pruneSaveList(Function *function);
 
     virtual void useStack(Function *function, FrameType *frame) {};
 };
@@ -1,44 +1,38 @@
 #include <sstream>
 #include "stackxor.h"
+#include "analysis/framesummary.h"
+#include "analysis/manager.h"
 #include "disasm/disassemble.h"
 #include "operation/mutator.h"
 #include "instr/concrete.h"
 
 void StackXOR::visit(Function *function) {
+#ifdef ARCH_X86_64
+    // find exits and calls before the prologue changes the function
+    auto summary = AnalysisManager::getInstance()->getFrameSummary(function);
+    auto instrList = FrameSummary::getInstructionList(function);
+    auto pointList = FrameSummary::getInstructions(instrList,
+        summary->getExitList());
+    for(auto instr : FrameSummary::getInstructions(instrList,
+        summary->getCallList())) {
+
+        // includes IndirectCallInstruction and DataLinkedControlFlowInstruction
+        if(!dynamic_cast<ControlFlowInstruction *>(instr->getSemantic())) {
+            pointList.push_back(instr);
+        }
+    }
+#endif
+
     auto block1 = function->getChildren()->getIterable()->get(0);
     Instruction *first = nullptr;
     if(block1->getChildren()->getIterable()->getCount() > 0) {
         first = block1->getChildren()->getIterable()->get(0);
     }
     addInstructions(block1, first, false);
-    recurse(function);
-}
 
-void StackXOR::visit(Block *block) {
-    recurse(block);
-}
-
-void StackXOR::visit(Instruction *instruction) {
-    auto parent = dynamic_cast<Block *>(instruction->getParent());
 #ifdef ARCH_X86_64
-    auto s = instruction->getSemantic();
-    if(dynamic_cast<ReturnInstruction *>(s)) {
-        addInstructions(parent, instruction, true);
-    }
-    else if(auto v = dynamic_cast<ControlFlowInstruction *>(s)) {
-        // not a call, but still external; must be tail recursion
-        if(v->getMnemonic() != "callq" && s->getLink()->isExternalJump()) {
-            addInstructions(parent, instruction, true);
-        }
-    }
-    else if(auto v = dynamic_cast<IndirectJumpInstruction *>(s)) {
-        if(!v->isForJumpTable()) {
-            addInstructions(parent, instruction, true);
-        }
-    }
-    else if(s->isControlFlow()) {
-        // includes IndirectCallInstruction and DataLinkedControlFlowInstruction
-        addInstructions(parent, instruction, true);
+    for(auto instr : pointList) {
+        addInstructions(dynamic_cast<Block *>(instr->getParent()), instr, true);
     }
 #endif
 }
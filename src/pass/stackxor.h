@@ -10,8 +10,6 @@ private:
 public:
     StackXOR(int xorOffset) : xorOffset(xorOffset) {}
     virtual void visit(Function *function);
-    virtual void visit(Block *block);
-    virtual void visit(Instruction *instruction);
 private:
     void addInstructions(Block *block, Instruction *instruction,
         bool beforeJumpTo);
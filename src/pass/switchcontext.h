@@ -40,7 +40,7 @@ public:
     SwitchContextPass(size_t contextSize = EGALITO_CONTEXT_SIZE,
         const std::vector<int> saveList = REGISTER_SAVE_LIST)
         : StackExtendPass(contextSize, saveList),
-          contextSize(contextSize) {}
+          contextSize(contextSize) { setSkipUnclobbered(true); }
 private:
     void useStack(Function *function, FrameType *frame);
     void addSaveContextAt(Function *function, FrameType *frame);
@@ -1,6 +1,8 @@
 #include <cassert>
 #include <cstring>
 #include "usegstable.h"
+#include "analysis/indirectcall.h"
+#include "analysis/manager.h"
 #include "chunk/concrete.h"
 #include "chunk/gstable.h"
 #include "chunk/link.h"
@@ -8,12 +10,23 @@
 #include "instr/concrete.h"
 #include "operation/find2.h"
 #include "operation/mutator.h"
+#include "pass/devirtualize.h"
 #include "disasm/disassemble.h"
 #include "chunk/dump.h"
 #include "log/log.h"
 #include "log/temp.h"
 
 void UseGSTablePass::visit(Program *program) {
+    // these go through the GS table as direct calls, without the indirect
+    // call sequence; copied, since rewriting invalidates the analysis
+    auto targets = AnalysisManager::getInstance()
+        ->getIndirectCallTargets(program);
+    for(auto &kv : targets->getSites()) {
+        if(auto target = targets->getSingleTarget(kv.first)) {
+            devirtualList[kv.first] = target;
+        }
+    }
+
     redirectEgalitoFunctionPointers();
     recurse(program);
     if(runtime) overwriteBootArguments();
@@ -61,11 +74,27 @@ void UseGSTablePass::visit(Block *block) {
             }
         }
         else if(dynamic_cast<IndirectCallInstruction *>(semantic)) {
-            indirectCalls.emplace_back(block, instr);
+            auto it = devirtualList.find(instr);
+            if(it != devirtualList.end()
+                && DevirtualizePass::devirtualize(instr, it->second)) {
+
+                directCalls.emplace_back(block, instr);
+            }
+            else {
+                indirectCalls.emplace_back(block, instr);
+            }
         }
         else if(auto v = dynamic_cast<IndirectJumpInstruction *>(semantic)) {
             if(!v->isForJumpTable()) {
-                indirectTailRecursions.emplace_back(block, instr);
+                auto it = devirtualList.find(instr);
+                if(it != devirtualList.end()
+                    && DevirtualizePass::devirtualize(instr, it->second)) {
+
+                    tailRecursions.emplace_back(block, instr);
+                }
+                else {
+                    indirectTailRecursions.emplace_back(block, instr);
+                }
             }
             else {
                 jumpTableJumps.emplace_back(block, instr);
@@ -2,6 +2,7 @@
 #define EGALITO_PASS_USE_GS_TABLE_H
 
 #include <vector>
+#include <map>
 #include "chunkpass.h"
 
 class GSTable;
@@ -28,6 +29,9 @@ private:
     std::vector<std::pair<Block *, Instruction *>> pointerLinks;
 
     std::vector<std::pair<Block *, Instruction *>> functionReturns;
+
+    // indirect calls and jumps with only one possible target
+    std::map<Instruction *, Function *> devirtualList;
 public:
     UseGSTablePass(Conductor *conductor, GSTable *gsTable, IFuncList *ifuncList,
         bool runtime = true)
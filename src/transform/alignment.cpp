@@ -0,0 +1,56 @@
+#include <algorithm>
+#include <ostream>
+#include <iomanip>
+#include "alignment.h"
+#include "chunk/function.h"
+
+AlignmentPolicy::AlignmentPolicy()
+#ifdef ARCH_X86_64
+    : defaultAlignment(16), hotAlignment(32), loopAlignment(32),
+#else
+    : defaultAlignment(16), hotAlignment(64), loopAlignment(32),
+#endif
+    hugePageText(false), hotTextEnd(0) {}
+
+bool AlignmentPolicy::isColdPart(Function *function) {
+    // not e.g. "foo.coldstart", which is an ordinary function
+    static const std::string suffix = ".cold";
+    auto name = function->getName();
+    if(name.find(suffix + ".") != std::string::npos) return true;
+    return name.size() >= suffix.size()
+        && name.compare(name.size() - suffix.size(), suffix.size(),
+            suffix) == 0;
+}
+
+size_t AlignmentPolicy::getFunctionAlignment(Function *function) const {
+    if(isColdPart(function)) return 1;
+    if(hotSet.empty()) return defaultAlignment;
+    return hotSet.count(function) ? hotAlignment : 1;
+}
+
+size_t AlignmentPolicy::getLoopAlignment(Function *function) const {
+    if(!hotSet.count(function)) return 1;
+    return std::min(loopAlignment, getFunctionAlignment(function));
+}
+
+void AlignmentPolicy::addEntryPadding(Function *function, size_t bytes) {
+    if(bytes) paddingMap[function].entry += bytes;
+}
+
+void AlignmentPolicy::addLoopPadding(Function *function, size_t bytes) {
+    if(bytes) paddingMap[function].loops += bytes;
+}
+
+void AlignmentPolicy::printReport(std::ostream &stream) const {
+    size_t entry = 0, loops = 0;
+    for(const auto &kv : paddingMap) {
+        stream << std::setw(6) << std::dec << kv.second.entry
+            << std::setw(6) << kv.second.loops
+            << "  [" << kv.first->getName() << "]\n";
+        entry += kv.second.entry;
+        loops += kv.second.loops;
+    }
+    stream << "padding: " << entry << " bytes before functions, "
+        << loops << " bytes before loop headers, in "
+        << paddingMap.size() << " functions\n";
+}
@@ -0,0 +1,75 @@
+#ifndef EGALITO_TRANSFORM_ALIGNMENT_H
+#define EGALITO_TRANSFORM_ALIGNMENT_H
+
+#include <map>
+#include <set>
+#include <iosfwd>
+#include "types.h"
+
+class Function;
+
+/** Decides how Generator aligns the code it lays out, and keeps track of
+    the padding that costs.
+
+    Without a profile every function gets the default alignment. Once any
+    function is marked hot, hot functions get the hot alignment and the
+    headers of their innermost loops the loop alignment (capped at the
+    function's own), while all other functions, like the cold parts split
+    off by BlockReorderPass, are packed with no padding at all.
+
+    The defaults suit the 32-byte fetch/decoded-icache windows of recent
+    x86 cores and the 16- to 64-byte fetch blocks of aarch64 ones.
+
+    With huge-page text, the hot functions of the whole program are placed
+    first and padded out to a 2MB boundary, so that the ELF generators can
+    map them as a segment of their own which may be backed by huge pages
+    (see app/order/inject/hugetext.c).
+*/
+class AlignmentPolicy {
+public:
+    struct Padding {
+        size_t entry;   // before the function, to align its start
+        size_t loops;   // inside the function, before loop headers
+    };
+private:
+    size_t defaultAlignment;
+    size_t hotAlignment;
+    size_t loopAlignment;
+    bool hugePageText;
+    address_t hotTextEnd;
+    std::set<Function *> hotSet;
+    std::map<Function *, Padding> paddingMap;
+public:
+    AlignmentPolicy();
+
+    void setDefaultAlignment(size_t alignment) { defaultAlignment = alignment; }
+    void setHotAlignment(size_t alignment) { hotAlignment = alignment; }
+    void setLoopAlignment(size_t alignment) { loopAlignment = alignment; }
+    void setHot(Function *function) { hotSet.insert(function); }
+    void setHugePageText(bool enable) { hugePageText = enable; }
+    void setHotTextEnd(address_t end) { hotTextEnd = end; }
+
+    bool isHot(Function *function) const { return hotSet.count(function); }
+    bool getHugePageText() const { return hugePageText; }
+    /** End of the padded hot text, or 0 if none was laid out. */
+    address_t getHotTextEnd() const { return hotTextEnd; }
+
+    /** Powers of two; 1 means no alignment. */
+    size_t getFunctionAlignment(Function *function) const;
+    size_t getLoopAlignment(Function *function) const;
+
+    void addEntryPadding(Function *function, size_t bytes);
+    void addLoopPadding(Function *function, size_t bytes);
+    const std::map<Function *, Padding> &getPaddingMap() const
+        { return paddingMap; }
+
+    /** Prints the padding of each padded function and the totals. */
+    void printReport(std::ostream &stream) const;
+
+    /** e.g. "foo.cold" from BlockReorderPass, or "foo.cold.12" from gcc */
+    static bool isColdPart(Function *function);
+
+    static const size_t HUGE_PAGE_SIZE = 0x200000;
+};
+
+#endif
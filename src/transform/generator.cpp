@@ -1,12 +1,20 @@
 #include <iostream>  // for std::cout.flush()
 #include <iomanip>
+#include <algorithm>
+#include <set>
 #include <cstdio>  // for std::fflush
 #include <cstring>
 #include "generator.h"
+#include "alignment.h"
+#include "analysis/loops.h"
+#include "analysis/manager.h"
 #include "chunk/cache.h"
+#include "disasm/disassemble.h"
 #include "operation/mutator.h"
 #include "operation/find2.h"
 #include "pass/clearspatial.h"
+#include "pass/promotejumps.h"
+#include "pass/shrinkjumps.h"
 #include "instr/semantic.h"
 #include "instr/writer.h"
 
@@ -138,6 +146,14 @@ void GeneratorHelper<ChunkType>::addPaddingBytes(ChunkType *chunk, Sandbox *sand
 }
 
 void Generator::assignAddresses(Program *program) {
+    if(alignment && alignment->getHugePageText()) {
+        std::vector<Function *> order;
+        for(auto module : CIter::modules(program)) {
+            auto moduleOrder = pickFunctionOrder(module);
+            order.insert(order.end(), moduleOrder.begin(), moduleOrder.end());
+        }
+        allocateHotText(order);
+    }
     for(auto module : CIter::modules(program)) {
         assignAddresses(module);
     }
@@ -150,6 +166,9 @@ void Generator::generateCode(Program *program, const std::vector<Function *> &or
 }
 
 void Generator::assignAddresses(Program *program, const std::vector<Function *> &order) {
+    if(alignment && alignment->getHugePageText()) {
+        allocateHotText(order);
+    }
     for(auto module : CIter::modules(program)) {
         assignAddresses(module, order);
     }
@@ -186,6 +205,10 @@ std::vector<Function *> Generator::pickFunctionOrder(Module *module) {
         if(a == startup_64) return true;
         if(b == startup_64) return false;
 #endif
+        // cold parts of functions go after all other code
+        bool aCold = AlignmentPolicy::isColdPart(a);
+        bool bCold = AlignmentPolicy::isColdPart(b);
+        if(aCold != bCold) return bCold;
         return a->getAddress() < b->getAddress();
     });
 #endif
@@ -193,16 +216,222 @@ std::vector<Function *> Generator::pickFunctionOrder(Module *module) {
     return order;
 }
 
-void Generator::assignAddresses(Module *module) {
-    auto order = pickFunctionOrder(module);
+// Intra-function jump sizes do not depend on where functions are placed, so
+// they can be settled before any slots are allocated.
+void Generator::relaxJumps(const std::vector<Function *> &order) {
+    ShrinkJumpsPass shrinkJumps;
+    for(auto f : order) {
+        if(hotText.count(f)) continue;
+        f->accept(&shrinkJumps);
+    }
+    LOG(1, "shrank " << std::dec << shrinkJumps.getShrunkCount()
+        << " jumps to 8-bit displacements");
+}
+
+void Generator::allocateFunctions(const std::vector<Function *> &order) {
+    if(alignment) {
+        for(auto f : order) {
+            if(!hotText.count(f)) alignLoops(f);
+        }
+    }
+
+    Function *prev = nullptr;
     for(auto f : order) {
+        if(hotText.count(f)) continue;
+        if(alignment && prev) {
+            padBefore(f, prev, alignment->getFunctionAlignment(f));
+        }
         auto slot = sandbox->allocate(f->getSize());
         LOG(2, "    alloc 0x" << std::hex << slot.getAddress()
             << " for [" << f->getName()
             << "] size " << std::dec << f->getSize());
         GeneratorHelper<Function>().assignAddress(f, slot);
+        prev = f;
+    }
+}
+
+// Places the hot functions of the whole program ahead of everything else,
+// then extends the slot of the last one to a huge page boundary so that no
+// other code shares the huge pages. This must run before any other slots
+// are allocated.
+void Generator::allocateHotText(const std::vector<Function *> &order) {
+    std::vector<Function *> hot;
+    for(auto f : order) {
+        if(alignment->isHot(f) && !hotText.count(f)) hot.push_back(f);
+    }
+    if(hot.empty()) return;
+
+    relaxJumps(hot);
+    allocateFunctions(hot);
+    hotText.insert(hot.begin(), hot.end());
+
+    const size_t align = AlignmentPolicy::HUGE_PAGE_SIZE;
+    if(hot.front()->getAddress() & (align - 1)) {
+        LOG(1, "WARNING: hot text does not start on a huge page boundary");
+        return;
+    }
+
+    auto last = hot.back();
+    auto lastSlot = last->getAssignedPosition()->getSlot();
+    address_t end = lastSlot.getAddress() + lastSlot.getSize();
+    size_t padding = (align - (end & (align - 1))) & (align - 1);
+    if(padding) {
+        auto slot = sandbox->allocate(padding);
+        if(slot.getAddress() != end) {
+            LOG(1, "WARNING: sandbox is not contiguous, cannot pad hot text");
+            return;
+        }
+        GeneratorHelper<Function>().assignAddress(last,
+            Slot(lastSlot.getAddress(), lastSlot.getSize() + slot.getSize()));
+    }
+    LOG(1, "hot text of " << std::dec << hot.size() << " functions ends at 0x"
+        << std::hex << (end + padding) << ", " << std::dec << padding
+        << " bytes of padding");
+    alignment->setHotTextEnd(end + padding);
+}
+
+// Extends the slot of prev (which addPaddingBytes fills with nops) up to the
+// next multiple of align; this relies on the sandbox handing out contiguous
+// slots, as the watermark allocators do.
+void Generator::padBefore(Function *function, Function *prev, size_t align) {
+    if(align <= 1) return;
+
+    auto prevSlot = prev->getAssignedPosition()->getSlot();
+    address_t end = prevSlot.getAddress() + prevSlot.getSize();
+    size_t padding = (align - (end & (align - 1))) & (align - 1);
+    if(!padding) return;
+
+    auto slot = sandbox->allocate(padding);
+    if(slot.getAddress() != end) {
+        LOG(1, "WARNING: sandbox is not contiguous, cannot align ["
+            << function->getName() << "]");
+        return;
+    }
+    GeneratorHelper<Function>().assignAddress(prev,
+        Slot(prevSlot.getAddress(), prevSlot.getSize() + slot.getSize()));
+    alignment->addEntryPadding(function, slot.getSize());
+}
+
+static Instruction *makeNop(size_t size) {
+#ifdef ARCH_X86_64
+    // the recommended multi-byte nops, by size
+    static const char *nopList[] = {
+        "\x90",
+        "\x66\x90",
+        "\x0f\x1f\x00",
+        "\x0f\x1f\x40\x00",
+        "\x0f\x1f\x44\x00\x00",
+        "\x66\x0f\x1f\x44\x00\x00",
+        "\x0f\x1f\x80\x00\x00\x00\x00",
+        "\x0f\x1f\x84\x00\x00\x00\x00\x00",
+        "\x66\x0f\x1f\x84\x00\x00\x00\x00\x00",
+    };
+    const char *bytes = nopList[size - 1];
+    return Disassemble::instruction(
+        std::vector<unsigned char>(bytes, bytes + size));
+#elif defined(ARCH_AARCH64)
+    (void)size;
+    return Disassemble::instruction(
+        std::vector<unsigned char>({0x1f, 0x20, 0x03, 0xd5}));
+#elif defined(ARCH_ARM)
+    (void)size;
+    return Disassemble::instruction(
+        std::vector<unsigned char>({0x00, 0xf0, 0x20, 0xe3}));
+#elif defined(ARCH_RISCV)
+    (void)size;
+    return Disassemble::instruction(
+        std::vector<unsigned char>({0x13, 0x00, 0x00, 0x00}));
+#else
+    (void)size;
+    return nullptr;
+#endif
+}
+
+static Block *makePaddingBlock(size_t size) {
+#ifdef ARCH_X86_64
+    const size_t maxNop = 9;
+#else
+    const size_t maxNop = 4;
+#endif
+    auto block = new Block();
+    while(size > 0) {
+        auto nopSize = std::min(size, maxNop);
+        ChunkMutator(block, false).append(makeNop(nopSize));
+        size -= nopSize;
+    }
+    {
+        ChunkMutator(block, true);
+    }
+    return block;
+}
+
+static void deletePaddingBlock(Function *function, Block *block) {
+    ChunkMutator(function).remove(block);
+    for(auto instr : CIter::children(block)) {
+        delete instr->getSemantic();
+        delete instr;
+    }
+    delete block;
+}
+
+// Inserts nop blocks before the headers of innermost loops. Jumps across
+// the padding may have to be widened, which moves the headers again, so
+// this repeats a few times; a header may stay unaligned, but the code is
+// always correct.
+void Generator::alignLoops(Function *function) {
+    size_t align = alignment->getLoopAlignment(function);
+    if(align <= 1 || function->getCache()) return;
+
+    std::set<Block *> headerSet;
+    auto forest = AnalysisManager::getInstance()->getLoopForest(function);
+    for(auto loop : forest->getLoopList()) {
+        if(!loop->getChildList().empty() || loop->isIrreducible()) continue;
+        headerSet.insert(loop->getHeader());
+    }
+    headerSet.erase(function->getChildren()->getIterable()->get(0));
+
+    std::vector<Block *> headerList;  // in layout order
+    for(auto block : CIter::children(function)) {
+        if(headerSet.count(block)) headerList.push_back(block);
+    }
+    if(headerList.empty()) return;
+
+    std::vector<Block *> paddingList;
+    size_t padding = 0;
+    for(int round = 0; round < 4; round ++) {
+        for(auto block : paddingList) deletePaddingBlock(function, block);
+        paddingList.clear();
+        padding = 0;
+
+        for(auto header : headerList) {
+            address_t offset = header->getAddress() - function->getAddress();
+            size_t size = (align - (offset & (align - 1))) & (align - 1);
+            if(!size) continue;
+
+            auto block = makePaddingBlock(size);
+            ChunkMutator(function).insertBefore(header, block);
+            paddingList.push_back(block);
+            padding += size;
+        }
+
+        auto size = function->getSize();
+#ifdef ARCH_X86_64
+        PromoteJumpsPass promoteJumps;
+        function->accept(&promoteJumps);
+#endif
+        if(function->getSize() == size) break;
     }
 
+    LOG(10, "aligned " << headerList.size() << " loop headers in ["
+        << function->getName() << "] with " << padding << " bytes");
+    alignment->addLoopPadding(function, padding);
+}
+
+void Generator::assignAddresses(Module *module) {
+    auto order = pickFunctionOrder(module);
+    relaxJumps(order);
+    allocateFunctions(order);
+
     if(module->getPLTList()) {
         // these don't have to be contiguous
         //const size_t pltSize = PLTList::getPLTTrampolineSize();
@@ -238,13 +467,8 @@ void Generator::generateCode(Module *module) {
 }
 
 void Generator::assignAddresses(Module *module, const std::vector<Function *> &order) {
-    for(auto f : order) {
-        auto slot = sandbox->allocate(f->getSize());
-        LOG(2, "    alloc 0x" << std::hex << slot.getAddress()
-            << " for [" << f->getName()
-            << "] size " << std::dec << f->getSize());
-        GeneratorHelper<Function>().assignAddress(f, slot);
-    }
+    relaxJumps(order);
+    allocateFunctions(order);
 
     if(module->getPLTList()) {
         // these don't have to be contiguous
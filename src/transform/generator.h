@@ -1,18 +1,26 @@
 #ifndef EGALITO_TRANSFORM_GENERATOR_H
 #define EGALITO_TRANSFORM_GENERATOR_H
 
+#include <set>
 #include <vector>
 #include "sandbox.h"
 
 class PLTTrampoline;
+class AlignmentPolicy;
 
 class Generator {
 private:
     Sandbox *sandbox;
     bool useDisps;
+    AlignmentPolicy *alignment;
+    std::set<Function *> hotText;  // already placed by allocateHotText
 public:
     Generator(Sandbox *sandbox, bool useDisps = true)
-        : sandbox(sandbox), useDisps(useDisps) {}
+        : sandbox(sandbox), useDisps(useDisps), alignment(nullptr) {}
+
+    /** Without a policy, functions are packed as the allocator sees fit. */
+    void setAlignmentPolicy(AlignmentPolicy *alignment)
+        { this->alignment = alignment; }
 
     void assignAddresses(Program *program);
     void generateCode(Program *program);
@@ -38,6 +46,11 @@ public:
     void jumpToSandbox(Module *module, const char *function = "main");
 private:
     std::vector<Function *> pickFunctionOrder(Module *module);
+    void relaxJumps(const std::vector<Function *> &order);
+    void allocateFunctions(const std::vector<Function *> &order);
+    void allocateHotText(const std::vector<Function *> &order);
+    void padBefore(Function *function, Function *prev, size_t align);
+    void alignLoops(Function *function);
     void pickFunctionAddressInSandbox(Function *function);
     void pickPLTAddressInSandbox(PLTTrampoline *trampoline);
 };
@@ -0,0 +1,247 @@
+#include <cstring>
+#include <cctype>
+#include <cstdint>
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+#include "bytescan.h"
+
+ByteScanner::ByteScanner(const std::string &pattern, Engine engine)
+    : pattern(pattern), engine(engine) {
+
+    // never use instructions this CPU does not have
+    if(engine > getBestEngine()) this->engine = getBestEngine();
+}
+
+// checks candidates from offset start onwards, one at a time
+static void findScalar(const char *data, size_t size,
+    const std::string &pattern, size_t start, std::vector<size_t> &out) {
+
+    size_t n = pattern.size();
+    if(size < n) return;
+    size_t limit = size - n + 1;
+
+    for(size_t i = start; i < limit; ) {
+        auto found = static_cast<const char *>(
+            std::memchr(data + i, pattern[0], limit - i));
+        if(!found) break;
+
+        i = found - data;
+        if(!std::memcmp(data + i + 1, pattern.data() + 1, n - 1)) {
+            out.push_back(i);
+        }
+        i ++;
+    }
+}
+
+#ifdef __x86_64__
+// The first and last byte of the pattern are compared at 16 or 32 positions
+// at once; the bytes in between only for positions where both of those match.
+
+static void findSSE2(const char *data, size_t size,
+    const std::string &pattern, std::vector<size_t> &out) {
+
+    size_t n = pattern.size();
+    if(size < n) return;
+    size_t limit = size - n + 1;
+
+    const __m128i first = _mm_set1_epi8(pattern[0]);
+    const __m128i last = _mm_set1_epi8(pattern[n - 1]);
+    size_t i = 0;
+    for( ; i + 16 <= limit; i += 16) {
+        auto a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        auto b = _mm_loadu_si128(
+            reinterpret_cast<const __m128i *>(data + i + n - 1));
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(
+            _mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+        while(mask) {
+            size_t offset = i + __builtin_ctz(mask);
+            if(n <= 2 || !std::memcmp(data + offset + 1, pattern.data() + 1,
+                n - 2)) {
+
+                out.push_back(offset);
+            }
+            mask &= mask - 1;
+        }
+    }
+    findScalar(data, size, pattern, i, out);
+}
+
+__attribute__((target("avx2")))
+static void findAVX2(const char *data, size_t size,
+    const std::string &pattern, std::vector<size_t> &out) {
+
+    size_t n = pattern.size();
+    if(size < n) return;
+    size_t limit = size - n + 1;
+
+    const __m256i first = _mm256_set1_epi8(pattern[0]);
+    const __m256i last = _mm256_set1_epi8(pattern[n - 1]);
+    size_t i = 0;
+    for( ; i + 32 <= limit; i += 32) {
+        auto a = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(data + i));
+        auto b = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(data + i + n - 1));
+        uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(
+            _mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+        while(mask) {
+            size_t offset = i + __builtin_ctz(mask);
+            if(n <= 2 || !std::memcmp(data + offset + 1, pattern.data() + 1,
+                n - 2)) {
+
+                out.push_back(offset);
+            }
+            mask &= mask - 1;
+        }
+    }
+    findScalar(data, size, pattern, i, out);
+}
+#endif
+
+std::vector<size_t> ByteScanner::findAll(const char *data, size_t size) const {
+    std::vector<size_t> out;
+    if(pattern.empty()) return out;
+
+    switch(engine) {
+#ifdef __x86_64__
+    case ENGINE_AVX2:
+        findAVX2(data, size, pattern, out);
+        break;
+    case ENGINE_SSE2:
+        findSSE2(data, size, pattern, out);
+        break;
+#endif
+    default:
+        findScalar(data, size, pattern, 0, out);
+        break;
+    }
+    return out;
+}
+
+class ByteRunBuilder {
+private:
+    size_t minLength;
+    size_t start;
+    bool inRun;
+    std::vector<ByteScanner::Run> &out;
+public:
+    ByteRunBuilder(size_t minLength, std::vector<ByteScanner::Run> &out)
+        : minLength(minLength), start(0), inRun(false), out(out) {}
+
+    void match(size_t offset)
+        { if(!inRun) { start = offset; inRun = true; } }
+    void mismatch(size_t offset)
+        { if(inRun) { add(offset); inRun = false; } }
+    void finish(size_t size) { mismatch(size); }
+
+    // a block of width bytes, where bit i of mask says whether byte i matched
+    void block(size_t offset, uint32_t mask, size_t width) {
+        uint32_t all = (width == 32 ? ~0u : (1u << width) - 1);
+        if(mask == all) match(offset);
+        else if(mask == 0) mismatch(offset);
+        else {
+            for(size_t i = 0; i < width; i ++) {
+                if(mask & (1u << i)) match(offset + i);
+                else mismatch(offset + i);
+            }
+        }
+    }
+private:
+    void add(size_t end)
+        { if(end - start >= minLength) out.emplace_back(start, end - start); }
+};
+
+#ifdef __x86_64__
+static size_t findRunsSSE2(const char *data, size_t size, char value,
+    ByteRunBuilder &runs) {
+
+    const __m128i v = _mm_set1_epi8(value);
+    size_t i = 0;
+    for( ; i + 16 <= size; i += 16) {
+        auto a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        runs.block(i, _mm_movemask_epi8(_mm_cmpeq_epi8(a, v)), 16);
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t findRunsAVX2(const char *data, size_t size, char value,
+    ByteRunBuilder &runs) {
+
+    const __m256i v = _mm256_set1_epi8(value);
+    size_t i = 0;
+    for( ; i + 32 <= size; i += 32) {
+        auto a = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(data + i));
+        runs.block(i, _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, v)), 32);
+    }
+    return i;
+}
+#endif
+
+std::vector<ByteScanner::Run> ByteScanner::findRuns(const char *data,
+    size_t size, char value, size_t minLength, Engine engine) {
+
+    std::vector<Run> out;
+    ByteRunBuilder runs(minLength ? minLength : 1, out);
+    if(engine > getBestEngine()) engine = getBestEngine();
+
+    size_t i = 0;
+    switch(engine) {
+#ifdef __x86_64__
+    case ENGINE_AVX2:
+        i = findRunsAVX2(data, size, value, runs);
+        break;
+    case ENGINE_SSE2:
+        i = findRunsSSE2(data, size, value, runs);
+        break;
+#endif
+    default:
+        break;
+    }
+
+    for( ; i < size; i ++) {
+        if(data[i] == value) runs.match(i);
+        else runs.mismatch(i);
+    }
+    runs.finish(size);
+    return out;
+}
+
+ByteScanner::Engine ByteScanner::getBestEngine() {
+#ifdef __x86_64__
+    static const Engine best = __builtin_cpu_supports("avx2")
+        ? ENGINE_AVX2 : ENGINE_SSE2;  // SSE2 is part of x86_64
+    return best;
+#else
+    return ENGINE_SCALAR;
+#endif
+}
+
+const char *ByteScanner::getEngineName(Engine engine) {
+    switch(engine) {
+    case ENGINE_SCALAR: return "scalar";
+    case ENGINE_SSE2:   return "sse2";
+    case ENGINE_AVX2:   return "avx2";
+    default:            return "???";
+    }
+}
+
+std::string ByteScanner::parseHex(const std::string &text) {
+    std::string bytes;
+    int high = -1;
+    for(char c : text) {
+        if(std::isspace(static_cast<unsigned char>(c))) continue;
+        if(!std::isxdigit(static_cast<unsigned char>(c))) return "";
+
+        int digit = std::isdigit(static_cast<unsigned char>(c))
+            ? c - '0' : std::tolower(static_cast<unsigned char>(c)) - 'a' + 10;
+        if(high < 0) high = digit;
+        else {
+            bytes.push_back(static_cast<char>((high << 4) | digit));
+            high = -1;
+        }
+    }
+    return (high < 0) ? bytes : "";
+}
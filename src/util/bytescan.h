@@ -0,0 +1,53 @@
+#ifndef EGALITO_UTIL_BYTESCAN_H
+#define EGALITO_UTIL_BYTESCAN_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+/** Finds every occurrence of a short byte pattern in a buffer, and runs of
+    a repeated byte (e.g. 0x90 or 0xcc padding), in a single sweep.
+
+    On x86_64 hosts, 32 (AVX2) or 16 (SSE2) candidate positions are tested
+    at once by comparing against the pattern's first and last byte; only
+    positions where both match are compared in full. The engine is chosen
+    at runtime from what the CPU supports, and the scalar version is always
+    available, so results do not depend on the engine.
+*/
+class ByteScanner {
+public:
+    enum Engine {
+        ENGINE_SCALAR,
+        ENGINE_SSE2,
+        ENGINE_AVX2
+    };
+    typedef std::pair<size_t, size_t> Run;  // offset, length
+private:
+    std::string pattern;
+    Engine engine;
+public:
+    ByteScanner(const std::string &pattern, Engine engine = getBestEngine());
+
+    const std::string &getPattern() const { return pattern; }
+    Engine getEngine() const { return engine; }
+
+    /** Returns the offsets of all (possibly overlapping) matches, in
+        increasing order.
+    */
+    std::vector<size_t> findAll(const char *data, size_t size) const;
+
+    /** Returns maximal runs of value that are at least minLength long. */
+    static std::vector<Run> findRuns(const char *data, size_t size,
+        char value, size_t minLength = 1, Engine engine = getBestEngine());
+
+    static Engine getBestEngine();
+    static const char *getEngineName(Engine engine);
+
+    /** Parses hex digits such as "f30f1efa" or "f3 0f 1e fa". Returns an
+        empty string on malformed input.
+    */
+    static std::string parseHex(const std::string &text);
+};
+
+#endif
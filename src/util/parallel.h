@@ -0,0 +1,56 @@
+#ifndef EGALITO_UTIL_PARALLEL_H
+#define EGALITO_UTIL_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstddef>
+
+/** Calls func(i) for every i in [0, count) using up to threads workers;
+    0 means one per hardware thread. Indices are handed out one at a time,
+    since work items (functions, modules) differ wildly in size.
+
+    Each index is run exactly once, and every call has finished when this
+    returns. Indices are handed out in increasing order, but the calls may
+    run and finish in any order; with a single worker they all run in order
+    on the calling thread. To get results in index order, write them to
+    slot i.
+
+    func must be safe to run concurrently with itself. If it throws, the
+    remaining indices are skipped and the first exception is rethrown here.
+*/
+template <typename FuncType>
+void parallelFor(size_t count, unsigned threads, FuncType func) {
+    if(threads == 0) threads = std::thread::hardware_concurrency();
+    threads = std::min<size_t>(threads, count);
+    if(threads <= 1) {
+        for(size_t i = 0; i < count; i ++) func(i);
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    std::vector<std::thread> workers;
+    for(unsigned t = 0; t < threads; t ++) {
+        workers.emplace_back([&] () {
+            for(size_t i; (i = next++) < count; ) {
+                try {
+                    func(i);
+                }
+                catch(...) {
+                    std::lock_guard<std::mutex> guard(errorMutex);
+                    if(!error) error = std::current_exception();
+                    next = count;
+                }
+            }
+        });
+    }
+    for(auto &worker : workers) worker.join();
+    if(error) std::rethrow_exception(error);
+}
+
+#endif
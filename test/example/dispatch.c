@@ -0,0 +1,46 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Call-heavy loop for measuring per-call hardening overhead: small leaf
+   functions reached both directly and through a function pointer that is
+   called twice per iteration. */
+
+typedef unsigned long (*op_t)(unsigned long, unsigned long);
+
+static __attribute__((noinline)) unsigned long add(unsigned long a,
+    unsigned long b) {
+
+    return a + b;
+}
+
+static __attribute__((noinline)) unsigned long mix(unsigned long a,
+    unsigned long b) {
+
+    return (a ^ (b << 7)) * 0x9e3779b97f4a7c15ul;
+}
+
+static __attribute__((noinline)) unsigned long sum(const unsigned long *v,
+    int n) {
+
+    unsigned long total = 0;
+    for(int i = 0; i < n; i ++) total += v[i];
+    return total;
+}
+
+static __attribute__((noinline)) unsigned long run(op_t op, long count) {
+    unsigned long v[4] = {1, 2, 3, 4};
+    unsigned long x = 0;
+    for(long i = 0; i < count; i ++) {
+        x = op(x, i);
+        x = op(x, v[i & 3]);
+        v[i & 3] = add(x, sum(v, 4));
+    }
+    return x;
+}
+
+int main(int argc, char *argv[]) {
+    long count = (argc > 1) ? atol(argv[1]) : 100000000;
+    op_t op = (argc > 2) ? add : mix;
+    printf("%lx\n", run(op, count));
+    return 0;
+}
@@ -0,0 +1,43 @@
+#!/bin/bash
+# Measures what check elision (etharden -e) saves on a hardened program.
+#
+#     ./harden-overhead.sh program [args...]
+#
+# The program is hardened with --cet (shadow stack and endbr CFI) using
+# union output, once with every check and once with -e, which leaves the
+# shadow stack out of safe leaf functions. The original and both hardened
+# versions are timed with perf stat. The default program is
+# test/example/dispatch, whose argument is the number of iterations;
+# dividing the difference in cycles by the number of calls made gives the
+# per-call overhead. Arguments are passed as given, from test/script/tmp.
+
+program=${1:-../example/build_x86_64/dispatch}
+program=$(readlink -f $program)
+shift
+
+N=${N:-5}
+EVENTS=${EVENTS:-instructions,cycles,branches}
+MODE=${MODE:---cet}
+APP=$(readlink -f ../../app)
+export LD_LIBRARY_PATH=$(readlink -f ../../src)
+
+mkdir -p tmp
+cd tmp
+name=$(basename $program)
+
+echo "=== hardening $name ==="
+$APP/etharden -u $MODE $program $name.hardened >/dev/null || exit 1
+$APP/etharden -v -u -e $MODE $program $name.elided \
+    | grep 'skipped' || exit 1
+
+measure() {
+    local label=$1
+    shift
+    echo "=== $label ==="
+    perf stat -r $N -e $EVENTS -o perf-$label.out "$@" >/dev/null
+    grep -E 'instructions|cycles|branches|elapsed' perf-$label.out
+}
+
+measure original $program "$@"
+measure hardened ./$name.hardened "$@"
+measure elided ./$name.elided "$@"
@@ -0,0 +1,50 @@
+#!/bin/bash
+# Compares I-TLB behaviour of a program before and after profile-guided
+# layout with huge-page hot text (etorder -H, libhugetext.so).
+#
+#     ./hugetext-perf.sh program [args...]
+#
+# The program is run once with edge profiling to collect profile.data, then
+# three versions are measured with perf stat: the original, the laid out
+# one, and the laid out one with its hot text remapped onto huge pages.
+# Arguments are passed as given, from test/script/tmp. Transparent huge
+# pages must be enabled ("madvise" or "always").
+
+if [ -z "$1" ]; then
+    echo "usage: $0 program [args...]"
+    exit 1
+fi
+program=$(readlink -f $1)
+shift
+
+N=${N:-5}
+EVENTS=${EVENTS:-iTLB-loads,iTLB-load-misses,instructions,cycles}
+APP=$(readlink -f ../../app)
+export LD_LIBRARY_PATH=$(readlink -f ../../src)
+
+mkdir -p tmp
+cd tmp
+name=$(basename $program)
+
+echo "=== profiling $name ==="
+$APP/etharden -m --profile-edges $program $name.prof >/dev/null || exit 1
+rm -f profile.data
+./$name.prof "$@" >/dev/null || exit 1
+$APP/etprofile $name.prof >$name.order || exit 1
+
+echo "=== laying out $name ==="
+$APP/etorder -m -b $program $name.order $name.order-only >/dev/null || exit 1
+$APP/etorder -m -b -H $program $name.order $name.hugetext \
+    | grep 'hot text' || exit 1
+
+measure() {
+    local label=$1
+    shift
+    echo "=== $label ==="
+    perf stat -r $N -e $EVENTS -o perf-$label.out "$@" >/dev/null
+    grep -E 'iTLB|instructions|cycles|elapsed' perf-$label.out
+}
+
+measure original $program "$@"
+measure ordered ./$name.order-only "$@"
+measure hugetext env LD_PRELOAD=$APP/libhugetext.so ./$name.hugetext "$@"
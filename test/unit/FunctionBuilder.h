@@ -0,0 +1,178 @@
+#ifndef EGALITO_TEST_FRAMEWORK_FUNCTION_BUILDER_H
+#define EGALITO_TEST_FRAMEWORK_FUNCTION_BUILDER_H
+
+#include <string>
+#include <vector>
+#include "chunk/concrete.h"
+#include "disasm/disassemble.h"
+#include "instr/concrete.h"
+#include "operation/mutator.h"
+
+typedef std::vector<std::vector<unsigned char>> CodeBytes;
+
+/** Builds a Function out of raw instruction bytes, for unit tests.
+
+    Instructions go into the current Block; startBlock() ends it and
+    begins the next one. Direct jumps and calls are made with addJump(),
+    which links them to a Block or Function so that a ControlFlowGraph
+    can be built over the result. Forward jumps can be created without a
+    target and linked with setTarget() once the target exists.
+
+    Jumps, calls and linked instructions are only supported on x86_64.
+*/
+class FunctionBuilder {
+private:
+    Function *function;
+    Block *block;
+    Chunk *prevChunk;
+public:
+    FunctionBuilder(address_t address, const std::string &name = "")
+        : block(nullptr), prevChunk(nullptr) {
+
+        function = new Function(address);
+        if(!name.empty()) function->setName(name);
+        function->setPosition(
+            PositionFactory::getInstance()->makeAbsolutePosition(address));
+    }
+
+    Function *get() const { return function; }
+    Block *getBlock() const { return block; }
+
+    Block *startBlock() {
+        auto positionFactory = PositionFactory::getInstance();
+        auto newBlock = new Block();
+        newBlock->setPosition(positionFactory->makePosition(
+            block, newBlock, function->getSize()));
+        ChunkMutator(function).append(newBlock);
+        block = newBlock;
+        prevChunk = nullptr;
+        return block;
+    }
+
+    Instruction *add(const std::vector<unsigned char> &bytes) {
+        auto instr = Disassemble::instruction(bytes, true, 0);
+        append(instr);
+        return instr;
+    }
+
+    void addAll(const CodeBytes &code) {
+        for(const auto &bytes : code) add(bytes);
+    }
+
+#ifdef ARCH_X86_64
+    /** An instruction whose operand at index refers to link's target,
+        e.g. lea 0x0(%rip), %rax.
+    */
+    Instruction *addLinked(const std::vector<unsigned char> &bytes,
+        Link *link, int index = 0) {
+
+        DisasmHandle handle(true);
+        auto instr = new Instruction();
+        auto semantic = new LinkedInstruction(instr);
+        semantic->setAssembly(
+            DisassembleInstruction(handle).makeAssemblyPtr(bytes));
+        semantic->setLink(link);
+        semantic->setIndex(index);
+        instr->setSemantic(semantic);
+        append(instr);
+        return instr;
+    }
+
+    /** mnemonic is one of jmp, je, jne, ja, jg or callq; jumps may be
+        made short by passing a displacementSize of 1.
+    */
+    Instruction *addJump(const std::string &mnemonic,
+        Chunk *target = nullptr, size_t displacementSize = 4) {
+
+        static const struct {
+            const char *mnemonic;
+            unsigned int id;
+            unsigned char cc;
+        } conditionList[] = {
+            {"je", X86_INS_JE, 0x4}, {"jne", X86_INS_JNE, 0x5},
+            {"ja", X86_INS_JA, 0x7}, {"jg", X86_INS_JG, 0xf},
+        };
+
+        bool isShort = (displacementSize == 1);
+        unsigned int id = X86_INS_JMP;
+        std::string opcode = isShort ? "\xeb" : "\xe9";
+        for(const auto &condition : conditionList) {
+            if(mnemonic != condition.mnemonic) continue;
+            id = condition.id;
+            opcode.clear();
+            if(!isShort) opcode += '\x0f';
+            opcode += static_cast<char>((isShort ? 0x70 : 0x80) | condition.cc);
+        }
+        if(mnemonic == "callq") {
+            id = X86_INS_CALL;
+            opcode = "\xe8";
+        }
+
+        auto instr = new Instruction();
+        instr->setSemantic(new ControlFlowInstruction(
+            id, instr, opcode, mnemonic, displacementSize));
+        if(target) setTarget(instr, target);
+        append(instr);
+        return instr;
+    }
+
+    static void setTarget(Instruction *jump, Chunk *target) {
+        auto scope = dynamic_cast<Function *>(target)
+            ? Link::SCOPE_EXTERNAL_JUMP : Link::SCOPE_INTERNAL_JUMP;
+        auto semantic = jump->getSemantic();
+        delete semantic->getLink();
+        semantic->setLink(new NormalLink(target, scope));
+    }
+#endif
+
+    /** A function consisting of a single block. */
+    static Function *make(address_t address, const CodeBytes &code) {
+        FunctionBuilder builder(address);
+        builder.startBlock();
+        builder.addAll(code);
+        return builder.get();
+    }
+
+    /** A Module whose FunctionList holds functionList, in order. It has
+        an empty DataRegionList.
+    */
+    static Module *makeModule(const std::vector<Function *> &functionList,
+        const std::string &name = "module-test") {
+
+        auto module = new Module();
+        module->setName(name);
+        auto list = new FunctionList();
+        module->getChildren()->add(list);
+        module->setFunctionList(list);
+        list->setParent(module);
+        for(auto function : functionList) {
+            list->getChildren()->add(function);
+            function->setParent(list);
+        }
+
+        auto regionList = new DataRegionList();
+        module->getChildren()->add(regionList);
+        module->setDataRegionList(regionList);
+        regionList->setParent(module);
+        return module;
+    }
+
+    static Program *makeProgram(const std::vector<Module *> &moduleList) {
+        auto program = new Program();
+        for(auto module : moduleList) {
+            program->add(module);
+            module->setParent(program);
+        }
+        return program;
+    }
+private:
+    void append(Instruction *instr) {
+        if(!block) startBlock();
+        instr->setPosition(PositionFactory::getInstance()->makePosition(
+            prevChunk, instr, block->getSize()));
+        ChunkMutator(block).append(instr);
+        prevChunk = instr;
+    }
+};
+
+#endif
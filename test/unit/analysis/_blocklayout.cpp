@@ -0,0 +1,49 @@
+#include "framework/include.h"
+#include "analysis/blocklayout.h"
+
+TEST_CASE("block layout makes hot edges fall through", "[analysis][layout][fast]") {
+    // 0 -> {1 (rare), 2 (hot)} -> 3; 4 never runs
+    BlockChainLayout layout(5);
+    layout.setCount(0, 100);
+    layout.setCount(1, 1);
+    layout.setCount(2, 99);
+    layout.setCount(3, 100);
+    layout.addEdge(0, 1, 1, true);
+    layout.addEdge(0, 2, 99, false);
+    layout.addEdge(1, 3, 1, false);
+    layout.addEdge(2, 3, 99, true);
+
+    size_t coldStart = 0;
+    auto order = layout.getOrder(&coldStart);
+    CHECK(order == std::vector<int>({0, 2, 3, 1, 4}));
+    CHECK(coldStart == 4);
+}
+
+TEST_CASE("block layout keeps the entry first and pinned blocks hot", "[analysis][layout][fast]") {
+    // a loop back to the entry, and two blocks that never ran
+    BlockChainLayout layout(4);
+    layout.setCount(0, 10);
+    layout.setCount(1, 10);
+    layout.addEdge(0, 1, 10, true);
+    layout.addEdge(1, 0, 9, false);
+    layout.setPinned(3);
+
+    size_t coldStart = 0;
+    auto order = layout.getOrder(&coldStart);
+    CHECK(order == std::vector<int>({0, 1, 3, 2}));
+    CHECK(coldStart == 3);
+}
+
+TEST_CASE("block layout prefers fall-throughs on ties", "[analysis][layout][fast]") {
+    BlockChainLayout layout(3);
+    layout.setCount(0, 5);
+    layout.setCount(1, 5);
+    layout.setCount(2, 5);
+    layout.addEdge(0, 2, 5, false);
+    layout.addEdge(0, 1, 5, true);
+
+    size_t coldStart = 0;
+    auto order = layout.getOrder(&coldStart);
+    CHECK(order == std::vector<int>({0, 1, 2}));
+    CHECK(coldStart == 3);
+}
@@ -0,0 +1,47 @@
+#include <algorithm>
+#include "framework/include.h"
+#include "analysis/calllayout.h"
+
+static size_t positionOf(const std::vector<int> &order, int id) {
+    return std::find(order.begin(), order.end(), id) - order.begin();
+}
+
+TEST_CASE("C3 layout follows hot call chains", "[analysis][layout][fast]") {
+    CallChainLayout layout(0x1000);
+    int cold = layout.addFunction(0x100, 0);
+    int main = layout.addFunction(0x100, 1);
+    int helper = layout.addFunction(0x40, 0);
+    int loop = layout.addFunction(0x80, 1000);
+    int other = layout.addFunction(0x80, 10);
+
+    layout.addCall(main, loop, 1000);
+    layout.addCall(loop, helper, 900);
+    layout.addCall(other, helper, 10);
+
+    auto order = layout.getOrder();
+    REQUIRE(order.size() == 5);
+
+    // helper inherits its hotness from its callers and follows loop
+    CHECK(layout.getCount(helper) == 0);
+    CHECK(positionOf(order, loop) == positionOf(order, main) + 1);
+    CHECK(positionOf(order, helper) == positionOf(order, loop) + 1);
+
+    // functions that never ran come last
+    CHECK(order.back() == cold);
+}
+
+TEST_CASE("C3 layout respects the cluster size limit", "[analysis][layout][fast]") {
+    CallChainLayout layout(0x100);
+    int a = layout.addFunction(0xc0, 100);
+    int b = layout.addFunction(0xc0, 100);
+    int c = layout.addFunction(0x10, 50);
+    layout.addCall(a, b, 100);
+    layout.addCall(a, c, 50);
+
+    auto order = layout.getOrder();
+    REQUIRE(order.size() == 3);
+
+    // b does not fit after a, but the small c does
+    CHECK(positionOf(order, c) == positionOf(order, a) + 1);
+    CHECK(positionOf(order, b) != positionOf(order, a) + 1);
+}
@@ -0,0 +1,65 @@
+#include "framework/include.h"
+#include "FunctionBuilder.h"
+#include "analysis/checkelision.h"
+#include "chunk/concrete.h"
+
+TEST_CASE("leaf functions that cannot reach their return address",
+    "[analysis][frame][fast]") {
+
+#ifdef ARCH_X86_64
+    // stores into the frame and below the frame pointer
+    CHECK(CheckElision::isSafeLeaf(FunctionBuilder::make(0x3000, {
+        {0x55},                             // push %rbp
+        {0x48, 0x89, 0xe5},                 // mov %rsp, %rbp
+        {0x48, 0x83, 0xec, 0x20},           // sub $0x20, %rsp
+        {0x48, 0x89, 0x7c, 0x24, 0x08},     // mov %rdi, 0x8(%rsp)
+        {0x48, 0x89, 0x75, 0xf8},           // mov %rsi, -0x8(%rbp)
+        {0x48, 0x83, 0xc4, 0x20},           // add $0x20, %rsp
+        {0x5d},                             // pop %rbp
+        {0xc3}                              // retq
+    })));
+
+    // past the end of the frame, where the return address is
+    CHECK(!CheckElision::isSafeLeaf(FunctionBuilder::make(0x3000, {
+        {0x48, 0x83, 0xec, 0x20},           // sub $0x20, %rsp
+        {0x48, 0x89, 0x7c, 0x24, 0x20},     // mov %rdi, 0x20(%rsp)
+        {0x48, 0x83, 0xc4, 0x20},           // add $0x20, %rsp
+        {0xc3}                              // retq
+    })));
+
+    // through a pointer that may point anywhere
+    CHECK(!CheckElision::isSafeLeaf(FunctionBuilder::make(0x3000, {
+        {0x48, 0x89, 0x07},                 // mov %rax, (%rdi)
+        {0xc3}                              // retq
+    })));
+#endif
+}
+
+TEST_CASE("leaf functions with several blocks",
+    "[analysis][frame][fast]") {
+
+#ifdef ARCH_X86_64
+    // sub $0x20, %rsp; test %rdi, %rdi; je exit; mov %rdi, 0x8(%rsp);
+    // exit: add $0x20, %rsp; [store]; retq
+    auto makeLeaf = [] (const std::vector<unsigned char> &store) {
+        FunctionBuilder builder(0x3000);
+        builder.add({0x48, 0x83, 0xec, 0x20});
+        builder.add({0x48, 0x85, 0xff});
+        auto je = builder.addJump("je");
+        builder.startBlock();
+        builder.add({0x48, 0x89, 0x7c, 0x24, 0x08});
+        FunctionBuilder::setTarget(je, builder.startBlock());
+        builder.add({0x48, 0x83, 0xc4, 0x20});
+        if(!store.empty()) builder.add(store);
+        builder.add({0xc3});
+        return builder.get();
+    };
+
+    // the prologue dominates the store in the middle block
+    CHECK(CheckElision::isSafeLeaf(makeLeaf({})));
+
+    // in the epilogue, after the frame is gone: mov %rdi, 0x8(%rsp)
+    CHECK(!CheckElision::isSafeLeaf(
+        makeLeaf({0x48, 0x89, 0x7c, 0x24, 0x08})));
+#endif
+}
@@ -0,0 +1,122 @@
+#include "framework/include.h"
+#include "analysis/dependencedag.h"
+#include "chunk/concrete.h"
+#include "disasm/disassemble.h"
+#include "operation/mutator.h"
+
+static Block *makeBlock(const std::vector<std::vector<unsigned char>> &code) {
+    PositionFactory *positionFactory = PositionFactory::getInstance();
+    Block *block = new Block();
+    block->setPosition(positionFactory->makePosition(nullptr, block, 0));
+
+    Chunk *prevChunk = nullptr;
+    for(const auto &bytes : code) {
+        auto instr = Disassemble::instruction(bytes, true, 0);
+        instr->setPosition(
+            positionFactory->makePosition(prevChunk, instr, block->getSize()));
+        ChunkMutator(block).append(instr);
+        prevChunk = instr;
+    }
+    return block;
+}
+
+static const DependenceDAG::Edge *findEdge(const DependenceDAG &dag,
+    uint32_t from, uint32_t to) {
+
+    for(const auto &e : dag.getSuccessors(from)) {
+        if(e.node == to) return &e;
+    }
+    return nullptr;
+}
+
+TEST_CASE("dependence DAG and list scheduling", "[analysis][dag][fast]") {
+#ifdef ARCH_X86_64
+    Block *block = makeBlock({
+        {0x48, 0x8b, 0x07},                 // mov (%rdi), %rax
+        {0x48, 0x83, 0xc0, 0x01},           // add $1, %rax
+        {0xb9, 0x05, 0x00, 0x00, 0x00},     // mov $5, %ecx
+        {0x48, 0x01, 0xca}                  // add %rcx, %rdx
+    });
+#elif defined(ARCH_AARCH64)
+    Block *block = makeBlock({
+        {0x01, 0x00, 0x40, 0xf9},           // ldr x1, [x0]
+        {0x21, 0x04, 0x00, 0x91},           // add x1, x1, #1
+        {0xa2, 0x00, 0x80, 0xd2},           // mov x2, #5
+        {0x63, 0x00, 0x02, 0x8b}            // add x3, x3, x2
+    });
+#endif
+
+    DependenceDAG dag(block);
+    REQUIRE(dag.getCount() == 4);
+
+    auto load = findEdge(dag, 0, 1);
+    REQUIRE(load != nullptr);
+    CHECK((load->kind & DependenceDAG::DEP_REGISTER) != 0);
+    CHECK(load->latency > 1);
+    CHECK(findEdge(dag, 0, 2) == nullptr);
+    CHECK(findEdge(dag, 2, 3) != nullptr);
+    CHECK(dag.getHeight(0) > dag.getHeight(2));
+
+    ListScheduler scheduler(&dag);
+    auto order = scheduler.schedule();
+    REQUIRE(order.size() == 4);
+    CHECK(order[0] == 0);
+
+    // the independent move fills the load shadow
+    size_t movePosition = 0, usePosition = 0;
+    for(size_t i = 0; i < order.size(); i ++) {
+        if(order[i] == 2) movePosition = i;
+        if(order[i] == 1) usePosition = i;
+    }
+    CHECK(movePosition < usePosition);
+    CHECK(scheduler.getCycle(1) >= load->latency);
+
+    delete block;
+}
+
+#ifdef ARCH_X86_64
+TEST_CASE("dependence DAG keeps endbr64 first", "[analysis][dag][fast][x86_64]") {
+#ifdef ARCH_X86_64
+    Block *block = makeBlock({
+        {0xf3, 0x0f, 0x1e, 0xfa},           // endbr64
+        {0x48, 0x8b, 0x07},                 // mov (%rdi), %rax
+        {0x48, 0x83, 0xc0, 0x01},           // add $1, %rax
+        {0xb9, 0x05, 0x00, 0x00, 0x00}      // mov $5, %ecx
+    });
+
+    DependenceDAG dag(block);
+    REQUIRE(dag.getCount() == 4);
+    for(uint32_t i = 1; i < 4; i ++) {
+        CHECK(findEdge(dag, 0, i) != nullptr);
+    }
+
+    ListScheduler scheduler(&dag);
+    auto order = scheduler.schedule();
+    REQUIRE(order.size() == 4);
+    CHECK(order[0] == 0);
+
+    delete block;
+#endif
+}
+
+TEST_CASE("dependence DAG memory disambiguation", "[analysis][dag][fast]") {
+    Block *block = makeBlock({
+        {0x48, 0x89, 0x44, 0x24, 0x08},     // mov %rax, 0x8(%rsp)
+        {0x48, 0x8b, 0x4c, 0x24, 0x10},     // mov 0x10(%rsp), %rcx
+        {0x48, 0x8b, 0x54, 0x24, 0x08},     // mov 0x8(%rsp), %rdx
+        {0x48, 0x8b, 0x37}                  // mov (%rdi), %rsi
+    });
+
+    DependenceDAG dag(block);
+    CHECK(findEdge(dag, 0, 1) == nullptr);
+
+    auto store = findEdge(dag, 0, 2);
+    REQUIRE(store != nullptr);
+    CHECK((store->kind & DependenceDAG::DEP_MEMORY) != 0);
+
+    // different base register: may alias
+    CHECK(findEdge(dag, 0, 3) != nullptr);
+
+    delete block;
+}
+#endif
@@ -0,0 +1,90 @@
+#include "framework/include.h"
+#include "analysis/edgeprofile.h"
+
+// the diamond 0 -> {1, 2} -> 3 -> exit, run 7 times via 1 and 3 times via 2
+static EdgeProfile makeDiamond() {
+    EdgeProfile profile("diamond");
+    for(unsigned long offset : {0, 4, 8, 12}) profile.addBlock(offset);
+    profile.addEdge(0, 1);
+    profile.addEdge(0, 2);
+    profile.addEdge(1, 3);
+    profile.addEdge(2, 3);
+    profile.addEdge(3, profile.getExitID());
+    return profile;
+}
+
+static std::vector<unsigned long> readCounters(const EdgeProfile &profile,
+    const std::vector<unsigned long> &actual) {
+
+    std::vector<unsigned long> counters(profile.getCounterCount());
+    for(size_t i = 0; i < profile.getEdgeList().size(); i ++) {
+        int counter = profile.getEdgeList()[i].counter;
+        if(counter >= 0) counters[counter] = actual[i];
+    }
+    return counters;
+}
+
+TEST_CASE("edge profile counts only non-tree edges", "[analysis][profile][fast]") {
+    EdgeProfile profile = makeDiamond();
+    std::vector<unsigned long> actual = {7, 3, 7, 3, 10};
+
+    REQUIRE(profile.placeCounters({1, 1, 1, 1, 1},
+        {false, false, false, false, false}));
+    // 6 edges including exit->entry, 5 nodes: a tree of 4 edges
+    CHECK(profile.getCounterCount() == 2);
+
+    std::vector<unsigned long> edgeCounts;
+    REQUIRE(profile.reconstruct(readCounters(profile, actual), edgeCounts));
+    CHECK(edgeCounts == actual);
+
+    auto blockCounts = profile.getBlockCounts(edgeCounts);
+    CHECK(blockCounts == std::vector<unsigned long>({10, 7, 3, 10}));
+}
+
+TEST_CASE("edge profile honours weights and fixed edges", "[analysis][profile][fast]") {
+    EdgeProfile profile = makeDiamond();
+
+    // the heavy edge 0->1 stays uninstrumented
+    REQUIRE(profile.placeCounters({100, 1, 1, 1, 1},
+        {false, false, false, false, false}, 5));
+    CHECK(profile.getEdgeList()[0].counter == -1);
+    for(const auto &edge : profile.getEdgeList()) {
+        CHECK(edge.counter < 7);
+    }
+
+    REQUIRE(profile.placeCounters({1, 1, 1, 1, 1},
+        {false, false, true, true, false}));
+    CHECK(profile.getEdgeList()[2].counter == -1);
+    CHECK(profile.getEdgeList()[3].counter == -1);
+
+    // 0->1->3 and 0->2->3 cannot both be left out of a tree
+    CHECK(!profile.placeCounters({1, 1, 1, 1, 1},
+        {true, true, true, true, false}));
+}
+
+TEST_CASE("edge profile with a loop round-trips through text", "[analysis][profile][fast]") {
+    EdgeProfile profile("loop");
+    for(unsigned long offset : {0, 3, 9}) profile.addBlock(offset);
+    profile.addEdge(0, 1);
+    profile.addEdge(1, 1);          // self loop, always counted
+    profile.addEdge(1, 2);
+    profile.addEdge(2, profile.getExitID());
+    REQUIRE(profile.placeCounters({1, 10, 1, 1}, {false, false, false, false}));
+    CHECK(profile.getEdgeList()[1].counter >= 0);
+
+    EdgeProfile decoded;
+    REQUIRE(decoded.decode(profile.encode()));
+    CHECK(decoded.getName() == "loop");
+    CHECK(decoded.getBlockCount() == 3);
+    CHECK(decoded.getBlockOffset(2) == 9);
+    REQUIRE(decoded.getEdgeList().size() == 4);
+
+    std::vector<unsigned long> actual = {2, 40, 2, 2};
+    std::vector<unsigned long> edgeCounts;
+    REQUIRE(decoded.reconstruct(readCounters(decoded, actual), edgeCounts));
+    CHECK(edgeCounts == actual);
+    CHECK(decoded.getBlockCounts(edgeCounts)
+        == std::vector<unsigned long>({2, 42, 2}));
+
+    CHECK(!decoded.decode("broken 2 0"));
+}
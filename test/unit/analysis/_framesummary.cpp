@@ -0,0 +1,64 @@
+#include <sstream>
+#include "framework/include.h"
+#include "FunctionBuilder.h"
+#include "analysis/framesummary.h"
+#include "archive/stream.h"
+#include "chunk/concrete.h"
+
+TEST_CASE("frame summary of a simple function", "[analysis][frame][fast]") {
+#ifdef ARCH_X86_64
+    Function *function = FunctionBuilder::make(0x1000, {
+        {0x55},                             // push %rbp
+        {0x48, 0x89, 0xe5},                 // mov %rsp, %rbp
+        {0x48, 0x83, 0xec, 0x20},           // sub $0x20, %rsp
+        {0x48, 0x83, 0xc4, 0x20},           // add $0x20, %rsp
+        {0x5d},                             // pop %rbp
+        {0xc3}                              // retq
+    });
+
+    FrameSummary summary(function);
+    CHECK(summary.hasFrame());
+    CHECK(summary.isLeaf());
+    CHECK(!summary.usesRedZone());
+    CHECK(summary.getFrameSize() == 0x20);
+    CHECK(summary.getSetBP() == 1);
+    CHECK(summary.getSetSP() == 2);
+    REQUIRE(summary.getResetSPList().size() == 1);
+    CHECK(summary.getResetSPList()[0] == 3);
+    REQUIRE(summary.getExitList().size() == 1);
+    CHECK(summary.getExitList()[0] == 5);
+
+    SECTION("round trip through an archive stream") {
+        std::stringstream stream;
+        ArchiveStreamWriter writer(stream);
+        summary.serialize(writer);
+
+        ArchiveStreamReader reader(stream);
+        FrameSummary copy;
+        REQUIRE(copy.deserialize(reader));
+        CHECK(copy.matches(function));
+        CHECK(copy.getFrameSize() == summary.getFrameSize());
+        CHECK(copy.getSetBP() == summary.getSetBP());
+        CHECK(copy.getExitList() == summary.getExitList());
+        CHECK(copy.getResetSPList() == summary.getResetSPList());
+    }
+#endif
+}
+
+TEST_CASE("frame summary of a red zone leaf", "[analysis][frame][fast]") {
+#ifdef ARCH_X86_64
+    Function *function = FunctionBuilder::make(0x1000, {
+        {0x48, 0x89, 0x7c, 0x24, 0xf8},     // mov %rdi, -0x8(%rsp)
+        {0x48, 0x8b, 0x44, 0x24, 0xf8},     // mov -0x8(%rsp), %rax
+        {0xc3}                              // retq
+    });
+
+    FrameSummary summary(function);
+    CHECK(!summary.hasFrame());
+    CHECK(summary.isLeaf());
+    CHECK(summary.usesRedZone());
+    CHECK(summary.getSetBP() == FrameSummary::NONE);
+    CHECK(summary.getSetSP() == FrameSummary::NONE);
+    CHECK(summary.getExitList().size() == 1);
+#endif
+}
@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <elf.h>
+#include "framework/include.h"
+#include "FunctionBuilder.h"
+#include "analysis/indirectcall.h"
+#include "analysis/compactcallgraph.h"
+#include "chunk/concrete.h"
+
+#ifdef ARCH_X86_64
+static Function *makeReturn(address_t address, const std::string &name) {
+    FunctionBuilder builder(address, name);
+    builder.add({0xc3});                    // retq
+    return builder.get();
+}
+
+// lea target(%rip), %rdi; callq callee; retq
+static Function *makeCaller(address_t address, Function *target,
+    Function *callee) {
+
+    FunctionBuilder builder(address, "caller");
+    builder.addLinked({0x48, 0x8d, 0x3d, 0x00, 0x00, 0x00, 0x00},
+        new NormalLink(target, Link::SCOPE_WITHIN_MODULE));
+    builder.addJump("callq", callee);
+    builder.add({0xc3});                    // retq
+    return builder.get();
+}
+
+// a region holding one section with an 8-byte slot that points at target
+static DataSection *addSlot(Module *module, address_t address,
+    const std::string &name, uint32_t permissions, Function *target) {
+
+    auto region = new DataRegion(address);
+    region->setPosition(new AbsolutePosition(address));
+    region->setSize(0x10);
+    region->setPermissions(permissions);
+    auto regionList = module->getDataRegionList();
+    regionList->getChildren()->add(region);
+    region->setParent(regionList);
+
+    auto section = new DataSection();
+    section->setName(name);
+    section->setPosition(new AbsoluteOffsetPosition(section, 0));
+    section->setSize(0x10);
+    region->getChildren()->add(section);
+    section->setParent(region);
+
+    auto var = new DataVariable(section, address,
+        new NormalLink(target, Link::SCOPE_EXTERNAL_DATA));
+    section->getChildren()->add(var);
+    var->setParent(section);
+    return section;
+}
+
+// mov slot(%rip), %rax; callq *%rax; retq
+static Function *makeLoadCall(address_t address, const std::string &name,
+    DataSection *slot, Instruction **site) {
+
+    FunctionBuilder builder(address, name);
+    builder.addLinked({0x48, 0x8b, 0x05, 0x00, 0x00, 0x00, 0x00},
+        new DataOffsetLink(slot, 0));
+    *site = builder.add({0xff, 0xd0});
+    builder.add({0xc3});
+    return builder.get();
+}
+#endif
+
+TEST_CASE("indirect call targets from constants and arguments",
+    "[analysis][fast][x86_64]") {
+
+#ifdef ARCH_X86_64
+    auto f1 = makeReturn(0x6000, "f1");
+    auto f2 = makeReturn(0x6010, "f2");
+
+    // lea f1(%rip), %rax; callq *%rax
+    FunctionBuilder direct(0x6100, "direct");
+    auto lea = direct.addLinked({0x48, 0x8d, 0x05, 0x00, 0x00, 0x00, 0x00},
+        new NormalLink(f1, Link::SCOPE_WITHIN_MODULE));
+    auto directSite = direct.add({0xff, 0xd0});     // callq *%rax
+    direct.add({0xc3});                             // retq
+
+    // the function pointer is an argument, from two callers
+    FunctionBuilder dispatch(0x6200, "dispatch");
+    auto dispatchSite = dispatch.add({0xff, 0xd7}); // callq *%rdi
+    dispatch.add({0xc3});                           // retq
+    auto caller1 = makeCaller(0x6300, f1, dispatch.get());
+    auto caller2 = makeCaller(0x6400, f2, dispatch.get());
+
+    // an argument, but nothing calls this function
+    FunctionBuilder unknown(0x6500, "unknown");
+    auto unknownSite = unknown.add({0xff, 0xd6});   // callq *%rsi
+    unknown.add({0xc3});                            // retq
+
+    auto module = FunctionBuilder::makeModule({f1, f2, direct.get(),
+        dispatch.get(), caller1, caller2, unknown.get()});
+    auto program = FunctionBuilder::makeProgram({module});
+    CompactCallGraph graph(program, 1);
+
+    SECTION("exact sets") {
+        IndirectCallTargets targets(program, &graph);
+        CHECK(targets.getSites().size() == 3);
+        CHECK(targets.getCount(IndirectCallTargets::EXACT) == 2);
+        CHECK(targets.getCount(IndirectCallTargets::UNRESOLVED) == 1);
+        CHECK(targets.getCount(IndirectCallTargets::CLASS_HIERARCHY) == 0);
+
+        auto set = targets.getTargets(directSite);
+        REQUIRE(set);
+        CHECK(set->getPrecision() == IndirectCallTargets::EXACT);
+        REQUIRE(set->getTargets().size() == 1);
+        CHECK(set->getTargets()[0] == f1);
+        CHECK(targets.getSingleTarget(directSite) == f1);
+
+        // the union of what the callers pass, so not a single target
+        set = targets.getTargets(dispatchSite);
+        REQUIRE(set);
+        CHECK(set->getPrecision() == IndirectCallTargets::EXACT);
+        CHECK(set->getTargets().size() == 2);
+        CHECK(std::is_sorted(set->getTargets().begin(),
+            set->getTargets().end()));
+        CHECK(targets.getSingleTarget(dispatchSite) == nullptr);
+
+        set = targets.getTargets(unknownSite);
+        REQUIRE(set);
+        CHECK(!set->isResolved());
+        CHECK(set->getTargets().empty());
+
+        CHECK(targets.getTargets(lea) == nullptr);
+    }
+
+    SECTION("sets larger than the limit are unresolved") {
+        IndirectCallTargets targets(program, &graph, 1);
+        CHECK(targets.getSingleTarget(directSite) == f1);
+        auto set = targets.getTargets(dispatchSite);
+        REQUIRE(set);
+        CHECK(!set->isResolved());
+        CHECK(targets.getCount(IndirectCallTargets::UNRESOLVED) == 2);
+    }
+#endif
+}
+
+TEST_CASE("indirect call targets loaded from writable data",
+    "[analysis][fast][x86_64]") {
+
+#ifdef ARCH_X86_64
+    auto f1 = makeReturn(0x6000, "f1");
+    auto module = FunctionBuilder::makeModule({f1});
+    auto rodata = addSlot(module, 0x20000, ".rodata", PF_R, f1);
+    // without RELRO in the output, .got stays writable at run time
+    auto got = addSlot(module, 0x21000, ".got", PF_R | PF_W, f1);
+
+    Instruction *rodataSite, *gotSite;
+    auto list = module->getFunctionList();
+    for(auto function : {makeLoadCall(0x6100, "rodata", rodata, &rodataSite),
+        makeLoadCall(0x6200, "got", got, &gotSite)}) {
+
+        list->getChildren()->add(function);
+        function->setParent(list);
+    }
+    auto program = FunctionBuilder::makeProgram({module});
+    CompactCallGraph graph(program, 1);
+    IndirectCallTargets targets(program, &graph);
+
+    auto set = targets.getTargets(rodataSite);
+    REQUIRE(set);
+    CHECK(set->getPrecision() == IndirectCallTargets::EXACT);
+    CHECK(targets.getSingleTarget(rodataSite) == f1);
+
+    // such a site must keep its endbr check
+    set = targets.getTargets(gotSite);
+    REQUIRE(set);
+    CHECK(set->getPrecision() == IndirectCallTargets::UNRESOLVED);
+    CHECK(targets.getSingleTarget(gotSite) == nullptr);
+#endif
+}
@@ -1,8 +1,11 @@
 #include <sstream>
+#include <elf.h>
 #include "config.h"
 #include "framework/include.h"
+#include "FunctionBuilder.h"
 #include "analysis/jumptable.h"
 #include "analysis/jumptabledetection.h"
+#include "analysis/manager.h"
 #include "conductor/conductor.h"
 #include "log/registry.h"
 
@@ -142,3 +145,94 @@ TEST_CASE("check completeness of jump tables in libc", "[analysis][full][.]") {
     }
 #endif
 }
+
+#ifdef ARCH_X86_64
+// cmp $5, %edi; <check> default; mov %edi, %edi; lea table(%rip), %rdx;
+// movslq (%rdx,%rdi,4), %rax; add %rdx, %rax; jmp *%rax
+// default: xor %eax, %eax; retq
+static Module *makeSwitch(const std::string &check, Function **function) {
+    FunctionBuilder builder(0x1000, "switch");
+    builder.startBlock();
+    builder.add({0x83, 0xff, 0x05});
+    auto branch = builder.addJump(check);
+    builder.startBlock();
+    builder.add({0x89, 0xff});
+    builder.add({0x48, 0x8d, 0x15, 0xee, 0x0f, 0x00, 0x00});   // 0x2000
+    builder.add({0x48, 0x63, 0x04, 0xba});
+    builder.add({0x48, 0x01, 0xd0});
+    builder.add({0xff, 0xe0});
+    auto fallback = builder.startBlock();
+    builder.add({0x31, 0xc0});
+    builder.add({0xc3});
+    FunctionBuilder::setTarget(branch, fallback);
+
+    *function = builder.get();
+    auto module = FunctionBuilder::makeModule({*function});
+
+    auto region = new DataRegion(0x2000);
+    region->setPosition(new AbsolutePosition(0x2000));
+    region->setSize(0x18);
+    region->setPermissions(PF_R);
+    auto regionList = module->getDataRegionList();
+    regionList->getChildren()->add(region);
+    region->setParent(regionList);
+
+    auto section = new DataSection();
+    section->setName(".rodata");
+    section->setPosition(new AbsoluteOffsetPosition(section, 0));
+    section->setSize(0x18);
+    region->getChildren()->add(section);
+    section->setParent(region);
+    return module;
+}
+#endif
+
+TEST_CASE("fast jump table path matches the canonical switch",
+    "[analysis][fast][x86_64]") {
+
+#ifdef ARCH_X86_64
+    GroupRegistry::getInstance()->muteAllSettings();
+
+    Function *function;
+    auto module = makeSwitch("ja", &function);
+
+    JumptableDetection jt(module);
+    jt.detect(function);
+
+    const auto &statistics = jt.getStatistics();
+    CHECK(statistics.fastJumps == 1);
+    CHECK(statistics.fastFunctions == 1);
+    CHECK(statistics.fullFunctions == 0);
+
+    REQUIRE(jt.getTableList().size() == 1);
+    auto table = jt.getTableList()[0];
+    CHECK(table->getAddress() == 0x2000);
+    CHECK(table->getScale() == 4);
+    CHECK(table->getEntries() == 6);    // 0 through 5
+
+    AnalysisManager::getInstance()->invalidate(function);
+#endif
+}
+
+TEST_CASE("fast jump table path falls back on a signed bounds check",
+    "[analysis][fast][x86_64]") {
+
+#ifdef ARCH_X86_64
+    GroupRegistry::getInstance()->muteAllSettings();
+
+    // a negative index passes jg, so this is not the canonical pattern
+    Function *function;
+    auto module = makeSwitch("jg", &function);
+
+    JumptableDetection jt(module);
+    jt.detect(function);
+
+    const auto &statistics = jt.getStatistics();
+    CHECK(statistics.fastJumps == 0);
+    CHECK(statistics.fastFunctions == 0);
+    CHECK(statistics.fullJumps == 1);
+    CHECK(statistics.fullFunctions == 1);
+
+    AnalysisManager::getInstance()->invalidate(function);
+#endif
+}
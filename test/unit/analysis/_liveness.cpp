@@ -0,0 +1,219 @@
+#include "framework/include.h"
+#include "FunctionBuilder.h"
+#include "analysis/liveness.h"
+#include "analysis/compactcallgraph.h"
+#include "analysis/controlflow.h"
+
+#ifdef ARCH_X86_64
+static bool isLive(const RegisterBitVector &live, Register reg) {
+    return live.get(RegisterBitVector::getIndex(reg));
+}
+
+// mov %rdi, %rax; retq
+static Function *makeLeaf(address_t address) {
+    FunctionBuilder builder(address, "leaf");
+    builder.addAll({
+        {0x48, 0x89, 0xf8},                 // mov %rdi, %rax
+        {0xc3}                              // retq
+    });
+    return builder.get();
+}
+#endif
+
+TEST_CASE("register bit vector operations", "[analysis][liveness][fast]") {
+    RegisterBitVector a, b;
+    CHECK(a.empty());
+
+    a.set(1);
+    a.set(70);  // second word
+    b.set(70);
+    b.set(3);
+    CHECK(a.count() == 2);
+    CHECK(a.get(70));
+    CHECK(!a.get(3));
+
+    SECTION("union and subtract") {
+        RegisterBitVector c = a;
+        c |= b;
+        CHECK(c.count() == 3);
+        c.subtract(b);
+        CHECK(c.count() == 1);
+        CHECK(c.get(1));
+    }
+
+    SECTION("transfer function") {
+        // live = use | (live & ~kill)
+        RegisterBitVector use, kill, live;
+        use.set(5);
+        kill.set(70);
+        CHECK(live.assignTransfer(use, a, kill));
+        CHECK(live.get(1));
+        CHECK(live.get(5));
+        CHECK(!live.get(70));
+        CHECK(!live.assignTransfer(use, a, kill));
+    }
+
+    SECTION("iteration visits set bits in order") {
+        std::vector<int> seen;
+        a.forEach([&seen] (int reg) { seen.push_back(reg); });
+        REQUIRE(seen.size() == 2);
+        CHECK(seen[0] == 1);
+        CHECK(seen[1] == 70);
+    }
+}
+
+TEST_CASE("calling convention register sets", "[analysis][liveness][fast]") {
+    auto callerSaved = RegisterBitVector::callerSaved();
+    auto calleeSaved = RegisterBitVector::calleeSaved();
+
+    RegisterBitVector overlap = callerSaved;
+    overlap &= calleeSaved;
+    CHECK(overlap.empty());
+
+    // the stack pointer is neither; it is simply always live
+    RegisterBitVector sp = RegisterBitVector::stackPointer();
+    sp &= RegisterBitVector::everything();
+    CHECK(sp.count() == 1);
+    sp.subtract(callerSaved);
+    sp.subtract(calleeSaved);
+    CHECK(sp.count() == 1);
+
+    RegisterBitVector args = RegisterBitVector::argumentRegisters();
+    args.subtract(callerSaved);
+    CHECK(args.empty());
+}
+
+TEST_CASE("liveness around a loop", "[analysis][liveness][fast]") {
+#ifdef ARCH_X86_64
+    FunctionBuilder builder(0x5000);
+    builder.add({0x48, 0xc7, 0xc0, 0x00, 0x00, 0x00, 0x00});  // mov $0, %rax
+    auto loop = builder.startBlock();
+    builder.add({0x48, 0x01, 0xf8});        // add %rdi, %rax
+    builder.add({0x48, 0x83, 0xee, 0x01});  // sub $0x1, %rsi
+    builder.addJump("jne", loop);
+    auto exit = builder.startBlock();
+    builder.add({0xc3});                    // retq
+    auto function = builder.get();
+
+    ControlFlowGraph cfg(function);
+    LivenessAnalysis live(function, &cfg);
+
+    // only the back edge keeps the loop's inputs live at its end
+    CHECK(isLive(live.getLiveOut(loop), X86_REG_RDI));
+    CHECK(isLive(live.getLiveOut(loop), X86_REG_RSI));
+    CHECK(isLive(live.getLiveOut(loop), X86_REG_RAX));
+    CHECK(!isLive(live.getLiveIn(exit), X86_REG_RDI));
+    CHECK(isLive(live.getLiveIn(loop), X86_REG_RAX));
+
+    // %rax is written before the loop reads it
+    CHECK(isLive(live.getLiveIn(), X86_REG_RDI));
+    CHECK(isLive(live.getLiveIn(), X86_REG_RSI));
+    CHECK(!isLive(live.getLiveIn(), X86_REG_RAX));
+    CHECK(!isLive(live.getLiveIn(), X86_REG_RCX));
+    CHECK(live.getDefined().get(RegisterBitVector::FLAGS));
+#endif
+}
+
+TEST_CASE("liveness across calls with and without a summary",
+    "[analysis][liveness][fast]") {
+#ifdef ARCH_X86_64
+    auto leaf = makeLeaf(0x5100);
+    FunctionBuilder builder(0x5200, "caller");
+    builder.addJump("callq", leaf);
+    builder.add({0x4c, 0x01, 0xd0});        // add %r10, %rax
+    builder.add({0xc3});                    // retq
+    auto caller = builder.get();
+
+    auto module = FunctionBuilder::makeModule({leaf, caller});
+    CompactCallGraph callGraph(module);
+    InterproceduralLiveness summaries(&callGraph);
+
+    auto leafSummary = summaries.getSummary(leaf);
+    REQUIRE(leafSummary);
+    CHECK(isLive(leafSummary->getLiveIn(), X86_REG_RDI));
+    CHECK(!isLive(leafSummary->getLiveIn(), X86_REG_R8));
+    CHECK(leafSummary->getClobbered().get(
+        RegisterBitVector::getIndex(X86_REG_RAX)));
+    CHECK(leafSummary->getClobbered().count() == 1);
+
+    SECTION("without a summary the calling convention is assumed") {
+        ControlFlowGraph cfg(caller);
+        LivenessAnalysis live(caller, &cfg);
+        CHECK(!isLive(live.getLiveIn(), X86_REG_R10));
+        CHECK(isLive(live.getLiveIn(), X86_REG_R8));
+        CHECK(isLive(live.getLiveIn(), X86_REG_RDI));
+    }
+
+    SECTION("the callee leaves %r10 alone and does not read %r8") {
+        ControlFlowGraph cfg(caller);
+        LivenessAnalysis live(caller, &cfg, &summaries);
+        CHECK(isLive(live.getLiveIn(), X86_REG_R10));
+        CHECK(!isLive(live.getLiveIn(), X86_REG_R8));
+        CHECK(isLive(live.getLiveIn(), X86_REG_RDI));
+
+        auto callerSummary = summaries.getSummary(caller);
+        REQUIRE(callerSummary);
+        CHECK(callerSummary->getClobbered().get(
+            RegisterBitVector::getIndex(X86_REG_RAX)));
+        CHECK(!callerSummary->getClobbered().get(
+            RegisterBitVector::getIndex(X86_REG_R10)));
+    }
+#endif
+}
+
+TEST_CASE("liveness at a tail call", "[analysis][liveness][fast]") {
+#ifdef ARCH_X86_64
+    auto leaf = makeLeaf(0x5300);
+    FunctionBuilder builder(0x5400, "tail");
+    builder.add({0x48, 0x89, 0xf7});        // mov %rsi, %rdi
+    builder.addJump("jmp", leaf);
+    auto tail = builder.get();
+
+    auto module = FunctionBuilder::makeModule({leaf, tail});
+    CompactCallGraph callGraph(module);
+    InterproceduralLiveness summaries(&callGraph);
+
+    SECTION("without a summary every argument may be read") {
+        ControlFlowGraph cfg(tail);
+        LivenessAnalysis live(tail, &cfg);
+        CHECK(isLive(live.getLiveIn(), X86_REG_RSI));
+        CHECK(isLive(live.getLiveIn(), X86_REG_R8));
+        CHECK(!isLive(live.getLiveIn(), X86_REG_RDI));
+    }
+
+    SECTION("with a summary, what the target reads and writes") {
+        auto summary = summaries.getSummary(tail);
+        REQUIRE(summary);
+        CHECK(isLive(summary->getLiveIn(), X86_REG_RSI));
+        CHECK(!isLive(summary->getLiveIn(), X86_REG_R8));
+        CHECK(!isLive(summary->getLiveIn(), X86_REG_RDI));
+        CHECK(summary->getClobbered().get(
+            RegisterBitVector::getIndex(X86_REG_RAX)));
+        CHECK(summary->getClobbered().get(
+            RegisterBitVector::getIndex(X86_REG_RDI)));
+    }
+#endif
+}
+
+TEST_CASE("liveness at an indirect jump", "[analysis][liveness][fast]") {
+#ifdef ARCH_X86_64
+    auto function = FunctionBuilder::make(0x5500, {
+        {0x4d, 0x31, 0xdb},                 // xor %r11, %r11
+        {0xff, 0xe0}                        // jmpq *%rax
+    });
+
+    ControlFlowGraph cfg(function);
+    LivenessAnalysis live(function, &cfg);
+
+    // anything may be read where this goes, except %r11: the zero idiom
+    // overwrites it without reading it
+    CHECK(isLive(live.getLiveIn(), X86_REG_RAX));
+    CHECK(isLive(live.getLiveIn(), X86_REG_R10));
+    CHECK(isLive(live.getLiveIn(), X86_REG_RBX));
+    CHECK(!isLive(live.getLiveIn(), X86_REG_R11));
+
+    auto everything = RegisterBitVector::everything();
+    everything.subtract(live.getDefined());
+    CHECK(everything.empty());
+#endif
+}
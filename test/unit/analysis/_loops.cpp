@@ -0,0 +1,148 @@
+#include "framework/include.h"
+#include "analysis/loops.h"
+#include "analysis/controlflow.h"
+#include "chunk/concrete.h"
+#include "disasm/disassemble.h"
+#include "instr/concrete.h"
+#include "operation/mutator.h"
+
+#ifdef ARCH_X86_64
+enum BlockEnd {
+    FALL,       // nop, then fall through
+    JUMP,       // jmp target
+    BRANCH,     // jne target, or fall through
+    RETURN      // retq
+};
+
+// one single-instruction block per (end, target) pair
+static Function *makeFunction(const std::vector<std::pair<BlockEnd, int>> &spec) {
+    PositionFactory *positionFactory = PositionFactory::getInstance();
+    Function *function = new Function(0x3000);
+    function->setPosition(positionFactory->makeAbsolutePosition(0x3000));
+
+    std::vector<Block *> blockList;
+    for(size_t i = 0; i < spec.size(); i ++) blockList.push_back(new Block());
+
+    Chunk *prevBlock = nullptr;
+    for(size_t i = 0; i < spec.size(); i ++) {
+        auto block = blockList[i];
+        block->setPosition(positionFactory->makePosition(
+            prevBlock, block, function->getSize()));
+        ChunkMutator(function).append(block);
+
+        Instruction *instr = nullptr;
+        switch(spec[i].first) {
+        case FALL:
+            instr = Disassemble::instruction({0x90}, true, 0);
+            break;
+        case RETURN:
+            instr = Disassemble::instruction({0xc3}, true, 0);
+            break;
+        case JUMP:
+        case BRANCH: {
+            instr = new Instruction();
+            auto semantic = (spec[i].first == JUMP)
+                ? new ControlFlowInstruction(X86_INS_JMP, instr, "\xe9", "jmp", 4)
+                : new ControlFlowInstruction(
+                    X86_INS_JNE, instr, "\x0f\x85", "jne", 4);
+            semantic->setLink(new NormalLink(blockList[spec[i].second],
+                Link::SCOPE_INTERNAL_JUMP));
+            instr->setSemantic(semantic);
+            break;
+        }
+        }
+        instr->setPosition(positionFactory->makePosition(nullptr, instr, 0));
+        ChunkMutator(block).append(instr);
+        prevBlock = block;
+    }
+    return function;
+}
+
+static Block *getBlock(Function *function, int index) {
+    return function->getChildren()->getIterable()->get(index);
+}
+#endif
+
+TEST_CASE("loop forest of nested natural loops", "[analysis][loops][fast]") {
+#ifdef ARCH_X86_64
+    Function *function = makeFunction({
+        {FALL, 0},          // 0
+        {FALL, 0},          // 1: outer header
+        {FALL, 0},          // 2: inner header
+        {BRANCH, 2},        // 3: inner latch
+        {BRANCH, 1},        // 4: outer latch
+        {RETURN, 0}         // 5
+    });
+    ControlFlowGraph cfg(function);
+    LoopForest forest(&cfg);
+
+    REQUIRE(forest.getLoopList().size() == 2);
+    REQUIRE(forest.getRootList().size() == 1);
+
+    auto outer = forest.getRootList()[0];
+    CHECK(!outer->isIrreducible());
+    CHECK(outer->getHeader() == getBlock(function, 1));
+    CHECK(outer->getBlockList().size() == 4);
+    REQUIRE(outer->getLatchList().size() == 1);
+    CHECK(outer->getLatchList()[0] == getBlock(function, 4));
+    REQUIRE(outer->getExitList().size() == 1);
+    CHECK(outer->getExitList()[0].first == getBlock(function, 4));
+    CHECK(outer->getExitList()[0].second == getBlock(function, 5));
+
+    REQUIRE(outer->getChildList().size() == 1);
+    auto inner = outer->getChildList()[0];
+    CHECK(inner->getParent() == outer);
+    CHECK(inner->getHeader() == getBlock(function, 2));
+    CHECK(inner->getDepth() == 2);
+    CHECK(inner->contains(getBlock(function, 3)));
+    CHECK(!inner->contains(getBlock(function, 4)));
+
+    CHECK(forest.getDepth(getBlock(function, 0)) == 0);
+    CHECK(forest.getDepth(getBlock(function, 1)) == 1);
+    CHECK(forest.getDepth(getBlock(function, 3)) == 2);
+    CHECK(forest.getLoopFor(getBlock(function, 4)) == outer);
+    CHECK(forest.getLoopFor(getBlock(function, 5)) == nullptr);
+    CHECK(forest.isHeader(getBlock(function, 1)));
+    CHECK(forest.isHeader(getBlock(function, 2)));
+    CHECK(!forest.isHeader(getBlock(function, 3)));
+#endif
+}
+
+TEST_CASE("loop forest of an irreducible loop", "[analysis][loops][fast]") {
+#ifdef ARCH_X86_64
+    Function *function = makeFunction({
+        {BRANCH, 2},        // 0: enters at 1 or 2
+        {FALL, 0},          // 1
+        {BRANCH, 1},        // 2
+        {RETURN, 0}         // 3
+    });
+    ControlFlowGraph cfg(function);
+    LoopForest forest(&cfg);
+
+    REQUIRE(forest.getLoopList().size() == 1);
+    auto loop = forest.getLoopList()[0];
+    CHECK(loop->isIrreducible());
+    CHECK(loop->getHeaderList().size() == 2);
+    CHECK(loop->getBlockList().size() == 2);
+    CHECK(loop->getChildList().empty());
+#endif
+}
+
+TEST_CASE("loop forest of a self loop", "[analysis][loops][fast]") {
+#ifdef ARCH_X86_64
+    Function *function = makeFunction({
+        {FALL, 0},          // 0
+        {BRANCH, 1},        // 1: jumps to itself
+        {RETURN, 0}         // 2
+    });
+    ControlFlowGraph cfg(function);
+    LoopForest forest(&cfg);
+
+    REQUIRE(forest.getLoopList().size() == 1);
+    auto loop = forest.getLoopList()[0];
+    CHECK(!loop->isIrreducible());
+    CHECK(loop->getHeader() == getBlock(function, 1));
+    CHECK(loop->getLatchList().size() == 1);
+    CHECK(loop->getBlockList().size() == 1);
+#endif
+}
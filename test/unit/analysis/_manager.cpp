@@ -0,0 +1,48 @@
+#include "framework/include.h"
+#include "FunctionBuilder.h"
+#include "analysis/manager.h"
+#include "analysis/controlflow.h"
+#include "analysis/usedef.h"
+#include "chunk/concrete.h"
+
+TEST_CASE("pinned analyses outlive invalidation", "[analysis][fast][x86_64]") {
+#ifdef ARCH_X86_64
+    FunctionBuilder builder(0x1000, "f");
+    builder.startBlock();
+    builder.add({0x48, 0x85, 0xff});            // test %rdi, %rdi
+    auto branch = builder.addJump("je");
+    builder.startBlock();
+    builder.add({0x48, 0x89, 0xf8});            // mov %rdi, %rax
+    auto exit = builder.startBlock();
+    builder.add({0xc3});                        // retq
+    FunctionBuilder::setTarget(branch, exit);
+    auto function = builder.get();
+
+    auto manager = AnalysisManager::getInstance();
+
+    SECTION("a pinned graph is replaced but not freed") {
+        auto cfg = manager->getControlFlowGraph(function);
+        AnalysisManager::Pin pin(ANALYSIS_CONTROL_FLOW, function);
+
+        manager->invalidate(function);
+        auto fresh = manager->getControlFlowGraph(function);
+        CHECK(fresh != cfg);
+        CHECK(cfg->getCount() == 3);
+        CHECK(manager->getControlFlowGraph(function) == fresh);
+    }
+
+    SECTION("a pinned use-def keeps its graph") {
+        auto working = manager->getUseDef(function);
+        AnalysisManager::Pin pin(ANALYSIS_USE_DEF, function);
+
+        manager->invalidate(function);
+        auto fresh = manager->getUseDef(function);
+        CHECK(fresh != working);
+        CHECK(fresh->getCFG() != working->getCFG());
+        CHECK(working->getCFG()->getCount() == 3);
+    }
+
+    manager->invalidate(function);
+    CHECK(!manager->isCached(ANALYSIS_CONTROL_FLOW, function));
+#endif
+}
@@ -0,0 +1,74 @@
+#include <algorithm>
+#include "framework/include.h"
+#include "FunctionBuilder.h"
+#include "analysis/scratch.h"
+#include "chunk/concrete.h"
+
+TEST_CASE("scratch registers in a leaf function", "[analysis][liveness][fast]") {
+#ifdef ARCH_X86_64
+    Function *function = FunctionBuilder::make(0x2000, {
+        {0x48, 0x89, 0xf8},                 // mov %rdi, %rax
+        {0x48, 0x83, 0xc0, 0x01},           // add $0x1, %rax
+        {0xc3}                              // retq
+    });
+    auto block = function->getChildren()->getIterable()->get(0);
+    auto mov = block->getChildren()->getIterable()->get(0);
+    auto ret = block->getChildren()->getIterable()->get(2);
+
+    ScratchRegisters scratch(function);
+
+    // rax is overwritten before it is read; rdi is the argument
+    CHECK(scratch.isDead(mov, X86_REG_RAX));
+    CHECK(!scratch.isDead(mov, X86_REG_RDI));
+    CHECK(scratch.isDead(mov, X86_REG_R10));
+    CHECK(scratch.areFlagsDead(mov));
+
+    // the return value and callee-saved registers are live at the return
+    CHECK(!scratch.isDead(ret, X86_REG_RAX));
+    CHECK(!scratch.isDead(ret, X86_REG_RBX));
+    CHECK(scratch.isDead(ret, X86_REG_R11));
+
+    // never hand out the stack pointer
+    CHECK(!scratch.isDead(mov, X86_REG_RSP));
+
+    auto dead = scratch.getDeadRegisters(mov);
+    REQUIRE(!dead.empty());
+    CHECK(dead[0] == X86_REG_RAX);
+    CHECK(std::find(dead.begin(), dead.end(), X86_REG_RDI) == dead.end());
+
+    CHECK(scratch.findScratch(ret, {X86_REG_RAX, X86_REG_R11})
+        == X86_REG_R11);
+    CHECK(scratch.findScratch(ret, {X86_REG_RAX, X86_REG_RBX})
+        == INVALID_REGISTER);
+#endif
+}
+
+TEST_CASE("scratch registers across blocks", "[analysis][liveness][fast]") {
+#ifdef ARCH_X86_64
+    FunctionBuilder builder(0x2100);
+    builder.startBlock();
+    auto test = builder.add({0x48, 0x85, 0xff});    // test %rdi, %rdi
+    auto je = builder.addJump("je");
+    builder.startBlock();
+    auto movSI = builder.add({0x48, 0x89, 0xf0});   // mov %rsi, %rax
+    builder.add({0xc3});                            // retq
+    auto target = builder.startBlock();
+    builder.add({0x48, 0x89, 0xd0});                // mov %rdx, %rax
+    builder.add({0xc3});                            // retq
+    FunctionBuilder::setTarget(je, target);
+
+    ScratchRegisters scratch(builder.get());
+
+    // each path reads one argument, and both overwrite %rax before use
+    CHECK(!scratch.isDead(test, X86_REG_RSI));
+    CHECK(!scratch.isDead(test, X86_REG_RDX));
+    CHECK(scratch.isDead(test, X86_REG_RAX));
+    CHECK(scratch.isDead(test, X86_REG_RCX));
+    CHECK(!scratch.isDead(movSI, X86_REG_RSI));
+    CHECK(scratch.isDead(movSI, X86_REG_RDX));
+
+    // the flags set by test are read by the branch
+    CHECK(scratch.areFlagsDead(test));
+    CHECK(!scratch.areFlagsDead(je));
+#endif
+}
@@ -0,0 +1,26 @@
+#include "framework/include.h"
+#include "FunctionBuilder.h"
+#include "operation/findbytes.h"
+
+TEST_CASE("find bytes in a function's current instructions",
+    "[chunk][fast][x86_64]") {
+
+#ifdef ARCH_X86_64
+    FunctionBuilder builder(0x8000);
+    auto first = builder.add({0xf3, 0x0f, 0x1e, 0xfa});    // endbr64
+    // mov $0xfa1e0ff3, %eax holds the pattern, but does not start with it
+    builder.add({0xb8, 0xf3, 0x0f, 0x1e, 0xfa});
+    auto jump = builder.addJump("jmp");
+    auto target = builder.startBlock();
+    FunctionBuilder::setTarget(jump, target);
+    auto second = builder.add({0xf3, 0x0f, 0x1e, 0xfa});   // endbr64
+    builder.add({0xc3});                                    // retq
+
+    auto found = ChunkFindBytes("\xf3\x0f\x1e\xfa").find(builder.get());
+    REQUIRE(found.size() == 2);
+    CHECK(found[0] == first);
+    CHECK(found[1] == second);
+
+    CHECK(ChunkFindBytes("\x0f\x05").find(builder.get()).empty());
+#endif
+}
@@ -0,0 +1,59 @@
+#include <cstring>
+#include "framework/include.h"
+#include "FunctionBuilder.h"
+#include "pass/blockreorder.h"
+#include "chunk/concrete.h"
+#include "instr/concrete.h"
+#include "instr/writer.h"
+
+TEST_CASE("jumps into a split-off cold part are external and near",
+    "[pass][fast][x86_64]") {
+
+#ifdef ARCH_X86_64
+    FunctionBuilder builder(0x4000, "f");
+    builder.startBlock();
+    builder.add({0x48, 0x85, 0xff});            // test %rdi, %rdi
+    auto branch = builder.addJump("je", nullptr, 1);
+    builder.startBlock();
+    builder.add({0xb8, 0x01, 0x00, 0x00, 0x00});    // mov $1, %eax
+    builder.add({0xc3});                        // retq
+    auto taken = builder.startBlock();
+    builder.add({0x31, 0xc0});                  // xor %eax, %eax
+    builder.add({0xc3});                        // retq
+    FunctionBuilder::setTarget(branch, taken);
+
+    auto function = builder.get();
+    auto module = FunctionBuilder::makeModule({function});
+
+    // the fall-through block never runs, so it is split off and the
+    // short je is inverted to reach it
+    BlockReorderPass reorder;
+    reorder.setProfile(function, {{0, 10}, {5, 0}, {11, 10}},
+        {{{0, 11}, 10}});
+    module->getFunctionList()->accept(&reorder);
+
+    REQUIRE(reorder.getColdList().size() == 1);
+    auto cold = reorder.getColdList()[0];
+    CHECK(cold->getName() == "f.cold");
+    CHECK(function->getChildren()->getIterable()->getCount() == 2);
+
+    auto cfi = dynamic_cast<ControlFlowInstruction *>(branch->getSemantic());
+    REQUIRE(cfi);
+    CHECK(cfi->getMnemonic() == "jne");
+    CHECK(cfi->getDisplacementSize() == 4);
+    CHECK(cfi->getLink()->getScope() == Link::SCOPE_EXTERNAL_JUMP);
+    CHECK(function->getSize() == 3 + 6 + 3);
+
+    // cold code is placed after all hot functions, well beyond rel8 range
+    cold->getPosition()->set(0x5000);
+
+    InstrWriterGetData writer;
+    cfi->accept(&writer);
+    auto data = writer.get();
+    REQUIRE(data.size() == 6);
+    CHECK(data.substr(0, 2) == "\x0f\x85");
+    int32_t displacement;
+    std::memcpy(&displacement, data.data() + 2, 4);
+    CHECK(branch->getAddress() + 6 + displacement == 0x5000);
+#endif
+}
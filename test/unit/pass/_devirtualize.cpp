@@ -0,0 +1,58 @@
+#include "framework/include.h"
+#include "FunctionBuilder.h"
+#include "pass/devirtualize.h"
+#include "analysis/manager.h"
+#include "chunk/concrete.h"
+#include "instr/concrete.h"
+
+TEST_CASE("devirtualize calls and jumps with one target",
+    "[pass][fast][x86_64]") {
+
+#ifdef ARCH_X86_64
+    FunctionBuilder target(0x7000, "target");
+    target.add({0xc3});                             // retq
+
+    // lea target(%rip), %rax; callq *%rax; lea target(%rip), %rax;
+    // jmpq *%rax
+    FunctionBuilder caller(0x7100, "caller");
+    caller.addLinked({0x48, 0x8d, 0x05, 0x00, 0x00, 0x00, 0x00},
+        new NormalLink(target.get(), Link::SCOPE_WITHIN_MODULE));
+    auto call = caller.add({0xff, 0xd0});
+    caller.addLinked({0x48, 0x8d, 0x05, 0x00, 0x00, 0x00, 0x00},
+        new NormalLink(target.get(), Link::SCOPE_WITHIN_MODULE));
+    auto jump = caller.add({0xff, 0xe0});
+
+    // nothing is known about %rdi here
+    FunctionBuilder other(0x7200, "other");
+    auto unresolved = other.add({0xff, 0xd7});      // callq *%rdi
+    other.add({0xc3});                              // retq
+
+    auto module = FunctionBuilder::makeModule(
+        {target.get(), caller.get(), other.get()});
+    auto program = FunctionBuilder::makeProgram({module});
+    size_t callerSize = caller.get()->getSize();
+
+    DevirtualizePass devirtualize;
+    program->accept(&devirtualize);
+
+    // the Instructions are kept, since links may point at them
+    auto cfi = dynamic_cast<ControlFlowInstruction *>(call->getSemantic());
+    REQUIRE(cfi);
+    CHECK(cfi->getMnemonic() == "callq");
+    CHECK(&*cfi->getLink()->getTarget() == target.get());
+    CHECK(cfi->returns());
+
+    cfi = dynamic_cast<ControlFlowInstruction *>(jump->getSemantic());
+    REQUIRE(cfi);
+    CHECK(cfi->getMnemonic() == "jmp");
+    CHECK(&*cfi->getLink()->getTarget() == target.get());
+
+    // two bytes each became five
+    CHECK(caller.get()->getSize() == callerSize + 6);
+    CHECK(caller.getBlock()->getSize() == callerSize + 6);
+
+    CHECK(dynamic_cast<IndirectCallInstruction *>(
+        unresolved->getSemantic()));
+    CHECK(other.get()->getSize() == 3);
+#endif
+}
@@ -0,0 +1,88 @@
+#include <typeinfo>
+#include "framework/include.h"
+#include "FunctionBuilder.h"
+#include "pass/inlinecalls.h"
+#include "chunk/concrete.h"
+#include "instr/concrete.h"
+
+#ifdef ARCH_X86_64
+static Function *makeLeaf(address_t address, const std::string &name,
+    const std::vector<unsigned char> &bytes) {
+
+    FunctionBuilder builder(address, name);
+    builder.add(bytes);
+    builder.add({0xc3});                    // retq
+    return builder.get();
+}
+#endif
+
+TEST_CASE("inline small leaf functions from other modules",
+    "[pass][fast][x86_64]") {
+
+#ifdef ARCH_X86_64
+    // lea data(%rip), %rax; add %rdi, %rax; retq
+    FunctionBuilder leaf(0x9000, "leaf");
+    auto dataLink = new DataOffsetLink(nullptr, 0x9800);
+    dataLink->setAddend(8);
+    leaf.addLinked({0x48, 0x8d, 0x05, 0x00, 0x00, 0x00, 0x00}, dataLink);
+    leaf.add({0x48, 0x01, 0xf8});
+    leaf.add({0xc3});
+
+    // mov (%rsp), %rax; retq
+    auto stack = makeLeaf(0x9100, "stack", {0x48, 0x8b, 0x04, 0x24});
+    // mov 0x0(%rip), %rax without a link; retq
+    auto rip = makeLeaf(0x9200, "rip",
+        {0x48, 0x8b, 0x05, 0x00, 0x00, 0x00, 0x00});
+
+    // mov %rsi, %rdi; callq leaf; callq stack; callq rip; retq
+    FunctionBuilder caller(0xa000, "caller");
+    caller.add({0x48, 0x89, 0xf7});
+    auto call = caller.addJump("callq", leaf.get());
+    auto stackCall = caller.addJump("callq", stack);
+    auto ripCall = caller.addJump("callq", rip);
+    caller.add({0xc3});
+
+    auto library = FunctionBuilder::makeModule({leaf.get(), stack, rip},
+        "module-library");
+    auto main = FunctionBuilder::makeModule({caller.get()});
+    auto program = FunctionBuilder::makeProgram({main, library});
+
+    InlineCallsPass inlineCalls;
+    program->accept(&inlineCalls);
+    CHECK(inlineCalls.getInlinedCount() == 1);
+
+    // the call's Instruction is kept, now holding the copied lea
+    auto list = caller.getBlock()->getChildren()->getIterable();
+    REQUIRE(list->getCount() == 6);
+    CHECK(list->get(1) == call);
+    auto linked = dynamic_cast<LinkedInstruction *>(call->getSemantic());
+    REQUIRE(linked);
+    CHECK(linked->getIndex() == 0);
+    CHECK(typeid(*list->get(2)->getSemantic()) == typeid(IsolatedInstruction));
+    CHECK(caller.get()->getSize() == 3 + 7 + 3 + 5 + 5 + 1);
+
+    // the data link is copied, not shared with the callee
+    auto link = linked->getLink();
+    REQUIRE(link);
+    CHECK(link != dataLink);
+    REQUIRE(typeid(*link) == typeid(DataOffsetLink));
+    CHECK(static_cast<DataOffsetLink *>(link)->getAddend() == 8);
+
+    // stack and unlinked RIP-relative bodies are left as calls
+    CHECK(list->get(3) == stackCall);
+    CHECK(list->get(4) == ripCall);
+    for(auto instr : {stackCall, ripCall}) {
+        auto cfi = dynamic_cast<ControlFlowInstruction *>(
+            instr->getSemantic());
+        REQUIRE(cfi);
+        CHECK(cfi->getMnemonic() == "callq");
+    }
+
+    // no call to leaf remains anywhere in the caller
+    for(auto instr : CIter::children(caller.getBlock())) {
+        auto cfi = dynamic_cast<ControlFlowInstruction *>(
+            instr->getSemantic());
+        if(cfi) CHECK(&*cfi->getLink()->getTarget() != leaf.get());
+    }
+#endif
+}
@@ -0,0 +1,84 @@
+#include "framework/include.h"
+#include "pass/jumpthread.h"
+#include "chunk/concrete.h"
+#include "instr/concrete.h"
+#include "disasm/disassemble.h"
+#include "operation/mutator.h"
+
+#ifdef ARCH_X86_64
+static Block *addBlock(Function *function) {
+    Block *block = new Block();
+    ChunkMutator(function).append(block);
+    return block;
+}
+
+static Instruction *addJump(Block *block, Chunk *target) {
+    auto instr = new Instruction();
+    auto semantic = new ControlFlowInstruction(
+        X86_INS_JMP, instr, "\xe9", "jmp", 4);
+    semantic->setLink(new NormalLink(target, Link::SCOPE_INTERNAL_JUMP));
+    instr->setSemantic(semantic);
+    ChunkMutator(block).append(instr);
+    return instr;
+}
+#endif
+
+TEST_CASE("jumps threaded through trampolines and tails duplicated",
+    "[pass][fast][x86_64]") {
+
+#ifdef ARCH_X86_64
+    Function *function = new Function(0x4000);
+    function->setPosition(
+        PositionFactory::getInstance()->makeAbsolutePosition(0x4000));
+
+    auto entry = addBlock(function);
+    auto trampoline = addBlock(function);
+    auto tail = addBlock(function);
+    ChunkMutator(tail).append(Disassemble::instruction(
+        {0x48, 0x89, 0xf8}, true, 0));      // mov %rdi, %rax
+    ChunkMutator(tail).append(Disassemble::instruction(
+        {0xc3}, true, 0));                  // retq
+    addJump(trampoline, tail->getChildren()->getIterable()->get(0));
+    auto jump = addJump(entry, trampoline);
+
+    JumpThreadPass jumpThread;
+    function->accept(&jumpThread);
+    CHECK(jumpThread.getThreadedCount() == 1);
+    CHECK(jumpThread.getDuplicatedCount() == 2);
+
+    // the jump's Instruction is kept, now holding the copied mov
+    auto list = entry->getChildren()->getIterable();
+    REQUIRE(list->getCount() == 2);
+    CHECK(list->get(0) == jump);
+    CHECK(!jump->getSemantic()->isControlFlow());
+    CHECK(dynamic_cast<ReturnInstruction *>(list->get(1)->getSemantic()));
+    CHECK(trampoline->getChildren()->getIterable()->getCount() == 2);
+    CHECK(tail->getChildren()->getIterable()->getCount() == 2);
+    CHECK(function->getSize() == 12);
+#endif
+}
+
+TEST_CASE("tails with RIP-relative operands are not duplicated",
+    "[pass][fast][x86_64]") {
+
+#ifdef ARCH_X86_64
+    Function *function = new Function(0x4100);
+    function->setPosition(
+        PositionFactory::getInstance()->makeAbsolutePosition(0x4100));
+
+    auto entry = addBlock(function);
+    auto tail = addBlock(function);
+    // mov 0x0(%rip), %rax, which has no link to keep it correct
+    ChunkMutator(tail).append(Disassemble::instruction(
+        {0x48, 0x8b, 0x05, 0x00, 0x00, 0x00, 0x00}, true, 0));
+    ChunkMutator(tail).append(Disassemble::instruction(
+        {0xc3}, true, 0));              // retq
+    auto jump = addJump(entry, tail);
+
+    JumpThreadPass jumpThread;
+    function->accept(&jumpThread);
+    CHECK(jumpThread.getDuplicatedCount() == 0);
+    CHECK(jump->getSemantic()->isControlFlow());
+    CHECK(entry->getChildren()->getIterable()->getCount() == 1);
+#endif
+}
@@ -0,0 +1,89 @@
+#include "framework/include.h"
+#include "FunctionBuilder.h"
+#include "pass/peephole.h"
+#include "chunk/concrete.h"
+#include "instr/semantic.h"
+
+TEST_CASE("peephole removes redundant instructions", "[pass][fast][x86_64]") {
+#ifdef ARCH_X86_64
+    Function *function = FunctionBuilder::make(0x2000, {
+        {0x48, 0x89, 0xf8},                 // mov %rdi, %rax
+        {0x53},                             // push %rbx
+        {0x48, 0x89, 0xf9},                 // mov %rdi, %rcx
+        {0x5b},                             // pop %rbx
+        {0x48, 0x89, 0xc0},                 // mov %rax, %rax
+        {0xc3}                              // retq
+    });
+    auto block = function->getChildren()->getIterable()->get(0);
+
+    PeepholePass peephole;
+    function->accept(&peephole);
+
+    // the mov into %rcx is dead once the push and pop are gone
+    CHECK(peephole.getCountMap().at("push-pop") == 2);
+    CHECK(peephole.getCountMap().at("dead-move") == 1);
+    CHECK(peephole.getCountMap().at("self-move") == 1);
+    CHECK(peephole.getTotalCount() == 4);
+
+    REQUIRE(block->getChildren()->getIterable()->getCount() == 2);
+    CHECK(block->getSize() == 4);
+    CHECK(function->getSize() == 4);
+#endif
+}
+
+TEST_CASE("peephole shortens a chain of moves", "[pass][fast][x86_64]") {
+#ifdef ARCH_X86_64
+    Function *function = FunctionBuilder::make(0x2000, {
+        {0x48, 0x89, 0xfe},                 // mov %rdi, %rsi
+        {0x48, 0x89, 0xf0},                 // mov %rsi, %rax
+        {0xc3}                              // retq
+    });
+    auto block = function->getChildren()->getIterable()->get(0);
+
+    PeepholePass peephole;
+    function->accept(&peephole);
+
+    CHECK(peephole.getCountMap().at("move-chain") == 1);
+    CHECK(peephole.getTotalCount() == 1);
+
+    // %rsi is not read again, so this becomes mov %rdi, %rax
+    REQUIRE(block->getChildren()->getIterable()->getCount() == 2);
+    auto mov = block->getChildren()->getIterable()->get(0);
+    CHECK(mov->getSemantic()->getData() == std::string("\x48\x89\xf8", 3));
+#endif
+}
+
+TEST_CASE("peephole across blocks and at jump targets",
+    "[pass][fast][x86_64]") {
+
+#ifdef ARCH_X86_64
+    FunctionBuilder builder(0x2000);
+    builder.add({0x48, 0x85, 0xff});                // test %rdi, %rdi
+    auto je = builder.addJump("je");
+    auto middle = builder.startBlock();
+    builder.add({0x48, 0x89, 0xf9});                // mov %rdi, %rcx
+    auto target = builder.startBlock();
+    FunctionBuilder::setTarget(je, target);
+    auto first = builder.add({0x48, 0x89, 0xc0});   // mov %rax, %rax
+    builder.add({0x49, 0x89, 0xf0});                // mov %rsi, %r8
+    builder.add({0xc3});                            // retq
+
+    PeepholePass peephole;
+    builder.get()->accept(&peephole);
+
+    // %rcx is dead after its block, but the move is the block's only
+    // instruction, so there is no semantic to move into it
+    CHECK(middle->getChildren()->getIterable()->getCount() == 1);
+    CHECK(peephole.getCountMap().at("self-move") == 1);
+    CHECK(peephole.getCountMap().at("dead-move") == 1);
+    CHECK(peephole.getTotalCount() == 2);
+
+    // the jump target keeps its Instruction, now holding the retq
+    auto list = target->getChildren()->getIterable();
+    REQUIRE(list->getCount() == 1);
+    CHECK(list->get(0) == first);
+    CHECK(dynamic_cast<ReturnInstruction *>(first->getSemantic()));
+    CHECK(&*je->getSemantic()->getLink()->getTarget() == target);
+    CHECK(builder.get()->getSize() == 3 + 6 + 3 + 1);
+#endif
+}
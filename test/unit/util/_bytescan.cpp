@@ -0,0 +1,71 @@
+#include <string>
+#include <vector>
+#include "framework/include.h"
+#include "util/bytescan.h"
+
+static std::vector<size_t> naiveFind(const std::string &data,
+    const std::string &pattern) {
+
+    std::vector<size_t> result;
+    for(size_t i = 0; i + pattern.size() <= data.size(); i ++) {
+        if(data.compare(i, pattern.size(), pattern) == 0) result.push_back(i);
+    }
+    return result;
+}
+
+static const ByteScanner::Engine engineList[] = {
+    ByteScanner::ENGINE_SCALAR,
+    ByteScanner::ENGINE_SSE2,
+    ByteScanner::ENGINE_AVX2
+};
+
+TEST_CASE("byte scanner finds patterns with every engine", "[util][fast]") {
+    // long enough to exercise the vector loops and the scalar tail
+    std::string data;
+    for(int i = 0; i < 300; i ++) {
+        data.push_back(static_cast<char>((i * 37) & 0xff));
+        if(i % 41 == 0) data += std::string("\xf3\x0f\x1e\xfa", 4);
+    }
+    data += std::string("\x0f\x05\x0f\x05\x0f", 5);
+
+    const std::string patternList[] = {
+        std::string("\xf3\x0f\x1e\xfa", 4),
+        std::string("\x0f\x05", 2),
+        std::string("\x0f", 1),
+        std::string("\x0f\x05\x0f", 3)     // overlapping matches
+    };
+    for(const auto &pattern : patternList) {
+        auto expected = naiveFind(data, pattern);
+        for(auto engine : engineList) {
+            ByteScanner scanner(pattern, engine);
+            CHECK(scanner.findAll(data.c_str(), data.size()) == expected);
+        }
+    }
+}
+
+TEST_CASE("byte scanner finds runs with every engine", "[util][fast]") {
+    std::string data(100, '\x90');
+    data.replace(3, 1, "\xc3");
+    data.replace(40, 2, "\x31\xc0");
+    data += std::string(3, '\xcc');
+
+    for(auto engine : engineList) {
+        auto runs = ByteScanner::findRuns(data.c_str(), data.size(), '\x90',
+            2, engine);
+        REQUIRE(runs.size() == 3);
+        CHECK(runs[0] == ByteScanner::Run(0, 3));
+        CHECK(runs[1] == ByteScanner::Run(4, 36));
+        CHECK(runs[2] == ByteScanner::Run(42, 58));
+
+        auto single = ByteScanner::findRuns(data.c_str(), data.size(), '\xcc',
+            4, engine);
+        CHECK(single.empty());
+    }
+}
+
+TEST_CASE("byte scanner parses hex", "[util][fast]") {
+    CHECK(ByteScanner::parseHex("f30f1efa") == std::string("\xf3\x0f\x1e\xfa"));
+    CHECK(ByteScanner::parseHex("0F 05") == std::string("\x0f\x05"));
+    CHECK(ByteScanner::parseHex("0f0").empty());
+    CHECK(ByteScanner::parseHex("zz").empty());
+}
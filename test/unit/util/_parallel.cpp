@@ -0,0 +1,70 @@
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "framework/include.h"
+#include "util/parallel.h"
+
+TEST_CASE("parallelFor runs every index once", "[util][fast]") {
+    const size_t count = 1000;
+    for(unsigned threads : {0u, 1u, 4u, 64u}) {
+        CAPTURE(threads);
+        std::vector<std::atomic<int>> seen(count);
+        for(auto &s : seen) s = 0;
+        std::vector<size_t> result(count, 0);
+
+        parallelFor(count, threads, [&] (size_t i) {
+            seen[i] ++;
+            result[i] = i * i;
+        });
+
+        // all calls have finished, and slot i holds the result for i
+        for(size_t i = 0; i < count; i ++) {
+            CHECK(seen[i] == 1);
+            CHECK(result[i] == i * i);
+        }
+    }
+
+    // nothing to do
+    parallelFor(0, 4, [] (size_t i) { FAIL("called with no indices"); });
+}
+
+TEST_CASE("parallelFor with one worker runs in order", "[util][fast]") {
+    std::vector<size_t> order;
+    auto caller = std::this_thread::get_id();
+    bool sameThread = true;
+    parallelFor(100, 1, [&] (size_t i) {
+        order.push_back(i);
+        if(std::this_thread::get_id() != caller) sameThread = false;
+    });
+    REQUIRE(order.size() == 100);
+    for(size_t i = 0; i < order.size(); i ++) CHECK(order[i] == i);
+    CHECK(sameThread);
+}
+
+TEST_CASE("parallelFor rethrows the first exception", "[util][fast]") {
+    for(unsigned threads : {1u, 4u}) {
+        CAPTURE(threads);
+        std::atomic<size_t> calls(0);
+        bool caught = false;
+        try {
+            parallelFor(10000, threads, [&] (size_t i) {
+                calls ++;
+                if(i == 10) throw "bad index";
+            });
+        }
+        catch(const char *message) {
+            caught = true;
+            CHECK(std::string(message) == "bad index");
+        }
+        CHECK(caught);
+
+        // the remaining indices are skipped
+        CHECK(calls < 10000);
+        if(threads == 1) CHECK(calls == 11);
+    }
+
+    CHECK_THROWS_AS(parallelFor(100, 4, [] (size_t i) {
+        if(i % 7 == 3) throw std::runtime_error("every worker throws");
+    }), const std::runtime_error &);
+}